@@ -0,0 +1,131 @@
+/* Boot stage timing
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "boot_timing.h"
+
+static const char *BOOT_TIMING_TAG = "boot";
+
+#define BOOT_TIMING_POLL_MS (50)
+
+static const char *const stage_names[BOOT_STAGE_MAX] = {
+    [BOOT_STAGE_GNSS] = "gnss",
+    [BOOT_STAGE_MAG] = "mag",
+    [BOOT_STAGE_NVS] = "nvs",
+    [BOOT_STAGE_SETTINGS] = "settings",
+    [BOOT_STAGE_WIFI] = "wifi",
+    [BOOT_STAGE_HTTPD] = "httpd",
+    [BOOT_STAGE_TRACK] = "track",
+    [BOOT_STAGE_CONTROL] = "control",
+    [BOOT_FIRST_SENTENCE] = "first_sentence",
+    [BOOT_FIRST_FIX] = "first_fix",
+    [BOOT_FIRST_CONTROL_OUTPUT] = "first_control_output",
+};
+
+static int64_t begin_us[BOOT_STAGE_MAX];
+static int64_t end_us[BOOT_STAGE_MAX];
+/* A bit per stage: claimed by the first caller, then published once the time is written */
+static atomic_uint begin_claimed;
+static atomic_uint end_claimed;
+static atomic_uint begun;
+static atomic_uint ended;
+
+void boot_timing_begin(boot_stage_t stage)
+{
+    const unsigned bit = 1u << stage;
+    if (atomic_fetch_or(&begin_claimed, bit) & bit) {
+        return;
+    }
+    begin_us[stage] = esp_timer_get_time();
+    atomic_fetch_or_explicit(&begun, bit, memory_order_release);
+}
+
+void boot_timing_end_at(boot_stage_t stage, int64_t time_us)
+{
+    const unsigned bit = 1u << stage;
+    if (atomic_load_explicit(&ended, memory_order_relaxed) & bit) {
+        return;
+    }
+    if (atomic_fetch_or(&end_claimed, bit) & bit) {
+        return;
+    }
+    end_us[stage] = time_us;
+    atomic_fetch_or_explicit(&ended, bit, memory_order_release);
+}
+
+void boot_timing_end(boot_stage_t stage)
+{
+    /* Checked first so the control loop doesn't read the clock on every call */
+    if (!(atomic_load_explicit(&ended, memory_order_relaxed) & (1u << stage))) {
+        boot_timing_end_at(stage, esp_timer_get_time());
+    }
+}
+
+bool boot_timing_reached(boot_stage_t stage)
+{
+    return atomic_load_explicit(&ended, memory_order_acquire) & (1u << stage);
+}
+
+bool boot_timing_wait(boot_stage_t stage, uint32_t timeout_ms)
+{
+    for (uint32_t waited = 0; !boot_timing_reached(stage); waited += BOOT_TIMING_POLL_MS) {
+        if (waited >= timeout_ms) {
+            return false;
+        }
+        vTaskDelay(pdMS_TO_TICKS(BOOT_TIMING_POLL_MS));
+    }
+    return true;
+}
+
+int boot_timing_format(char *buf, size_t size)
+{
+    const unsigned have_begin = atomic_load_explicit(&begun, memory_order_acquire);
+    const unsigned have_end = atomic_load_explicit(&ended, memory_order_acquire);
+    int n = 0;
+
+    if (size > 0) {
+        buf[0] = '\0';
+    }
+    for (int i = 0; i < BOOT_STAGE_MAX && n < (int)size; i++) {
+        const unsigned bit = 1u << i;
+        if (!(have_end & bit)) {
+            continue;
+        }
+        if (have_begin & bit) {
+            n += snprintf(buf + n, size - n, "boot_%s_start_us %lld\nboot_%s_us %lld\n",
+                          stage_names[i], (long long)begin_us[i], stage_names[i], (long long)(end_us[i] - begin_us[i]));
+        } else {
+            n += snprintf(buf + n, size - n, "boot_%s_us %lld\n", stage_names[i], (long long)end_us[i]);
+        }
+    }
+    return n;
+}
+
+void boot_timing_log(void)
+{
+    const unsigned have_begin = atomic_load_explicit(&begun, memory_order_acquire);
+    const unsigned have_end = atomic_load_explicit(&ended, memory_order_acquire);
+
+    for (int i = 0; i < BOOT_STAGE_MAX; i++) {
+        const unsigned bit = 1u << i;
+        if (!(have_end & bit)) {
+            ESP_LOGI(BOOT_TIMING_TAG, "%-20s not reached", stage_names[i]);
+        } else if (have_begin & bit) {
+            ESP_LOGI(BOOT_TIMING_TAG, "%-20s %7lld us, done at %7lld us", stage_names[i],
+                     (long long)(end_us[i] - begin_us[i]), (long long)end_us[i]);
+        } else {
+            ESP_LOGI(BOOT_TIMING_TAG, "%-20s at %7lld us", stage_names[i], (long long)end_us[i]);
+        }
+    }
+}
@@ -0,0 +1,101 @@
+/* Boot stage timing
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Init stages and milestones, in the order they are reported
+ *
+ */
+typedef enum {
+    BOOT_STAGE_GNSS,            /*!< NMEA parser and GNSS UART */
+    BOOT_STAGE_MAG,             /*!< Magnetometer */
+    BOOT_STAGE_NVS,             /*!< NVS flash */
+    BOOT_STAGE_SETTINGS,        /*!< Settings, route and geofence restore */
+    BOOT_STAGE_WIFI,            /*!< Netif and WiFi access point */
+    BOOT_STAGE_HTTPD,           /*!< Webserver */
+    BOOT_STAGE_TRACK,           /*!< Track log scan */
+    BOOT_STAGE_CONTROL,         /*!< Motor outputs and control task */
+    BOOT_FIRST_SENTENCE,        /*!< First NMEA sentence with a good checksum */
+    BOOT_FIRST_FIX,             /*!< First position fix */
+    BOOT_FIRST_CONTROL_OUTPUT,  /*!< First motor command from the station keeping controller */
+    BOOT_STAGE_MAX,
+} boot_stage_t;
+
+/**
+ * @brief Record the start of a stage, only the first call counts
+ *
+ * @param stage stage
+ */
+void boot_timing_begin(boot_stage_t stage);
+
+/**
+ * @brief Record the end of a stage, only the first call counts
+ *
+ * Milestones have no duration, they only need this call. Cheap enough for the control loop, and safe from
+ * any task.
+ *
+ * @param stage stage or milestone
+ */
+void boot_timing_end(boot_stage_t stage);
+
+/**
+ * @brief Record a milestone at a time taken earlier, only the first call counts
+ *
+ * @param stage milestone
+ * @param time_us esp_timer time
+ */
+void boot_timing_end_at(boot_stage_t stage, int64_t time_us);
+
+/**
+ * @brief Check whether a stage or milestone has been reached
+ *
+ * @param stage stage or milestone
+ * @return true once boot_timing_end has been called for it
+ */
+bool boot_timing_reached(boot_stage_t stage);
+
+/**
+ * @brief Block until a stage or milestone is reached
+ *
+ * @param stage stage or milestone
+ * @param timeout_ms longest wait
+ * @return true if it was reached in time
+ */
+bool boot_timing_wait(boot_stage_t stage, uint32_t timeout_ms);
+
+/**
+ * @brief Write the timings as "name value" lines, in microseconds since the app started
+ *
+ * Each stage gives boot_<stage>_start_us and boot_<stage>_us (duration), each milestone gives
+ * boot_<milestone>_us. Stages and milestones not reached yet are left out.
+ *
+ * @param buf output buffer
+ * @param size size of buf
+ * @return int characters written, as snprintf
+ */
+int boot_timing_format(char *buf, size_t size);
+
+/**
+ * @brief Log the timings
+ *
+ */
+void boot_timing_log(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,45 @@
+/* Lock-free command queue from the webserver to the control task
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "command_queue.h"
+
+_Static_assert((COMMAND_QUEUE_LEN & (COMMAND_QUEUE_LEN - 1)) == 0, "COMMAND_QUEUE_LEN must be a power of two");
+
+void command_queue_init(command_queue_t *queue)
+{
+    atomic_init(&queue->head, 0);
+    atomic_init(&queue->tail, 0);
+    queue->dropped = 0;
+}
+
+bool command_queue_push(command_queue_t *queue, const command_t *cmd)
+{
+    unsigned head = atomic_load_explicit(&queue->head, memory_order_relaxed);
+    unsigned next = (head + 1) & (COMMAND_QUEUE_LEN - 1);
+    /* Acquire pairs with the consumer's release so the slot is no longer being read */
+    if (next == atomic_load_explicit(&queue->tail, memory_order_acquire)) {
+        queue->dropped++;
+        return false;
+    }
+    queue->slots[head] = *cmd;
+    /* Release publishes the slot contents before the new head */
+    atomic_store_explicit(&queue->head, next, memory_order_release);
+    return true;
+}
+
+bool command_queue_pop(command_queue_t *queue, command_t *cmd)
+{
+    unsigned tail = atomic_load_explicit(&queue->tail, memory_order_relaxed);
+    if (tail == atomic_load_explicit(&queue->head, memory_order_acquire)) {
+        return false;
+    }
+    *cmd = queue->slots[tail];
+    atomic_store_explicit(&queue->tail, (tail + 1) & (COMMAND_QUEUE_LEN - 1), memory_order_release);
+    return true;
+}
@@ -0,0 +1,100 @@
+/* Lock-free command queue from the webserver to the control task
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "geo.h"
+
+/**
+ * @brief Setpoint commands
+ *
+ */
+typedef enum {
+    COMMAND_SET_TARGET,     /*!< Move the target to an absolute position */
+    COMMAND_NUDGE,          /*!< Move the target by a number of metres north and east */
+    COMMAND_SET_GAIN,       /*!< Set the motor gain */
+    COMMAND_STEP_GAIN,      /*!< Add to the motor gain */
+    COMMAND_SET_ROUTE,      /*!< Take a new list of waypoints from the upload buffer */
+    COMMAND_SET_GEOFENCE,   /*!< Take new geofence polygons from the upload buffer */
+} command_type_t;
+
+/**
+ * @brief One setpoint command
+ *
+ */
+typedef struct {
+    command_type_t type;            /*!< Command type */
+    union {
+        geo_point_t target;         /*!< COMMAND_SET_TARGET */
+        struct {
+            float north;            /*!< Metres north, negative is south */
+            float east;             /*!< Metres east, negative is west */
+        } nudge;                    /*!< COMMAND_NUDGE */
+        int gain;                   /*!< COMMAND_SET_GAIN and COMMAND_STEP_GAIN, % */
+        struct {
+            uint32_t count;         /*!< Number of waypoints uploaded, 0 clears the route */
+            bool loop;              /*!< Return to the first waypoint after the last */
+        } route;                    /*!< COMMAND_SET_ROUTE */
+    };
+} command_t;
+
+/**
+ * @brief Number of slots, a power of two. One slot is always left free
+ *
+ */
+#define COMMAND_QUEUE_LEN (16)
+
+/**
+ * @brief Single producer, single consumer ring of commands
+ *
+ * Only the producer writes head and only the consumer writes tail, so neither side takes a lock
+ * or blocks. The producer is the httpd task, the consumer is the control task.
+ */
+typedef struct {
+    command_t slots[COMMAND_QUEUE_LEN]; /*!< Commands */
+    atomic_uint head;                   /*!< Next slot to write, producer owned */
+    atomic_uint tail;                   /*!< Next slot to read, consumer owned */
+    uint32_t dropped;                   /*!< Commands refused because the queue was full, producer owned */
+} command_queue_t;
+
+/**
+ * @brief Initialise an empty queue
+ *
+ * @param queue queue
+ */
+void command_queue_init(command_queue_t *queue);
+
+/**
+ * @brief Add a command, producer side
+ *
+ * @param queue queue
+ * @param cmd command to copy in
+ * @return true if queued, false if the queue was full
+ */
+bool command_queue_push(command_queue_t *queue, const command_t *cmd);
+
+/**
+ * @brief Take the oldest command, consumer side
+ *
+ * @param queue queue
+ * @param cmd filled with the command
+ * @return true if a command was taken, false if the queue was empty
+ */
+bool command_queue_pop(command_queue_t *queue, command_t *cmd);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,105 @@
+/* Control loop timing statistics
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "control_stats.h"
+
+/* Upper bounds of the histogram buckets, the last bucket collects everything above */
+static const uint32_t cycle_bounds_pct[CONTROL_STATS_BUCKETS - 1] = {10, 25, 50, 75, 90, 100, 150};
+static const uint32_t jitter_bounds_us[CONTROL_STATS_BUCKETS - 1] = {50, 100, 250, 500, 1000, 2500, 5000};
+
+/**
+ * @brief Find the histogram bucket of a value
+ *
+ * @param bounds upper bounds of the buckets
+ * @param value value to classify
+ * @return int bucket index
+ */
+static int bucket_of(const uint32_t *bounds, uint32_t value)
+{
+    int i = 0;
+    while (i < CONTROL_STATS_BUCKETS - 1 && value >= bounds[i]) {
+        i++;
+    }
+    return i;
+}
+
+void control_stats_init(control_stats_t *stats, uint32_t period_us)
+{
+    memset(stats, 0, sizeof(control_stats_t));
+    stats->period_us = period_us;
+}
+
+void control_stats_record(control_stats_t *stats, int64_t release_us, int64_t start_us, int64_t end_us, uint32_t skipped)
+{
+    uint32_t cycle_us = (uint32_t)(end_us - start_us);
+    uint32_t jitter_us = start_us > release_us ? (uint32_t)(start_us - release_us) : 0;
+
+    stats->cycles++;
+    stats->skipped += skipped;
+    stats->cycle_last_us = cycle_us;
+    stats->cycle_sum_us += cycle_us;
+    if (cycle_us > stats->cycle_max_us) {
+        stats->cycle_max_us = cycle_us;
+    }
+    if (jitter_us > stats->jitter_max_us) {
+        stats->jitter_max_us = jitter_us;
+    }
+    /* Work must be done before the next release */
+    if (end_us - release_us > (int64_t)stats->period_us) {
+        stats->deadline_misses++;
+    }
+    stats->cycle_hist[bucket_of(cycle_bounds_pct, (uint32_t)((uint64_t)cycle_us * 100 / stats->period_us))]++;
+    stats->jitter_hist[bucket_of(jitter_bounds_us, jitter_us)]++;
+}
+
+/**
+ * @brief Append one histogram to a text buffer
+ *
+ * @return int number of characters written
+ */
+static int format_hist(char *buf, size_t len, const char *name, const char *unit,
+                       const uint32_t *bounds, const uint32_t *hist)
+{
+    int n = 0;
+    for (int i = 0; i < CONTROL_STATS_BUCKETS && (size_t)n < len; i++) {
+        if (i < CONTROL_STATS_BUCKETS - 1) {
+            n += snprintf(buf + n, len - n, "%s_lt_%u%s %u\n", name, bounds[i], unit, hist[i]);
+        } else {
+            n += snprintf(buf + n, len - n, "%s_ge_%u%s %u\n", name, bounds[i - 1], unit, hist[i]);
+        }
+    }
+    return n;
+}
+
+int control_stats_format(const control_stats_t *stats, char *buf, size_t len)
+{
+    int n = snprintf(buf, len,
+                     "control_period_us %u\n"
+                     "control_cycles %u\n"
+                     "control_deadline_misses %u\n"
+                     "control_skipped %u\n"
+                     "control_cycle_last_us %u\n"
+                     "control_cycle_mean_us %u\n"
+                     "control_cycle_max_us %u\n"
+                     "control_jitter_max_us %u\n",
+                     stats->period_us, stats->cycles, stats->deadline_misses, stats->skipped,
+                     stats->cycle_last_us, stats->cycles ? (uint32_t)(stats->cycle_sum_us / stats->cycles) : 0,
+                     stats->cycle_max_us, stats->jitter_max_us);
+    if (n < 0 || (size_t)n >= len) {
+        return n;
+    }
+    n += format_hist(buf + n, len - n, "control_cycle", "pct", cycle_bounds_pct, stats->cycle_hist);
+    if ((size_t)n >= len) {
+        return n;
+    }
+    n += format_hist(buf + n, len - n, "control_jitter", "us", jitter_bounds_us, stats->jitter_hist);
+    return n;
+}
@@ -0,0 +1,71 @@
+/* Control loop timing statistics
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+#define CONTROL_STATS_BUCKETS (8)
+
+/**
+ * @brief Timing statistics of a fixed period control loop
+ *
+ * All times are in microseconds. Cycle time is measured from the start of a cycle to the end of its work,
+ * jitter is how late a cycle started relative to its ideal release time.
+ */
+typedef struct {
+    uint32_t period_us;                           /*!< Nominal period of the loop */
+    uint32_t cycles;                              /*!< Number of completed cycles */
+    uint32_t deadline_misses;                     /*!< Cycles whose work did not finish within the period */
+    uint32_t skipped;                             /*!< Releases that were lost because the previous cycle overran */
+    uint32_t cycle_max_us;                        /*!< Longest cycle time seen */
+    uint32_t cycle_last_us;                       /*!< Cycle time of the last cycle */
+    uint32_t jitter_max_us;                       /*!< Largest start latency seen */
+    uint64_t cycle_sum_us;                        /*!< Sum of cycle times, for the mean */
+    uint32_t cycle_hist[CONTROL_STATS_BUCKETS];   /*!< Cycle time histogram, buckets in percent of period */
+    uint32_t jitter_hist[CONTROL_STATS_BUCKETS];  /*!< Start latency histogram, buckets in microseconds */
+} control_stats_t;
+
+/**
+ * @brief Reset statistics for a loop running with the given period
+ *
+ * @param stats statistics object
+ * @param period_us nominal loop period in microseconds
+ */
+void control_stats_init(control_stats_t *stats, uint32_t period_us);
+
+/**
+ * @brief Record one completed cycle
+ *
+ * @param stats statistics object
+ * @param release_us ideal release time of the cycle
+ * @param start_us time the cycle actually started
+ * @param end_us time the cycle finished its work
+ * @param skipped number of releases missed since the previous cycle
+ */
+void control_stats_record(control_stats_t *stats, int64_t release_us, int64_t start_us, int64_t end_us, uint32_t skipped);
+
+/**
+ * @brief Format statistics as plain text, one "name value" pair per line
+ *
+ * @param stats statistics object
+ * @param buf output buffer
+ * @param len size of output buffer
+ * @return int number of characters written (excluding the terminator)
+ */
+int control_stats_format(const control_stats_t *stats, char *buf, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,76 @@
+/* Dead reckoning position predictor
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <math.h>
+#include "dead_reckoning.h"
+#include "geo.h"
+
+void dead_reckoning_init(dead_reckoning_t *dr, const dead_reckoning_config_t *config)
+{
+    memset(dr, 0, sizeof(dead_reckoning_t));
+    dr->config = *config;
+}
+
+void dead_reckoning_fix(dead_reckoning_t *dr, int64_t t_us, float north, float east, float fix_north,
+                        float fix_east, float speed, float cog, float thrust)
+{
+    if (dr->valid) {
+        /* Score the prediction for this instant against the fix, and the naive "hold last fix" alternative */
+        float pn, pe;
+        dead_reckoning_predict(dr, t_us, cog, dr->fix_thrust, &pn, &pe);
+        float en = pn - fix_north, ee = pe - fix_east;
+        float sn = dr->fix_north - fix_north, se = dr->fix_east - fix_east;
+        float err = sqrtf(en * en + ee * ee);
+        dr->quality.fixes++;
+        dr->quality.last_err_m = err;
+        dr->quality.sum_sq_err += err * err;
+        dr->quality.sum_sq_stale += sn * sn + se * se;
+        if (err > dr->quality.max_err_m) {
+            dr->quality.max_err_m = err;
+        }
+        /* Blend the error out instead of jumping to the fix */
+        dr->corr_north = pn - north;
+        dr->corr_east = pe - east;
+    }
+    dr->valid = true;
+    dr->fix_us = t_us;
+    dr->last_us = t_us;
+    dr->fix_north = fix_north;
+    dr->fix_east = fix_east;
+    dr->north = north;
+    dr->east = east;
+    dr->vn = speed * cosf(cog * GEO_DEG_TO_RAD);
+    dr->ve = speed * sinf(cog * GEO_DEG_TO_RAD);
+    dr->fix_thrust = thrust;
+}
+
+bool dead_reckoning_predict(dead_reckoning_t *dr, int64_t t_us, float heading, float thrust, float *north, float *east)
+{
+    if (!dr->valid) {
+        return false;
+    }
+    float age = (t_us - dr->fix_us) / 1000000.0f;
+    float dt = (t_us - dr->last_us) / 1000000.0f;
+    if (dt > 0 && age <= dr->config.horizon_s) {
+        /* Ground velocity of the fix, plus whatever the thrust changed since the fix along the heading */
+        float dv = dr->config.thrust_mps * (thrust - dr->fix_thrust) / 100.0f;
+        dr->north += (dr->vn + dv * cosf(heading * GEO_DEG_TO_RAD)) * dt;
+        dr->east += (dr->ve + dv * sinf(heading * GEO_DEG_TO_RAD)) * dt;
+        float decay = dr->config.blend_s > 0 ? expf(-dt / dr->config.blend_s) : 0;
+        dr->corr_north *= decay;
+        dr->corr_east *= decay;
+    }
+    if (dt > 0) {
+        dr->last_us = t_us;
+    }
+    *north = dr->north + dr->corr_north;
+    *east = dr->east + dr->corr_east;
+    return age <= dr->config.horizon_s;
+}
@@ -0,0 +1,116 @@
+/* Dead reckoning position predictor
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Configuration of the predictor
+ *
+ */
+typedef struct {
+    float thrust_mps;    /*!< Speed through the water at 100% thrust on both motors (m/s) */
+    float blend_s;       /*!< Time constant over which a prediction error is blended out after a fix (seconds) */
+    float horizon_s;     /*!< Longest time a fix is propagated before the estimate is held (seconds) */
+} dead_reckoning_config_t;
+
+/**
+ * @brief Default configuration of the predictor
+ *
+ */
+#define DEAD_RECKONING_CONFIG_DEFAULT() \
+    {                                   \
+        .thrust_mps = 1.0f,             \
+        .blend_s = 0.5f,                \
+        .horizon_s = 3.0f               \
+    }
+
+/**
+ * @brief Prediction quality, measured against each following fix
+ *
+ */
+typedef struct {
+    uint32_t fixes;        /*!< Number of fixes the prediction was checked against */
+    float last_err_m;      /*!< Prediction error at the last fix (metres) */
+    float max_err_m;       /*!< Largest prediction error (metres) */
+    float sum_sq_err;      /*!< Sum of squared prediction errors */
+    float sum_sq_stale;    /*!< Sum of squared errors of simply holding the previous fix, for comparison */
+} dead_reckoning_quality_t;
+
+/**
+ * @brief Predictor state
+ *
+ */
+typedef struct {
+    dead_reckoning_config_t config;   /*!< Configuration */
+    bool valid;                       /*!< A fix has been received */
+    int64_t fix_us;                   /*!< Time of the last fix */
+    int64_t last_us;                  /*!< Time of the last prediction step */
+    float fix_north;                  /*!< Last measured fix, metres north of the local reference */
+    float fix_east;                   /*!< Last measured fix, metres east of the local reference */
+    float vn;                         /*!< Ground velocity of the last fix, north (m/s) */
+    float ve;                         /*!< Ground velocity of the last fix, east (m/s) */
+    float fix_thrust;                 /*!< Mean motor duty when the fix was taken, % */
+    float north;                      /*!< Propagated position without the correction offset */
+    float east;                       /*!< Propagated position without the correction offset */
+    float corr_north;                 /*!< Correction offset still being blended out */
+    float corr_east;                  /*!< Correction offset still being blended out */
+    dead_reckoning_quality_t quality; /*!< Prediction quality */
+} dead_reckoning_t;
+
+/**
+ * @brief Initialise the predictor
+ *
+ * @param dr predictor
+ * @param config configuration
+ */
+void dead_reckoning_init(dead_reckoning_t *dr, const dead_reckoning_config_t *config);
+
+/**
+ * @brief Feed a new fix, scores the prediction made for this instant and starts blending towards the new start
+ *
+ * The estimate is propagated from the filtered position, while the prediction is scored against the fix as
+ * measured, so the score doesn't compare the prediction with a position that has already been pulled towards
+ * it.
+ *
+ * @param dr predictor
+ * @param t_us time of the fix
+ * @param north filtered position to propagate from, metres north of the local reference
+ * @param east filtered position to propagate from, metres east of the local reference
+ * @param fix_north measured fix, metres north of the local reference
+ * @param fix_east measured fix, metres east of the local reference
+ * @param speed speed over ground (m/s)
+ * @param cog course over ground (degrees true)
+ * @param thrust mean motor duty when the fix was taken, %
+ */
+void dead_reckoning_fix(dead_reckoning_t *dr, int64_t t_us, float north, float east, float fix_north,
+                        float fix_east, float speed, float cog, float thrust);
+
+/**
+ * @brief Propagate the estimate to the given time
+ *
+ * @param dr predictor
+ * @param t_us time of the estimate, at or after the last call
+ * @param heading current heading (degrees)
+ * @param thrust current mean motor duty, %
+ * @param north estimated position, metres north of the local reference
+ * @param east estimated position, metres east of the local reference
+ * @return bool false if no fix has arrived yet or the last one is older than the horizon
+ */
+bool dead_reckoning_predict(dead_reckoning_t *dr, int64_t t_us, float heading, float thrust, float *north, float *east);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,244 @@
+/* Drift history and set/drift estimation
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <math.h>
+#include "drift_history.h"
+#include "geo.h"
+
+/* Fewer samples than this give a meaningless slope */
+#define DRIFT_MIN_SAMPLES (4)
+
+static inline bool is_idle(const drift_sample_t *s)
+{
+    return s->port == 0 && s->stbd == 0;
+}
+
+/**
+ * @brief Add (sign = 1) or remove (sign = -1) a sample from a set of sums
+ *
+ */
+static void sums_apply(drift_sums_t *sums, const drift_sample_t *s, int64_t base_us, float sign)
+{
+    float t = (s->t_us - base_us) / 1000000.0f;
+    sums->n += sign;
+    sums->t += sign * t;
+    sums->tt += sign * t * t;
+    sums->x += sign * s->north;
+    sums->y += sign * s->east;
+    sums->tx += sign * t * s->north;
+    sums->ty += sign * t * s->east;
+}
+
+/**
+ * @brief Move the time origin of a set of sums forward by dt seconds
+ *
+ */
+static void sums_shift(drift_sums_t *sums, float dt)
+{
+    sums->tt += -2 * dt * sums->t + sums->n * dt * dt;
+    sums->tx -= dt * sums->x;
+    sums->ty -= dt * sums->y;
+    sums->t -= sums->n * dt;
+}
+
+/**
+ * @brief Least squares slope of position against time
+ *
+ * @return bool true if the fit is well conditioned
+ */
+static bool sums_slope(const drift_sums_t *sums, float *vn, float *ve)
+{
+    float denom = sums->n * sums->tt - sums->t * sums->t;
+    if (sums->n < DRIFT_MIN_SAMPLES || denom <= 1e-6f) {
+        return false;
+    }
+    *vn = (sums->n * sums->tx - sums->t * sums->x) / denom;
+    *ve = (sums->n * sums->ty - sums->t * sums->y) / denom;
+    return true;
+}
+
+/**
+ * @brief Add (sign = 1) or remove (sign = -1) the sums of one idle run, centred on its own means, to the fit
+ *
+ * A run of one sample says nothing about the slope and is left out.
+ */
+static void fit_apply(drift_fit_t *fit, const drift_sums_t *sums, float sign)
+{
+    if (sums->n < 2) {
+        return;
+    }
+    fit->n += sign * sums->n;
+    fit->stt += sign * (sums->tt - sums->t * sums->t / sums->n);
+    fit->stn += sign * (sums->tx - sums->t * sums->x / sums->n);
+    fit->ste += sign * (sums->ty - sums->t * sums->y / sums->n);
+}
+
+/**
+ * @brief Slope shared by the idle runs, each run weighted by its spread in time
+ *
+ * Fitting one line through all the idle samples would join up runs the motors moved the boat between, and
+ * pull the slope towards zero whenever the boat was driven back against the drift.
+ *
+ * @return bool true if the fit is well conditioned
+ */
+static bool fit_slope(const drift_fit_t *fit, float *vn, float *ve)
+{
+    if (fit->n < DRIFT_MIN_SAMPLES || fit->stt <= 1e-6f) {
+        return false;
+    }
+    *vn = fit->stn / fit->stt;
+    *ve = fit->ste / fit->stt;
+    return true;
+}
+
+/**
+ * @brief Add (sign = 1) or remove (sign = -1) a sample of an idle run, keeping the fit up to date
+ *
+ */
+static void segment_apply(drift_history_t *hist, drift_segment_t *seg, const drift_sample_t *s, float sign)
+{
+    fit_apply(&hist->idle, &seg->sums, -1);
+    sums_apply(&seg->sums, s, seg->base_us, sign);
+    fit_apply(&hist->idle, &seg->sums, 1);
+}
+
+/**
+ * @brief Account for a new sample in the idle runs, an idle sample after a driven one starts a new run
+ *
+ */
+static void idle_add(drift_history_t *hist, const drift_sample_t *s)
+{
+    if (!is_idle(s)) {
+        hist->seg_open = false;
+        return;
+    }
+    if (!hist->seg_open) {
+        drift_segment_t *seg = &hist->segments[(hist->seg_first + hist->seg_count) % DRIFT_SEGMENTS_MAX];
+        memset(seg, 0, sizeof(drift_segment_t));
+        seg->base_us = s->t_us;
+        hist->seg_count++;
+        hist->seg_open = true;
+    }
+    segment_apply(hist, &hist->segments[(hist->seg_first + hist->seg_count - 1) % DRIFT_SEGMENTS_MAX], s, 1);
+}
+
+/**
+ * @brief Account for the oldest sample leaving the ring, it belongs to the oldest idle run if it is idle
+ *
+ */
+static void idle_remove(drift_history_t *hist, const drift_sample_t *s)
+{
+    if (!is_idle(s) || hist->seg_count == 0) {
+        return;
+    }
+    drift_segment_t *seg = &hist->segments[hist->seg_first];
+    segment_apply(hist, seg, s, -1);
+    if (seg->sums.n < 0.5f) {
+        hist->seg_first = (hist->seg_first + 1) % DRIFT_SEGMENTS_MAX;
+        hist->seg_count--;
+        hist->seg_open = hist->seg_open && hist->seg_count > 0;
+    }
+}
+
+/**
+ * @brief Recompute the sums from the ring, bounds the rounding error of the incremental updates
+ *
+ */
+static void recompute_sums(drift_history_t *hist)
+{
+    memset(&hist->all, 0, sizeof(drift_sums_t));
+    memset(&hist->idle, 0, sizeof(drift_fit_t));
+    hist->seg_first = 0;
+    hist->seg_count = 0;
+    hist->seg_open = false;
+    for (uint16_t i = 0; i < hist->count; i++) {
+        const drift_sample_t *s = &hist->samples[(hist->head + DRIFT_HISTORY_LEN - hist->count + i) % DRIFT_HISTORY_LEN];
+        sums_apply(&hist->all, s, hist->base_us, 1);
+        idle_add(hist, s);
+    }
+}
+
+void drift_history_init(drift_history_t *hist, float excursion_m)
+{
+    memset(hist, 0, sizeof(drift_history_t));
+    hist->excursion_m = excursion_m;
+}
+
+void drift_history_retarget(drift_history_t *hist)
+{
+    hist->prev_valid = false;
+    hist->outside = false;
+}
+
+void drift_history_add(drift_history_t *hist, const drift_sample_t *sample, float target_north, float target_east)
+{
+    /* Evict the oldest sample when full */
+    if (hist->count == DRIFT_HISTORY_LEN) {
+        const drift_sample_t *old = &hist->samples[hist->head];
+        sums_apply(&hist->all, old, hist->base_us, -1);
+        idle_remove(hist, old);
+        hist->count--;
+    }
+    if (hist->count == 0) {
+        hist->base_us = sample->t_us;
+    }
+    hist->samples[hist->head] = *sample;
+    hist->head = (hist->head + 1) % DRIFT_HISTORY_LEN;
+    hist->count++;
+    sums_apply(&hist->all, sample, hist->base_us, 1);
+    idle_add(hist, sample);
+
+    /* Keep the time origin on the oldest sample so the sums stay small */
+    const drift_sample_t *oldest = &hist->samples[(hist->head + DRIFT_HISTORY_LEN - hist->count) % DRIFT_HISTORY_LEN];
+    if (hist->head == 0) {
+        /* Once per lap of the ring: rebuild from scratch instead of shifting */
+        hist->base_us = oldest->t_us;
+        recompute_sums(hist);
+    } else if (oldest->t_us != hist->base_us) {
+        float dt = (oldest->t_us - hist->base_us) / 1000000.0f;
+        sums_shift(&hist->all, dt);
+        hist->base_us = oldest->t_us;
+    }
+
+    /* Overshoot: position relative to the target flipped to the other side within the excursion radius */
+    float rn = sample->north - target_north;
+    float re = sample->east - target_east;
+    float range = sqrtf(rn * rn + re * re);
+    if (hist->prev_valid && !hist->outside && range < hist->excursion_m &&
+            rn * hist->prev_rn + re * hist->prev_re < 0) {
+        hist->overshoots++;
+    }
+    /* Excursion: leaving the excursion radius */
+    if (range >= hist->excursion_m) {
+        if (!hist->outside && hist->prev_valid) {
+            hist->excursions++;
+        }
+        hist->outside = true;
+    } else {
+        hist->outside = false;
+    }
+    hist->prev_rn = rn;
+    hist->prev_re = re;
+    hist->prev_valid = true;
+}
+
+void drift_history_estimate(const drift_history_t *hist, drift_estimate_t *est)
+{
+    memset(est, 0, sizeof(drift_estimate_t));
+    est->valid = sums_slope(&hist->all, &est->vn, &est->ve);
+    est->drift_valid = fit_slope(&hist->idle, &est->drift_vn, &est->drift_ve);
+    if (est->drift_valid) {
+        est->drift_mps = sqrtf(est->drift_vn * est->drift_vn + est->drift_ve * est->drift_ve);
+        est->set_deg = geo_bearing_deg(est->drift_vn, est->drift_ve);
+    }
+    est->outside = hist->outside;
+    est->overshoots = hist->overshoots;
+    est->excursions = hist->excursions;
+}
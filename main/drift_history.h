@@ -0,0 +1,158 @@
+/* Drift history and set/drift estimation
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Number of fixes kept in the history, about a minute at the default 1 Hz fix rate
+ *
+ */
+#ifndef DRIFT_HISTORY_LEN
+#define DRIFT_HISTORY_LEN (64)
+#endif
+
+/**
+ * @brief One entry of the drift history
+ *
+ */
+typedef struct {
+    int64_t t_us;  /*!< Time of the fix (microseconds) */
+    float north;   /*!< Position north of the local reference (metres) */
+    float east;    /*!< Position east of the local reference (metres) */
+    float port;    /*!< Port motor duty when the fix arrived, % */
+    float stbd;    /*!< Starboard motor duty when the fix arrived, % */
+} drift_sample_t;
+
+/**
+ * @brief Running sums of a least squares fit of position against time
+ *
+ */
+typedef struct {
+    float n;   /*!< Number of samples */
+    float t;   /*!< Sum of t */
+    float tt;  /*!< Sum of t*t */
+    float x;   /*!< Sum of north */
+    float y;   /*!< Sum of east */
+    float tx;  /*!< Sum of t*north */
+    float ty;  /*!< Sum of t*east */
+} drift_sums_t;
+
+/**
+ * @brief Most idle segments the ring can hold, idle and driven samples alternating
+ *
+ */
+#define DRIFT_SEGMENTS_MAX (DRIFT_HISTORY_LEN / 2 + 1)
+
+/**
+ * @brief Sums over one unbroken run of samples with the motors idle
+ *
+ * Between two idle runs the motors moved the boat, so each run has its own intercept. The sums are kept
+ * from the first sample of the run, which also keeps them small.
+ */
+typedef struct {
+    int64_t base_us;    /*!< Time origin of the sums */
+    drift_sums_t sums;  /*!< Samples of the run still in the ring */
+} drift_segment_t;
+
+/**
+ * @brief Centred sums of all the idle runs, the slope they share is stn/stt and ste/stt
+ *
+ */
+typedef struct {
+    float n;    /*!< Number of samples */
+    float stt;  /*!< Sum over the runs of the spread of t about the run's mean */
+    float stn;  /*!< Sum over the runs of the co-spread of t and north */
+    float ste;  /*!< Sum over the runs of the co-spread of t and east */
+} drift_fit_t;
+
+/**
+ * @brief Drift history ring and incremental statistics
+ *
+ */
+typedef struct {
+    drift_sample_t samples[DRIFT_HISTORY_LEN]; /*!< Ring of samples */
+    uint16_t head;                             /*!< Index the next sample is written to */
+    uint16_t count;                            /*!< Number of valid samples */
+    int64_t base_us;                           /*!< Time origin of the sums, the oldest sample */
+    drift_sums_t all;                          /*!< Fit over every sample, ground velocity */
+    drift_segment_t segments[DRIFT_SEGMENTS_MAX]; /*!< Ring of the idle runs in the history, oldest first */
+    uint16_t seg_first;                        /*!< Index of the oldest idle run */
+    uint16_t seg_count;                        /*!< Number of idle runs */
+    bool seg_open;                             /*!< The newest sample was idle, the next idle one joins its run */
+    drift_fit_t idle;                          /*!< Fit over the idle runs, current/wind set */
+    float excursion_m;                         /*!< Range from the target that counts as an excursion */
+    float prev_rn;                             /*!< Previous position relative to the target, north */
+    float prev_re;                             /*!< Previous position relative to the target, east */
+    bool prev_valid;                           /*!< Previous relative position is valid */
+    bool outside;                              /*!< Boat is currently outside the excursion radius */
+    uint32_t overshoots;                       /*!< Number of times the boat crossed over the target */
+    uint32_t excursions;                       /*!< Number of times the boat left the excursion radius */
+} drift_history_t;
+
+/**
+ * @brief Drift estimate derived from the history
+ *
+ */
+typedef struct {
+    bool valid;        /*!< Ground velocity is valid (enough samples) */
+    float vn;          /*!< Ground velocity north (m/s) */
+    float ve;          /*!< Ground velocity east (m/s) */
+    bool drift_valid;  /*!< Set and drift are valid (enough samples with the motors idle) */
+    float drift_vn;    /*!< Drift velocity with motors idle, north (m/s) */
+    float drift_ve;    /*!< Drift velocity with motors idle, east (m/s) */
+    float set_deg;     /*!< Direction the boat is set towards (degrees true) */
+    float drift_mps;   /*!< Speed of the drift (m/s) */
+    bool outside;      /*!< Boat is outside the excursion radius */
+    uint32_t overshoots; /*!< Number of times the boat crossed over the target */
+    uint32_t excursions; /*!< Number of excursions */
+} drift_estimate_t;
+
+/**
+ * @brief Clear the history
+ *
+ * @param hist drift history
+ * @param excursion_m range from the target that counts as an excursion (metres)
+ */
+void drift_history_init(drift_history_t *hist, float excursion_m);
+
+/**
+ * @brief Forget the target relative state after the target moved, position history is kept
+ *
+ * @param hist drift history
+ */
+void drift_history_retarget(drift_history_t *hist);
+
+/**
+ * @brief Add a fix to the history, constant time, evicts the oldest sample when full
+ *
+ * @param hist drift history
+ * @param sample fix with the motor duties applied at the time
+ * @param target_north target position north of the local reference (metres)
+ * @param target_east target position east of the local reference (metres)
+ */
+void drift_history_add(drift_history_t *hist, const drift_sample_t *sample, float target_north, float target_east);
+
+/**
+ * @brief Compute the drift estimate, constant time
+ *
+ * @param hist drift history
+ * @param est estimate
+ */
+void drift_history_estimate(const drift_history_t *hist, drift_estimate_t *est);
+
+#ifdef __cplusplus
+}
+#endif
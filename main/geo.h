@@ -0,0 +1,110 @@
+/* Local flat earth projection helpers
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <math.h>
+
+#define GEO_METRES_PER_DEG (111204.0f)        /*!< Metres per degree of latitude */
+#define GEO_DEG_TO_RAD (3.14159265f / 180.0f)
+#define GEO_RAD_TO_DEG (180.0f / 3.14159265f)
+#define GEO_E7_PER_DEG (10000000)             /*!< Fixed point units per degree */
+
+/**
+ * @brief A position in 1e-7 degree fixed point, about 1 cm
+ *
+ */
+typedef struct {
+    int32_t lat_e7;     /*!< Latitude, 1e-7 degrees, north positive */
+    int32_t lon_e7;     /*!< Longitude, 1e-7 degrees, east positive */
+} geo_point_t;
+
+/**
+ * @brief Offset of a position from a reference point in a local north/east frame
+ *
+ * Equirectangular projection around the reference, accurate to well under a metre over the few hundred metres
+ * the boat works in.
+ *
+ * @param lat0 reference latitude (degrees)
+ * @param lon0 reference longitude (degrees)
+ * @param lat latitude of the position (degrees)
+ * @param lon longitude of the position (degrees)
+ * @param north metres north of the reference
+ * @param east metres east of the reference
+ */
+static inline void geo_offset_m(float lat0, float lon0, float lat, float lon, float *north, float *east)
+{
+    *north = (lat - lat0) * GEO_METRES_PER_DEG;
+    *east = (lon - lon0) * GEO_METRES_PER_DEG * cosf(lat0 * GEO_DEG_TO_RAD);
+}
+
+/**
+ * @brief Offset of a fixed point position from a fixed point reference, see geo_offset_m
+ *
+ * The difference is taken in 1e-7 degrees before going to float, so it keeps centimetres however far from
+ * the equator and the meridian the boat is.
+ *
+ * @param ref reference point
+ * @param p position
+ * @param north metres north of the reference
+ * @param east metres east of the reference
+ */
+static inline void geo_offset_e7(const geo_point_t *ref, const geo_point_t *p, float *north, float *east)
+{
+    float lat0 = (float)ref->lat_e7 / GEO_E7_PER_DEG;
+    *north = (float)((int64_t)p->lat_e7 - ref->lat_e7) * (GEO_METRES_PER_DEG / GEO_E7_PER_DEG);
+    *east = (float)((int64_t)p->lon_e7 - ref->lon_e7) * (GEO_METRES_PER_DEG / GEO_E7_PER_DEG) * cosf(lat0 * GEO_DEG_TO_RAD);
+}
+
+/**
+ * @brief Position at an offset from a fixed point reference, the inverse of geo_offset_e7
+ *
+ * @param ref reference point
+ * @param north metres north of the reference
+ * @param east metres east of the reference
+ * @param p filled with the position, rounded to 1e-7 degrees
+ */
+static inline void geo_point_at(const geo_point_t *ref, float north, float east, geo_point_t *p)
+{
+    float lat0 = (float)ref->lat_e7 / GEO_E7_PER_DEG;
+    int32_t dlat = (int32_t)lroundf(north * (GEO_E7_PER_DEG / GEO_METRES_PER_DEG));
+    int32_t dlon = (int32_t)lroundf(east * (GEO_E7_PER_DEG / GEO_METRES_PER_DEG) / cosf(lat0 * GEO_DEG_TO_RAD));
+    p->lat_e7 = ref->lat_e7 + dlat;
+    p->lon_e7 = ref->lon_e7 + dlon;
+}
+
+/**
+ * @brief Compass bearing of a north/east vector
+ *
+ * @return float bearing in degrees, 0..360 clockwise from north
+ */
+static inline float geo_bearing_deg(float north, float east)
+{
+    float deg = atan2f(east, north) * GEO_RAD_TO_DEG;
+    return deg < 0 ? deg + 360.0f : deg;
+}
+
+/**
+ * @brief Wrap an angle or an angle difference into -180..180 degrees
+ *
+ * @return float the same angle, at least -180 and less than 180
+ */
+static inline float geo_wrap180(float deg)
+{
+    return deg - 360.0f * floorf((deg + 180.0f) / 360.0f);
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,241 @@
+/* Geofence and no-go zones
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <float.h>
+#include <math.h>
+#include "nvs.h"
+#include "geofence.h"
+
+#define GEOFENCE_NVS_NAMESPACE "geofence"
+#define GEOFENCE_ESCAPE_TURN_DEG (45.0f)    /*!< Off the way out by this much or more, the escape turn is at full duty */
+
+static inline float clampf(float v, float lo, float hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+void geofence_def_clear(geofence_def_t *def)
+{
+    def->polygon_count = 0;
+    def->vertex_total = 0;
+}
+
+esp_err_t geofence_def_add(geofence_def_t *def, geofence_kind_t kind, const geo_point_t *vertices, uint32_t count)
+{
+    if (count < 3) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (def->polygon_count == GEOFENCE_MAX_POLYGONS || def->vertex_total + count > GEOFENCE_MAX_VERTICES) {
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(&def->vertices[def->vertex_total], vertices, count * sizeof(geo_point_t));
+    def->kind[def->polygon_count] = kind;
+    def->vertex_count[def->polygon_count] = count;
+    def->polygon_count++;
+    def->vertex_total += count;
+    return ESP_OK;
+}
+
+esp_err_t geofence_def_save(const geofence_def_t *def)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(GEOFENCE_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (def->polygon_count == 0) {
+        err = nvs_erase_key(handle, "vertices");
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    } else {
+        err = nvs_set_blob(handle, "kind", def->kind, def->polygon_count);
+        if (err == ESP_OK) {
+            err = nvs_set_blob(handle, "counts", def->vertex_count, def->polygon_count * sizeof(uint16_t));
+        }
+        if (err == ESP_OK) {
+            err = nvs_set_blob(handle, "vertices", def->vertices, def->vertex_total * sizeof(geo_point_t));
+        }
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+esp_err_t geofence_def_restore(geofence_def_t *def)
+{
+    nvs_handle_t handle;
+    size_t kind_len = sizeof(def->kind);
+    size_t count_len = sizeof(def->vertex_count);
+    size_t vertex_len = sizeof(def->vertices);
+    uint32_t total = 0;
+    esp_err_t err;
+
+    geofence_def_clear(def);
+    err = nvs_open(GEOFENCE_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_get_blob(handle, "vertices", def->vertices, &vertex_len);
+    if (err == ESP_OK) {
+        err = nvs_get_blob(handle, "kind", def->kind, &kind_len);
+    }
+    if (err == ESP_OK) {
+        err = nvs_get_blob(handle, "counts", def->vertex_count, &count_len);
+    }
+    nvs_close(handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    /* Only accept a consistent set */
+    if (kind_len * sizeof(uint16_t) != count_len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    for (size_t i = 0; i < kind_len; i++) {
+        total += def->vertex_count[i];
+    }
+    if (total * sizeof(geo_point_t) != vertex_len) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    def->polygon_count = kind_len;
+    def->vertex_total = total;
+    return ESP_OK;
+}
+
+void geofence_build(geofence_t *fence, const geofence_def_t *def)
+{
+    uint32_t v = 0;
+
+    fence->polygon_count = 0;
+    if (def->polygon_count == 0) {
+        return;
+    }
+    fence->origin = def->vertices[0];
+    fence->cos_lat0 = cosf((float)fence->origin.lat_e7 / GEO_E7_PER_DEG * GEO_DEG_TO_RAD);
+    for (uint32_t p = 0; p < def->polygon_count; p++) {
+        geofence_polygon_t *poly = &fence->polygons[p];
+        uint32_t count = def->vertex_count[p];
+        poly->kind = def->kind[p];
+        poly->first_edge = v;
+        poly->edge_count = count;
+        poly->min_n = poly->min_e = FLT_MAX;
+        poly->max_n = poly->max_e = -FLT_MAX;
+        for (uint32_t i = 0; i < count; i++) {
+            const geo_point_t *a = &def->vertices[v + i];
+            const geo_point_t *b = &def->vertices[v + (i + 1) % count];
+            geofence_edge_t *edge = &fence->edges[v + i];
+            float n1, e1;
+            geo_offset_e7(&fence->origin, a, &edge->n0, &edge->e0);
+            geo_offset_e7(&fence->origin, b, &n1, &e1);
+            edge->dn = n1 - edge->n0;
+            edge->de = e1 - edge->e0;
+            edge->de_per_dn = edge->dn != 0 ? edge->de / edge->dn : 0;
+            edge->inv_len2 = edge->dn * edge->dn + edge->de * edge->de;
+            edge->inv_len2 = edge->inv_len2 > 0 ? 1.0f / edge->inv_len2 : 0;
+            poly->min_n = fminf(poly->min_n, edge->n0);
+            poly->max_n = fmaxf(poly->max_n, edge->n0);
+            poly->min_e = fminf(poly->min_e, edge->e0);
+            poly->max_e = fmaxf(poly->max_e, edge->e0);
+        }
+        v += count;
+    }
+    fence->polygon_count = def->polygon_count;
+}
+
+void geofence_check(const geofence_t *fence, const geo_point_t *position, float margin_m, geofence_result_t *result)
+{
+    /* The projection of geo_offset_e7 with the cosine from the build */
+    float pn = (float)((int64_t)position->lat_e7 - fence->origin.lat_e7) * (GEO_METRES_PER_DEG / GEO_E7_PER_DEG);
+    float pe = (float)((int64_t)position->lon_e7 - fence->origin.lon_e7) * (GEO_METRES_PER_DEG / GEO_E7_PER_DEG) *
+               fence->cos_lat0;
+
+    result->breached = false;
+    result->clearance_m = FLT_MAX;
+    result->danger_n = 0;
+    result->danger_e = 0;
+    result->polygon = -1;
+    for (uint32_t p = 0; p < fence->polygon_count; p++) {
+        const geofence_polygon_t *poly = &fence->polygons[p];
+        bool near = pn >= poly->min_n - margin_m && pn <= poly->max_n + margin_m &&
+                    pe >= poly->min_e - margin_m && pe <= poly->max_e + margin_m;
+        if (!near && poly->kind == GEOFENCE_KEEP_OUT) {
+            /* Clear of this zone by more than the margin */
+            continue;
+        }
+        /* Crossing number for containment and the nearest point on the boundary in one pass */
+        const geofence_edge_t *edge = &fence->edges[poly->first_edge];
+        bool inside = false;
+        float best_d2 = FLT_MAX, best_n = 0, best_e = 0;
+        for (uint32_t i = 0; i < poly->edge_count; i++, edge++) {
+            float rn = pn - edge->n0;
+            float re = pe - edge->e0;
+            if ((edge->n0 > pn) != (edge->n0 + edge->dn > pn) && re < rn * edge->de_per_dn) {
+                inside = !inside;
+            }
+            float t = (rn * edge->dn + re * edge->de) * edge->inv_len2;
+            t = t < 0 ? 0 : (t > 1 ? 1 : t);
+            float qn = edge->dn * t - rn;
+            float qe = edge->de * t - re;
+            float d2 = qn * qn + qe * qe;
+            if (d2 < best_d2) {
+                best_d2 = d2;
+                best_n = qn;
+                best_e = qe;
+            }
+        }
+        bool breached = poly->kind == GEOFENCE_KEEP_OUT ? inside : !inside;
+        float dist = sqrtf(best_d2);
+        float clearance = breached ? -dist : dist;
+        result->breached |= breached;
+        if (clearance < result->clearance_m) {
+            /* The nearest boundary point is towards danger unless already over it */
+            float sign = breached ? -1.0f : 1.0f;
+            result->clearance_m = clearance;
+            result->polygon = p;
+            result->danger_n = dist > 0 ? sign * best_n / dist : 0;
+            result->danger_e = dist > 0 ? sign * best_e / dist : 0;
+        }
+    }
+}
+
+float geofence_thrust_scale(const geofence_result_t *result, float direction_deg, float margin_m)
+{
+    float approach;
+    if (result->polygon < 0 || result->clearance_m >= margin_m) {
+        return 1.0f;
+    }
+    approach = cosf(direction_deg * GEO_DEG_TO_RAD) * result->danger_n + sinf(direction_deg * GEO_DEG_TO_RAD) * result->danger_e;
+    if (approach <= 0) {
+        return 1.0f;
+    }
+    if (result->clearance_m <= 0) {
+        return 0;
+    }
+    return result->clearance_m / margin_m;
+}
+
+void geofence_limit_thrust(const geofence_result_t *result, float heading_deg, float margin_m, float escape_duty,
+                           float *port, float *stbd)
+{
+    float forward = (*port + *stbd) / 2;
+    float turn = (*port - *stbd) / 2;
+
+    forward *= geofence_thrust_scale(result, heading_deg, margin_m);
+    if (result->polygon >= 0 && result->breached && (result->danger_n != 0 || result->danger_e != 0)) {
+        /* Come round to the way out, away from the nearest boundary, and drive along it */
+        float off = geo_wrap180(geo_bearing_deg(-result->danger_n, -result->danger_e) - heading_deg);
+        turn = clampf(off / GEOFENCE_ESCAPE_TURN_DEG, -1, 1) * escape_duty;
+        forward = fmaxf(forward, escape_duty * cosf(off * GEO_DEG_TO_RAD));
+    }
+    *port = clampf(forward + turn, 0, 100);
+    *stbd = clampf(forward - turn, 0, 100);
+}
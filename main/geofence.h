@@ -0,0 +1,185 @@
+/* Geofence and no-go zones
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "geo.h"
+
+#define GEOFENCE_MAX_POLYGONS (32)      /*!< Most polygons */
+#define GEOFENCE_MAX_VERTICES (512)     /*!< Most vertices over all polygons */
+
+/**
+ * @brief What a polygon protects
+ *
+ */
+typedef enum {
+    GEOFENCE_KEEP_IN,   /*!< Operating area, the boat must stay inside every one */
+    GEOFENCE_KEEP_OUT,  /*!< No-go zone, the boat must stay outside */
+} geofence_kind_t;
+
+/**
+ * @brief Polygons as entered, in 1e-7 degree fixed point
+ *
+ */
+typedef struct {
+    uint32_t polygon_count;                         /*!< Number of polygons */
+    uint32_t vertex_total;                          /*!< Number of vertices over all polygons */
+    uint8_t kind[GEOFENCE_MAX_POLYGONS];            /*!< geofence_kind_t of each polygon */
+    uint16_t vertex_count[GEOFENCE_MAX_POLYGONS];   /*!< Number of vertices of each polygon */
+    geo_point_t vertices[GEOFENCE_MAX_VERTICES];    /*!< Vertices of all polygons, one polygon after the other */
+} geofence_def_t;
+
+/**
+ * @brief One polygon edge in the local frame, precomputed by geofence_build
+ *
+ */
+typedef struct {
+    float n0;           /*!< Start, metres north of the origin */
+    float e0;           /*!< Start, metres east of the origin */
+    float dn;           /*!< Edge vector, north */
+    float de;           /*!< Edge vector, east */
+    float de_per_dn;    /*!< de / dn, for the crossing test */
+    float inv_len2;     /*!< 1 / squared length, for the nearest point */
+} geofence_edge_t;
+
+/**
+ * @brief One polygon in the local frame
+ *
+ */
+typedef struct {
+    float min_n;            /*!< Bounding box */
+    float max_n;            /*!< Bounding box */
+    float min_e;            /*!< Bounding box */
+    float max_e;            /*!< Bounding box */
+    uint16_t first_edge;    /*!< Index of the first edge in the edge table */
+    uint16_t edge_count;    /*!< Number of edges */
+    geofence_kind_t kind;   /*!< Keep in or keep out */
+} geofence_polygon_t;
+
+/**
+ * @brief Polygons projected around the first vertex, with bounding boxes and edge tables
+ *
+ */
+typedef struct {
+    geo_point_t origin;                                 /*!< Origin of the local frame, the first vertex */
+    float cos_lat0;                                     /*!< cos of the origin latitude */
+    uint32_t polygon_count;                             /*!< Number of polygons, 0 disables the fence */
+    geofence_polygon_t polygons[GEOFENCE_MAX_POLYGONS]; /*!< Polygons */
+    geofence_edge_t edges[GEOFENCE_MAX_VERTICES];       /*!< Edges of all polygons */
+} geofence_t;
+
+/**
+ * @brief Result of a geofence check
+ *
+ */
+typedef struct {
+    bool breached;      /*!< Inside a no-go zone or outside an operating area */
+    float clearance_m;  /*!< Distance to the nearest boundary that matters, negative when breached */
+    float danger_n;     /*!< Unit vector towards the forbidden side of that boundary, north */
+    float danger_e;     /*!< Unit vector towards the forbidden side of that boundary, east */
+    int polygon;        /*!< Polygon with the least clearance, -1 if none is within the margin */
+} geofence_result_t;
+
+/**
+ * @brief Remove all polygons
+ *
+ * @param def polygons
+ */
+void geofence_def_clear(geofence_def_t *def);
+
+/**
+ * @brief Add a polygon
+ *
+ * @param def polygons
+ * @param kind keep in or keep out
+ * @param vertices vertices in order, the polygon closes itself
+ * @param count number of vertices, at least 3
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG for fewer than 3 vertices, ESP_ERR_NO_MEM when full
+ */
+esp_err_t geofence_def_add(geofence_def_t *def, geofence_kind_t kind, const geo_point_t *vertices, uint32_t count);
+
+/**
+ * @brief Store polygons in NVS
+ *
+ * @param def polygons
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t geofence_def_save(const geofence_def_t *def);
+
+/**
+ * @brief Read polygons stored by geofence_def_save
+ *
+ * @param def filled with the polygons, cleared if none are stored
+ * @return esp_err_t ESP_OK, ESP_ERR_NVS_NOT_FOUND if none are stored
+ */
+esp_err_t geofence_def_restore(geofence_def_t *def);
+
+/**
+ * @brief Project polygons into the local frame and build the bounding boxes and edge tables
+ *
+ * @param fence fence
+ * @param def polygons
+ */
+void geofence_build(geofence_t *fence, const geofence_def_t *def);
+
+/**
+ * @brief Check a position against every polygon
+ *
+ * Polygons whose bounding box, grown by margin_m, does not hold the position are skipped without looking
+ * at their edges. Otherwise one pass over the edges gives both containment and the nearest edge.
+ *
+ * @param fence fence
+ * @param position position
+ * @param margin_m clearance that is reported, boundaries further away may be skipped
+ * @param result filled with the result
+ */
+void geofence_check(const geofence_t *fence, const geo_point_t *position, float margin_m, geofence_result_t *result);
+
+/**
+ * @brief Thrust limit for travel in a direction
+ *
+ * Full thrust away from the nearest boundary. Towards it, thrust falls linearly to zero over the
+ * margin and is zero once breached.
+ *
+ * @param result result of geofence_check
+ * @param direction_deg direction the thrust pushes the boat (degrees)
+ * @param margin_m distance over which thrust is reduced
+ * @return float scale for the motor duties, 0 to 1
+ */
+float geofence_thrust_scale(const geofence_result_t *result, float direction_deg, float margin_m);
+
+/**
+ * @brief Limit the motor duties of a boat with two fixed forward thrusters
+ *
+ * The duties are split into forward thrust, their mean, and turn, half their difference. Only the
+ * forward thrust is scaled by geofence_thrust_scale for the heading, the turn is kept so the boat can
+ * still come round. Once breached the turn is replaced by one towards the way out of at most escape_duty,
+ * and the boat drives out with at least escape_duty times the cosine of the angle off that way, so
+ * it leaves even when the target is over the boundary and the controller is idle.
+ *
+ * @param result result of geofence_check
+ * @param heading_deg heading of the boat (degrees)
+ * @param margin_m distance over which thrust is reduced
+ * @param escape_duty duty used to turn and drive out once breached, %
+ * @param port port duty, %, limited in place
+ * @param stbd starboard duty, %, limited in place
+ */
+void geofence_limit_thrust(const geofence_result_t *result, float heading_deg, float margin_m, float escape_duty,
+                           float *port, float *stbd);
+
+#ifdef __cplusplus
+}
+#endif
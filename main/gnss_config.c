@@ -0,0 +1,338 @@
+/* GNSS receiver configuration
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nmea_gps.h"
+#include "ubx.h"
+#include "gnss_config.h"
+
+static const char *GNSS_CONFIG_TAG = "gnss_config";
+
+#define GNSS_DETECT_MS (1500)       /* Longer than one epoch at 1 Hz */
+#define GNSS_ACK_MS (500)
+#define GNSS_RETRIES (3)
+#define GNSS_LINE_MAX (96)
+
+/* u-blox NMEA message ids in class 0xF0 */
+#define UBX_CLASS_NMEA (0xF0)
+#define UBX_ID_CFG_PRT (0x00)
+#define UBX_ID_CFG_MSG (0x01)
+#define UBX_ID_CFG_RATE (0x08)
+
+static const uint32_t scan_bauds[] = { 9600, 115200, 38400, 57600, 19200, 230400, 4800 };
+
+/**
+ * @brief Receive side, shared by all waits so a frame split over two reads is not lost
+ *
+ */
+typedef struct {
+    const gnss_link_t *link;
+    ubx_decoder_t ubx;
+    char line[GNSS_LINE_MAX];
+    uint8_t line_len;
+    uint8_t chunk[64];
+} gnss_rx_t;
+
+typedef enum {
+    GNSS_RX_NONE,
+    GNSS_RX_NMEA,   /*!< A sentence with a good checksum is in line */
+    GNSS_RX_UBX,    /*!< A frame with a good checksum is in ubx */
+} gnss_rx_event_t;
+
+/* Return 1 to stop waiting with success, -1 to stop with failure, 0 to keep waiting */
+typedef int (*gnss_match_t)(const gnss_rx_t *rx, gnss_rx_event_t event, const void *arg);
+
+static bool nmea_line_valid(const char *line, size_t len)
+{
+    uint8_t crc = 0;
+    size_t i = 1;
+    for (; i < len && line[i] != '*'; i++) {
+        crc ^= (uint8_t)line[i];
+    }
+    if (i + 2 >= len) {
+        return false;
+    }
+    char hex[3] = { line[i + 1], line[i + 2], '\0' };
+    char *end;
+    unsigned long got = strtoul(hex, &end, 16);
+    return end == hex + 2 && got == crc;
+}
+
+static gnss_rx_event_t rx_byte(gnss_rx_t *rx, uint8_t c)
+{
+    if (c == UBX_SYNC_1 || ubx_decoder_busy(&rx->ubx)) {
+        ubx_result_t res = ubx_decode_byte(&rx->ubx, c);
+        if (res != UBX_NOT_FRAME) {
+            rx->line_len = 0;
+            return res == UBX_FRAME ? GNSS_RX_UBX : GNSS_RX_NONE;
+        }
+    }
+    if (c == '$') {
+        rx->line_len = 0;
+    } else if (rx->line_len == 0) {
+        return GNSS_RX_NONE;
+    }
+    if (c == '\r' || c == '\n') {
+        size_t len = rx->line_len;
+        rx->line[len] = '\0';
+        rx->line_len = 0;
+        return nmea_line_valid(rx->line, len) ? GNSS_RX_NMEA : GNSS_RX_NONE;
+    }
+    if (rx->line_len >= GNSS_LINE_MAX - 1) {
+        rx->line_len = 0;
+        return GNSS_RX_NONE;
+    }
+    rx->line[rx->line_len++] = c;
+    return GNSS_RX_NONE;
+}
+
+static int wait_for(gnss_rx_t *rx, uint32_t timeout_ms, gnss_match_t match, const void *arg)
+{
+    const int64_t deadline_us = esp_timer_get_time() + (int64_t)timeout_ms * 1000;
+    int64_t left_us;
+    while ((left_us = deadline_us - esp_timer_get_time()) > 0) {
+        int len = rx->link->read(rx->link->ctx, rx->chunk, sizeof(rx->chunk), (uint32_t)((left_us + 999) / 1000));
+        for (int i = 0; i < len; i++) {
+            gnss_rx_event_t event = rx_byte(rx, rx->chunk[i]);
+            int res = event != GNSS_RX_NONE ? match(rx, event, arg) : 0;
+            if (res != 0) {
+                return res;
+            }
+        }
+    }
+    return 0;
+}
+
+static int match_any(const gnss_rx_t *rx, gnss_rx_event_t event, const void *arg)
+{
+    return 1;
+}
+
+static int match_mtk_ack(const gnss_rx_t *rx, gnss_rx_event_t event, const void *arg)
+{
+    char prefix[16];
+    int n = snprintf(prefix, sizeof(prefix), "$PMTK001,%d,", *(const int *)arg);
+    if (event != GNSS_RX_NMEA || strncmp(rx->line, prefix, n) != 0) {
+        return 0;
+    }
+    /* 3 is success, 0 invalid, 1 unsupported, 2 failed */
+    return rx->line[n] == '3' ? 1 : -1;
+}
+
+static int match_ubx_ack(const gnss_rx_t *rx, gnss_rx_event_t event, const void *arg)
+{
+    const uint8_t *msg = arg;
+    if (event != GNSS_RX_UBX || rx->ubx.cls != UBX_CLASS_ACK || rx->ubx.len != 2 ||
+            rx->ubx.payload[0] != msg[0] || rx->ubx.payload[1] != msg[1]) {
+        return 0;
+    }
+    return rx->ubx.id == UBX_ID_ACK_ACK ? 1 : -1;
+}
+
+static void send_mtk(gnss_rx_t *rx, const char *body)
+{
+    char buf[GNSS_LINE_MAX];
+    uint8_t crc = 0;
+    for (const char *p = body; *p; p++) {
+        crc ^= (uint8_t)*p;
+    }
+    int len = snprintf(buf, sizeof(buf), "$%s*%02X\r\n", body, crc);
+    rx->link->write(rx->link->ctx, (const uint8_t *)buf, len);
+}
+
+static void send_ubx(gnss_rx_t *rx, uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len)
+{
+    uint8_t buf[32];
+    rx->link->write(rx->link->ctx, buf, ubx_build_frame(cls, id, payload, len, buf));
+}
+
+static esp_err_t mtk_command(gnss_rx_t *rx, const char *body, int cmd)
+{
+    for (int i = 0; i < GNSS_RETRIES; i++) {
+        send_mtk(rx, body);
+        int res = wait_for(rx, GNSS_ACK_MS, match_mtk_ack, &cmd);
+        if (res != 0) {
+            return res > 0 ? ESP_OK : ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+    return ESP_ERR_TIMEOUT;
+}
+
+static esp_err_t ubx_command(gnss_rx_t *rx, uint8_t id, const uint8_t *payload, uint16_t len)
+{
+    const uint8_t msg[2] = { UBX_CLASS_CFG, id };
+    for (int i = 0; i < GNSS_RETRIES; i++) {
+        send_ubx(rx, UBX_CLASS_CFG, id, payload, len);
+        int res = wait_for(rx, GNSS_ACK_MS, match_ubx_ack, msg);
+        if (res != 0) {
+            return res > 0 ? ESP_OK : ESP_ERR_NOT_SUPPORTED;
+        }
+    }
+    return ESP_ERR_TIMEOUT;
+}
+
+static bool detect(gnss_rx_t *rx, uint32_t baud)
+{
+    rx->link->set_baud(rx->link->ctx, baud);
+    ubx_decoder_reset(&rx->ubx);
+    rx->line_len = 0;
+    return wait_for(rx, GNSS_DETECT_MS, match_any, NULL) > 0;
+}
+
+static esp_err_t find_receiver(gnss_rx_t *rx, const gnss_config_t *config, uint32_t *baud)
+{
+    const uint32_t start = *baud;
+    if (detect(rx, start)) {
+        return ESP_OK;
+    }
+    /* Left at the target by an earlier boot is the likely case, then the usual rates */
+    if (config->baud_rate != start && detect(rx, config->baud_rate)) {
+        *baud = config->baud_rate;
+        return ESP_OK;
+    }
+    for (size_t i = 0; i < sizeof(scan_bauds) / sizeof(scan_bauds[0]); i++) {
+        if (scan_bauds[i] != start && scan_bauds[i] != config->baud_rate && detect(rx, scan_bauds[i])) {
+            *baud = scan_bauds[i];
+            return ESP_OK;
+        }
+    }
+    rx->link->set_baud(rx->link->ctx, start);
+    return ESP_ERR_NOT_FOUND;
+}
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, v & 0xffff);
+    put_u16(p + 2, v >> 16);
+}
+
+static esp_err_t set_baud(gnss_rx_t *rx, const gnss_config_t *config, uint32_t *baud)
+{
+    for (int i = 0; i < GNSS_RETRIES; i++) {
+        if (config->type == GNSS_RECEIVER_MTK) {
+            char body[24];
+            snprintf(body, sizeof(body), "PMTK251,%u", (unsigned)config->baud_rate);
+            send_mtk(rx, body);
+        } else {
+            /* CFG-PRT for UART1: 8N1, UBX and NMEA in and out */
+            uint8_t prt[20] = { 0x01 };
+            put_u32(prt + 4, 0x000008C0);
+            put_u32(prt + 8, config->baud_rate);
+            put_u16(prt + 12, 0x0003);
+            put_u16(prt + 14, 0x0003);
+            send_ubx(rx, UBX_CLASS_CFG, UBX_ID_CFG_PRT, prt, sizeof(prt));
+        }
+        /* The receiver answers at the new rate if it answers at all, so hearing it there is the acknowledgement */
+        if (detect(rx, config->baud_rate)) {
+            *baud = config->baud_rate;
+            return ESP_OK;
+        }
+        /* Still at the old rate, or gone quiet: go back and try again */
+        detect(rx, *baud);
+    }
+    return ESP_ERR_TIMEOUT;
+}
+
+static esp_err_t set_rate(gnss_rx_t *rx, const gnss_config_t *config)
+{
+    const uint16_t period_ms = 1000 / (config->rate_hz ? config->rate_hz : 1);
+    if (config->type == GNSS_RECEIVER_MTK) {
+        char body[24];
+        snprintf(body, sizeof(body), "PMTK220,%u", period_ms);
+        return mtk_command(rx, body, 220);
+    }
+    /* CFG-RATE: measurement period, one solution per measurement, aligned to GPS time */
+    uint8_t rate[6];
+    put_u16(rate, period_ms);
+    put_u16(rate + 2, 1);
+    put_u16(rate + 4, 1);
+    return ubx_command(rx, UBX_ID_CFG_RATE, rate, sizeof(rate));
+}
+
+static esp_err_t set_statements(gnss_rx_t *rx, const gnss_config_t *config)
+{
+    const uint32_t keep = config->ubx_pvt && config->type == GNSS_RECEIVER_UBLOX ? 0 : config->statements;
+#define KEEP(statement) ((keep & (1 << (statement))) ? 1 : 0)
+    if (config->type == GNSS_RECEIVER_MTK) {
+        /* GLL, RMC, VTG, GGA, GSA, GSV, reserved, ZDA, MCHN */
+        char body[64];
+        snprintf(body, sizeof(body), "PMTK314,%d,%d,%d,%d,%d,%d,0,0,0,0,0,0,0,0,0,0,0,%d,0",
+                 KEEP(STATEMENT_GLL), KEEP(STATEMENT_RMC), KEEP(STATEMENT_VTG),
+                 KEEP(STATEMENT_GGA), KEEP(STATEMENT_GSA), KEEP(STATEMENT_GSV), KEEP(STATEMENT_ZDA));
+        return mtk_command(rx, body, 314);
+    }
+    /* CFG-MSG per sentence: class, id, rate on the current port */
+    static const struct {
+        uint8_t id;
+        uint8_t statement;
+    } nmea_msgs[] = {
+        { 0x00, STATEMENT_GGA }, { 0x01, STATEMENT_GLL }, { 0x02, STATEMENT_GSA },
+        { 0x03, STATEMENT_GSV }, { 0x04, STATEMENT_RMC }, { 0x05, STATEMENT_VTG },
+        { 0x07, STATEMENT_GST }, { 0x08, STATEMENT_ZDA }, { 0x09, STATEMENT_GBS },
+        { 0x0A, STATEMENT_DTM }, { 0x0D, STATEMENT_GNS },
+    };
+    esp_err_t err = ESP_OK;
+    for (size_t i = 0; i < sizeof(nmea_msgs) / sizeof(nmea_msgs[0]); i++) {
+        const uint8_t msg[3] = { UBX_CLASS_NMEA, nmea_msgs[i].id, KEEP(nmea_msgs[i].statement) };
+        esp_err_t res = ubx_command(rx, UBX_ID_CFG_MSG, msg, sizeof(msg));
+        err = err == ESP_OK ? res : err;
+    }
+    const uint8_t pvt[3] = { UBX_CLASS_NAV, UBX_ID_NAV_PVT, config->ubx_pvt ? 1 : 0 };
+    esp_err_t res = ubx_command(rx, UBX_ID_CFG_MSG, pvt, sizeof(pvt));
+    return err == ESP_OK ? res : err;
+#undef KEEP
+}
+
+esp_err_t gnss_config_run(const gnss_link_t *link, const gnss_config_t *config, uint32_t *baud)
+{
+    static gnss_rx_t rx;
+    esp_err_t err, result = ESP_OK;
+
+    if (config->type == GNSS_RECEIVER_NONE) {
+        return ESP_OK;
+    }
+    memset(&rx, 0, sizeof(rx));
+    rx.link = link;
+    err = find_receiver(&rx, config, baud);
+    if (err != ESP_OK) {
+        ESP_LOGW(GNSS_CONFIG_TAG, "receiver not heard at any baud rate");
+        return err;
+    }
+    ESP_LOGI(GNSS_CONFIG_TAG, "receiver found at %u baud", (unsigned)*baud);
+    /* Baud first, a 10 Hz sentence set doesn't fit at 9600 */
+    if (*baud != config->baud_rate) {
+        err = set_baud(&rx, config, baud);
+        if (err != ESP_OK) {
+            ESP_LOGW(GNSS_CONFIG_TAG, "receiver did not move to %u baud", (unsigned)config->baud_rate);
+            result = err;
+        }
+    }
+    err = set_statements(&rx, config);
+    if (err != ESP_OK) {
+        ESP_LOGW(GNSS_CONFIG_TAG, "sentence selection not acknowledged: %s", esp_err_to_name(err));
+        result = err;
+    }
+    err = set_rate(&rx, config);
+    if (err != ESP_OK) {
+        ESP_LOGW(GNSS_CONFIG_TAG, "rate not acknowledged: %s", esp_err_to_name(err));
+        result = err;
+    }
+    ESP_LOGI(GNSS_CONFIG_TAG, "%u baud, %u Hz", (unsigned)*baud, (unsigned)config->rate_hz);
+    return result;
+}
@@ -0,0 +1,93 @@
+/* GNSS receiver configuration
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+/**
+ * @brief Command set understood by the receiver
+ *
+ */
+typedef enum {
+    GNSS_RECEIVER_NONE,     /*!< Leave the receiver as it is */
+    GNSS_RECEIVER_MTK,      /*!< MediaTek $PMTK commands */
+    GNSS_RECEIVER_UBLOX,    /*!< u-blox UBX CFG messages */
+} gnss_receiver_t;
+
+/**
+ * @brief Receiver settings to apply
+ *
+ */
+typedef struct {
+    gnss_receiver_t type;   /*!< Command set, GNSS_RECEIVER_NONE skips configuration */
+    uint32_t baud_rate;     /*!< Baud rate to move the receiver to */
+    uint32_t rate_hz;       /*!< Navigation rate */
+    uint32_t statements;    /*!< Sentences to keep, bit (1 << nmea_statement_t) per statement, the rest are turned off */
+    bool ubx_pvt;           /*!< u-blox only: output UBX NAV-PVT and turn every NMEA sentence off */
+} gnss_config_t;
+
+#if CONFIG_GNSS_RECEIVER_UBX_PVT
+#define GNSS_CONFIG_UBX_PVT_DEFAULT true
+#else
+#define GNSS_CONFIG_UBX_PVT_DEFAULT false
+#endif
+
+/**
+ * @brief Default receiver settings
+ *
+ * The statements to keep are filled in by the NMEA parser from the statements it parses.
+ */
+#define GNSS_CONFIG_DEFAULT()                           \
+    {                                                   \
+        .type = CONFIG_GNSS_RECEIVER_TYPE,              \
+        .baud_rate = CONFIG_GNSS_RECEIVER_BAUD_RATE,    \
+        .rate_hz = CONFIG_GNSS_RECEIVER_RATE_HZ,        \
+        .statements = 0,                                \
+        .ubx_pvt = GNSS_CONFIG_UBX_PVT_DEFAULT,         \
+    }
+
+/**
+ * @brief Byte link to the receiver, the UART on target and a scripted fake receiver on a host
+ *
+ */
+typedef struct {
+    esp_err_t (*set_baud)(void *ctx, uint32_t baud);                        /*!< Change the link baud rate */
+    int (*write)(void *ctx, const uint8_t *data, size_t len);              /*!< Send, returns once the bytes are on the wire */
+    int (*read)(void *ctx, uint8_t *buf, size_t len, uint32_t timeout_ms);  /*!< Receive, returns 0 on timeout */
+    void *ctx;                                                              /*!< Passed to every call */
+} gnss_link_t;
+
+/**
+ * @brief Find the receiver's baud rate and apply the settings
+ *
+ * The receiver is looked for at the current baud rate, then at the target, then at the other common
+ * rates, so a receiver left at any of them by an earlier boot is found. The baud rate is changed first so
+ * the higher navigation rate fits on the wire, and checked by listening at the new rate. Every other
+ * command is repeated until the receiver acknowledges it, up to three times.
+ *
+ * @param link link to the receiver
+ * @param config settings to apply
+ * @param baud baud rate of the link on entry, updated to the rate the link is left at
+ * @return esp_err_t ESP_OK if every setting was acknowledged, ESP_ERR_NOT_FOUND if the receiver was not heard
+ *         at any baud rate, ESP_ERR_TIMEOUT if a setting was not acknowledged, ESP_ERR_NOT_SUPPORTED if one
+ *         was refused. Settings after a failed one are still tried.
+ */
+esp_err_t gnss_config_run(const gnss_link_t *link, const gnss_config_t *config, uint32_t *baud);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,154 @@
+/* GNSS and compass Kalman filter
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <math.h>
+#include "nav_filter.h"
+#include "geo.h"
+
+/* Initial uncertainty of states that are not measured directly */
+#define NAV_INIT_VEL_VAR (4.0f)
+#define NAV_INIT_RATE_VAR (100.0f)
+
+/**
+ * @brief Fuse a direct measurement of one state
+ *
+ * Measurements are independent, so fusing them one at a time is exact and needs no matrix inversion.
+ *
+ * @param kf filter
+ * @param k index of the measured state
+ * @param innovation measurement minus the current estimate of the state
+ * @param r measurement variance
+ */
+static void update_scalar(nav_filter_t *kf, int k, float innovation, float r)
+{
+    float row[NAV_STATES];
+    float gain[NAV_STATES];
+    float s = kf->P[k][k] + r;
+    for (int i = 0; i < NAV_STATES; i++) {
+        row[i] = kf->P[k][i];
+        gain[i] = kf->P[i][k] / s;
+    }
+    for (int i = 0; i < NAV_STATES; i++) {
+        kf->x[i] += gain[i] * innovation;
+        for (int j = 0; j < NAV_STATES; j++) {
+            kf->P[i][j] -= gain[i] * row[j];
+        }
+    }
+}
+
+/**
+ * @brief Reset one state to a value with the given variance, uncorrelated with the others
+ *
+ */
+static void seed_state(nav_filter_t *kf, int k, float value, float var)
+{
+    for (int i = 0; i < NAV_STATES; i++) {
+        kf->P[k][i] = 0;
+        kf->P[i][k] = 0;
+    }
+    kf->x[k] = value;
+    kf->P[k][k] = var;
+}
+
+/**
+ * @brief Add the discrete white noise acceleration model of one position/velocity pair to P
+ *
+ */
+static void add_process_noise(nav_filter_t *kf, int pos, int vel, float sigma, float dt)
+{
+    float q = sigma * sigma;
+    float dt2 = dt * dt;
+    kf->P[pos][pos] += q * dt2 * dt2 / 4;
+    kf->P[pos][vel] += q * dt2 * dt / 2;
+    kf->P[vel][pos] += q * dt2 * dt / 2;
+    kf->P[vel][vel] += q * dt2;
+}
+
+void nav_filter_init(nav_filter_t *kf, const nav_filter_config_t *config)
+{
+    memset(kf, 0, sizeof(nav_filter_t));
+    kf->config = *config;
+}
+
+void nav_filter_predict(nav_filter_t *kf, float dt)
+{
+    static const int pairs[3][2] = {{NAV_N, NAV_VN}, {NAV_E, NAV_VE}, {NAV_PSI, NAV_RATE}};
+    if (dt <= 0) {
+        return;
+    }
+    /* x = F x, F is the identity plus dt coupling each position to its rate */
+    for (int p = 0; p < 3; p++) {
+        kf->x[pairs[p][0]] += kf->x[pairs[p][1]] * dt;
+    }
+    kf->x[NAV_PSI] = fmodf(kf->x[NAV_PSI] + 360.0f, 360.0f);
+    /* P = F P F', done as row then column operations since F is sparse */
+    for (int p = 0; p < 3; p++) {
+        for (int j = 0; j < NAV_STATES; j++) {
+            kf->P[pairs[p][0]][j] += dt * kf->P[pairs[p][1]][j];
+        }
+    }
+    for (int p = 0; p < 3; p++) {
+        for (int i = 0; i < NAV_STATES; i++) {
+            kf->P[i][pairs[p][0]] += dt * kf->P[i][pairs[p][1]];
+        }
+    }
+    add_process_noise(kf, NAV_N, NAV_VN, kf->config.accel_sigma, dt);
+    add_process_noise(kf, NAV_E, NAV_VE, kf->config.accel_sigma, dt);
+    add_process_noise(kf, NAV_PSI, NAV_RATE, kf->config.yaw_accel_sigma, dt);
+}
+
+void nav_filter_update_position(nav_filter_t *kf, float north, float east, float dop_h)
+{
+    float sigma = kf->config.uere_m * (dop_h > 0 ? dop_h : 1.0f);
+    nav_filter_update_position_sigma(kf, north, east, sigma, sigma);
+}
+
+void nav_filter_update_position_sigma(nav_filter_t *kf, float north, float east, float sigma_n, float sigma_e)
+{
+    float r_n = sigma_n * sigma_n;
+    float r_e = sigma_e * sigma_e;
+    if (!kf->position_valid) {
+        /* Seed from the first fix */
+        seed_state(kf, NAV_N, north, r_n);
+        seed_state(kf, NAV_E, east, r_e);
+        seed_state(kf, NAV_VN, 0, NAV_INIT_VEL_VAR);
+        seed_state(kf, NAV_VE, 0, NAV_INIT_VEL_VAR);
+        kf->position_valid = true;
+        return;
+    }
+    update_scalar(kf, NAV_N, north - kf->x[NAV_N], r_n);
+    update_scalar(kf, NAV_E, east - kf->x[NAV_E], r_e);
+}
+
+void nav_filter_update_velocity(nav_filter_t *kf, float speed, float cog)
+{
+    float r = kf->config.speed_sigma * kf->config.speed_sigma;
+    float vn = speed * cosf(cog * GEO_DEG_TO_RAD);
+    float ve = speed * sinf(cog * GEO_DEG_TO_RAD);
+    if (!kf->position_valid) {
+        return;
+    }
+    update_scalar(kf, NAV_VN, vn - kf->x[NAV_VN], r);
+    update_scalar(kf, NAV_VE, ve - kf->x[NAV_VE], r);
+}
+
+void nav_filter_update_heading(nav_filter_t *kf, float heading)
+{
+    float r = kf->config.heading_sigma * kf->config.heading_sigma;
+    if (!kf->heading_valid) {
+        seed_state(kf, NAV_PSI, heading, r);
+        seed_state(kf, NAV_RATE, 0, NAV_INIT_RATE_VAR);
+        kf->heading_valid = true;
+        return;
+    }
+    /* Innovation is taken the short way round */
+    update_scalar(kf, NAV_PSI, geo_wrap180(heading - kf->x[NAV_PSI]), r);
+    kf->x[NAV_PSI] = fmodf(kf->x[NAV_PSI] + 360.0f, 360.0f);
+}
@@ -0,0 +1,126 @@
+/* GNSS and compass Kalman filter
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Filter states
+ *
+ */
+typedef enum {
+    NAV_N,       /*!< Position north of the local reference (metres) */
+    NAV_E,       /*!< Position east of the local reference (metres) */
+    NAV_VN,      /*!< Velocity north (m/s) */
+    NAV_VE,      /*!< Velocity east (m/s) */
+    NAV_PSI,     /*!< Heading (degrees, 0..360) */
+    NAV_RATE,    /*!< Turn rate (deg/s) */
+    NAV_STATES
+} nav_state_t;
+
+/**
+ * @brief Noise model of the filter
+ *
+ */
+typedef struct {
+    float accel_sigma;       /*!< Random walk of the velocity (m/s^2) */
+    float yaw_accel_sigma;   /*!< Random walk of the turn rate (deg/s^2) */
+    float uere_m;            /*!< Range error of the receiver, scaled by HDOP into the position noise (metres) */
+    float speed_sigma;       /*!< Noise of each velocity component derived from SOG/COG (m/s) */
+    float heading_sigma;     /*!< Noise of the magnetometer heading (degrees) */
+} nav_filter_config_t;
+
+/**
+ * @brief Default noise model, a small boat with a consumer grade receiver
+ *
+ */
+#define NAV_FILTER_CONFIG_DEFAULT() \
+    {                               \
+        .accel_sigma = 0.2f,        \
+        .yaw_accel_sigma = 10.0f,   \
+        .uere_m = 2.0f,             \
+        .speed_sigma = 0.3f,        \
+        .heading_sigma = 8.0f       \
+    }
+
+/**
+ * @brief Filter state, all storage is fixed size
+ *
+ */
+typedef struct {
+    nav_filter_config_t config;          /*!< Noise model */
+    float x[NAV_STATES];                 /*!< State estimate */
+    float P[NAV_STATES][NAV_STATES];     /*!< State covariance */
+    bool position_valid;                 /*!< Position has been initialised from a fix */
+    bool heading_valid;                  /*!< Heading has been initialised from the compass */
+} nav_filter_t;
+
+/**
+ * @brief Initialise the filter, the first measurements of each kind seed the state
+ *
+ * @param kf filter
+ * @param config noise model
+ */
+void nav_filter_init(nav_filter_t *kf, const nav_filter_config_t *config);
+
+/**
+ * @brief Propagate the state with a constant velocity, constant turn rate model
+ *
+ * @param kf filter
+ * @param dt time step (seconds)
+ */
+void nav_filter_predict(nav_filter_t *kf, float dt);
+
+/**
+ * @brief Fuse a GNSS position
+ *
+ * @param kf filter
+ * @param north metres north of the local reference
+ * @param east metres east of the local reference
+ * @param dop_h horizontal dilution of precision of the fix
+ */
+void nav_filter_update_position(nav_filter_t *kf, float north, float east, float dop_h);
+
+/**
+ * @brief Fuse a GNSS position with the receiver's own error estimate
+ *
+ * @param kf filter
+ * @param north metres north of the local reference
+ * @param east metres east of the local reference
+ * @param sigma_n one standard deviation of the north error (m)
+ * @param sigma_e one standard deviation of the east error (m)
+ */
+void nav_filter_update_position_sigma(nav_filter_t *kf, float north, float east, float sigma_n, float sigma_e);
+
+/**
+ * @brief Fuse a GNSS velocity
+ *
+ * @param kf filter
+ * @param speed speed over ground (m/s)
+ * @param cog course over ground (degrees true)
+ */
+void nav_filter_update_velocity(nav_filter_t *kf, float speed, float cog);
+
+/**
+ * @brief Fuse a compass heading
+ *
+ * @param kf filter
+ * @param heading heading (degrees)
+ */
+void nav_filter_update_heading(nav_filter_t *kf, float heading);
+
+#ifdef __cplusplus
+}
+#endif
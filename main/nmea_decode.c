@@ -0,0 +1,466 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <ctype.h>
+#include <math.h>
+#include "sdkconfig.h"
+#include "nmea_decode.h"
+
+/**
+ * @brief Copy the current item into a char array, cut to fit
+ *
+ * @param dec decoder
+ * @param dest char array
+ * @param size size of dest
+ */
+static void copy_item(const nmea_decoder_t *dec, char *dest, size_t size)
+{
+    size_t len = strnlen(dec->item_str, size - 1);
+    memcpy(dest, dec->item_str, len);
+    dest[len] = '\0';
+}
+
+/**
+ * @brief Read the current item as a decimal integer, the same as strtol()
+ *
+ * NMEA items are plain digits, which are converted here; anything else is left to strtol().
+ *
+ * @param dec decoder
+ * @return long value, 0 for an empty item
+ */
+static long item_int(const nmea_decoder_t *dec)
+{
+    const char *s = dec->item_str;
+    bool neg = *s == '-';
+    long v = 0;
+    if (neg || *s == '+') {
+        s++;
+    }
+    const char *digits = s;
+    while (*s >= '0' && *s <= '9') {
+        v = 10 * v + (*s++ - '0');
+    }
+    if (*s || s - digits > 9) {
+        return strtol(dec->item_str, NULL, 10);
+    }
+    return neg ? -v : v;
+}
+
+/**
+ * @brief Read the current item as a decimal number, the same as strtof()
+ *
+ * strtof() is a large part of the time spent on a sentence, on the host and more so on the ESP32 where
+ * it works in software doubles. An item of digits with one point is an integer over a power of ten:
+ * when both are exact floats a single float division rounds like strtof(), otherwise the division is
+ * done in double. Anything else is left to strtof().
+ *
+ * @param dec decoder
+ * @return float value, 0 for an empty item
+ */
+static float item_float(const nmea_decoder_t *dec)
+{
+    static const float pow10f[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+    static const double pow10[] = {1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15};
+    const char *s = dec->item_str;
+    bool neg = *s == '-';
+    bool point = false;
+    int64_t v = 0;
+    int digits = 0;
+    int decimals = 0;
+    if (neg || *s == '+') {
+        s++;
+    }
+    for (;; s++) {
+        if (*s >= '0' && *s <= '9') {
+            v = 10 * v + (*s - '0');
+            digits++;
+            decimals += point;
+        } else if (*s == '.' && !point) {
+            point = true;
+        } else {
+            break;
+        }
+    }
+    if (*s || digits > 15) {
+        return strtof(dec->item_str, NULL);
+    }
+    if (digits == 0) {
+        /* Nothing converted, strtof() gives +0 even after a '-' */
+        return 0;
+    }
+    float f;
+    if (v < (1 << 24) && decimals <= 10) {
+        f = (float)v / pow10f[decimals];
+    } else {
+        f = (float)((double)v / pow10[decimals]);
+    }
+    return neg ? -f : f;
+}
+
+/**
+ * @brief parse latitude or longitude
+ *              format of latitude in NMEA is ddmm.sss and longitude is dddmm.sss
+ *
+ * The digits are converted to 1e-7 degrees exactly, a float only holds a longitude to about a metre.
+ *
+ * @param dec decoder
+ * @param e7 filled with the value in 1e-7 degrees, rounded to the nearest
+ * @return float Latitude or Longitude value (unit: degree), 0 with e7 0 if the item is empty or malformed
+ */
+static float parse_lat_long(nmea_decoder_t *dec, int32_t *e7)
+{
+    const char *s = dec->item_str;
+    uint32_t whole = 0, frac = 0;
+    int digits = 0, decimals = 0;
+
+    *e7 = 0;
+    for (; *s >= '0' && *s <= '9'; s++) {
+        whole = whole * 10 + (*s - '0');
+        digits++;
+    }
+    if (*s == '.') {
+        for (s++; *s >= '0' && *s <= '9'; s++) {
+            /* Past 1e-7 minutes is well under a millimetre */
+            if (decimals < 7) {
+                frac = frac * 10 + (*s - '0');
+                decimals++;
+            }
+        }
+    }
+    /* dddmm at most, and no more than 180 degrees */
+    if (digits == 0 || digits > 5 || *s || whole / 100 > 180) {
+        return 0;
+    }
+    for (; decimals < 7; decimals++) {
+        frac *= 10;
+    }
+    uint32_t deg = whole / 100;
+    uint32_t min_e7 = (whole % 100) * (uint32_t)10000000 + frac;
+    *e7 = (int32_t)(deg * 10000000 + (min_e7 + 30) / 60);
+    return deg + min_e7 / 6e8f;
+}
+
+/**
+ * @brief Converter two continuous numeric character into a uint8_t number
+ *
+ * @param digit_char numeric character
+ * @return uint8_t result of converting
+ */
+static inline uint8_t convert_two_digit2number(const char *digit_char)
+{
+    return 10 * (digit_char[0] - '0') + (digit_char[1] - '0');
+}
+
+/**
+ * @brief Parse UTC time in GPS statements
+ *
+ * @param dec decoder
+ * @param tim filled with the time, the fraction of a second is read as milliseconds
+ */
+static void parse_utc_time(nmea_decoder_t *dec, gps_time_t *tim)
+{
+    tim->hour = convert_two_digit2number(dec->item_str + 0);
+    tim->minute = convert_two_digit2number(dec->item_str + 2);
+    tim->second = convert_two_digit2number(dec->item_str + 4);
+    if (dec->item_str[6] == '.') {
+        /* Up to three decimals, ".5" is 500 ms */
+        uint16_t tmp = 0;
+        const char *frac = dec->item_str + 7;
+        for (int i = 0; i < 3; i++) {
+            tmp = 10 * tmp + (isdigit((unsigned char)*frac) ? *frac++ - '0' : 0);
+        }
+        tim->thousand = tmp;
+    }
+}
+
+/**
+ * @brief Parse a field of one of the four satellites in a GSV statement
+ *
+ * @param dec decoder
+ * @param slot satellite in the statement, 0..3
+ * @return gps_satellite_t* satellite to fill, NULL if it doesn't fit
+ */
+static gps_satellite_t *gsv_satellite(nmea_decoder_t *dec, int slot)
+{
+    int index = 4 * (dec->sat_num - 1) + slot;
+    if (index < 0 || index >= GPS_MAX_SATELLITES_IN_VIEW) {
+        return NULL;
+    }
+    return &dec->gps.sats_desc_in_view[index];
+}
+
+/**
+ * @brief Parse the GNS mode indicator, one character per constellation
+ *
+ * @param dec decoder
+ */
+static void parse_gns_mode(nmea_decoder_t *dec)
+{
+    /* N no fix, D differential, the other modes are a fix */
+    gps_fix_t fix = GPS_FIX_INVALID;
+    copy_item(dec, dec->gps.mode, sizeof(dec->gps.mode));
+    for (const char *m = dec->gps.mode; *m; m++) {
+        if (*m == 'D') {
+            fix = GPS_FIX_DGPS;
+        } else if (*m != 'N' && fix == GPS_FIX_INVALID) {
+            fix = GPS_FIX_GPS;
+        }
+    }
+    dec->gps.fix = fix;
+}
+
+/* Item decoders by field type, see nmea_schema.h */
+#define NMEA_DECODE_TIME(dec, dest, scale, arg) parse_utc_time(dec, &(dec)->gps.dest)
+#define NMEA_DECODE_DATE(dec, dest, scale, arg)                                         \
+    do {                                                                                \
+        (dec)->gps.dest.day = convert_two_digit2number((dec)->item_str + 0);            \
+        (dec)->gps.dest.month = convert_two_digit2number((dec)->item_str + 2);          \
+        (dec)->gps.dest.year = convert_two_digit2number((dec)->item_str + 4);           \
+    } while (0)
+#define NMEA_DECODE_LAT(dec, dest, scale, arg) ((dec)->gps.dest = parse_lat_long(dec, &(dec)->gps.dest##_e7))
+#define NMEA_DECODE_LON(dec, dest, scale, arg) ((dec)->gps.dest = parse_lat_long(dec, &(dec)->gps.dest##_e7))
+#define NMEA_DECODE_NS(dec, dest, scale, arg)                                           \
+    do {                                                                                \
+        if ((dec)->item_str[0] == 'S' || (dec)->item_str[0] == 's') {                   \
+            (dec)->gps.dest *= -1;                                                      \
+            (dec)->gps.dest##_e7 *= -1;                                                 \
+        }                                                                               \
+    } while (0)
+#define NMEA_DECODE_EW(dec, dest, scale, arg)                                           \
+    do {                                                                                \
+        if ((dec)->item_str[0] == 'W' || (dec)->item_str[0] == 'w') {                   \
+            (dec)->gps.dest *= -1;                                                      \
+            (dec)->gps.dest##_e7 *= -1;                                                 \
+        }                                                                               \
+    } while (0)
+#define NMEA_DECODE_SIGN_NS(dec, dest, scale, arg)                                      \
+    do {                                                                                \
+        if ((dec)->item_str[0] == 'S' || (dec)->item_str[0] == 's') {                   \
+            (dec)->gps.dest *= -1;                                                      \
+        }                                                                               \
+    } while (0)
+#define NMEA_DECODE_SIGN_EW(dec, dest, scale, arg)                                      \
+    do {                                                                                \
+        if ((dec)->item_str[0] == 'W' || (dec)->item_str[0] == 'w') {                   \
+            (dec)->gps.dest *= -1;                                                      \
+        }                                                                               \
+    } while (0)
+#define NMEA_DECODE_FLOAT(dec, dest, scale, arg) ((dec)->gps.dest = item_float(dec) * (scale))
+#define NMEA_DECODE_ABS(dec, dest, scale, arg) NMEA_DECODE_FLOAT(dec, dest, scale, arg)
+#define NMEA_DECODE_SUM(dec, dest, scale, arg) ((dec)->gps.dest += item_float(dec) * (scale))
+#define NMEA_DECODE_INT(dec, dest, scale, arg) ((dec)->gps.dest = item_int(dec))
+#define NMEA_DECODE_ID(dec, dest, scale, arg) NMEA_DECODE_INT(dec, dest, scale, arg)
+#define NMEA_DECODE_YEAR(dec, dest, scale, arg) ((dec)->gps.dest = item_int(dec) - 2000)
+#define NMEA_DECODE_VALID(dec, dest, scale, arg) ((dec)->gps.dest = ((dec)->item_str[0] == 'A'))
+#define NMEA_DECODE_STR(dec, dest, scale, arg) copy_item(dec, (dec)->gps.dest, sizeof((dec)->gps.dest))
+#define NMEA_DECODE_CONST(dec, dest, scale, arg) ((void)0)
+#define NMEA_DECODE_MSG_COUNT(dec, dest, scale, arg) ((dec)->dest = item_int(dec))
+#define NMEA_DECODE_MSG_NUM(dec, dest, scale, arg) ((dec)->dest = item_int(dec))
+#define NMEA_DECODE_SAT(dec, dest, scale, arg)                                          \
+    do {                                                                                \
+        gps_satellite_t *sat = gsv_satellite(dec, arg);                                 \
+        if (sat) {                                                                      \
+            sat->dest = item_int(dec);                                                  \
+        }                                                                               \
+    } while (0)
+#define NMEA_DECODE_MODE(dec, dest, scale, arg) parse_gns_mode(dec)
+#define NMEA_DECODE_DEVIATION(dec, dest, scale, arg) ((dec)->hdg_correction = item_float(dec))
+#define NMEA_DECODE_DEVIATION_EW(dec, dest, scale, arg)                                 \
+    do {                                                                                \
+        if ((dec)->item_str[0] == 'W' || (dec)->item_str[0] == 'w') {                   \
+            (dec)->hdg_correction *= -1;                                                \
+        }                                                                               \
+        (dec)->gps.dest = fmodf((dec)->gps.dest + (dec)->hdg_correction + 360.0f, 360.0f); \
+    } while (0)
+
+#define NMEA_DECODE_CASE(index, type, dest, scale, arg) \
+    case index:                                         \
+        NMEA_DECODE_##type(dec, dest, scale, arg);      \
+        break;
+
+/* parse_gga(), parse_gsa()... one switch on the item number per statement, as a hand written one would be */
+#define NMEA_PARSE_FUNC(NAME, name, fields)             \
+    static void parse_##name(nmea_decoder_t *dec)       \
+    {                                                   \
+        switch (dec->item_num) {                        \
+        NMEA_FIELDS_##NAME(NMEA_DECODE_CASE)            \
+        default:                                        \
+            break;                                      \
+        }                                               \
+    }
+NMEA_STATEMENT_LIST(NMEA_PARSE_FUNC)
+
+void nmea_decoder_init(nmea_decoder_t *dec)
+{
+    memset(dec, 0, sizeof(*dec));
+}
+
+nmea_statement_t nmea_decode_header(const char *header)
+{
+    const char *formatter = header + 3;
+#define NMEA_MATCH_HEADER(NAME, name, fields)                                     \
+    if (NMEA_STATEMENT_BUILT(NAME) && !memcmp(formatter, #NAME, 3)) {             \
+        return STATEMENT_##NAME;                                                  \
+    }
+    NMEA_STATEMENT_LIST(NMEA_MATCH_HEADER)
+#undef NMEA_MATCH_HEADER
+    return STATEMENT_UNKNOWN;
+}
+
+bool nmea_statement_mask_parse(const char *list, uint32_t *mask)
+{
+    static const struct {
+        const char *name;
+        nmea_statement_t statement;
+    } names[] = {
+#define NMEA_NAME_ENTRY(NAME, name, fields) { #name, STATEMENT_##NAME },
+        NMEA_STATEMENT_LIST(NMEA_NAME_ENTRY)
+#undef NMEA_NAME_ENTRY
+        { "unknown", STATEMENT_UNKNOWN },
+    };
+    uint32_t value = 0;
+
+    do {
+        size_t len = strcspn(list, ",");
+        size_t i;
+        for (i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+            if (len == strlen(names[i].name) && strncasecmp(list, names[i].name, len) == 0) {
+                value |= 1 << names[i].statement;
+                break;
+            }
+        }
+        /* An empty list or name matches nothing */
+        if (i == sizeof(names) / sizeof(names[0])) {
+            return false;
+        }
+        list += len;
+    } while (*list++ == ',');
+    *mask = value;
+    return true;
+}
+
+bool nmea_statement_masks_valid(uint32_t built, uint32_t enabled, uint32_t required)
+{
+    const uint32_t allowed = built | (1 << STATEMENT_UNKNOWN);
+    return !(enabled & ~allowed) && !(required & ~enabled) && !(required & (1 << STATEMENT_UNKNOWN)) && required;
+}
+
+/**
+ * @brief Parse received item
+ *
+ * @param dec decoder
+ */
+static void parse_item(nmea_decoder_t *dec)
+{
+    /* start of a statement */
+    if (dec->item_num == 0 && dec->item_str[0] == '$') {
+        /* Talker IDs are two characters, a longer address is proprietary */
+        if (strlen(dec->item_str) == NMEA_HEADER_LEN) {
+            dec->statement = nmea_decode_header(dec->item_str);
+        } else {
+            dec->statement = STATEMENT_UNKNOWN;
+        }
+        return;
+    }
+    /* Parse each item, depend on the type of the statement */
+    switch (dec->statement) {
+#define NMEA_PARSE_CASE(NAME, name, fields)             \
+    case STATEMENT_##NAME:                              \
+        if (NMEA_STATEMENT_BUILT(NAME)) {               \
+            parse_##name(dec);                          \
+        }                                               \
+        break;
+    NMEA_STATEMENT_LIST(NMEA_PARSE_CASE)
+#undef NMEA_PARSE_CASE
+    default:
+        break;
+    }
+}
+
+nmea_decode_result_t nmea_decode_line(nmea_decoder_t *dec, const char *line, uint32_t required)
+{
+    /* Kept out of the decoder while the line is read, the compiler can't hold them in registers across
+       the character stores into item_str otherwise */
+    uint8_t crc = 0;
+    bool asterisk = false;
+    size_t item_pos = 0;
+
+    for (const char *d = line; *d && *d != '\r' && *d != '\n'; d++) {
+        /* Start of a statement */
+        if (*d == '$') {
+            /* Reset runtime information */
+            asterisk = false;
+            item_pos = 0;
+            crc = 0;
+            dec->item_num = 0;
+            dec->statement = STATEMENT_UNKNOWN;
+            dec->sat_count = 0;
+            dec->sat_num = 0;
+            /* Add character to item */
+            dec->item_str[item_pos++] = *d;
+        }
+        /* Detect item separator character */
+        else if (*d == ',') {
+            /* Parse current item */
+            dec->item_str[item_pos] = '\0';
+            parse_item(dec);
+            /* Add character to CRC computation */
+            crc ^= (uint8_t)(*d);
+            /* Start with next item */
+            item_pos = 0;
+            dec->item_num++;
+        }
+        /* End of CRC computation */
+        else if (*d == '*') {
+            /* Parse current item */
+            dec->item_str[item_pos] = '\0';
+            parse_item(dec);
+            /* Asterisk detected */
+            asterisk = true;
+            /* Start with next item */
+            item_pos = 0;
+            dec->item_num++;
+        }
+        /* Other non-space character */
+        else {
+            if (!asterisk) {
+                /* Add to CRC */
+                crc ^= (uint8_t)(*d);
+            }
+            /* Add character to item */
+            if (item_pos < NMEA_MAX_STATEMENT_ITEM_LENGTH - 1) {
+                dec->item_str[item_pos++] = *d;
+            }
+        }
+    }
+    dec->item_str[item_pos] = '\0';
+    /* End of statement, convert received CRC from string (hex) to number */
+    if (!asterisk || (uint8_t)strtol(dec->item_str, NULL, 16) != crc) {
+        return NMEA_DECODE_CRC_ERROR;
+    }
+    if (dec->statement != STATEMENT_UNKNOWN && (dec->statement != STATEMENT_GSV || dec->sat_num == dec->sat_count)) {
+        /* GSV counts once its last statement is in */
+        dec->parsed_statement |= 1 << dec->statement;
+    }
+    /* Check if all statements have been parsed */
+    if ((dec->parsed_statement & required) == required) {
+        dec->gps.statements = dec->parsed_statement;
+        dec->parsed_statement = 0;
+        return NMEA_DECODE_UPDATE;
+    }
+    return NMEA_DECODE_OK;
+}
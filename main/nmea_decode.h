@@ -0,0 +1,110 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nmea_gps.h"
+
+#define NMEA_MAX_STATEMENT_ITEM_LENGTH (16)
+#define NMEA_HEADER_LEN (6)                        /* "$" + talker + formatter, e.g. "$GPGGA" */
+
+/**
+ * @brief Result of decoding one line
+ *
+ */
+typedef enum {
+    NMEA_DECODE_CRC_ERROR, /*!< Checksum missing or wrong, gps may hold some of the line's items */
+    NMEA_DECODE_OK,        /*!< Statement decoded into gps */
+    NMEA_DECODE_UPDATE,    /*!< Statement decoded and every required statement is in, gps is a complete update */
+} nmea_decode_result_t;
+
+/**
+ * @brief Statement decoder state
+ *
+ * Holds no OS objects and does no I/O, so it is shared by the parser task and the host tools. One decoder
+ * per stream, the lines of a stream must be given in order.
+ *
+ */
+typedef struct {
+    uint8_t item_num;                              /*!< Current item number */
+    uint32_t parsed_statement;                     /*!< OR'd of statements that have been parsed */
+    uint8_t sat_num;                               /*!< GSV sentence number in its group */
+    uint8_t sat_count;                             /*!< GSV sentences in the group */
+    uint8_t statement;                             /*!< Statement of the last line, nmea_statement_t */
+    float hdg_correction;                          /*!< HDG deviation being read */
+    char item_str[NMEA_MAX_STATEMENT_ITEM_LENGTH]; /*!< Current item */
+    gps_t gps;                                     /*!< Decoded values, updated item by item */
+} nmea_decoder_t;
+
+/**
+ * @brief Reset a decoder
+ *
+ * @param dec decoder
+ */
+void nmea_decoder_init(nmea_decoder_t *dec);
+
+/**
+ * @brief Identify a statement from its header
+ *
+ * @param header "$" followed by the 2 character talker and the formatter, at least NMEA_HEADER_LEN characters
+ * @return nmea_statement_t statement, STATEMENT_UNKNOWN if it is not one that is compiled in
+ */
+nmea_statement_t nmea_decode_header(const char *header);
+
+/**
+ * @brief Read a comma separated list of statement names into a mask
+ *
+ * Names are the lower case formatters, e.g. "gga,rmc", in any case. "unknown" stands for every statement
+ * the decoder doesn't know.
+ *
+ * @param list names, terminated
+ * @param mask filled with bit (1 << nmea_statement_t) per name, left alone on failure
+ * @return true on success, false if the list is empty or holds an empty or unknown name
+ */
+bool nmea_statement_mask_parse(const char *list, uint32_t *mask);
+
+/**
+ * @brief Check a set of enabled and required statements
+ *
+ * @param built statements compiled in
+ * @param enabled statements to parse, STATEMENT_UNKNOWN included
+ * @param required statements to wait for before an update
+ * @return true if every enabled statement is built, every required one is enabled and at least one is
+ *         required, otherwise every statement would be an update on its own
+ */
+bool nmea_statement_masks_valid(uint32_t built, uint32_t enabled, uint32_t required);
+
+/**
+ * @brief Decode one NMEA line into the decoder's GPS object
+ *
+ * The line starts at '$' and ends at "\r\n", '\n' or the terminator. Items are decoded as they are met,
+ * the checksum is only known at the end. Statements the decoder doesn't know are checksummed but not
+ * decoded, dec->statement is then STATEMENT_UNKNOWN.
+ *
+ * @param dec decoder
+ * @param line terminated line
+ * @param required statements to wait for before reporting an update, bit (1 << nmea_statement_t) each
+ * @return nmea_decode_result_t result
+ */
+nmea_decode_result_t nmea_decode_line(nmea_decoder_t *dec, const char *line, uint32_t required);
+
+#ifdef __cplusplus
+}
+#endif
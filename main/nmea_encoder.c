@@ -0,0 +1,352 @@
+/* NMEA 0183 sentence encoder
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdbool.h>
+#include <string.h>
+#include <math.h>
+#include "numfmt.h"
+#include "nmea_encoder.h"
+
+/* Output position while a statement is written */
+typedef struct {
+    char *p;            /* Next character */
+    char *end;          /* End of the usable output */
+    bool overflow;      /* Something didn't fit */
+    bool in_body;       /* Between '$' and '*', characters go into the checksum */
+    uint8_t crc;        /* Checksum of the sentence so far */
+    uint8_t item;       /* Field being written, 0 is the address */
+    uint8_t page;       /* Sentence of a GSV group, from 0 */
+    uint8_t pages;      /* Sentences in a GSV group */
+    const gps_t *gps;   /* Values to write */
+} nmea_writer_t;
+
+static inline void put_char(nmea_writer_t *w, char c)
+{
+    if (w->p < w->end) {
+        *w->p++ = c;
+        if (w->in_body) {
+            w->crc ^= (uint8_t)c;
+        }
+    } else {
+        w->overflow = true;
+    }
+}
+
+static void put_str(nmea_writer_t *w, const char *s)
+{
+    while (*s) {
+        put_char(w, *s++);
+    }
+}
+
+static void put_uint(nmea_writer_t *w, uint32_t value, uint8_t width)
+{
+    char digits[10];
+    int n = 0;
+    do {
+        digits[n++] = '0' + value % 10;
+        value /= 10;
+    } while ((value || n < width) && n < (int)sizeof(digits));
+    while (n) {
+        put_char(w, digits[--n]);
+    }
+}
+
+static void put_int(nmea_writer_t *w, int32_t value, uint8_t width)
+{
+    if (value < 0) {
+        put_char(w, '-');
+        value = -value;
+    }
+    put_uint(w, value, width);
+}
+
+static void put_fixed(nmea_writer_t *w, float value, uint8_t decimals)
+{
+    char digits[NUMFMT_MAX_LEN];
+    int n = numfmt_fixed(digits, value, decimals);
+    for (int i = 0; i < n; i++) {
+        put_char(w, digits[i]);
+    }
+}
+
+/* ddmm.mmmm or dddmm.mmmm from 1e-7 degrees, the sign goes in the hemisphere field */
+static void put_lat_long(nmea_writer_t *w, int32_t e7, uint8_t degree_width)
+{
+    /* In 1e-4 minutes, 1e-7 degrees is 6e-6 minutes or 0.06 of the unit */
+    uint32_t total = (uint32_t)(((uint64_t)(e7 < 0 ? -(int64_t)e7 : e7) * 6 + 50) / 100);
+    put_uint(w, total / 600000, degree_width);
+    total %= 600000;
+    put_uint(w, total / 10000, 2);
+    put_char(w, '.');
+    put_uint(w, total % 10000, 4);
+}
+
+static void put_time(nmea_writer_t *w, const gps_time_t *tim)
+{
+    put_uint(w, tim->hour, 2);
+    put_uint(w, tim->minute, 2);
+    put_uint(w, tim->second, 2);
+    put_char(w, '.');
+    put_uint(w, tim->thousand, 3);
+}
+
+static void put_satellite_field(nmea_writer_t *w, int slot, uint16_t (*get)(const gps_satellite_t *sat))
+{
+    int index = 4 * w->page + slot;
+    if (index < w->gps->sats_in_view && index < GPS_MAX_SATELLITES_IN_VIEW) {
+        put_uint(w, get(&w->gps->sats_desc_in_view[index]), 2);
+    }
+}
+
+/* Fields are separated by ',' up to the one about to be written, skipped fields stay empty */
+static void skip_to(nmea_writer_t *w, uint8_t index)
+{
+    while (w->item < index) {
+        put_char(w, ',');
+        w->item++;
+    }
+}
+
+#define NMEA_SAT_GETTER(member)                                     \
+    static uint16_t get_##member(const gps_satellite_t *sat)        \
+    {                                                               \
+        return sat->member;                                         \
+    }
+NMEA_SAT_GETTER(num)
+NMEA_SAT_GETTER(elevation)
+NMEA_SAT_GETTER(azimuth)
+NMEA_SAT_GETTER(snr)
+
+/* Field encoders by field type, see nmea_schema.h */
+#define NMEA_ENCODE_TIME(w, dest, scale, arg) put_time(w, &(w)->gps->dest)
+#define NMEA_ENCODE_DATE(w, dest, scale, arg)                       \
+    do {                                                            \
+        put_uint(w, (w)->gps->dest.day, 2);                         \
+        put_uint(w, (w)->gps->dest.month, 2);                       \
+        put_uint(w, (w)->gps->dest.year % 100, 2);                  \
+    } while (0)
+#define NMEA_ENCODE_LAT(w, dest, scale, arg) put_lat_long(w, (w)->gps->dest##_e7, 2)
+#define NMEA_ENCODE_LON(w, dest, scale, arg) put_lat_long(w, (w)->gps->dest##_e7, 3)
+#define NMEA_ENCODE_NS(w, dest, scale, arg) put_char(w, (w)->gps->dest##_e7 < 0 ? 'S' : 'N')
+#define NMEA_ENCODE_EW(w, dest, scale, arg) put_char(w, (w)->gps->dest##_e7 < 0 ? 'W' : 'E')
+#define NMEA_ENCODE_SIGN_NS(w, dest, scale, arg) put_char(w, (w)->gps->dest < 0 ? 'S' : 'N')
+#define NMEA_ENCODE_SIGN_EW(w, dest, scale, arg) put_char(w, (w)->gps->dest < 0 ? 'W' : 'E')
+#define NMEA_ENCODE_FLOAT(w, dest, scale, arg) put_fixed(w, (w)->gps->dest / (scale), arg)
+#define NMEA_ENCODE_ABS(w, dest, scale, arg) put_fixed(w, fabsf((w)->gps->dest / (scale)), arg)
+#define NMEA_ENCODE_SUM(w, dest, scale, arg) ((void)0)
+#define NMEA_ENCODE_INT(w, dest, scale, arg) put_int(w, (w)->gps->dest, arg)
+#define NMEA_ENCODE_ID(w, dest, scale, arg)                         \
+    do {                                                            \
+        if ((w)->gps->dest) {                                       \
+            put_uint(w, (w)->gps->dest, 2);                         \
+        }                                                           \
+    } while (0)
+#define NMEA_ENCODE_YEAR(w, dest, scale, arg) put_uint(w, (w)->gps->dest + 2000, 4)
+#define NMEA_ENCODE_VALID(w, dest, scale, arg) put_char(w, (w)->gps->dest ? 'A' : 'V')
+#define NMEA_ENCODE_STR(w, dest, scale, arg) put_str(w, (w)->gps->dest)
+#define NMEA_ENCODE_CONST(w, dest, scale, arg) put_str(w, dest)
+#define NMEA_ENCODE_MSG_COUNT(w, dest, scale, arg) put_uint(w, (w)->pages, 1)
+#define NMEA_ENCODE_MSG_NUM(w, dest, scale, arg) put_uint(w, (w)->page + 1, 1)
+#define NMEA_ENCODE_SAT(w, dest, scale, arg) put_satellite_field(w, arg, get_##dest)
+#define NMEA_ENCODE_MODE(w, dest, scale, arg) put_str(w, (w)->gps->dest)
+#define NMEA_ENCODE_DEVIATION(w, dest, scale, arg) ((void)0)
+#define NMEA_ENCODE_DEVIATION_EW(w, dest, scale, arg) ((void)0)
+
+#define NMEA_ENCODE_FIELD(index, type, dest, scale, arg)    \
+    skip_to(w, index);                                      \
+    NMEA_ENCODE_##type(w, dest, scale, arg);
+
+/* encode_gga(), encode_gsa()... the fields of one sentence after the address */
+#define NMEA_ENCODE_FUNC(NAME, name, fields)                \
+    static void encode_##name(nmea_writer_t *w)             \
+    {                                                       \
+        NMEA_FIELDS_##NAME(NMEA_ENCODE_FIELD)               \
+        skip_to(w, fields);                                 \
+    }
+NMEA_STATEMENT_LIST(NMEA_ENCODE_FUNC)
+
+static void begin_sentence(nmea_writer_t *w, const char *talker, const char *formatter)
+{
+    w->item = 0;
+    put_char(w, '$');
+    w->in_body = true;
+    w->crc = 0;
+    put_char(w, talker[0]);
+    put_char(w, talker[1]);
+    put_str(w, formatter);
+}
+
+static void end_sentence(nmea_writer_t *w)
+{
+    static const char hex[] = "0123456789ABCDEF";
+    w->in_body = false;
+    put_char(w, '*');
+    put_char(w, hex[w->crc >> 4]);
+    put_char(w, hex[w->crc & 0x0F]);
+    put_char(w, '\r');
+    put_char(w, '\n');
+}
+
+/* Terminate the output, or empty it if anything didn't fit */
+static int finish(nmea_writer_t *w, char *buf)
+{
+    if (w->overflow) {
+        buf[0] = '\0';
+        return -1;
+    }
+    *w->p = '\0';
+    return w->p - buf;
+}
+
+static void encode_sentence(nmea_writer_t *w, nmea_statement_t statement, const char *talker)
+{
+    switch (statement) {
+#define NMEA_ENCODE_CASE(NAME, name, fields)    \
+    case STATEMENT_##NAME:                      \
+        begin_sentence(w, talker, #NAME);       \
+        encode_##name(w);                       \
+        break;
+        NMEA_STATEMENT_LIST(NMEA_ENCODE_CASE)
+#undef NMEA_ENCODE_CASE
+    default:
+        return;
+    }
+    end_sentence(w);
+}
+
+int nmea_encode(nmea_statement_t statement, const char *talker, const gps_t *gps, char *buf, size_t size)
+{
+    if (statement == STATEMENT_UNKNOWN || !talker || strlen(talker) != 2 || size == 0) {
+        return -1;
+    }
+    nmea_writer_t w = {
+        .p = buf,
+        .end = buf + size - 1,
+        .pages = 1,
+        .gps = gps,
+    };
+    if (statement == STATEMENT_GSV) {
+        int sats = gps->sats_in_view < GPS_MAX_SATELLITES_IN_VIEW ? gps->sats_in_view : GPS_MAX_SATELLITES_IN_VIEW;
+        w.pages = sats > 4 ? (sats + 3) / 4 : 1;
+    }
+    for (w.page = 0; w.page < w.pages && !w.overflow; w.page++) {
+        encode_sentence(&w, statement, talker);
+    }
+    return finish(&w, buf);
+}
+
+/* Cross track error in nautical miles and the side to steer to, left when right of track */
+static void put_cross_track(nmea_writer_t *w, const nmea_steer_t *steer)
+{
+    put_fixed(w, fabsf(steer->cross_track_m) / NMEA_METRES_PER_NM, 3);
+    put_char(w, ',');
+    put_char(w, steer->cross_track_m > 0 ? 'L' : 'R');
+    put_char(w, ',');
+    put_char(w, 'N');
+}
+
+static bool steer_begin(nmea_writer_t *w, const char *talker, const char *formatter, char *buf, size_t size)
+{
+    if (!talker || strlen(talker) != 2 || size == 0) {
+        return false;
+    }
+    *w = (nmea_writer_t) {
+        .p = buf,
+        .end = buf + size - 1,
+    };
+    begin_sentence(w, talker, formatter);
+    return true;
+}
+
+int nmea_encode_xte(const char *talker, const nmea_steer_t *steer, char *buf, size_t size)
+{
+    nmea_writer_t w;
+    if (!steer_begin(&w, talker, "XTE", buf, size)) {
+        return -1;
+    }
+    const char status = steer->valid ? 'A' : 'V';
+    put_char(&w, ',');
+    put_char(&w, status);
+    put_char(&w, ',');
+    put_char(&w, status);
+    put_char(&w, ',');
+    put_cross_track(&w, steer);
+    put_str(&w, steer->valid ? ",A" : ",N");
+    end_sentence(&w);
+    return finish(&w, buf);
+}
+
+int nmea_encode_apb(const char *talker, const nmea_steer_t *steer, char *buf, size_t size)
+{
+    nmea_writer_t w;
+    if (!steer_begin(&w, talker, "APB", buf, size)) {
+        return -1;
+    }
+    const char status = steer->valid ? 'A' : 'V';
+    put_char(&w, ',');
+    put_char(&w, status);
+    put_char(&w, ',');
+    put_char(&w, status);
+    put_char(&w, ',');
+    put_cross_track(&w, steer);
+    put_char(&w, ',');
+    put_char(&w, steer->arrived ? 'A' : 'V');
+    put_char(&w, ',');
+    put_char(&w, steer->passed ? 'A' : 'V');
+    put_char(&w, ',');
+    put_fixed(&w, steer->track_deg, 1);
+    put_str(&w, ",T,");
+    put_str(&w, steer->dest_id);
+    put_char(&w, ',');
+    put_fixed(&w, steer->bearing_deg, 1);
+    put_str(&w, ",T,");
+    put_fixed(&w, steer->steer_deg, 1);
+    put_str(&w, ",T");
+    put_str(&w, steer->valid ? ",A" : ",N");
+    end_sentence(&w);
+    return finish(&w, buf);
+}
+
+int nmea_encode_rmb(const char *talker, const nmea_steer_t *steer, char *buf, size_t size)
+{
+    nmea_writer_t w;
+    if (!steer_begin(&w, talker, "RMB", buf, size)) {
+        return -1;
+    }
+    put_char(&w, ',');
+    put_char(&w, steer->valid ? 'A' : 'V');
+    put_char(&w, ',');
+    put_fixed(&w, fabsf(steer->cross_track_m) / NMEA_METRES_PER_NM, 3);
+    put_char(&w, ',');
+    put_char(&w, steer->cross_track_m > 0 ? 'L' : 'R');
+    put_char(&w, ',');
+    put_str(&w, steer->origin_id);
+    put_char(&w, ',');
+    put_str(&w, steer->dest_id);
+    put_char(&w, ',');
+    put_lat_long(&w, steer->dest.lat_e7, 2);
+    put_char(&w, ',');
+    put_char(&w, steer->dest.lat_e7 < 0 ? 'S' : 'N');
+    put_char(&w, ',');
+    put_lat_long(&w, steer->dest.lon_e7, 3);
+    put_char(&w, ',');
+    put_char(&w, steer->dest.lon_e7 < 0 ? 'W' : 'E');
+    put_char(&w, ',');
+    put_fixed(&w, steer->range_m / NMEA_METRES_PER_NM, 3);
+    put_char(&w, ',');
+    put_fixed(&w, steer->bearing_deg, 1);
+    put_char(&w, ',');
+    put_fixed(&w, steer->closing_mps / NMEA_KNOTS, 2);
+    put_char(&w, ',');
+    put_char(&w, steer->arrived ? 'A' : 'V');
+    put_str(&w, steer->valid ? ",A" : ",N");
+    end_sentence(&w);
+    return finish(&w, buf);
+}
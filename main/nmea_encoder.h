@@ -0,0 +1,104 @@
+/* NMEA 0183 sentence encoder
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdbool.h>
+#include "nmea_gps.h"
+#include "geo.h"
+
+/**
+ * @brief Longest NMEA 0183 sentence, from '$' to "\r\n"
+ *
+ */
+#define NMEA_MAX_SENTENCE_LEN (82)
+
+/**
+ * @brief Metres in a nautical mile
+ *
+ */
+#define NMEA_METRES_PER_NM (1852.0f)
+
+/**
+ * @brief Steering to a waypoint, for APB, XTE and RMB
+ *
+ */
+typedef struct {
+    bool valid;             /*!< Position and steering are usable, sentences are flagged void otherwise */
+    float cross_track_m;    /*!< Distance off the track from origin to destination, positive right of track */
+    float track_deg;        /*!< Bearing of the track from origin to destination (degrees true) */
+    float bearing_deg;      /*!< Bearing from the present position to the destination (degrees true) */
+    float steer_deg;        /*!< Heading to steer (degrees true) */
+    float range_m;          /*!< Distance to the destination (metres) */
+    float closing_mps;      /*!< Speed towards the destination (m/s) */
+    geo_point_t dest;       /*!< Destination */
+    const char *origin_id;  /*!< Origin waypoint name, may be empty */
+    const char *dest_id;    /*!< Destination waypoint name */
+    bool arrived;           /*!< Inside the arrival circle */
+    bool passed;            /*!< Passed the perpendicular through the destination */
+} nmea_steer_t;
+
+/**
+ * @brief Write a statement from a GPS object as NMEA 0183
+ *
+ * The layout comes from the same schema the parser reads with (nmea_schema.h), so a sentence written
+ * here parses back to the same values. Fields the GPS object doesn't hold are left empty. GSV is
+ * written as one sentence per four satellites in view, every other statement as one sentence.
+ *
+ * @param statement statement to write
+ * @param talker two character talker ID, e.g. "GP", "GN" or "HE"
+ * @param gps GPS object
+ * @param buf output, terminated
+ * @param size size of buf
+ * @return int number of characters written without the terminator, -1 if the statement is unknown or
+ *         the sentences don't fit
+ */
+int nmea_encode(nmea_statement_t statement, const char *talker, const gps_t *gps, char *buf, size_t size);
+
+/**
+ * @brief Write an XTE cross track error sentence
+ *
+ * @param talker two character talker ID
+ * @param steer steering to the destination
+ * @param buf output, terminated
+ * @param size size of buf
+ * @return int number of characters written without the terminator, -1 if it doesn't fit
+ */
+int nmea_encode_xte(const char *talker, const nmea_steer_t *steer, char *buf, size_t size);
+
+/**
+ * @brief Write an APB autopilot sentence
+ *
+ * @param talker two character talker ID
+ * @param steer steering to the destination
+ * @param buf output, terminated
+ * @param size size of buf
+ * @return int number of characters written without the terminator, -1 if it doesn't fit
+ */
+int nmea_encode_apb(const char *talker, const nmea_steer_t *steer, char *buf, size_t size);
+
+/**
+ * @brief Write an RMB navigation to waypoint sentence
+ *
+ * @param talker two character talker ID
+ * @param steer steering to the destination
+ * @param buf output, terminated
+ * @param size size of buf
+ * @return int number of characters written without the terminator, -1 if it doesn't fit
+ */
+int nmea_encode_rmb(const char *talker, const nmea_steer_t *steer, char *buf, size_t size);
+
+#ifdef __cplusplus
+}
+#endif
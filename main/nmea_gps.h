@@ -0,0 +1,169 @@
+// Copyright 2015-2018 Espressif Systems (Shanghai) PTE LTD
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "nmea_schema.h"
+
+#define GPS_MAX_SATELLITES_IN_USE (12)
+#define GPS_MAX_SATELLITES_IN_VIEW (16)
+#define GPS_MAX_SYSTEMS (6)
+
+/**
+ * @brief GPS fix type
+ *
+ */
+typedef enum {
+    GPS_FIX_INVALID, /*!< Not fixed */
+    GPS_FIX_GPS,     /*!< GPS */
+    GPS_FIX_DGPS,    /*!< Differential GPS */
+} gps_fix_t;
+
+/**
+ * @brief GPS fix mode
+ *
+ */
+typedef enum {
+    GPS_MODE_INVALID = 1, /*!< Not fixed */
+    GPS_MODE_2D,          /*!< 2D GPS */
+    GPS_MODE_3D           /*!< 3D GPS */
+} gps_fix_mode_t;
+
+/**
+ * @brief GPS satellite information
+ *
+ */
+typedef struct {
+    uint8_t num;       /*!< Satellite number */
+    uint8_t elevation; /*!< Satellite elevation */
+    uint16_t azimuth;  /*!< Satellite azimuth */
+    uint8_t snr;       /*!< Satellite signal noise ratio */
+} gps_satellite_t;
+
+/**
+ * @brief GPS time
+ *
+ */
+typedef struct {
+    uint8_t hour;      /*!< Hour */
+    uint8_t minute;    /*!< Minute */
+    uint8_t second;    /*!< Second */
+    uint16_t thousand; /*!< Thousand */
+} gps_time_t;
+
+/**
+ * @brief GPS date
+ *
+ */
+typedef struct {
+    uint8_t day;   /*!< Day (start from 1) */
+    uint8_t month; /*!< Month (start from 1) */
+    uint16_t year; /*!< Year (start from 2000) */
+} gps_date_t;
+
+/**
+ * @brief NMEA Statement
+ *
+ */
+typedef enum {
+    STATEMENT_UNKNOWN = 0, /*!< Unknown statement */
+#define NMEA_STATEMENT_ENUM(NAME, name, fields) STATEMENT_##NAME,
+    NMEA_STATEMENT_LIST(NMEA_STATEMENT_ENUM)
+#undef NMEA_STATEMENT_ENUM
+} nmea_statement_t;
+
+/**
+ * @brief GPS position error estimate, one standard deviation
+ *
+ */
+typedef struct {
+    float rms;         /*!< RMS of the range residuals (meters) */
+    float major;       /*!< Semi-major axis of the error ellipse (meters) */
+    float minor;       /*!< Semi-minor axis of the error ellipse (meters) */
+    float orientation; /*!< Orientation of the semi-major axis (degrees from true north) */
+    float lat;         /*!< Latitude error (meters) */
+    float lon;         /*!< Longitude error (meters) */
+    float alt;         /*!< Altitude error (meters) */
+} gps_error_t;
+
+/**
+ * @brief GPS satellite fault detection
+ *
+ */
+typedef struct {
+    float lat;         /*!< Expected latitude error (meters) */
+    float lon;         /*!< Expected longitude error (meters) */
+    float alt;         /*!< Expected altitude error (meters) */
+    uint8_t sat;       /*!< Most likely failed satellite, 0 if none */
+    float probability; /*!< Probability of missed detection for the failed satellite */
+    float bias;        /*!< Estimated range bias of the failed satellite (meters) */
+    float bias_sd;     /*!< Standard deviation of the bias (meters) */
+} gps_fault_t;
+
+/**
+ * @brief Offset of the local datum from the reference datum
+ *
+ */
+typedef struct {
+    float lat;         /*!< Latitude offset, north positive (minutes) */
+    float lon;         /*!< Longitude offset, east positive (minutes) */
+    float alt;         /*!< Altitude offset (meters) */
+} gps_datum_offset_t;
+
+/**
+ * @brief GPS object
+ *
+ * Written by hand, not generated from nmea_schema.h: a schema field with a new dest needs its member added here.
+ */
+typedef struct {
+    float latitude;                                                /*!< Latitude (degrees) */
+    float longitude;                                               /*!< Longitude (degrees) */
+    int32_t latitude_e7;                                           /*!< Latitude, 1e-7 degrees, exact from the sentence */
+    int32_t longitude_e7;                                          /*!< Longitude, 1e-7 degrees, exact from the sentence */
+    float altitude;                                                /*!< Altitude (meters) */
+    gps_fix_t fix;                                                 /*!< Fix status */
+    uint8_t sats_in_use;                                           /*!< Number of satellites in use */
+    gps_time_t tim;                                                /*!< time in UTC */
+    gps_fix_mode_t fix_mode;                                       /*!< Fix mode */
+    uint8_t sats_id_in_use[GPS_MAX_SATELLITES_IN_USE];             /*!< ID list of satellite in use */
+    float dop_h;                                                   /*!< Horizontal dilution of precision */
+    float dop_p;                                                   /*!< Position dilution of precision  */
+    float dop_v;                                                   /*!< Vertical dilution of precision  */
+    uint8_t sats_in_view;                                          /*!< Number of satellites in view */
+    gps_satellite_t sats_desc_in_view[GPS_MAX_SATELLITES_IN_VIEW]; /*!< Information of satellites in view */
+    gps_date_t date;                                               /*!< Fix date */
+    bool valid;                                                    /*!< GPS validity */
+    float speed;                                                   /*!< Ground speed, unit: m/s */
+    float cog;                                                     /*!< Course over ground */
+    float variation;                                               /*!< Magnetic variation */
+    gps_error_t error;                                             /*!< Position error estimate (GST) */
+    gps_fault_t fault;                                             /*!< Satellite fault detection (GBS) */
+    char mode[GPS_MAX_SYSTEMS + 1];                                /*!< Mode indicator per constellation, e.g. "AAN" (GNS) */
+    float heading;                                                 /*!< True heading, unit: degree (HDT) */
+    float heading_magnetic;                                        /*!< Magnetic heading with deviation applied, unit: degree (HDG) */
+    char datum[4];                                                 /*!< Local datum code, "W84" for WGS84 (DTM) */
+    gps_datum_offset_t datum_offset;                               /*!< Offset of the local datum from the reference datum (DTM) */
+    char datum_ref[4];                                             /*!< Reference datum code (DTM) */
+    uint32_t statements;                                           /*!< Statements parsed into this update, bit (1 << nmea_statement_t) each */
+} gps_t;
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,201 @@
+/* NMEA 0183 output to a chartplotter or autopilot
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "nmea_output.h"
+
+static const char *NMEA_OUTPUT_TAG = "nmea_output";
+
+/*
+ * uart_write_bytes() waits for room in the driver's TX buffer and for the driver's TX lock, so it is
+ * never called from the queuing task. Sentences go into a single producer, single consumer ring and
+ * the output task, below the producer's priority, moves them to the UART. The producer only ever
+ * writes head and the output task only ever writes tail; both count bytes and wrap by the mask.
+ */
+static uint8_t *ring;
+static size_t ring_mask;
+static atomic_uint ring_head;
+static atomic_uint ring_tail;
+static uart_port_t out_port;
+static TaskHandle_t out_task;           /*!< NULL without a UART */
+static void (*out_tap)(const char *sentence, size_t len);
+static bool out_ready;
+
+static nmea_output_stats_t stats;       /*!< Guarded by stats_lock */
+static uint64_t cycles_total;           /*!< Guarded by stats_lock */
+static atomic_uint bytes_sent;
+static portMUX_TYPE stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Copies a whole sentence in or nothing */
+static bool ring_push(const char *data, size_t len)
+{
+    unsigned head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    unsigned tail = atomic_load_explicit(&ring_tail, memory_order_acquire);
+    if (len > ring_mask + 1 - (head - tail)) {
+        return false;
+    }
+    size_t off = head & ring_mask;
+    size_t first = ring_mask + 1 - off;
+    if (first > len) {
+        first = len;
+    }
+    memcpy(ring + off, data, first);
+    memcpy(ring, data + first, len - first);
+    atomic_store_explicit(&ring_head, head + len, memory_order_release);
+    return true;
+}
+
+static void nmea_output_task_entry(void *arg)
+{
+    unsigned tail = atomic_load_explicit(&ring_tail, memory_order_relaxed);
+    unsigned head;
+
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while ((head = atomic_load_explicit(&ring_head, memory_order_acquire)) != tail) {
+            size_t off = tail & ring_mask;
+            size_t len = head - tail;
+            if (len > ring_mask + 1 - off) {
+                len = ring_mask + 1 - off;
+            }
+            /* Returns once the bytes are in the hardware FIFO, the time on the line is spent here */
+            uart_write_bytes(out_port, (const char *)ring + off, len);
+            tail += len;
+            atomic_store_explicit(&ring_tail, tail, memory_order_release);
+            atomic_fetch_add_explicit(&bytes_sent, len, memory_order_relaxed);
+        }
+    }
+}
+
+/* Queue an encoded sentence and account for it, start is the cycle count before encoding */
+static bool queue_sentence(const char *buf, int len, uint32_t start)
+{
+    bool queued = len > 0;
+    if (queued && out_tap) {
+        out_tap(buf, len);
+    }
+    if (queued && out_task) {
+        queued = ring_push(buf, len);
+        if (queued) {
+            xTaskNotifyGive(out_task);
+        }
+    }
+    uint32_t cycles = esp_cpu_get_ccount() - start;
+    portENTER_CRITICAL(&stats_lock);
+    if (queued) {
+        stats.sentences++;
+        stats.bytes += len;
+    } else {
+        stats.dropped++;
+    }
+    stats.cycles_last = cycles;
+    if (cycles > stats.cycles_max) {
+        stats.cycles_max = cycles;
+    }
+    cycles_total += cycles;
+    portEXIT_CRITICAL(&stats_lock);
+    return queued;
+}
+
+bool nmea_output_gps(nmea_statement_t statement, const char *talker, const gps_t *gps)
+{
+    char buf[NMEA_MAX_SENTENCE_LEN + 1];
+    if (!out_ready) {
+        return false;
+    }
+    uint32_t start = esp_cpu_get_ccount();
+    return queue_sentence(buf, nmea_encode(statement, talker, gps, buf, sizeof(buf)), start);
+}
+
+bool nmea_output_steer(nmea_output_steer_encoder_t encoder, const char *talker, const nmea_steer_t *steer)
+{
+    char buf[NMEA_MAX_SENTENCE_LEN + 1];
+    if (!out_ready) {
+        return false;
+    }
+    uint32_t start = esp_cpu_get_ccount();
+    return queue_sentence(buf, encoder(talker, steer, buf, sizeof(buf)), start);
+}
+
+void nmea_output_get_stats(nmea_output_stats_t *out)
+{
+    portENTER_CRITICAL(&stats_lock);
+    *out = stats;
+    out->cycles_avg = stats.sentences + stats.dropped ? cycles_total / (stats.sentences + stats.dropped) : 0;
+    portEXIT_CRITICAL(&stats_lock);
+    out->bytes_sent = atomic_load_explicit(&bytes_sent, memory_order_relaxed);
+}
+
+esp_err_t nmea_output_init(const nmea_output_config_t *config)
+{
+    esp_err_t err;
+
+    out_tap = config->tap;
+    if (config->tx_pin < 0) {
+        out_ready = true;
+        return ESP_OK;
+    }
+    if (config->ring_size == 0 || (config->ring_size & (config->ring_size - 1))) {
+        ESP_LOGE(NMEA_OUTPUT_TAG, "buffer size %u is not a power of two", (unsigned)config->ring_size);
+        return ESP_ERR_INVALID_ARG;
+    }
+    ring = malloc(config->ring_size);
+    if (!ring) {
+        return ESP_ERR_NO_MEM;
+    }
+    ring_mask = config->ring_size - 1;
+    atomic_init(&ring_head, 0);
+    atomic_init(&ring_tail, 0);
+    atomic_init(&bytes_sent, 0);
+    out_port = config->uart_port;
+    uart_config_t uart_config = {
+        .baud_rate = config->baud_rate,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_APB,
+    };
+    /* The driver wants an RX buffer larger than the FIFO even though nothing is read. No TX buffer,
+       the ring is the buffer */
+    err = uart_driver_install(out_port, 256, 0, 0, NULL, 0);
+    if (err != ESP_OK) {
+        ESP_LOGE(NMEA_OUTPUT_TAG, "install uart driver failed");
+        goto err_uart_install;
+    }
+    err = uart_param_config(out_port, &uart_config);
+    if (err == ESP_OK) {
+        err = uart_set_pin(out_port, config->tx_pin, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    }
+    if (err != ESP_OK) {
+        ESP_LOGE(NMEA_OUTPUT_TAG, "config uart failed");
+        goto err_uart_config;
+    }
+    if (xTaskCreate(nmea_output_task_entry, "nmea_output", config->task_stack_size, NULL,
+                    config->task_priority, &out_task) != pdPASS) {
+        ESP_LOGE(NMEA_OUTPUT_TAG, "create output task failed");
+        err = ESP_ERR_NO_MEM;
+        goto err_uart_config;
+    }
+    out_ready = true;
+    ESP_LOGI(NMEA_OUTPUT_TAG, "NMEA output on GPIO%d at %u baud", config->tx_pin, (unsigned)config->baud_rate);
+    return ESP_OK;
+err_uart_config:
+    uart_driver_delete(out_port);
+err_uart_install:
+    free(ring);
+    ring = NULL;
+    return err;
+}
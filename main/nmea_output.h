@@ -0,0 +1,115 @@
+/* NMEA 0183 output to a chartplotter or autopilot
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/uart.h"
+#include "nmea_encoder.h"
+
+/**
+ * @brief NMEA output configuration
+ *
+ */
+typedef struct {
+    uart_port_t uart_port;      /*!< UART port, not shared with the receiver */
+    int tx_pin;                 /*!< TX GPIO, -1 for no UART, sentences then only go to tap */
+    uint32_t baud_rate;         /*!< Baud rate */
+    size_t ring_size;           /*!< Bytes queued between the caller and the UART, a power of two */
+    uint32_t task_stack_size;   /*!< Stack size of the task writing to the UART */
+    uint32_t task_priority;     /*!< Priority of that task, below the caller so queuing never switches to it */
+    void (*tap)(const char *sentence, size_t len); /*!< Also gets every sentence on the caller's task, may be NULL */
+} nmea_output_config_t;
+
+/**
+ * @brief Default NMEA output configuration
+ *
+ */
+#define NMEA_OUTPUT_CONFIG_DEFAULT()                    \
+    {                                                   \
+        .uart_port = UART_NUM_2,                        \
+        .tx_pin = CONFIG_NMEA_OUTPUT_UART_TXD,          \
+        .baud_rate = CONFIG_NMEA_OUTPUT_BAUD_RATE,      \
+        .ring_size = CONFIG_NMEA_OUTPUT_RING_SIZE,      \
+        .task_stack_size = 2048,                        \
+        .task_priority = 1,                             \
+        .tap = NULL,                                    \
+    }
+
+/**
+ * @brief NMEA output counters
+ *
+ */
+typedef struct {
+    uint32_t sentences;     /*!< Sentences queued */
+    uint32_t dropped;       /*!< Sentences not sent on the UART because the buffer was full */
+    uint32_t bytes;         /*!< Bytes queued */
+    uint32_t bytes_sent;    /*!< Bytes handed to the UART */
+    uint32_t cycles_last;   /*!< CPU cycles to encode and queue the last sentence */
+    uint32_t cycles_max;    /*!< Most CPU cycles for one sentence */
+    uint32_t cycles_avg;    /*!< Mean CPU cycles per sentence */
+} nmea_output_stats_t;
+
+/**
+ * @brief Encoder of a steering sentence, nmea_encode_apb(), nmea_encode_xte() or nmea_encode_rmb()
+ *
+ */
+typedef int (*nmea_output_steer_encoder_t)(const char *talker, const nmea_steer_t *steer, char *buf, size_t size);
+
+/**
+ * @brief Install the UART and start the task that drains the buffer into it
+ *
+ * Without a TX pin only the tap gets the sentences.
+ *
+ * @param config configuration
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG if the buffer size is not a power of two,
+ *         ESP_ERR_NO_MEM if the buffer or the task can't be created, or the UART driver error
+ */
+esp_err_t nmea_output_init(const nmea_output_config_t *config);
+
+/**
+ * @brief Queue a statement from a GPS object, see nmea_encode()
+ *
+ * Only one task may queue sentences. Never blocks: a sentence that doesn't fit in the buffer is
+ * dropped whole, so a slow or stalled line costs the caller nothing.
+ *
+ * @param statement statement to send, written as one sentence
+ * @param talker two character talker ID
+ * @param gps GPS object
+ * @return true if the sentence was queued
+ */
+bool nmea_output_gps(nmea_statement_t statement, const char *talker, const gps_t *gps);
+
+/**
+ * @brief Queue a steering sentence, same rules as nmea_output_gps()
+ *
+ * @param encoder encoder of the sentence
+ * @param talker two character talker ID
+ * @param steer steering to the destination
+ * @return true if the sentence was queued
+ */
+bool nmea_output_steer(nmea_output_steer_encoder_t encoder, const char *talker, const nmea_steer_t *steer);
+
+/**
+ * @brief Read the counters
+ *
+ * @param stats filled with the counters, all zero before nmea_output_init()
+ */
+void nmea_output_get_stats(nmea_output_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
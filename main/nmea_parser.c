@@ -13,21 +13,28 @@
 // limitations under the License.
 
 #include <stdlib.h>
+#include <stdatomic.h>
 #include <string.h>
-#include <ctype.h>
-#include <math.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "nmea_parser.h"
+#include "nmea_decode.h"
+#if CONFIG_NMEA_PARSER_UBX
+#include "ubx.h"
+#endif
 
 /**
  * @brief NMEA Parser runtime buffer size
  *
  */
 #define NMEA_PARSER_RUNTIME_BUFFER_SIZE (CONFIG_NMEA_PARSER_RING_BUFFER_SIZE / 2)
-#define NMEA_MAX_STATEMENT_ITEM_LENGTH (16)
 #define NMEA_EVENT_LOOP_QUEUE_SIZE (16)
+#define NMEA_PARSER_RX_CHUNK_SIZE (128)
+#define UBX_PVT_HOLDOFF_US (2000000)   /* NMEA updates are dropped this long after a NAV-PVT */
+#define NMEA_REQUIRED_DEFAULT ((1 << STATEMENT_GGA) | (1 << STATEMENT_GSA) | (1 << STATEMENT_RMC) | \
+                               (1 << STATEMENT_GSV) | (1 << STATEMENT_GLL) | (1 << STATEMENT_VTG))
 
 /**
  * @brief Define of NMEA Parser Event base
@@ -36,558 +43,246 @@
 ESP_EVENT_DEFINE_BASE(ESP_NMEA_EVENT);
 
 static const char *GPS_TAG = "nmea_parser";
+static portMUX_TYPE sentences_lock = portMUX_INITIALIZER_UNLOCKED;
 
 /**
  * @brief GPS parser library runtime structure
  *
  */
 typedef struct {
-    uint8_t item_pos;                              /*!< Current position in item */
-    uint8_t item_num;                              /*!< Current item number */
-    uint8_t asterisk;                              /*!< Asterisk detected flag */
-    uint8_t crc;                                   /*!< Calculated CRC value */
-    uint8_t parsed_statement;                      /*!< OR'd of statements that have been parsed */
-    uint8_t sat_num;                               /*!< Satellite number */
-    uint8_t sat_count;                             /*!< Satellite count */
-    uint8_t cur_statement;                         /*!< Current statement ID */
-    uint32_t all_statements;                       /*!< All statements mask */
-    char item_str[NMEA_MAX_STATEMENT_ITEM_LENGTH]; /*!< Current item */
-    gps_t parent;                                  /*!< Parent class */
+    atomic_uint all_statements;                    /*!< Statements needed before an update is posted */
+    atomic_uint enabled_statements;                /*!< Statements parsed, the rest are dropped after the header */
+    uint32_t built_statements;                     /*!< Statements compiled in */
+    atomic_uint rejected;                          /*!< Statements dropped after the header */
+    nmea_sentence_table_t sentences;               /*!< Sentences registered by the application */
+    _Atomic(nmea_raw_cb_t) raw_cb;                 /*!< Gets every sentence with a good checksum, published after raw_ctx */
+    void *raw_ctx;                                 /*!< Passed to raw_cb */
+    nmea_decoder_t dec;                            /*!< Statement decoder, holds the GPS object */
     uart_port_t uart_port;                         /*!< Uart port number */
     uint8_t *buffer;                               /*!< Runtime buffer */
     esp_event_loop_handle_t event_loop_hdl;        /*!< Event loop handle */
     TaskHandle_t tsk_hdl;                          /*!< NMEA Parser task handle */
     QueueHandle_t event_queue;                     /*!< UART event queue handle */
+    int64_t first_statement_us;                    /*!< esp_timer time of the first statement with a good CRC */
+    uint16_t line_len;                             /*!< Bytes of the NMEA line being assembled in buffer */
+    uint32_t baud_rate;                            /*!< Current UART baud rate */
+    bool has_tx;                                   /*!< A Tx pin is connected, so the receiver can be configured */
+    gnss_config_t receiver;                        /*!< Receiver settings applied when the task starts */
+    uint8_t rx[NMEA_PARSER_RX_CHUNK_SIZE];         /*!< Bytes read from the UART, before they are demultiplexed */
+#if CONFIG_NMEA_PARSER_UBX
+    ubx_decoder_t ubx;                             /*!< UBX frame decoder */
+    gps_t pvt;                                     /*!< Solution from the last NAV-PVT, kept apart from the NMEA one */
+    int64_t pvt_us;                                /*!< esp_timer time of the last NAV-PVT, 0 before the first */
+#endif
 } esp_gps_t;
 
 /**
- * @brief parse latitude or longitude
- *              format of latitude in NMEA is ddmm.sss and longitude is dddmm.sss
- * @param esp_gps esp_gps_t type object
- * @return float Latitude or Longitude value (unit: degree)
- */
-static float parse_lat_long(esp_gps_t *esp_gps)
-{
-    float ll = strtof(esp_gps->item_str, NULL);
-    int deg = ((int)ll) / 100;
-    float min = ll - (deg * 100);
-    ll = deg + min / 60.0f;
-    return ll;
-}
-
-/**
- * @brief Converter two continuous numeric character into a uint8_t number
- *
- * @param digit_char numeric character
- * @return uint8_t result of converting
- */
-static inline uint8_t convert_two_digit2number(const char *digit_char)
-{
-    return 10 * (digit_char[0] - '0') + (digit_char[1] - '0');
-}
-
-/**
- * @brief Parse UTC time in GPS statements
+ * @brief Parse NMEA statements from GPS receiver
  *
  * @param esp_gps esp_gps_t type object
+ * @param len number of bytes to decode
+ * @return esp_err_t ESP_OK on success, ESP_FAIL on error
  */
-static void parse_utc_time(esp_gps_t *esp_gps)
+static esp_err_t gps_decode(esp_gps_t *esp_gps, size_t len)
 {
-    esp_gps->parent.tim.hour = convert_two_digit2number(esp_gps->item_str + 0);
-    esp_gps->parent.tim.minute = convert_two_digit2number(esp_gps->item_str + 2);
-    esp_gps->parent.tim.second = convert_two_digit2number(esp_gps->item_str + 4);
-    if (esp_gps->item_str[6] == '.') {
-        uint16_t tmp = 0;
-        uint8_t i = 7;
-        while (esp_gps->item_str[i]) {
-            tmp = 10 * tmp + esp_gps->item_str[i] - '0';
-            i++;
-        }
-        esp_gps->parent.tim.thousand = tmp;
-    }
-}
+    const char *line = (const char *)esp_gps->buffer;
+    uint32_t required = atomic_load_explicit(&esp_gps->all_statements, memory_order_relaxed);
+    nmea_decode_result_t res = nmea_decode_line(&esp_gps->dec, line, required);
+    int sentence = -1;
 
-#if CONFIG_NMEA_STATEMENT_GGA
-/**
- * @brief Parse GGA statements
- *
- * @param esp_gps esp_gps_t type object
- */
-static void parse_gga(esp_gps_t *esp_gps)
-{
-    /* Process GGA statement */
-    switch (esp_gps->item_num) {
-    case 1: /* Process UTC time */
-        parse_utc_time(esp_gps);
-        break;
-    case 2: /* Latitude */
-        esp_gps->parent.latitude = parse_lat_long(esp_gps);
-        break;
-    case 3: /* Latitude north(1)/south(-1) information */
-        if (esp_gps->item_str[0] == 'S' || esp_gps->item_str[0] == 's') {
-            esp_gps->parent.latitude *= -1;
+    if (esp_gps->dec.statement == STATEMENT_UNKNOWN) {
+        sentence = nmea_sentence_find(&esp_gps->sentences, line + 1, strcspn(line + 1, ",*\r\n"), false);
+    }
+    if (res != NMEA_DECODE_CRC_ERROR) {
+        if (!esp_gps->first_statement_us) {
+            esp_gps->first_statement_us = esp_timer_get_time();
+        }
+        nmea_raw_cb_t raw_cb = atomic_load_explicit(&esp_gps->raw_cb, memory_order_acquire);
+        if (raw_cb) {
+            /* len counts the terminator */
+            raw_cb(line, len - 1, esp_gps->raw_ctx);
         }
-        break;
-    case 4: /* Longitude */
-        esp_gps->parent.longitude = parse_lat_long(esp_gps);
-        break;
-    case 5: /* Longitude east(1)/west(-1) information */
-        if (esp_gps->item_str[0] == 'W' || esp_gps->item_str[0] == 'w') {
-            esp_gps->parent.longitude *= -1;
+        if (sentence >= 0) {
+            nmea_sentence_dispatch(&esp_gps->sentences, sentence, (char *)esp_gps->buffer);
         }
-        break;
-    case 6: /* Fix status */
-        esp_gps->parent.fix = (gps_fix_t)strtol(esp_gps->item_str, NULL, 10);
-        break;
-    case 7: /* Satellites in use */
-        esp_gps->parent.sats_in_use = (uint8_t)strtol(esp_gps->item_str, NULL, 10);
-        break;
-    case 8: /* HDOP */
-        esp_gps->parent.dop_h = strtof(esp_gps->item_str, NULL);
-        break;
-    case 9: /* Altitude */
-        esp_gps->parent.altitude = strtof(esp_gps->item_str, NULL);
-        break;
-    case 11: /* Altitude above ellipsoid */
-        esp_gps->parent.altitude += strtof(esp_gps->item_str, NULL);
-        break;
-    default:
-        break;
+#if CONFIG_NMEA_PARSER_UBX
+        /* The receiver sends NAV-PVT for the same epochs, one update per epoch is enough */
+        if (res == NMEA_DECODE_UPDATE && esp_gps->pvt_us &&
+                esp_timer_get_time() - esp_gps->pvt_us < UBX_PVT_HOLDOFF_US) {
+            res = NMEA_DECODE_OK;
+        }
+#endif
+        if (res == NMEA_DECODE_UPDATE) {
+            /* Send signal to notify that GPS information has been updated */
+            esp_event_post_to(esp_gps->event_loop_hdl, ESP_NMEA_EVENT, GPS_UPDATE,
+                              &(esp_gps->dec.gps), sizeof(gps_t), 100 / portTICK_PERIOD_MS);
+        }
+    } else {
+        ESP_LOGD(GPS_TAG, "CRC Error for statement:%s", line);
+    }
+    if (esp_gps->dec.statement == STATEMENT_UNKNOWN && sentence < 0 &&
+            (atomic_load_explicit(&esp_gps->enabled_statements, memory_order_relaxed) & (1 << STATEMENT_UNKNOWN))) {
+        /* Send signal to notify that one unknown statement has been met */
+        esp_event_post_to(esp_gps->event_loop_hdl, ESP_NMEA_EVENT, GPS_UNKNOWN,
+                          esp_gps->buffer, len, 100 / portTICK_PERIOD_MS);
     }
+    return ESP_OK;
 }
-#endif
 
-#if CONFIG_NMEA_STATEMENT_GSA
+#if CONFIG_NMEA_PARSER_UBX
 /**
- * @brief Parse GSA statements
+ * @brief Handle a complete UBX frame
  *
  * @param esp_gps esp_gps_t type object
  */
-static void parse_gsa(esp_gps_t *esp_gps)
+static void ubx_handle_frame(esp_gps_t *esp_gps)
 {
-    /* Process GSA statement */
-    switch (esp_gps->item_num) {
-    case 2: /* Process fix mode */
-        esp_gps->parent.fix_mode = (gps_fix_mode_t)strtol(esp_gps->item_str, NULL, 10);
-        break;
-    case 15: /* Process PDOP */
-        esp_gps->parent.dop_p = strtof(esp_gps->item_str, NULL);
-        break;
-    case 16: /* Process HDOP */
-        esp_gps->parent.dop_h = strtof(esp_gps->item_str, NULL);
-        break;
-    case 17: /* Process VDOP */
-        esp_gps->parent.dop_v = strtof(esp_gps->item_str, NULL);
-        break;
-    default:
-        /* Parse satellite IDs */
-        if (esp_gps->item_num >= 3 && esp_gps->item_num <= 14) {
-            esp_gps->parent.sats_id_in_use[esp_gps->item_num - 3] = (uint8_t)strtol(esp_gps->item_str, NULL, 10);
-        }
-        break;
+    ubx_decoder_t *ubx = &esp_gps->ubx;
+    if (!esp_gps->first_statement_us) {
+        esp_gps->first_statement_us = esp_timer_get_time();
+    }
+    /* One NAV-PVT carries the whole solution, no need to wait for other messages. It is decoded apart from
+       the NMEA statements so a half decoded NMEA epoch never mixes into it, or it into the next NMEA update */
+    if (ubx->cls == UBX_CLASS_NAV && ubx->id == UBX_ID_NAV_PVT &&
+            ubx_nav_pvt_to_gps(ubx->payload, ubx->len, &esp_gps->pvt)) {
+        esp_gps->pvt.statements = 0;
+        esp_gps->pvt_us = esp_timer_get_time();
+        esp_event_post_to(esp_gps->event_loop_hdl, ESP_NMEA_EVENT, GPS_UPDATE,
+                          &(esp_gps->pvt), sizeof(gps_t), 100 / portTICK_PERIOD_MS);
     }
 }
 #endif
 
-#if CONFIG_NMEA_STATEMENT_GSV
 /**
- * @brief Parse GSV statements
+ * @brief Split the bytes from the receiver into NMEA lines and UBX frames
+ *
+ * UBX frames start with 0xB5, which never appears in NMEA, so the lead byte tells the two apart. A UBX
+ * frame cuts short any NMEA line it interrupts.
  *
  * @param esp_gps esp_gps_t type object
+ * @param data bytes from the UART
+ * @param len number of bytes
  */
-static void parse_gsv(esp_gps_t *esp_gps)
+static void gps_ingest(esp_gps_t *esp_gps, const uint8_t *data, size_t len)
 {
-    /* Process GSV statement */
-    switch (esp_gps->item_num) {
-    case 1: /* total GSV numbers */
-        esp_gps->sat_count = (uint8_t)strtol(esp_gps->item_str, NULL, 10);
-        break;
-    case 2: /* Current GSV statement number */
-        esp_gps->sat_num = (uint8_t)strtol(esp_gps->item_str, NULL, 10);
-        break;
-    case 3: /* Process satellites in view */
-        esp_gps->parent.sats_in_view = (uint8_t)strtol(esp_gps->item_str, NULL, 10);
-        break;
-    default:
-        if (esp_gps->item_num >= 4 && esp_gps->item_num <= 19) {
-            uint8_t item_num = esp_gps->item_num - 4; /* Normalize item number from 4-19 to 0-15 */
-            uint8_t index;
-            uint32_t value;
-            index = 4 * (esp_gps->sat_num - 1) + item_num / 4; /* Get array index */
-            if (index < GPS_MAX_SATELLITES_IN_VIEW) {
-                value = strtol(esp_gps->item_str, NULL, 10);
-                switch (item_num % 4) {
-                case 0:
-                    esp_gps->parent.sats_desc_in_view[index].num = (uint8_t)value;
-                    break;
-                case 1:
-                    esp_gps->parent.sats_desc_in_view[index].elevation = (uint8_t)value;
-                    break;
-                case 2:
-                    esp_gps->parent.sats_desc_in_view[index].azimuth = (uint16_t)value;
-                    break;
-                case 3:
-                    esp_gps->parent.sats_desc_in_view[index].snr = (uint8_t)value;
-                    break;
-                default:
-                    break;
+    for (size_t i = 0; i < len; i++) {
+        uint8_t c = data[i];
+#if CONFIG_NMEA_PARSER_UBX
+        if (c == UBX_SYNC_1 || ubx_decoder_busy(&esp_gps->ubx)) {
+            ubx_result_t res = ubx_decode_byte(&esp_gps->ubx, c);
+            if (res != UBX_NOT_FRAME) {
+                esp_gps->line_len = 0;
+                if (res == UBX_FRAME) {
+                    ubx_handle_frame(esp_gps);
+                } else if (res == UBX_BAD_CHECKSUM) {
+                    ESP_LOGD(GPS_TAG, "CRC Error for UBX %02x %02x", esp_gps->ubx.cls, esp_gps->ubx.id);
                 }
+                continue;
             }
         }
-        break;
-    }
-}
 #endif
-
-#if CONFIG_NMEA_STATEMENT_RMC
-/**
- * @brief Parse RMC statements
- *
- * @param esp_gps esp_gps_t type object
- */
-static void parse_rmc(esp_gps_t *esp_gps)
-{
-    /* Process GPRMC statement */
-    switch (esp_gps->item_num) {
-    case 1:/* Process UTC time */
-        parse_utc_time(esp_gps);
-        break;
-    case 2: /* Process valid status */
-        esp_gps->parent.valid = (esp_gps->item_str[0] == 'A');
-        break;
-    case 3:/* Latitude */
-        esp_gps->parent.latitude = parse_lat_long(esp_gps);
-        break;
-    case 4: /* Latitude north(1)/south(-1) information */
-        if (esp_gps->item_str[0] == 'S' || esp_gps->item_str[0] == 's') {
-            esp_gps->parent.latitude *= -1;
+        if (c == '$') {
+            esp_gps->line_len = 0;
+        } else if (esp_gps->line_len == 0) {
+            /* Noise between statements */
+            continue;
         }
-        break;
-    case 5: /* Longitude */
-        esp_gps->parent.longitude = parse_lat_long(esp_gps);
-        break;
-    case 6: /* Longitude east(1)/west(-1) information */
-        if (esp_gps->item_str[0] == 'W' || esp_gps->item_str[0] == 'w') {
-            esp_gps->parent.longitude *= -1;
+        if (esp_gps->line_len >= NMEA_PARSER_RUNTIME_BUFFER_SIZE - 1) {
+            ESP_LOGW(GPS_TAG, "NMEA statement too long, dropped");
+            esp_gps->line_len = 0;
+            continue;
+        }
+        esp_gps->buffer[esp_gps->line_len++] = c;
+        if (esp_gps->line_len == NMEA_HEADER_LEN) {
+            /* Drop statements that are not wanted before any checksum or item work, the rest of the line
+               is then skipped as noise up to the next '$' */
+            uint32_t enabled = atomic_load_explicit(&esp_gps->enabled_statements, memory_order_relaxed);
+            nmea_statement_t statement = nmea_decode_header((const char *)esp_gps->buffer);
+            if (!(enabled & (1 << statement)) &&
+                    !(statement == STATEMENT_UNKNOWN &&
+                      nmea_sentence_find(&esp_gps->sentences, (const char *)esp_gps->buffer + 1, NMEA_HEADER_LEN - 1, true) >= 0)) {
+                atomic_fetch_add_explicit(&esp_gps->rejected, 1, memory_order_relaxed);
+                esp_gps->line_len = 0;
+                continue;
+            }
+        }
+        if (c == '\n') {
+            /* make sure the line is a standard string */
+            esp_gps->buffer[esp_gps->line_len] = '\0';
+            /* Send new line to handle */
+            if (gps_decode(esp_gps, esp_gps->line_len + 1) != ESP_OK) {
+                ESP_LOGW(GPS_TAG, "GPS decode line failed");
+            }
+            esp_gps->line_len = 0;
         }
-        break;
-    case 7: /* Process ground speed in unit m/s */
-        esp_gps->parent.speed = strtof(esp_gps->item_str, NULL) * 1.852;
-        break;
-    case 8: /* Process true course over ground */
-        esp_gps->parent.cog = strtof(esp_gps->item_str, NULL);
-        break;
-    case 9: /* Process date */
-        esp_gps->parent.date.day = convert_two_digit2number(esp_gps->item_str + 0);
-        esp_gps->parent.date.month = convert_two_digit2number(esp_gps->item_str + 2);
-        esp_gps->parent.date.year = convert_two_digit2number(esp_gps->item_str + 4);
-        break;
-    case 10: /* Process magnetic variation */
-        esp_gps->parent.variation = strtof(esp_gps->item_str, NULL);
-        break;
-    default:
-        break;
     }
 }
-#endif
 
-#if CONFIG_NMEA_STATEMENT_GLL
 /**
- * @brief Parse GLL statements
+ * @brief Read the bytes waiting in the UART and hand them to gps_ingest
  *
  * @param esp_gps esp_gps_t type object
+ * @param size bytes reported by the UART event
  */
-static void parse_gll(esp_gps_t *esp_gps)
+static void esp_handle_uart_data(esp_gps_t *esp_gps, size_t size)
 {
-    /* Process GPGLL statement */
-    switch (esp_gps->item_num) {
-    case 1:/* Latitude */
-        esp_gps->parent.latitude = parse_lat_long(esp_gps);
-        break;
-    case 2: /* Latitude north(1)/south(-1) information */
-        if (esp_gps->item_str[0] == 'S' || esp_gps->item_str[0] == 's') {
-            esp_gps->parent.latitude *= -1;
-        }
-        break;
-    case 3: /* Longitude */
-        esp_gps->parent.longitude = parse_lat_long(esp_gps);
-        break;
-    case 4: /* Longitude east(1)/west(-1) information */
-        if (esp_gps->item_str[0] == 'W' || esp_gps->item_str[0] == 'w') {
-            esp_gps->parent.longitude *= -1;
+    while (size > 0) {
+        int read_len = uart_read_bytes(esp_gps->uart_port, esp_gps->rx,
+                                       size < sizeof(esp_gps->rx) ? size : sizeof(esp_gps->rx), 0);
+        if (read_len <= 0) {
+            break;
         }
-        break;
-    case 5:/* Process UTC time */
-        parse_utc_time(esp_gps);
-        break;
-    case 6: /* Process valid status */
-        esp_gps->parent.valid = (esp_gps->item_str[0] == 'A');
-        break;
-    default:
-        break;
+        gps_ingest(esp_gps, esp_gps->rx, read_len);
+        size -= read_len;
     }
 }
-#endif
 
-#if CONFIG_NMEA_STATEMENT_VTG
-/**
- * @brief Parse VTG statements
- *
- * @param esp_gps esp_gps_t type object
- */
-static void parse_vtg(esp_gps_t *esp_gps)
+static esp_err_t uart_link_set_baud(void *ctx, uint32_t baud)
 {
-    /* Process GPVGT statement */
-    switch (esp_gps->item_num) {
-    case 1: /* Process true course over ground */
-        esp_gps->parent.cog = strtof(esp_gps->item_str, NULL);
-        break;
-    case 3:/* Process magnetic variation */
-        esp_gps->parent.variation = strtof(esp_gps->item_str, NULL);
-        break;
-    case 5:/* Process ground speed in unit m/s */
-        esp_gps->parent.speed = strtof(esp_gps->item_str, NULL) * 1.852;//knots to m/s
-        break;
-    case 7:/* Process ground speed in unit m/s */
-        esp_gps->parent.speed = strtof(esp_gps->item_str, NULL) / 3.6;//km/h to m/s
-        break;
-    default:
-        break;
-    }
+    esp_gps_t *esp_gps = (esp_gps_t *)ctx;
+    uart_flush_input(esp_gps->uart_port);
+    return uart_set_baudrate(esp_gps->uart_port, baud);
 }
-#endif
 
-/**
- * @brief Parse received item
- *
- * @param esp_gps esp_gps_t type object
- * @return esp_err_t ESP_OK on success, ESP_FAIL on error
- */
-static esp_err_t parse_item(esp_gps_t *esp_gps)
+static int uart_link_write(void *ctx, const uint8_t *data, size_t len)
 {
-    esp_err_t err = ESP_OK;
-    /* start of a statement */
-    if (esp_gps->item_num == 0 && esp_gps->item_str[0] == '$') {
-        if (0) {
-        }
-#if CONFIG_NMEA_STATEMENT_GGA
-        else if (strstr(esp_gps->item_str, "GGA")) {
-            esp_gps->cur_statement = STATEMENT_GGA;
-        }
-#endif
-#if CONFIG_NMEA_STATEMENT_GSA
-        else if (strstr(esp_gps->item_str, "GSA")) {
-            esp_gps->cur_statement = STATEMENT_GSA;
-        }
-#endif
-#if CONFIG_NMEA_STATEMENT_RMC
-        else if (strstr(esp_gps->item_str, "RMC")) {
-            esp_gps->cur_statement = STATEMENT_RMC;
-        }
-#endif
-#if CONFIG_NMEA_STATEMENT_GSV
-        else if (strstr(esp_gps->item_str, "GSV")) {
-            esp_gps->cur_statement = STATEMENT_GSV;
-        }
-#endif
-#if CONFIG_NMEA_STATEMENT_GLL
-        else if (strstr(esp_gps->item_str, "GLL")) {
-            esp_gps->cur_statement = STATEMENT_GLL;
-        }
-#endif
-#if CONFIG_NMEA_STATEMENT_VTG
-        else if (strstr(esp_gps->item_str, "VTG")) {
-            esp_gps->cur_statement = STATEMENT_VTG;
-        }
-#endif
-        else {
-            esp_gps->cur_statement = STATEMENT_UNKNOWN;
-        }
-        goto out;
-    }
-    /* Parse each item, depend on the type of the statement */
-    if (esp_gps->cur_statement == STATEMENT_UNKNOWN) {
-        goto out;
-    }
-#if CONFIG_NMEA_STATEMENT_GGA
-    else if (esp_gps->cur_statement == STATEMENT_GGA) {
-        parse_gga(esp_gps);
-    }
-#endif
-#if CONFIG_NMEA_STATEMENT_GSA
-    else if (esp_gps->cur_statement == STATEMENT_GSA) {
-        parse_gsa(esp_gps);
-    }
-#endif
-#if CONFIG_NMEA_STATEMENT_GSV
-    else if (esp_gps->cur_statement == STATEMENT_GSV) {
-        parse_gsv(esp_gps);
-    }
-#endif
-#if CONFIG_NMEA_STATEMENT_RMC
-    else if (esp_gps->cur_statement == STATEMENT_RMC) {
-        parse_rmc(esp_gps);
-    }
-#endif
-#if CONFIG_NMEA_STATEMENT_GLL
-    else if (esp_gps->cur_statement == STATEMENT_GLL) {
-        parse_gll(esp_gps);
-    }
-#endif
-#if CONFIG_NMEA_STATEMENT_VTG
-    else if (esp_gps->cur_statement == STATEMENT_VTG) {
-        parse_vtg(esp_gps);
-    }
-#endif
-    else {
-        err =  ESP_FAIL;
-    }
-out:
-    return err;
+    esp_gps_t *esp_gps = (esp_gps_t *)ctx;
+    int written = uart_write_bytes(esp_gps->uart_port, (const char *)data, len);
+    uart_wait_tx_done(esp_gps->uart_port, 100 / portTICK_PERIOD_MS);
+    return written;
 }
 
-/**
- * @brief Parse NMEA statements from GPS receiver
- *
- * @param esp_gps esp_gps_t type object
- * @param len number of bytes to decode
- * @return esp_err_t ESP_OK on success, ESP_FAIL on error
- */
-static esp_err_t gps_decode(esp_gps_t *esp_gps, size_t len)
+static int uart_link_read(void *ctx, uint8_t *buf, size_t len, uint32_t timeout_ms)
 {
-    const uint8_t *d = esp_gps->buffer;
-    while (*d) {
-        /* Start of a statement */
-        if (*d == '$') {
-            /* Reset runtime information */
-            esp_gps->asterisk = 0;
-            esp_gps->item_num = 0;
-            esp_gps->item_pos = 0;
-            esp_gps->cur_statement = 0;
-            esp_gps->crc = 0;
-            esp_gps->sat_count = 0;
-            esp_gps->sat_num = 0;
-            /* Add character to item */
-            esp_gps->item_str[esp_gps->item_pos++] = *d;
-            esp_gps->item_str[esp_gps->item_pos] = '\0';
-        }
-        /* Detect item separator character */
-        else if (*d == ',') {
-            /* Parse current item */
-            parse_item(esp_gps);
-            /* Add character to CRC computation */
-            esp_gps->crc ^= (uint8_t)(*d);
-            /* Start with next item */
-            esp_gps->item_pos = 0;
-            esp_gps->item_str[0] = '\0';
-            esp_gps->item_num++;
-        }
-        /* End of CRC computation */
-        else if (*d == '*') {
-            /* Parse current item */
-            parse_item(esp_gps);
-            /* Asterisk detected */
-            esp_gps->asterisk = 1;
-            /* Start with next item */
-            esp_gps->item_pos = 0;
-            esp_gps->item_str[0] = '\0';
-            esp_gps->item_num++;
-        }
-        /* End of statement */
-        else if (*d == '\r') {
-            /* Convert received CRC from string (hex) to number */
-            uint8_t crc = (uint8_t)strtol(esp_gps->item_str, NULL, 16);
-            /* CRC passed */
-            if (esp_gps->crc == crc) {
-                switch (esp_gps->cur_statement) {
-#if CONFIG_NMEA_STATEMENT_GGA
-                case STATEMENT_GGA:
-                    esp_gps->parsed_statement |= 1 << STATEMENT_GGA;
-                    break;
-#endif
-#if CONFIG_NMEA_STATEMENT_GSA
-                case STATEMENT_GSA:
-                    esp_gps->parsed_statement |= 1 << STATEMENT_GSA;
-                    break;
-#endif
-#if CONFIG_NMEA_STATEMENT_RMC
-                case STATEMENT_RMC:
-                    esp_gps->parsed_statement |= 1 << STATEMENT_RMC;
-                    break;
-#endif
-#if CONFIG_NMEA_STATEMENT_GSV
-                case STATEMENT_GSV:
-                    if (esp_gps->sat_num == esp_gps->sat_count) {
-                        esp_gps->parsed_statement |= 1 << STATEMENT_GSV;
-                    }
-                    break;
-#endif
-#if CONFIG_NMEA_STATEMENT_GLL
-                case STATEMENT_GLL:
-                    esp_gps->parsed_statement |= 1 << STATEMENT_GLL;
-                    break;
-#endif
-#if CONFIG_NMEA_STATEMENT_VTG
-                case STATEMENT_VTG:
-                    esp_gps->parsed_statement |= 1 << STATEMENT_VTG;
-                    break;
-#endif
-                default:
-                    break;
-                }
-                /* Check if all statements have been parsed */
-                if (((esp_gps->parsed_statement) & esp_gps->all_statements) == esp_gps->all_statements) {
-                    esp_gps->parsed_statement = 0;
-                    /* Send signal to notify that GPS information has been updated */
-                    esp_event_post_to(esp_gps->event_loop_hdl, ESP_NMEA_EVENT, GPS_UPDATE,
-                                      &(esp_gps->parent), sizeof(gps_t), 100 / portTICK_PERIOD_MS);
-                }
-            } else {
-                ESP_LOGD(GPS_TAG, "CRC Error for statement:%s", esp_gps->buffer);
-            }
-            if (esp_gps->cur_statement == STATEMENT_UNKNOWN) {
-                /* Send signal to notify that one unknown statement has been met */
-                esp_event_post_to(esp_gps->event_loop_hdl, ESP_NMEA_EVENT, GPS_UNKNOWN,
-                                  esp_gps->buffer, len, 100 / portTICK_PERIOD_MS);
-            }
-        }
-        /* Other non-space character */
-        else {
-            if (!(esp_gps->asterisk)) {
-                /* Add to CRC */
-                esp_gps->crc ^= (uint8_t)(*d);
-            }
-            /* Add character to item */
-            esp_gps->item_str[esp_gps->item_pos++] = *d;
-            esp_gps->item_str[esp_gps->item_pos] = '\0';
-        }
-        /* Process next character */
-        d++;
+    esp_gps_t *esp_gps = (esp_gps_t *)ctx;
+    size_t avail = 0;
+    /* Take what is there without waiting, so an acknowledgement is seen as soon as it arrives */
+    uart_get_buffered_data_len(esp_gps->uart_port, &avail);
+    if (avail == 0) {
+        return uart_read_bytes(esp_gps->uart_port, buf, 1, pdMS_TO_TICKS(timeout_ms));
     }
-    return ESP_OK;
+    return uart_read_bytes(esp_gps->uart_port, buf, avail < len ? avail : len, 0);
 }
 
 /**
- * @brief Handle when a pattern has been detected by uart
+ * @brief Move the receiver to the configured baud rate, navigation rate and sentences
  *
  * @param esp_gps esp_gps_t type object
  */
-static void esp_handle_uart_pattern(esp_gps_t *esp_gps)
+static void gps_configure_receiver(esp_gps_t *esp_gps)
 {
-    int pos = uart_pattern_pop_pos(esp_gps->uart_port);
-    if (pos != -1) {
-        /* read one line(include '\n') */
-        int read_len = uart_read_bytes(esp_gps->uart_port, esp_gps->buffer, pos + 1, 100 / portTICK_PERIOD_MS);
-        /* make sure the line is a standard string */
-        esp_gps->buffer[read_len] = '\0';
-        /* Send new line to handle */
-        if (gps_decode(esp_gps, read_len + 1) != ESP_OK) {
-            ESP_LOGW(GPS_TAG, "GPS decode line failed");
-        }
-    } else {
-        ESP_LOGW(GPS_TAG, "Pattern Queue Size too small");
-        uart_flush_input(esp_gps->uart_port);
+    const gnss_link_t link = {
+        .set_baud = uart_link_set_baud,
+        .write = uart_link_write,
+        .read = uart_link_read,
+        .ctx = esp_gps,
+    };
+    if (gnss_config_run(&link, &esp_gps->receiver, &esp_gps->baud_rate) != ESP_OK) {
+        ESP_LOGW(GPS_TAG, "receiver configuration incomplete, carrying on at %u baud", esp_gps->baud_rate);
     }
+    /* Drop what was read while configuring, the parser starts from a clean line */
+    uart_flush_input(esp_gps->uart_port);
+    xQueueReset(esp_gps->event_queue);
 }
 
 /**
@@ -599,10 +294,14 @@ static void nmea_parser_task_entry(void *arg)
 {
     esp_gps_t *esp_gps = (esp_gps_t *)arg;
     uart_event_t event;
+    if (esp_gps->has_tx && esp_gps->receiver.type != GNSS_RECEIVER_NONE) {
+        gps_configure_receiver(esp_gps);
+    }
     while (1) {
         if (xQueueReceive(esp_gps->event_queue, &event, pdMS_TO_TICKS(200))) {
             switch (event.type) {
             case UART_DATA:
+                esp_handle_uart_data(esp_gps, event.size);
                 break;
             case UART_FIFO_OVF:
                 ESP_LOGW(GPS_TAG, "HW FIFO Overflow");
@@ -623,9 +322,6 @@ static void nmea_parser_task_entry(void *arg)
             case UART_FRAME_ERR:
                 ESP_LOGE(GPS_TAG, "Frame Error");
                 break;
-            case UART_PATTERN_DET:
-                esp_handle_uart_pattern(esp_gps);
-                break;
             default:
                 ESP_LOGW(GPS_TAG, "unknown uart event type: %d", event.type);
                 break;
@@ -655,27 +351,21 @@ nmea_parser_handle_t nmea_parser_init(const nmea_parser_config_t *config)
         ESP_LOGE(GPS_TAG, "calloc memory for runtime buffer failed");
         goto err_buffer;
     }
-#if CONFIG_NMEA_STATEMENT_GSA
-    esp_gps->all_statements |= (1 << STATEMENT_GSA);
-#endif
-#if CONFIG_NMEA_STATEMENT_GSV
-    esp_gps->all_statements |= (1 << STATEMENT_GSV);
-#endif
-#if CONFIG_NMEA_STATEMENT_GGA
-    esp_gps->all_statements |= (1 << STATEMENT_GGA);
-#endif
-#if CONFIG_NMEA_STATEMENT_RMC
-    esp_gps->all_statements |= (1 << STATEMENT_RMC);
-#endif
-#if CONFIG_NMEA_STATEMENT_GLL
-    esp_gps->all_statements |= (1 << STATEMENT_GLL);
-#endif
-#if CONFIG_NMEA_STATEMENT_VTG
-    esp_gps->all_statements |= (1 << STATEMENT_VTG);
-#endif
+#define NMEA_BUILT_BIT(NAME, name, fields) | (NMEA_STATEMENT_BUILT(NAME) << STATEMENT_##NAME)
+    esp_gps->built_statements = 0 NMEA_STATEMENT_LIST(NMEA_BUILT_BIT);
+#undef NMEA_BUILT_BIT
     /* Set attributes */
     esp_gps->uart_port = config->uart.uart_port;
-    esp_gps->all_statements &= 0xFE;
+    nmea_decoder_init(&esp_gps->dec);
+    /* Only the basic statements are waited for, the others may come at their own rate or not at all */
+    uint32_t required = esp_gps->built_statements & NMEA_REQUIRED_DEFAULT;
+    atomic_init(&esp_gps->all_statements, required ? required : esp_gps->built_statements);
+    /* Unknown statements are still posted as GPS_UNKNOWN unless turned off */
+    atomic_init(&esp_gps->enabled_statements, esp_gps->built_statements | (1 << STATEMENT_UNKNOWN));
+    esp_gps->baud_rate = config->uart.baud_rate;
+    esp_gps->has_tx = config->uart.tx_pin >= 0;
+    esp_gps->receiver = config->receiver;
+    esp_gps->receiver.statements = esp_gps->built_statements;
     /* Install UART friver */
     uart_config_t uart_config = {
         .baud_rate = config->uart.baud_rate,
@@ -694,15 +384,12 @@ nmea_parser_handle_t nmea_parser_init(const nmea_parser_config_t *config)
         ESP_LOGE(GPS_TAG, "config uart parameter failed");
         goto err_uart_config;
     }
-    if (uart_set_pin(esp_gps->uart_port, UART_PIN_NO_CHANGE, config->uart.rx_pin,
+    if (uart_set_pin(esp_gps->uart_port, esp_gps->has_tx ? config->uart.tx_pin : UART_PIN_NO_CHANGE, config->uart.rx_pin,
                      UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE) != ESP_OK) {
         ESP_LOGE(GPS_TAG, "config uart gpio failed");
         goto err_uart_config;
     }
-    /* Set pattern interrupt, used to detect the end of a line */
-    uart_enable_pattern_det_baud_intr(esp_gps->uart_port, '\n', 1, 9, 0, 0);
-    /* Set pattern queue size */
-    uart_pattern_queue_reset(esp_gps->uart_port, config->uart.event_queue_size);
+    /* Lines are found in software, a UBX frame can hold any byte so hardware line detection can't be used */
     uart_flush(esp_gps->uart_port);
     /* Create Event loop */
     esp_event_loop_args_t loop_args = {
@@ -792,3 +479,84 @@ esp_err_t nmea_parser_remove_handler(nmea_parser_handle_t nmea_hdl, esp_event_ha
     esp_gps_t *esp_gps = (esp_gps_t *)nmea_hdl;
     return esp_event_handler_unregister_with(esp_gps->event_loop_hdl, ESP_NMEA_EVENT, ESP_EVENT_ANY_ID, event_handler);
 }
+
+/**
+ * @brief Time the first statement with a good CRC was received
+ *
+ * @param nmea_hdl handle of NMEA parser
+ * @return int64_t esp_timer time in microseconds, 0 if none has been received yet
+ */
+int64_t nmea_parser_get_first_statement_time(nmea_parser_handle_t nmea_hdl)
+{
+    esp_gps_t *esp_gps = (esp_gps_t *)nmea_hdl;
+    return esp_gps->first_statement_us;
+}
+
+/**
+ * @brief Change which statements are parsed and which are needed for an update
+ *
+ * @param nmea_hdl handle of NMEA parser
+ * @param enabled statements to parse, bit (1 << nmea_statement_t) each
+ * @param required statements to wait for before posting GPS_UPDATE
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG if a statement is not compiled in or required but not enabled,
+ *         or none is required
+ */
+esp_err_t nmea_parser_set_statements(nmea_parser_handle_t nmea_hdl, uint32_t enabled, uint32_t required)
+{
+    esp_gps_t *esp_gps = (esp_gps_t *)nmea_hdl;
+    if (!nmea_statement_masks_valid(esp_gps->built_statements, enabled, required)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    atomic_store(&esp_gps->all_statements, required);
+    atomic_store(&esp_gps->enabled_statements, enabled);
+    return ESP_OK;
+}
+
+/**
+ * @brief Get which statements are parsed and which are needed for an update
+ *
+ * @param nmea_hdl handle of NMEA parser
+ * @param enabled filled with the statements parsed
+ * @param required filled with the statements needed for an update
+ * @param rejected filled with the number of statements dropped after the header, may be NULL
+ */
+void nmea_parser_get_statements(nmea_parser_handle_t nmea_hdl, uint32_t *enabled, uint32_t *required, uint32_t *rejected)
+{
+    esp_gps_t *esp_gps = (esp_gps_t *)nmea_hdl;
+    *enabled = atomic_load(&esp_gps->enabled_statements);
+    *required = atomic_load(&esp_gps->all_statements);
+    if (rejected) {
+        *rejected = atomic_load(&esp_gps->rejected);
+    }
+}
+
+/**
+ * @brief Decode a proprietary or other sentence the parser doesn't know
+ *
+ * @param nmea_hdl handle of NMEA parser
+ * @param key address to match
+ * @param schema type of each field after the address
+ * @param num_fields number of schema entries
+ * @param cb callback for each sentence with a good checksum
+ * @param ctx passed to the callback
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG or ESP_ERR_NO_MEM on error
+ */
+esp_err_t nmea_parser_register_sentence(nmea_parser_handle_t nmea_hdl, const char *key, const nmea_field_type_t *schema,
+                                        size_t num_fields, nmea_sentence_cb_t cb, void *ctx)
+{
+    esp_gps_t *esp_gps = (esp_gps_t *)nmea_hdl;
+    /* The parser reads the table without the lock, registrations are serialised against each other */
+    portENTER_CRITICAL(&sentences_lock);
+    esp_err_t err = nmea_sentence_add(&esp_gps->sentences, key, schema, num_fields, cb, ctx);
+    portEXIT_CRITICAL(&sentences_lock);
+    return err;
+}
+
+esp_err_t nmea_parser_set_raw_handler(nmea_parser_handle_t nmea_hdl, nmea_raw_cb_t cb, void *ctx)
+{
+    esp_gps_t *esp_gps = (esp_gps_t *)nmea_hdl;
+    /* The parser task reads ctx after it sees cb */
+    esp_gps->raw_ctx = ctx;
+    atomic_store_explicit(&esp_gps->raw_cb, cb, memory_order_release);
+    return ESP_OK;
+}
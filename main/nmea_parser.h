@@ -22,9 +22,9 @@ extern "C" {
 #include "esp_event.h"
 #include "esp_err.h"
 #include "driver/uart.h"
-
-#define GPS_MAX_SATELLITES_IN_USE (12)
-#define GPS_MAX_SATELLITES_IN_VIEW (16)
+#include "gnss_config.h"
+#include "nmea_gps.h"
+#include "nmea_sentence.h"
 
 /**
  * @brief Declare of NMEA Parser Event base
@@ -32,97 +32,6 @@ extern "C" {
  */
 ESP_EVENT_DECLARE_BASE(ESP_NMEA_EVENT);
 
-/**
- * @brief GPS fix type
- *
- */
-typedef enum {
-    GPS_FIX_INVALID, /*!< Not fixed */
-    GPS_FIX_GPS,     /*!< GPS */
-    GPS_FIX_DGPS,    /*!< Differential GPS */
-} gps_fix_t;
-
-/**
- * @brief GPS fix mode
- *
- */
-typedef enum {
-    GPS_MODE_INVALID = 1, /*!< Not fixed */
-    GPS_MODE_2D,          /*!< 2D GPS */
-    GPS_MODE_3D           /*!< 3D GPS */
-} gps_fix_mode_t;
-
-/**
- * @brief GPS satellite information
- *
- */
-typedef struct {
-    uint8_t num;       /*!< Satellite number */
-    uint8_t elevation; /*!< Satellite elevation */
-    uint16_t azimuth;  /*!< Satellite azimuth */
-    uint8_t snr;       /*!< Satellite signal noise ratio */
-} gps_satellite_t;
-
-/**
- * @brief GPS time
- *
- */
-typedef struct {
-    uint8_t hour;      /*!< Hour */
-    uint8_t minute;    /*!< Minute */
-    uint8_t second;    /*!< Second */
-    uint16_t thousand; /*!< Thousand */
-} gps_time_t;
-
-/**
- * @brief GPS date
- *
- */
-typedef struct {
-    uint8_t day;   /*!< Day (start from 1) */
-    uint8_t month; /*!< Month (start from 1) */
-    uint16_t year; /*!< Year (start from 2000) */
-} gps_date_t;
-
-/**
- * @brief NMEA Statement
- *
- */
-typedef enum {
-    STATEMENT_UNKNOWN = 0, /*!< Unknown statement */
-    STATEMENT_GGA,         /*!< GGA */
-    STATEMENT_GSA,         /*!< GSA */
-    STATEMENT_RMC,         /*!< RMC */
-    STATEMENT_GSV,         /*!< GSV */
-    STATEMENT_GLL,         /*!< GLL */
-    STATEMENT_VTG          /*!< VTG */
-} nmea_statement_t;
-
-/**
- * @brief GPS object
- *
- */
-typedef struct {
-    float latitude;                                                /*!< Latitude (degrees) */
-    float longitude;                                               /*!< Longitude (degrees) */
-    float altitude;                                                /*!< Altitude (meters) */
-    gps_fix_t fix;                                                 /*!< Fix status */
-    uint8_t sats_in_use;                                           /*!< Number of satellites in use */
-    gps_time_t tim;                                                /*!< time in UTC */
-    gps_fix_mode_t fix_mode;                                       /*!< Fix mode */
-    uint8_t sats_id_in_use[GPS_MAX_SATELLITES_IN_USE];             /*!< ID list of satellite in use */
-    float dop_h;                                                   /*!< Horizontal dilution of precision */
-    float dop_p;                                                   /*!< Position dilution of precision  */
-    float dop_v;                                                   /*!< Vertical dilution of precision  */
-    uint8_t sats_in_view;                                          /*!< Number of satellites in view */
-    gps_satellite_t sats_desc_in_view[GPS_MAX_SATELLITES_IN_VIEW]; /*!< Information of satellites in view */
-    gps_date_t date;                                               /*!< Fix date */
-    bool valid;                                                    /*!< GPS validity */
-    float speed;                                                   /*!< Ground speed, unit: m/s */
-    float cog;                                                     /*!< Course over ground */
-    float variation;                                               /*!< Magnetic variation */
-} gps_t;
-
 /**
  * @brief Configuration of NMEA Parser
  *
@@ -131,12 +40,14 @@ typedef struct {
     struct {
         uart_port_t uart_port;        /*!< UART port number */
         uint32_t rx_pin;              /*!< UART Rx Pin number */
+        int32_t tx_pin;               /*!< UART Tx Pin number, -1 if the receiver can't be configured */
         uint32_t baud_rate;           /*!< UART baud rate */
         uart_word_length_t data_bits; /*!< UART data bits length */
         uart_parity_t parity;         /*!< UART parity */
         uart_stop_bits_t stop_bits;   /*!< UART stop bits length */
         uint32_t event_queue_size;    /*!< UART event queue size */
     } uart;                           /*!< UART specific configuration */
+    gnss_config_t receiver;           /*!< Receiver settings applied at startup, needs tx_pin */
 } nmea_parser_config_t;
 
 /**
@@ -154,12 +65,14 @@ typedef void *nmea_parser_handle_t;
         .uart = {                          \
             .uart_port = UART_NUM_1,       \
             .rx_pin = 2,                   \
+            .tx_pin = CONFIG_NMEA_PARSER_UART_TXD, \
             .baud_rate = 9600,             \
             .data_bits = UART_DATA_8_BITS, \
             .parity = UART_PARITY_DISABLE, \
             .stop_bits = UART_STOP_BITS_1, \
             .event_queue_size = 16         \
-        }                                  \
+        },                                 \
+        .receiver = GNSS_CONFIG_DEFAULT(), \
     }
 
 /**
@@ -171,6 +84,15 @@ typedef enum {
     GPS_UNKNOWN /*!< Unknown statements detected */
 } nmea_event_id_t;
 
+/**
+ * @brief Called on the parser task with every sentence whose checksum passed
+ *
+ * @param sentence the sentence as received, from '$' to "\r\n", not terminated
+ * @param len length of the sentence
+ * @param ctx context given with the handler
+ */
+typedef void (*nmea_raw_cb_t)(const char *sentence, size_t len, void *ctx);
+
 /**
  * @brief Init NMEA Parser
  *
@@ -213,6 +135,80 @@ esp_err_t nmea_parser_add_handler(nmea_parser_handle_t nmea_hdl, esp_event_handl
  */
 esp_err_t nmea_parser_remove_handler(nmea_parser_handle_t nmea_hdl, esp_event_handler_t event_handler);
 
+/**
+ * @brief Time the first statement with a good CRC was received
+ *
+ * @param nmea_hdl handle of NMEA parser
+ * @return int64_t esp_timer time in microseconds, 0 if none has been received yet
+ */
+int64_t nmea_parser_get_first_statement_time(nmea_parser_handle_t nmea_hdl);
+
+/**
+ * @brief Change which statements are parsed and which are needed for an update
+ *
+ * Statements that are not enabled are dropped straight after their 6 character header, before any
+ * checksum or item parsing. GPS_UPDATE is posted once every required statement has been parsed, so
+ * dropping a statement from the required set also stops updates waiting for it. Bit STATEMENT_UNKNOWN
+ * in enabled passes other statements on as GPS_UNKNOWN. By default every statement compiled in is enabled,
+ * and GGA, GSA, GSV, RMC, GLL and VTG are required. Statements that are enabled but not required are
+ * published with whichever update follows them. Can be called from any task.
+ *
+ * @param nmea_hdl handle of NMEA parser
+ * @param enabled statements to parse, bit (1 << nmea_statement_t) each
+ * @param required statements to wait for before posting GPS_UPDATE, a subset of enabled
+ * @return esp_err_t
+ *  - ESP_OK: Success
+ *  - ESP_ERR_INVALID_ARG: A statement is not compiled in, or is required but not enabled, or none is required
+ */
+esp_err_t nmea_parser_set_statements(nmea_parser_handle_t nmea_hdl, uint32_t enabled, uint32_t required);
+
+/**
+ * @brief Get which statements are parsed and which are needed for an update
+ *
+ * @param nmea_hdl handle of NMEA parser
+ * @param enabled filled with the statements parsed
+ * @param required filled with the statements needed for an update
+ * @param rejected filled with the number of statements dropped after the header, may be NULL
+ */
+void nmea_parser_get_statements(nmea_parser_handle_t nmea_hdl, uint32_t *enabled, uint32_t *required, uint32_t *rejected);
+
+/**
+ * @brief Decode a proprietary or other sentence the parser doesn't know
+ *
+ * The key is matched against the address field, the characters between '$' and the first ','. A '-'
+ * in the key matches any character, so "--TXT" matches GPTXT and GNTXT. Matching sentences are
+ * checksummed and split in the parser's single pass over the line, converted to the types in the
+ * schema and handed to the callback instead of being posted as GPS_UNKNOWN. They are decoded even
+ * when STATEMENT_UNKNOWN is not enabled. Sentences are checked in the order they were registered.
+ *
+ * @param nmea_hdl handle of NMEA parser
+ * @param key address to match, up to 14 characters, e.g. "PMTK001", "PUBX" or "--TXT"
+ * @param schema type of each field after the address, must stay valid while the parser runs
+ * @param num_fields number of schema entries, up to CONFIG_NMEA_PARSER_MAX_FIELDS
+ * @param cb callback for each sentence with a good checksum
+ * @param ctx passed to the callback
+ * @return esp_err_t
+ *  - ESP_OK: Success
+ *  - ESP_ERR_INVALID_ARG: The key is empty or too long, or there are too many fields
+ *  - ESP_ERR_NO_MEM: CONFIG_NMEA_PARSER_MAX_SENTENCES sentences are already registered
+ */
+esp_err_t nmea_parser_register_sentence(nmea_parser_handle_t nmea_hdl, const char *key, const nmea_field_type_t *schema,
+                                        size_t num_fields, nmea_sentence_cb_t cb, void *ctx);
+
+/**
+ * @brief Pass the received sentences on, e.g. to forward them to another device
+ *
+ * Only sentences that are enabled (see nmea_parser_set_statements) or registered reach the handler, the
+ * others are dropped after their header. It runs on the parser task and must not block. Set it once,
+ * the context of a handler that is replaced while the parser runs may be mixed up for one sentence.
+ *
+ * @param nmea_hdl handle of NMEA parser
+ * @param cb handler, NULL to stop
+ * @param ctx passed to cb
+ * @return esp_err_t ESP_OK
+ */
+esp_err_t nmea_parser_set_raw_handler(nmea_parser_handle_t nmea_hdl, nmea_raw_cb_t cb, void *ctx);
+
 #ifdef __cplusplus
 }
 #endif
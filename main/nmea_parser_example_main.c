@@ -9,10 +9,12 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <limits.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
 #include "nmea_parser.h"
+#include "nmea_decode.h"
 
 //Wifi Access Point includes
 #include <string.h>
@@ -33,22 +35,109 @@
 //pwm icludes
 #include "driver/mcpwm.h"
 
+//Control loop timing includes
+#include "esp_timer.h"
+#include "control_stats.h"
+#include "station_controller.h"
+#include "drift_history.h"
+#include "dead_reckoning.h"
+#include "nav_filter.h"
+#include "geo.h"
+#include "page_cache.h"
+#include "telemetry.h"
+#include "command_queue.h"
+#include "route.h"
+#include "geofence.h"
+#include "track_log.h"
+#include "settings.h"
+#include "boot_timing.h"
+#include "numfmt.h"
+#include "nmea_output.h"
+#include "nmea_server.h"
+
 //static const char *TAG = "gps_demo";
 
-//Global Static variables for passing GPS lat long back to main program
-static float longitudex;
-static float latitudex;
-static float lat_target;
-static float long_target;
+//Last fix as the GPS handler hands it to the control task. The handler fills its own copy and publishes it
+//whole under last_fix_lock, and the control task copies it out once a cycle, so neither sees half a fix.
+//Only what the control task and the NMEA output use, not the whole gps_t with its satellites
+typedef struct {
+    uint32_t seq;           //incremented on every new fix
+    int64_t time_us;        //esp_timer time of the fix
+    int64_t utc_ms;         //UTC of the fix, ms since 1970, 0 until the receiver has sent a date
+    geo_point_t position;   //1e-7 degrees, exactly as the receiver gave it
+    float speed;            //speed over ground m/s
+    float cog;              //course over ground degrees
+    float dop_h;            //horizontal dilution of precision
+    float err_lat;          //1 sigma latitude error from the last GST (m)
+    float err_lon;          //1 sigma longitude error from the last GST (m)
+    uint8_t gst_age;        //fixes since the last GST, its errors are used to weight the fix while fresh
+    gps_time_t tim;         //the rest is repeated as RMC on the NMEA output
+    gps_date_t date;
+    bool valid;
+    float variation;
+} fix_snapshot_t;
+static fix_snapshot_t last_fix;
+static portMUX_TYPE last_fix_lock = portMUX_INITIALIZER_UNLOCKED;
+//Setpoints and navigation results, only touched by the control task, the webserver changes setpoints through command_queue
+static geo_point_t target;  //station keeping target, or the point steered for on a route leg
 static float bearing;
 static float distance;
 static int motorgain = 50;  //overall motor gain that can be trimmed in web page for tuning pull strength 
+static command_queue_t command_queue;
+static nmea_parser_handle_t nmea_hdl;
+static geo_point_t route_upload[ROUTE_MAX_WAYPOINTS]; //waypoints uploaded by the webserver, handed over by COMMAND_SET_ROUTE
+static atomic_bool route_upload_busy;                 //set while route_upload waits for the control task
+static route_t route;                                 //route the control task is following, no waypoints when holding one point
+static geofence_def_t fence_def;                      //polygons in force as entered, owned by the webserver
+static geofence_def_t fence_upload;                   //polygons handed over by COMMAND_SET_GEOFENCE, edited while not busy
+static atomic_bool fence_upload_busy;                 //set while fence_upload waits for the control task
+static geofence_t fence;                              //projected polygons checked by the control task every cycle
+
+#define MAX_NUDGE_M (1000.0f) //largest single target nudge accepted from the webserver
+static float port_duty;     //last commanded port motor duty %
+static float stbd_duty;     //last commanded starbord motor duty %
+
+//Control task handle and timing statistics, stats are written by the control task and read by the webserver
+static TaskHandle_t control_task_hdl;
+static control_stats_t control_stats;
+static drift_estimate_t drift_estimate;
+static dead_reckoning_quality_t dr_quality;
+static uint32_t nav_filter_us_last; //time spent in the Kalman filter in the last cycle
+static uint32_t nav_filter_us_max;  //longest time spent in the Kalman filter in one cycle
+static uint32_t geofence_us_last;   //time spent on geofence checks in the last cycle
+static uint32_t geofence_us_max;    //longest time spent on geofence checks in one cycle
+static uint32_t geofence_overruns;  //cycles where the geofence checks took longer than GEOFENCE_BUDGET_US
+static uint32_t geofence_breaches;  //times the boat went over a geofence boundary
+static float geofence_clearance;    //distance to the nearest geofence boundary, capped at the margin
+static portMUX_TYPE control_stats_lock = portMUX_INITIALIZER_UNLOCKED;
+
+#define EXCURSION_RADIUS_M (10.0f) //drift further than this from the target counts as an excursion
+#define GEOFENCE_MARGIN_M (10.0f)  //thrust towards a geofence boundary fades out within this distance
+#define GEOFENCE_ESCAPE_DUTY (40.0f) //duty used to come round and drive back over a geofence boundary once breached
+#define GEOFENCE_BUDGET_US (500)   //geofence checks should take less than this per cycle
+#define GST_MAX_AGE (3)            //fall back to HDOP weighting once GST has been missing for this many fixes
+//our own sentences are built when something takes them, the UART output or the network server
+#if CONFIG_NMEA_OUTPUT_UART_TXD >= 0 || CONFIG_NMEA_SERVER
+#define NMEA_OUT_ENABLED (1)
+#else
+#define NMEA_OUT_ENABLED (0)
+#endif
 
 static const char *TAG = "wifi softAP";
 
 #define TIME_ZONE (+10)   //Sydney Time
 #define YEAR_BASE (2000) //date in GPS starts from 2000
 
+//UTC of a fix in ms since 1970, 0 if the receiver hasn't sent a date yet
+static int64_t gps_utc_ms(const gps_t *gps)
+{
+    if (gps->date.month == 0 || gps->date.day == 0){
+        return 0;
+    }
+    int64_t days = numfmt_days_from_civil(gps->date.year + YEAR_BASE, gps->date.month, gps->date.day);
+    return ((days * 24 + gps->tim.hour) * 60 + gps->tim.minute) * 60000 + gps->tim.second * 1000 + gps->tim.thousand;
+}
+
 //Memory and WiFi Connect #defines
 #define EXAMPLE_ESP_WIFI_SSID      "spotlock"
 #define EXAMPLE_ESP_WIFI_PASS      "password"
@@ -68,16 +157,17 @@ static void wifi_event_handler(void* arg, esp_event_base_t event_base, int32_t e
                  MAC2STR(event->mac), event->aid);
     }
 }
-void wifi_init_softap(void)
+//Initialize NVS, needed by the settings restore and by WiFi
+void nvs_init(void)
 {
-    //Initialize NVS
     esp_err_t ret = nvs_flash_init();
     if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
       ESP_ERROR_CHECK(nvs_flash_erase());
       ret = nvs_flash_init();
     }
-
-
+}
+void wifi_init_softap(void)
+{
     ESP_ERROR_CHECK(esp_netif_init());
     ESP_ERROR_CHECK(esp_event_loop_create_default());
     esp_netif_create_default_wifi_ap();
@@ -109,8 +199,8 @@ void wifi_init_softap(void)
              EXAMPLE_ESP_WIFI_SSID, EXAMPLE_ESP_WIFI_PASS, EXAMPLE_ESP_WIFI_CHANNEL);
 }
 
-//Webserver Hard Coded HTML Web Pages
-char html_index[] = "<!DOCTYPE html>"
+//Webserver Hard Coded HTML Web Page, a small client that takes live values from /ws (or /api/state) and updates in place
+static const char html_index[] = "<!DOCTYPE html>"
                     "<html>"
                     "<head>"
                         "<meta name=\"viewport\" content=\"width=device-width, initial-scale=1.0\">"
@@ -118,188 +208,631 @@ char html_index[] = "<!DOCTYPE html>"
                         "<body>"
                             "<h2 style=\"background-color:DodgerBlue; text-align:center;\">SPOT LOCK WEB PAGE</h2>"
                             "<p>Unit Position:</p>"
-                            "<p>";
-                            //insert live variables
-char html_index_2[] =       "</p>"
-                            "<p>Target Position:</p/>"
-                            "<p>";
-                            //insert live variables
-char html_index_3[] =       "</p>"
+                            "<p id=\"pos\">-</p>"
+                            "<p>Target Position:</p>"
+                            "<p id=\"tgt\">-</p>"
+                            "<p>Lat <input id=\"tlat\" size=\"11\"> Long <input id=\"tlon\" size=\"11\"> "
+                            "<button type=\"button\" onclick=\"settgt()\">Set Target</button></p>"
+                            "<p id=\"rng\">-</p>"
+                            "<p id=\"hdg\">-</p>"
+                            "<p id=\"wp\"></p>"
+                            "<p id=\"alarm\" style=\"color:red;font-weight:bold\"></p>"
                             "<p align=\"center\">______________________________________________________________________________</p>"
-                            "<p><button type=\"button\" onclick= \"window.location.href='pg'\">+ Gain</button>       </p>";
-                            //insert live variables
-char html_index_4[] =       "<p>         <button type=\"button\" onclick= \"window.location.href='mg'\">- Gain</button></p>"
+                            "<p><button type=\"button\" onclick=\"go('api/gain?step=5')\">+ Gain</button>       </p>"
+                            "<p id=\"gain\">-</p>"
+                            "<p>         <button type=\"button\" onclick=\"go('api/gain?step=-5')\">- Gain</button></p>"
                             "<p align=\"center\">______________________________________________________________________________</p>"
                             "<p align=\"center\">"
-                            "<button type=\"button\" onclick= \"window.location.href='N10'\" style=\"margin-left:auto;margin-right:auto;display:block;margin-top:22\%;margin-bottom:0\%\">North 10m</button>"
+                            "<button type=\"button\" onclick=\"go('api/nudge?n=10')\" style=\"margin-left:auto;margin-right:auto;display:block;margin-top:22%;margin-bottom:0%\">North 10m</button>"
                             "</p>"
                             "<p align=\"center\">"
-                            "<button type=\"button\" onclick= \"window.location.href='N2'\" style=\"margin-left:auto;margin-right:auto;display:block;margin-top:22\%;margin-bottom:0\%\">North 2m</button>"
+                            "<button type=\"button\" onclick=\"go('api/nudge?n=2')\" style=\"margin-left:auto;margin-right:auto;display:block;margin-top:22%;margin-bottom:0%\">North 2m</button>"
                             "</p>"
                             "<p align=\"center\">"
-                            "<button type=\"button\" onclick= \"window.location.href='W10'\">West 10m</button>"
-                            "<button type=\"button\" onclick= \"window.location.href='W2'\">West 2m</button>"
+                            "<button type=\"button\" onclick=\"go('api/nudge?e=-10')\">West 10m</button>"
+                            "<button type=\"button\" onclick=\"go('api/nudge?e=-2')\">West 2m</button>"
                             "                                              "
-                            "<button type=\"button\" onclick= \"window.location.href='E2'\" >East 2m</button>"
-                            "<button type=\"button\" onclick= \"window.location.href='E10'\" >East 10m</button>"
+                            "<button type=\"button\" onclick=\"go('api/nudge?e=2')\" >East 2m</button>"
+                            "<button type=\"button\" onclick=\"go('api/nudge?e=10')\" >East 10m</button>"
                             "</p>"
                             "<p align=\"center\">"
-                            "<button type=\"button\" onclick= \"window.location.href='S2'\" style=\"margin-left:auto;margin-right:auto;display:block;margin-top:22\%;margin-bottom:0\%\">South 2m</button>"
+                            "<button type=\"button\" onclick=\"go('api/nudge?n=-2')\" style=\"margin-left:auto;margin-right:auto;display:block;margin-top:22%;margin-bottom:0%\">South 2m</button>"
                             "</p>"
                             "<p align=\"center\">"
-                            "<button type=\"button\" onclick= \"window.location.href='S10'\" style=\"margin-left:auto;margin-right:auto;display:block;margin-top:22\%;margin-bottom:0\%\">South 10m</button>"
+                            "<button type=\"button\" onclick=\"go('api/nudge?n=-10')\" style=\"margin-left:auto;margin-right:auto;display:block;margin-top:22%;margin-bottom:0%\">South 10m</button>"
                             "</p>"
+                            "<script>"
+                            "var ws;"
+                            "function $(i){return document.getElementById(i);}"
+                            "function show(s){"
+                                "$('pos').textContent='Lat '+s.lat.toFixed(6)+'N, Long '+s.lon.toFixed(6)+'E';"
+                                "$('tgt').textContent='Lat '+s.tlat.toFixed(6)+'N, Long '+s.tlon.toFixed(6)+'E';"
+                                "$('rng').textContent='Distance: '+s.range.toFixed(2)+'  Bearing: '+s.brg.toFixed(1);"
+                                "$('hdg').textContent='Heading: '+s.hdg.toFixed(1)+'  Port: '+s.port.toFixed(0)+'%  Stbd: '+s.stbd.toFixed(0)+'%';"
+                                "$('gain').textContent='Motor Gain:  '+s.gain;"
+                                "$('alarm').textContent=s.alarm?'GEOFENCE ALARM':'';"
+                                "$('wp').textContent=s.wp<0?'':'Waypoint '+s.wp+'  Cross track: '+s.xte.toFixed(1)+'m';"
+                            "}"
+                            "function poll(){fetch('api/state').then(function(r){return r.json();}).then(show);}"
+                            "function go(c){fetch(c,{method:'POST'}).then(function(){if(!ws||ws.readyState!=1)setTimeout(poll,300);});}"
+                            "function settgt(){go('api/target?lat='+Math.round($('tlat').value*1e7)+'&lon='+Math.round($('tlon').value*1e7));}"
+                            "function connect(){"
+                                "ws=new WebSocket('ws://'+location.host+'/ws');"
+                                "ws.onmessage=function(e){show(JSON.parse(e.data));};"
+                                "ws.onclose=function(){setTimeout(connect,2000);};"
+                            "}"
+                            "poll();connect();"
+                            "</script>"
                         "</body>"
                     "</html>";                    
 
 //Webserver Code
+//Page statistics, only touched from the httpd task
+static uint32_t page_requests;
+static uint32_t page_us_last;
+static uint32_t page_us_max;
+static uint32_t page_stack_free_min = UINT32_MAX;
+
+//The page is static and served straight from flash, live values come over the WebSocket
+static page_cache_t index_cache;
+
 esp_err_t send_page(httpd_req_t *req)
 {
-    int numchars;
-    char response_data[sizeof(html_index) + sizeof(html_index_2) + sizeof(html_index_3) + sizeof(html_index_4) + 150]; //Create "response_data" which is an array of chars, use the content to drive the array size
-    memset(response_data, 0, sizeof(response_data)); //set all of response_data to "0" chars
-    numchars = sprintf(response_data, html_index);  //Stores "html_index" in response_data, records the number of chars in numchars
-    numchars = numchars + sprintf(response_data + numchars, "Lat %fN, Long %fE", latitudex, longitudex); //Uses numchars to append to response_data and updates numchars
-    numchars = numchars + sprintf(response_data + numchars, html_index_2);
-    numchars = numchars + sprintf(response_data + numchars, "Lat %fN, Long %fE</p><p> Distance: %f  Bearing: %f", lat_target, long_target, distance, bearing);
-    numchars = numchars + sprintf(response_data + numchars, html_index_3);
-    numchars = numchars + sprintf(response_data + numchars, "Motor Gain:  %d   ", motorgain);
-    numchars = numchars + sprintf(response_data + numchars, html_index_4);
-    numchars = httpd_resp_send(req, response_data, HTTPD_RESP_USE_STRLEN);
-    return numchars;
+    int64_t start_us = esp_timer_get_time();
+    esp_err_t err = page_cache_serve(&index_cache, req, 0, "text/html", NULL, NULL);
+
+    page_requests++;
+    page_us_last = (uint32_t)(esp_timer_get_time() - start_us);
+    if (page_us_last > page_us_max) {
+        page_us_max = page_us_last;
+    }
+    if (uxTaskGetStackHighWaterMark(NULL) < page_stack_free_min) {
+        page_stack_free_min = uxTaskGetStackHighWaterMark(NULL);
+    }
+    return err;
+}
+//Setpoint changes are queued for the control task and acknowledged with an empty response,
+//the new state reaches the page with the next push
+esp_err_t send_command(httpd_req_t *req, const command_t *cmd)
+{
+    if (!command_queue_push(&command_queue, cmd)){
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    //a manual setpoint ends any route, the stored one must not come back at the next boot either
+    if ((cmd->type == COMMAND_SET_TARGET || cmd->type == COMMAND_NUDGE) && route_save(NULL, 0, false) != ESP_OK){
+        ESP_LOGW(TAG, "stored route not erased");
+    }
+    httpd_resp_set_status(req, HTTPD_204);
+    return httpd_resp_send(req, NULL, 0);
+}
+//Copy the query string of the request into query, false if there is none or it is too long
+static bool get_query(httpd_req_t *req, char *query, size_t len)
+{
+    return httpd_req_get_url_query_str(req, query, len) == ESP_OK;
+}
+//True if the query has the key, whatever its value
+static bool query_has(const char *query, const char *key)
+{
+    char text[2];
+    return httpd_query_key_value(query, key, text, sizeof(text)) != ESP_ERR_NOT_FOUND;
+}
+//Read an integer query parameter within [min, max], false if missing or malformed, value is only set on success
+static bool query_long(const char *query, const char *key, long min, long max, long *value)
+{
+    char text[16];
+    char *end;
+    long v;
+    if (httpd_query_key_value(query, key, text, sizeof(text)) != ESP_OK){
+        return false;
+    }
+    v = strtol(text, &end, 10);
+    if (end == text || *end != '\0' || v < min || v > max){
+        return false;
+    }
+    *value = v;
+    return true;
+}
+//Read a decimal query parameter within [min, max], false if missing or malformed, value is only set on success
+static bool query_float(const char *query, const char *key, float min, float max, float *value)
+{
+    char text[16];
+    char *end;
+    float v;
+    if (httpd_query_key_value(query, key, text, sizeof(text)) != ESP_OK){
+        return false;
+    }
+    v = strtof(text, &end);
+    if (end == text || *end != '\0' || !(v >= min && v <= max)){
+        return false;
+    }
+    *value = v;
+    return true;
 }
 esp_err_t index_handler(httpd_req_t *req)
 {
     return send_page(req);
 }
-esp_err_t minusgain_handler(httpd_req_t *req)
-{   
-    if (motorgain > 0){
-        motorgain = motorgain -5; 
-    }  
-    return send_page(req);
+//POST /api/target?lat=<1e-7 deg>&lon=<1e-7 deg>, move the target to a typed position
+esp_err_t target_handler(httpd_req_t *req)
+{
+    char query[64];
+    long lat, lon;
+    if (!get_query(req, query, sizeof(query)) ||
+        !query_long(query, "lat", -90L * GEO_E7_PER_DEG, 90L * GEO_E7_PER_DEG, &lat) ||
+        !query_long(query, "lon", -180L * GEO_E7_PER_DEG, 180L * GEO_E7_PER_DEG, &lon)){
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "lat and lon in 1e-7 degrees required");
+    }
+    const command_t cmd = { .type = COMMAND_SET_TARGET, .target = { .lat_e7 = lat, .lon_e7 = lon } };
+    return send_command(req, &cmd);
 }
-esp_err_t plusgain_handler(httpd_req_t *req)
+//POST /api/nudge?n=<metres>&e=<metres>, move the target in the local frame, either may be left out
+esp_err_t nudge_handler(httpd_req_t *req)
 {
-    if (motorgain < 100){
-        motorgain = motorgain +5; 
-    }  
-    return send_page(req);
+    char query[64];
+    command_t cmd = { .type = COMMAND_NUDGE };
+    bool has_n, has_e;
+    if (!get_query(req, query, sizeof(query))){
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "n or e in metres required");
+    }
+    has_n = query_has(query, "n");
+    has_e = query_has(query, "e");
+    if ((!has_n && !has_e) ||
+        (has_n && !query_float(query, "n", -MAX_NUDGE_M, MAX_NUDGE_M, &cmd.nudge.north)) ||
+        (has_e && !query_float(query, "e", -MAX_NUDGE_M, MAX_NUDGE_M, &cmd.nudge.east))){
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "n or e in metres required");
+    }
+    return send_command(req, &cmd);
 }
-esp_err_t N10_handler(httpd_req_t *req)
+//POST /api/gain?set=<%> or /api/gain?step=<%>
+esp_err_t gain_handler(httpd_req_t *req)
 {
-    lat_target = lat_target + 0.0001; //North 10m  
-    return send_page(req);
+    char query[32];
+    long gain;
+    command_t cmd;
+    if (get_query(req, query, sizeof(query)) && query_long(query, "set", 0, 100, &gain)){
+        cmd.type = COMMAND_SET_GAIN;
+    } else if (get_query(req, query, sizeof(query)) && query_long(query, "step", -100, 100, &gain)){
+        cmd.type = COMMAND_STEP_GAIN;
+    } else {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "set or step in % required");
+    }
+    cmd.gain = gain;
+    return send_command(req, &cmd);
 }
-esp_err_t N2_handler(httpd_req_t *req)
+//Read a comma separated list of statement names into a mask, mask is left alone if key is missing,
+//an empty list is refused like an unknown name
+static bool query_statements(const char *query, const char *key, uint32_t *mask)
 {
-    lat_target = lat_target + 0.00002; //North 2m  
-    return send_page(req);
+    char text[64];
+    if (httpd_query_key_value(query, key, text, sizeof(text)) != ESP_OK){
+        return true;
+    }
+    return nmea_statement_mask_parse(text, mask);
 }
-esp_err_t W10_handler(httpd_req_t *req)
+//Change which NMEA statements are parsed and which ones a fix waits for, e.g. turn GSV off while holding
+esp_err_t nmea_handler(httpd_req_t *req)
 {
-    long_target = long_target - 0.0001;
-    return send_page(req);
+    char query[160];
+    uint32_t enabled, required;
+    nmea_parser_get_statements(nmea_hdl, &enabled, &required, NULL);
+    if (!get_query(req, query, sizeof(query))){
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "enable and/or require statement lists required");
+    }
+    if (!query_statements(query, "enable", &enabled) || !query_statements(query, "require", &required)){
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "empty list or unknown statement name");
+    }
+    //a statement that is turned off can't be waited for
+    if (!strstr(query, "require=")){
+        required &= enabled;
+    }
+    if (nmea_parser_set_statements(nmea_hdl, enabled, required) != ESP_OK){
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "statement not built in, required but not enabled, or none required");
+    }
+    httpd_resp_set_status(req, HTTPD_204);
+    return httpd_resp_send(req, NULL, 0);
 }
-esp_err_t W2_handler(httpd_req_t *req)
+//Receive the whole request body into buf as a string, false if it doesn't fit or the connection failed
+static bool recv_body(httpd_req_t *req, char *buf, size_t cap)
 {
-    long_target = long_target - 0.00002;
-    return send_page(req);
+    size_t received = 0;
+    if (req->content_len >= cap){
+        httpd_resp_send_err(req, HTTPD_413_CONTENT_TOO_LARGE, "body too large");
+        return false;
+    }
+    while (received < req->content_len){
+        int ret = httpd_req_recv(req, buf + received, req->content_len - received);
+        if (ret == HTTPD_SOCK_ERR_TIMEOUT){
+            continue;
+        }
+        if (ret <= 0){
+            return false;
+        }
+        received += ret;
+    }
+    buf[received] = '\0';
+    return true;
 }
-esp_err_t E2_handler(httpd_req_t *req)
+//Parse one "<lat>,<lon>" per line in 1e-7 degrees, returns an error message or NULL on success
+static const char *parse_points(char *p, geo_point_t *points, uint32_t max, uint32_t *count)
 {
-    long_target = long_target + 0.00002;
-    return send_page(req);
+    char *end;
+    long lat, lon;
+    *count = 0;
+    while (1){
+        p += strspn(p, " \t\r\n");
+        if (*p == '\0'){
+            return NULL;
+        }
+        if (*count == max){
+            return "too many points";
+        }
+        lat = strtol(p, &end, 10);
+        if (end == p || *end != ',' || lat < -90L * GEO_E7_PER_DEG || lat > 90L * GEO_E7_PER_DEG){
+            return "expected <lat>,<lon> in 1e-7 degrees";
+        }
+        p = end + 1;
+        lon = strtol(p, &end, 10);
+        if (end == p || (*end != '\0' && !strchr(" \t\r\n", *end)) ||
+            lon < -180L * GEO_E7_PER_DEG || lon > 180L * GEO_E7_PER_DEG){
+            return "expected <lat>,<lon> in 1e-7 degrees";
+        }
+        p = end;
+        points[*count].lat_e7 = lat;
+        points[*count].lon_e7 = lon;
+        (*count)++;
+    }
 }
-esp_err_t E10_handler(httpd_req_t *req)
+//Room for the longest coordinates on every line of the largest upload
+static char upload_body[GEOFENCE_MAX_VERTICES * 24 + 1];
+//POST /api/waypoints[?loop=1], body is one "<lat>,<lon>" per line in 1e-7 degrees, replaces the route
+//and stores it for the next boot. An empty body clears the route
+esp_err_t waypoints_handler(httpd_req_t *req)
 {
-    long_target = long_target + 0.0001;
-    return send_page(req);
+    char query[16];
+    long loop = 0;
+    uint32_t count;
+    const char *error;
+
+    if (!recv_body(req, upload_body, sizeof(upload_body))){
+        return ESP_FAIL;
+    }
+    if (get_query(req, query, sizeof(query)) && query_has(query, "loop") && !query_long(query, "loop", 0, 1, &loop)){
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "loop must be 0 or 1");
+    }
+    //the upload buffer is only refilled once the control task has taken the previous route
+    if (atomic_load(&route_upload_busy)){
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    error = parse_points(upload_body, route_upload, ROUTE_MAX_WAYPOINTS, &count);
+    if (error){
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+    }
+    const command_t cmd = { .type = COMMAND_SET_ROUTE, .route = { .count = count, .loop = loop } };
+    atomic_store(&route_upload_busy, true);
+    if (!command_queue_push(&command_queue, &cmd)){
+        atomic_store(&route_upload_busy, false);
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    //written here rather than in the control task, a flash write can take tens of milliseconds
+    if (route_save(route_upload, count, loop) != ESP_OK){
+        ESP_LOGW(TAG, "route not saved");
+    }
+    httpd_resp_set_status(req, HTTPD_204);
+    return httpd_resp_send(req, NULL, 0);
 }
-esp_err_t S2_handler(httpd_req_t *req)
+//Hand the polygons in fence_upload to the control task, which rebuilds its edge tables between cycles.
+//The caller fills fence_upload, which it may only do while fence_upload_busy is clear
+static bool send_geofence(void)
 {
-    lat_target = lat_target - 0.00002;
-    return send_page(req);
+    const command_t cmd = { .type = COMMAND_SET_GEOFENCE };
+    atomic_store(&fence_upload_busy, true);
+    if (!command_queue_push(&command_queue, &cmd)){
+        atomic_store(&fence_upload_busy, false);
+        return false;
+    }
+    return true;
 }
-esp_err_t S10_handler(httpd_req_t *req)
+//POST /api/geofence?kind=in|out adds a polygon, body is one "<lat>,<lon>" vertex per line in 1e-7 degrees.
+//POST /api/geofence?clear=1 removes every polygon. The polygons are stored for the next boot
+esp_err_t geofence_handler(httpd_req_t *req)
 {
-    lat_target = lat_target - 0.0001;
-    return send_page(req);
+    static geo_point_t vertices[GEOFENCE_MAX_VERTICES];
+    char query[24];
+    char kind[8];
+    long clear = 0;
+    uint32_t count;
+    const char *error;
+    esp_err_t err;
+
+    if (!recv_body(req, upload_body, sizeof(upload_body))){
+        return ESP_FAIL;
+    }
+    if (!get_query(req, query, sizeof(query))){
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "kind=in, kind=out or clear=1 required");
+    }
+    if (atomic_load(&fence_upload_busy)){
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    //the change is made on the upload copy, fence_def only takes it once the control task has it too
+    fence_upload = fence_def;
+    if (query_long(query, "clear", 1, 1, &clear)){
+        geofence_def_clear(&fence_upload);
+    } else if (httpd_query_key_value(query, "kind", kind, sizeof(kind)) == ESP_OK &&
+               (strcmp(kind, "in") == 0 || strcmp(kind, "out") == 0)){
+        error = parse_points(upload_body, vertices, GEOFENCE_MAX_VERTICES, &count);
+        if (error){
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, error);
+        }
+        err = geofence_def_add(&fence_upload, strcmp(kind, "in") == 0 ? GEOFENCE_KEEP_IN : GEOFENCE_KEEP_OUT,
+                               vertices, count);
+        if (err == ESP_ERR_INVALID_ARG){
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "a polygon needs at least 3 vertices");
+        }
+        if (err != ESP_OK){
+            return httpd_resp_send_err(req, HTTPD_413_CONTENT_TOO_LARGE, "too many polygons or vertices");
+        }
+    } else {
+        return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "kind=in, kind=out or clear=1 required");
+    }
+    if (!send_geofence()){
+        httpd_resp_set_status(req, "503 Service Unavailable");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    //the control task only reads fence_upload, so copying from it here is safe
+    fence_def = fence_upload;
+    if (geofence_def_save(&fence_def) != ESP_OK){
+        ESP_LOGW(TAG, "geofence not saved");
+    }
+    httpd_resp_set_status(req, HTTPD_204);
+    return httpd_resp_send(req, NULL, 0);
 }
-httpd_uri_t uri_index = { // "ip/"
-    .uri = "/",
-    .method = HTTP_GET,
-    .handler = index_handler,
-    .user_ctx = NULL};
-httpd_uri_t uri_minusgain = { // "ip/mg"
-    .uri = "/mg",
-    .method = HTTP_GET,
-    .handler = minusgain_handler,
-    .user_ctx = NULL};
-httpd_uri_t uri_plusgain = { // "ip/pg"
-    .uri = "/pg",
-    .method = HTTP_GET,
-    .handler = plusgain_handler,
-    .user_ctx = NULL};
-httpd_uri_t uri_N10 = { 
-    .uri = "/N10",
-    .method = HTTP_GET,
-    .handler = N10_handler,
-    .user_ctx = NULL};
-httpd_uri_t uri_N2 = { 
-    .uri = "/N2",
-    .method = HTTP_GET,
-    .handler = N2_handler,
-    .user_ctx = NULL};
-httpd_uri_t uri_W10 = {
-    .uri = "/W10",
-    .method = HTTP_GET,
-    .handler = W10_handler,
-    .user_ctx = NULL};
-httpd_uri_t uri_W2 = {
-    .uri = "/W2",
-    .method = HTTP_GET,
-    .handler = W2_handler,
-    .user_ctx = NULL};
-httpd_uri_t uri_E2 = {
-    .uri = "/E2",
-    .method = HTTP_GET,
-    .handler = E2_handler,
-    .user_ctx = NULL};
-httpd_uri_t uri_E10 = {
-    .uri = "/E10",
-    .method = HTTP_GET,
-    .handler = E10_handler,
-    .user_ctx = NULL};
-httpd_uri_t uri_S2 = {
-    .uri = "/S2",
+//Append a string literal to a buffer at numchars, advancing numchars
+#define APPEND_LITERAL(buf, numchars, literal) \
+    do { memcpy((buf) + (numchars), literal, sizeof(literal) - 1); (numchars) += sizeof(literal) - 1; } while (0)
+
+//Track download state, the response is sent in chunks as the log is decoded block by block
+typedef struct {
+    httpd_req_t *req;
+    bool gpx;
+    size_t len;
+    char buf[1024];
+} track_download_t;
+
+//Format one track point as a CSV line or a GPX trkpt, sending a chunk whenever the buffer is nearly full
+static esp_err_t track_point_out(const track_point_t *point, void *ctx)
+{
+    track_download_t *dl = ctx;
+    char *buf = dl->buf;
+    size_t numchars = dl->len;
+    if (dl->gpx){
+        APPEND_LITERAL(buf, numchars, "<trkpt lat=\"");
+        numchars += numfmt_scaled(buf + numchars, point->lat_e7, 7);
+        APPEND_LITERAL(buf, numchars, "\" lon=\"");
+        numchars += numfmt_scaled(buf + numchars, point->lon_e7, 7);
+        APPEND_LITERAL(buf, numchars, "\"><time>");
+        numchars += numfmt_utc(buf + numchars, point->t_ms);
+        APPEND_LITERAL(buf, numchars, "</time></trkpt>\n");
+    } else {
+        numchars += numfmt_utc(buf + numchars, point->t_ms);
+        buf[numchars++] = ',';
+        numchars += numfmt_scaled(buf + numchars, point->lat_e7, 7);
+        buf[numchars++] = ',';
+        numchars += numfmt_scaled(buf + numchars, point->lon_e7, 7);
+        buf[numchars++] = ',';
+        numchars += numfmt_scaled(buf + numchars, point->heading, 1);
+        buf[numchars++] = ',';
+        numchars += numfmt_int(buf + numchars, point->port);
+        buf[numchars++] = ',';
+        numchars += numfmt_int(buf + numchars, point->stbd);
+        buf[numchars++] = '\n';
+    }
+    dl->len = numchars;
+    //a point takes well under 160 characters in either format
+    if (dl->len > sizeof(dl->buf) - 160){
+        dl->len = 0;
+        return httpd_resp_send_chunk(dl->req, buf, numchars);
+    }
+    return ESP_OK;
+}
+
+//GET /track[?from=<unix s>][&to=<unix s>][&format=csv|gpx], streams the logged track as CSV (the default) or GPX
+esp_err_t track_handler(httpd_req_t *req)
+{
+    static track_download_t dl; //one request at a time, keeps the buffer off the httpd stack
+    char query[64];
+    char format[8] = "csv";
+    long from_s = 0, to_s = LONG_MAX;
+    esp_err_t err;
+
+    if (get_query(req, query, sizeof(query))){
+        if ((query_has(query, "from") && !query_long(query, "from", 0, LONG_MAX, &from_s)) ||
+            (query_has(query, "to") && !query_long(query, "to", 0, LONG_MAX, &to_s))){
+            return httpd_resp_send_err(req, HTTPD_400_BAD_REQUEST, "from and to must be UTC seconds since 1970");
+        }
+        httpd_query_key_value(query, "format", format, sizeof(format));
+    }
+    dl.req = req;
+    dl.gpx = strcmp(format, "gpx") == 0;
+    dl.len = 0;
+    if (dl.gpx){
+        httpd_resp_set_type(req, "application/gpx+xml");
+        httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"track.gpx\"");
+        APPEND_LITERAL(dl.buf, dl.len, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                       "<gpx version=\"1.1\" creator=\"spotlock\" xmlns=\"http://www.topografix.com/GPX/1/1\">"
+                       "<trk><name>spotlock</name><trkseg>\n");
+    } else {
+        httpd_resp_set_type(req, "text/csv");
+        httpd_resp_set_hdr(req, "Content-Disposition", "attachment; filename=\"track.csv\"");
+        APPEND_LITERAL(dl.buf, dl.len, "time,lat,lon,heading,port,stbd\n");
+    }
+    err = track_log_read((int64_t)from_s * 1000, (int64_t)to_s * 1000 + 999, track_point_out, &dl);
+    if (err != ESP_OK){
+        //headers are gone already, all that can be done is to cut the response short
+        return ESP_FAIL;
+    }
+    if (dl.gpx){
+        APPEND_LITERAL(dl.buf, dl.len, "</trkseg></trk></gpx>\n");
+    }
+    if (httpd_resp_send_chunk(req, dl.buf, dl.len) != ESP_OK){
+        return ESP_FAIL;
+    }
+    return httpd_resp_send_chunk(req, NULL, 0);
+}
+esp_err_t metrics_handler(httpd_req_t *req)
+{
+    static char metrics[4096]; //httpd serves one request at a time so a static buffer keeps this off the stack
+    control_stats_t snapshot;
+    drift_estimate_t drift;
+    dead_reckoning_quality_t dr;
+    uint32_t kf_us_last, kf_us_max;
+    uint32_t fence_us_last, fence_us_max, fence_overruns, fence_breaches;
+    track_log_stats_t track;
+    uint32_t nmea_enabled, nmea_required, nmea_rejected;
+    nmea_output_stats_t nmea_out;
+    nmea_server_stats_t nmea_srv;
+    float fence_clearance;
+    int numchars;
+    portENTER_CRITICAL(&control_stats_lock);
+    snapshot = control_stats;
+    drift = drift_estimate;
+    dr = dr_quality;
+    kf_us_last = nav_filter_us_last;
+    kf_us_max = nav_filter_us_max;
+    fence_us_last = geofence_us_last;
+    fence_us_max = geofence_us_max;
+    fence_overruns = geofence_overruns;
+    fence_breaches = geofence_breaches;
+    fence_clearance = geofence_clearance;
+    portEXIT_CRITICAL(&control_stats_lock);
+    nmea_parser_get_statements(nmea_hdl, &nmea_enabled, &nmea_required, &nmea_rejected);
+    numchars = control_stats_format(&snapshot, metrics, sizeof(metrics));
+    if (numchars > 0 && numchars < (int)sizeof(metrics)) {
+        snprintf(metrics + numchars, sizeof(metrics) - numchars,
+                 "drift_valid %d\ndrift_set_deg %.0f\ndrift_mps %.2f\n"
+                 "drift_overshoots %u\ndrift_excursions %u\ndrift_outside %d\n"
+                 "dr_fixes %u\ndr_last_err_m %.2f\ndr_max_err_m %.2f\ndr_rms_err_m %.2f\ndr_rms_stale_m %.2f\n"
+                 "nav_filter_us_last %u\nnav_filter_us_max %u\n"
+                 "geofence_us_last %u\ngeofence_us_max %u\ngeofence_overruns %u\ngeofence_breaches %u\n"
+                 "geofence_clearance_m %.1f\n",
+                 drift.drift_valid, drift.set_deg, drift.drift_mps,
+                 drift.overshoots, drift.excursions, drift.outside,
+                 dr.fixes, dr.last_err_m, dr.max_err_m,
+                 dr.fixes ? sqrtf(dr.sum_sq_err / dr.fixes) : 0, dr.fixes ? sqrtf(dr.sum_sq_stale / dr.fixes) : 0,
+                 kf_us_last, kf_us_max,
+                 fence_us_last, fence_us_max, fence_overruns, fence_breaches, fence_clearance);
+    }
+    numchars = strlen(metrics);
+    snprintf(metrics + numchars, sizeof(metrics) - numchars,
+             "page_requests %u\npage_us_last %u\npage_us_max %u\nhttpd_stack_free_min %u\n"
+             "heap_free %u\nheap_free_min %u\n"
+             "page_cache_hits %u\npage_cache_misses %u\npage_cache_not_modified %u\npage_cache_bytes_saved %u\n"
+             "commands_dropped %u\nsettings_writes %u\n"
+             "nmea_enabled 0x%02x\nnmea_required 0x%02x\nnmea_rejected %u\n",
+             page_requests, page_us_last, page_us_max, page_stack_free_min,
+             esp_get_free_heap_size(), esp_get_minimum_free_heap_size(),
+             index_cache.hits, index_cache.misses, index_cache.not_modified, index_cache.bytes_saved,
+             command_queue.dropped, settings_get_write_count(),
+             nmea_enabled, nmea_required, nmea_rejected);
+    numchars = strlen(metrics);
+    boot_timing_format(metrics + numchars, sizeof(metrics) - numchars);
+    track_log_get_stats(&track);
+    nmea_output_get_stats(&nmea_out);
+    nmea_server_get_stats(&nmea_srv);
+    numchars = strlen(metrics);
+    snprintf(metrics + numchars, sizeof(metrics) - numchars,
+             "track_capacity_blocks %u\ntrack_blocks_written %u\ntrack_points_logged %u\ntrack_points_dropped %u\n"
+             "track_bytes_per_point %u.%02u\n",
+             track.capacity_blocks, track.blocks_written, track.points_logged, track.points_dropped,
+             track.bytes_per_point / 100, track.bytes_per_point % 100);
+    numchars = strlen(metrics);
+    snprintf(metrics + numchars, sizeof(metrics) - numchars,
+             "nmea_out_sentences %u\nnmea_out_dropped %u\nnmea_out_bytes %u\nnmea_out_bytes_sent %u\n"
+             "nmea_out_cycles_last %u\nnmea_out_cycles_max %u\nnmea_out_cycles_avg %u\n",
+             nmea_out.sentences, nmea_out.dropped, nmea_out.bytes, nmea_out.bytes_sent,
+             nmea_out.cycles_last, nmea_out.cycles_max, nmea_out.cycles_avg);
+    numchars = strlen(metrics);
+    snprintf(metrics + numchars, sizeof(metrics) - numchars,
+             "nmea_srv_published %u\nnmea_srv_published_bytes %u\nnmea_srv_dropped %u\n"
+             "nmea_srv_accepted %u\nnmea_srv_rejected %u\nnmea_srv_sent_bytes %u\nnmea_srv_sent_bytes_per_s %u\n"
+             "nmea_srv_udp_lag_bytes %u\n",
+             nmea_srv.published, nmea_srv.published_bytes, nmea_srv.dropped,
+             nmea_srv.accepted, nmea_srv.rejected, nmea_srv.sent, nmea_srv.sent_per_s, nmea_srv.udp_lag);
+    for (int i = 0; i < CONFIG_NMEA_SERVER_MAX_CLIENTS; i++){
+        if (nmea_srv.clients[i].connected){
+            numchars = strlen(metrics);
+            snprintf(metrics + numchars, sizeof(metrics) - numchars,
+                     "nmea_srv_client%d_sent_bytes %u\nnmea_srv_client%d_lag_bytes %u\n"
+                     "nmea_srv_client%d_skips %u\nnmea_srv_client%d_skipped_bytes %u\n",
+                     i, nmea_srv.clients[i].sent, i, nmea_srv.clients[i].lag,
+                     i, nmea_srv.clients[i].skips, i, nmea_srv.clients[i].skipped);
+        }
+    }
+    httpd_resp_set_type(req, "text/plain");
+    return httpd_resp_send(req, metrics, HTTPD_RESP_USE_STRLEN);
+}
+//Every page and API call goes through one dispatcher, new calls only need a line in this table
+typedef struct {
+    httpd_method_t method;
+    const char *path;
+    esp_err_t (*handler)(httpd_req_t *req);
+} web_route_t;
+static const web_route_t web_routes[] = {
+    { HTTP_GET,  "/",              index_handler },     // "ip/" web page
+    { HTTP_GET,  "/metrics",       metrics_handler },   // "ip/metrics" control loop timing
+    { HTTP_POST, "/api/target",    target_handler },
+    { HTTP_POST, "/api/nudge",     nudge_handler },
+    { HTTP_POST, "/api/gain",      gain_handler },
+    { HTTP_POST, "/api/waypoints", waypoints_handler },
+    { HTTP_POST, "/api/geofence",  geofence_handler },
+    { HTTP_POST, "/api/nmea",      nmea_handler },
+    { HTTP_GET,  "/track",         track_handler },     // "ip/track" logged track as CSV or GPX
+};
+esp_err_t dispatch_handler(httpd_req_t *req)
+{
+    size_t len = strcspn(req->uri, "?");
+    bool path_found = false;
+    for (size_t i = 0; i < sizeof(web_routes) / sizeof(web_routes[0]); i++){
+        if (strlen(web_routes[i].path) == len && memcmp(web_routes[i].path, req->uri, len) == 0){
+            if ((int)web_routes[i].method == req->method){
+                return web_routes[i].handler(req);
+            }
+            path_found = true;
+        }
+    }
+    if (path_found){
+        return httpd_resp_send_err(req, HTTPD_405_METHOD_NOT_ALLOWED, NULL);
+    }
+    return httpd_resp_send_err(req, HTTPD_404_NOT_FOUND, NULL);
+}
+httpd_uri_t uri_get = { // every GET not handled by telemetry
+    .uri = "/*",
     .method = HTTP_GET,
-    .handler = S2_handler,
+    .handler = dispatch_handler,
     .user_ctx = NULL};
-httpd_uri_t uri_S10 = {
-    .uri = "/S10",
-    .method = HTTP_GET,
-    .handler = S10_handler,
+httpd_uri_t uri_post = { // every POST
+    .uri = "/*",
+    .method = HTTP_POST,
+    .handler = dispatch_handler,
     .user_ctx = NULL};
 httpd_handle_t setup_server(void)
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
-    config.max_uri_handlers = 12;
+    config.max_uri_handlers = 4;
+    config.uri_match_fn = httpd_uri_match_wildcard;
     httpd_handle_t server = NULL;
 
+    page_cache_init_static(&index_cache, html_index, sizeof(html_index) - 1);
+
     if (httpd_start(&server, &config) == ESP_OK)
     {
-        httpd_register_uri_handler(server, &uri_index);
-        httpd_register_uri_handler(server, &uri_minusgain);
-        httpd_register_uri_handler(server, &uri_plusgain);
-        httpd_register_uri_handler(server, &uri_N10);
-        httpd_register_uri_handler(server, &uri_N2);
-        httpd_register_uri_handler(server, &uri_W10);
-        httpd_register_uri_handler(server, &uri_W2);
-        httpd_register_uri_handler(server, &uri_E2);
-        httpd_register_uri_handler(server, &uri_E10);
-        httpd_register_uri_handler(server, &uri_S2);
-        httpd_register_uri_handler(server, &uri_S10);
+        //JSON state and WebSocket push, registered first so the wildcard dispatchers don't shadow them
+        telemetry_init(server);
+        httpd_register_uri_handler(server, &uri_get);
+        httpd_register_uri_handler(server, &uri_post);
     }
 
     return server;
@@ -317,7 +850,14 @@ httpd_handle_t setup_server(void)
 static void gps_event_handler(void *event_handler_arg, esp_event_base_t event_base, int32_t event_id, void *event_data)
 {
     gps_t* gps = NULL;
+    static fix_snapshot_t fix = { .gst_age = UINT8_MAX }; //the handler's own copy of the last fix
 
+    if (!boot_timing_reached(BOOT_FIRST_SENTENCE)){
+        int64_t first_us = nmea_parser_get_first_statement_time((nmea_parser_handle_t)event_handler_arg);
+        if (first_us){
+            boot_timing_end_at(BOOT_FIRST_SENTENCE, first_us);
+        }
+    }
     switch (event_id) {
     case GPS_UPDATE:
         gps = (gps_t *)event_data;
@@ -335,8 +875,32 @@ static void gps_event_handler(void *event_handler_arg, esp_event_base_t event_ba
                  gps->tim.hour + TIME_ZONE, gps->tim.minute, gps->tim.second,
                  gps->latitude, gps->longitude, gps->altitude, gps->speed);*/
         //printf("GPS data received\n");
-        longitudex = gps->longitude;  //for export to main program
-        latitudex = gps->latitude;    //for export to main program
+        //for export to main program, built in the handler's copy and then published in one go
+        fix.position.lat_e7 = gps->latitude_e7;
+        fix.position.lon_e7 = gps->longitude_e7;
+        fix.speed = gps->speed;
+        fix.cog = gps->cog;
+        fix.dop_h = gps->dop_h;
+        if (gps->statements & (1 << STATEMENT_GST)){
+            fix.err_lat = gps->error.lat;
+            fix.err_lon = gps->error.lon;
+            fix.gst_age = 0;
+        } else if (fix.gst_age < UINT8_MAX){
+            fix.gst_age++;
+        }
+        fix.time_us = esp_timer_get_time();
+        fix.utc_ms = gps_utc_ms(gps);
+        fix.tim = gps->tim;
+        fix.date = gps->date;
+        fix.valid = gps->valid;
+        fix.variation = gps->variation;
+        fix.seq++;
+        portENTER_CRITICAL(&last_fix_lock);
+        last_fix = fix;
+        portEXIT_CRITICAL(&last_fix_lock);
+        if (gps->latitude != 0){
+            boot_timing_end_at(BOOT_FIRST_FIX, fix.time_us);
+        }
         break;
     case GPS_UNKNOWN:
         /* print unknown statements */
@@ -347,6 +911,28 @@ static void gps_event_handler(void *event_handler_arg, esp_event_base_t event_ba
     }
 }
 
+//$--TXT text from the receiver: total, number, severity (00 error, 01 warning, 02 notice, 07 user), text
+static const nmea_field_type_t txt_schema[] = { NMEA_FIELD_INT, NMEA_FIELD_INT, NMEA_FIELD_INT, NMEA_FIELD_STRING };
+
+//Runs on the parser task, decoded there instead of re-parsing a GPS_UNKNOWN copy
+static void gps_txt_handler(const char *address, const nmea_field_t *fields, size_t num_fields, void *ctx)
+{
+    const char *text = fields[3].present ? fields[3].value.s : "";
+    if (fields[2].present && fields[2].value.i <= 1){
+        ESP_LOGW(TAG, "%s: %s", address, text);
+    } else {
+        ESP_LOGD(TAG, "%s: %s", address, text);
+    }
+}
+
+#if CONFIG_NMEA_SERVER
+//Runs on the parser task, a copy into the server's ring
+static void gps_forward_handler(const char *sentence, size_t len, void *ctx)
+{
+    nmea_server_publish(sentence, len);
+}
+#endif
+
 //I2C Sensor Functions
 void I2Cstart(){
     uint8_t mrincyclestt;
@@ -826,106 +1412,562 @@ void init_pwm(){
     mcpwm_init(MCPWM_UNIT_0, MCPWM_TIMER_0, &pwm_config);
 }
 
-void app_main(void)
-{   
-    //Wifi Access Point Start
-    wifi_init_softap();
-    //Webserver Start
-    setup_server();
+//Store the target, writes are coalesced so nudging away at the buttons costs one flash write
+static void save_target(void)
+{
+    settings_set_target(&target);
+}
+
+//Apply one setpoint command from the webserver, called by the control task between cycles
+static void apply_command(const command_t *cmd, uint8_t gps_active)
+{
+    switch (cmd->type){
+    case COMMAND_SET_TARGET:
+        //a manual target ends any route
+        route_load(&route, route_upload, 0, false);
+        target = cmd->target;
+        break;
+    case COMMAND_SET_ROUTE:
+        //take the uploaded route and head for its first waypoint, legs are precomputed here once
+        route_load(&route, route_upload, cmd->route.count, cmd->route.loop);
+        atomic_store(&route_upload_busy, false);
+        if (route.count > 0){
+            target = route.waypoints[0];
+        }
+        break;
+    case COMMAND_SET_GEOFENCE:
+        //project the polygons and build the edge tables once, checks then only read them
+        geofence_build(&fence, &fence_upload);
+        atomic_store(&fence_upload_busy, false);
+        break;
+    case COMMAND_NUDGE:
+        //nudges end any route, as the stored route is erased with them, and move the target once there is one
+        route_load(&route, route_upload, 0, false);
+        if (gps_active){
+            //metres become a whole number of 1e-7 degrees added to the target, nothing is lost to float rounding
+            geo_point_at(&target, cmd->nudge.north, cmd->nudge.east, &target);
+        }
+        break;
+    case COMMAND_SET_GAIN:
+        motorgain = cmd->gain;
+        break;
+    case COMMAND_STEP_GAIN:
+        motorgain += cmd->gain;
+        break;
+    }
+    if (motorgain < 0){
+        motorgain = 0;
+    }
+    if (motorgain > 100){
+        motorgain = 100;
+    }
+    //manual setpoints survive a reboot, routes are stored by route_save
+    switch (cmd->type){
+    case COMMAND_SET_TARGET:
+        save_target();
+        break;
+    case COMMAND_NUDGE:
+        if (gps_active){
+            save_target();
+        }
+        break;
+    case COMMAND_SET_GAIN:
+    case COMMAND_STEP_GAIN:
+        settings_set_gain(motorgain);
+        break;
+    default:
+        break;
+    }
+}
+
+//Control loop timer, releases the control task once per period
+static void control_timer_cb(void *arg)
+{
+    xTaskNotifyGive(control_task_hdl);
+}
+
+//Fixed period station keeping loop, pinned to its own core and released by control_timer_cb
+static void control_task(void *arg)
+{
+    const uint32_t period_us = 1000000 / CONFIG_CONTROL_LOOP_RATE_HZ;
     //initialize GPS related variables and operations
     uint8_t gps_active = 0;
     float lat_offset, long_offset;
-    /* NMEA parser configuration */
-    nmea_parser_config_t config = NMEA_PARSER_CONFIG_DEFAULT();
-    /* init NMEA parser library */
-    nmea_parser_handle_t nmea_hdl = nmea_parser_init(&config);
-    /* register event handler for NMEA parser library */
-    nmea_parser_add_handler(nmea_hdl, gps_event_handler, NULL);
     //Initialize heading variables that must be retained between function calls
     int32_t xmagmax = 20;
     int32_t ymagmax =20;
     int32_t xmagmin = 20;
     int32_t ymagmin =20;
+    settings_t saved_settings;
     float_t heading = 0;
     float_t coursecorrection;
-    //Initialise Magnetometer, address 1CH, 0x28, 001 1100
     uint8_t slave_addr = 28;
-    if (I2C_Setup_Mag(slave_addr) == 1){
-        printf("Magnetometer setup Good \n");
+    //Station keeping controller, the target is remembered to detect nudges from the webserver
+    const station_controller_config_t ctl_config = STATION_CONTROLLER_CONFIG_DEFAULT();
+    station_controller_t ctl;
+    station_controller_input_t ctl_in = { .dt = period_us / 1000000.0f };
+    station_controller_output_t ctl_out = { 0 };
+    geo_point_t ctl_target = { 0 };
+    //Drift history, positions are kept in metres from the first fix
+    static drift_history_t drift;
+    drift_sample_t drift_sample;
+    track_point_t track_point;
+    drift_estimate_t drift_est = { 0 };
+    geo_point_t ref = { 0 };
+    float target_north, target_east;
+    fix_snapshot_t fix = { 0 };
+    uint32_t last_fix_seq = 0;
+    bool new_fix = false;
+    //Dead reckoning between fixes, the loop gets a fresh position estimate every cycle
+    const dead_reckoning_config_t dr_config = DEAD_RECKONING_CONFIG_DEFAULT();
+    dead_reckoning_t dr;
+    float fix_north, fix_east, est_north, est_east;
+    geo_point_t est = { 0 };
+    //Kalman filter of GNSS position/velocity and compass heading, feeds the dead reckoning and the controller
+    const nav_filter_config_t kf_config = NAV_FILTER_CONFIG_DEFAULT();
+    nav_filter_t kf;
+    float_t nav_heading = 0;
+    int64_t kf_us;
+    uint32_t releases;
+    int64_t release_us, start_us, end_us;
+    //Telemetry is pushed to web clients every few cycles, and only when there is a new fix, setpoint or alarm
+    const uint32_t telemetry_cycles = CONFIG_CONTROL_LOOP_RATE_HZ / CONFIG_TELEMETRY_PUSH_RATE_HZ > 0 ?
+                                      CONFIG_CONTROL_LOOP_RATE_HZ / CONFIG_TELEMETRY_PUSH_RATE_HZ : 1;
+    uint32_t telemetry_count = 0;
+    uint32_t telemetry_fix_seq = 0;
+    telemetry_state_t telemetry = { 0 };
+    command_t cmd;
+    //Route following, the steer point moves along the leg every cycle
+    const route_config_t route_config = ROUTE_CONFIG_DEFAULT();
+    route_status_t route_st = { 0 };
+    //Geofence, forward thrust towards a boundary fades out over GEOFENCE_MARGIN_M
+    geofence_result_t fence_res = { .polygon = -1 };
+    float port_out, stbd_out;
+    bool fence_alarm = false;
+    int64_t fence_us = 0;
+    //NMEA output, steering to the target or waypoint, compass heading and the fix, queued every few cycles
+    const uint32_t nmea_out_cycles = CONFIG_CONTROL_LOOP_RATE_HZ / CONFIG_NMEA_OUTPUT_RATE_HZ > 0 ?
+                                     CONFIG_CONTROL_LOOP_RATE_HZ / CONFIG_NMEA_OUTPUT_RATE_HZ : 1;
+    uint32_t nmea_out_count = 0;
+    nmea_steer_t steer = { 0 };
+    char origin_id[NUMFMT_MAX_LEN + 1], dest_id[NUMFMT_MAX_LEN + 1];
+    static gps_t nmea_out_fix;  //kept off the stack, only used by this task
+    float dest_north, dest_east;
+
+    control_task_hdl = xTaskGetCurrentTaskHandle();
+    //carry on with the compass calibration from before the reboot
+    settings_get(&saved_settings);
+    if (saved_settings.mag_valid){
+        xmagmax = saved_settings.mag_x_max;
+        xmagmin = saved_settings.mag_x_min;
+        ymagmax = saved_settings.mag_y_max;
+        ymagmin = saved_settings.mag_y_min;
+    } else {
+        saved_settings.mag_x_max = xmagmax;
+        saved_settings.mag_x_min = xmagmin;
+        saved_settings.mag_y_max = ymagmax;
+        saved_settings.mag_y_min = ymagmin;
     }
+    control_stats_init(&control_stats, period_us);
+    station_controller_init(&ctl, &ctl_config);
+    route_init(&route, &route_config);
+    drift_history_init(&drift, EXCURSION_RADIUS_M);
+    dead_reckoning_init(&dr, &dr_config);
+    nav_filter_init(&kf, &kf_config);
+    esp_timer_handle_t control_timer;
+    const esp_timer_create_args_t timer_args = {
+        .callback = control_timer_cb,
+        .name = "control"
+    };
+    ESP_ERROR_CHECK(esp_timer_create(&timer_args, &control_timer));
+    release_us = esp_timer_get_time();
+    ESP_ERROR_CHECK(esp_timer_start_periodic(control_timer, period_us));
 
     while(1) {  // PROGRAM LOOP FOR REPEAT READS OF SENSORs
+        //Wait for release, more than one pending release means the previous cycle overran
+        releases = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        start_us = esp_timer_get_time();
+        release_us += (int64_t)releases * period_us;
+        //Setpoints only change here, between cycles
+        while (command_queue_pop(&command_queue, &cmd)){
+            apply_command(&cmd, gps_active);
+        }
+        kf_us = esp_timer_get_time();
+        nav_filter_predict(&kf, releases * ctl_in.dt);
+        kf_us = esp_timer_get_time() - kf_us;
+        //Take the last fix once a cycle, all of it from the same update
+        portENTER_CRITICAL(&last_fix_lock);
+        fix = last_fix;
+        portEXIT_CRITICAL(&last_fix_lock);
+
         //Check if gps is active, store first reported position (for development only,  start stop of machine later)
         if (gps_active == 0){//test for activation
-            if (latitudex !=0){
-                //gps has become active for the first time, store target coords at current position
-                lat_target = latitudex;
-                long_target = longitudex;
+            if (fix.position.lat_e7 != 0){
+                //gps has become active for the first time, store target coords at current position unless one was set
+                if (target.lat_e7 == 0 && target.lon_e7 == 0){
+                    target = fix.position;
+                    save_target();
+                }
+                ref = fix.position;
                 gps_active = 1;
             }
         }    
         if (gps_active == 1){ //calculate current bearing and distance to target
-            lat_offset = lat_target - latitudex;  //makes go N to target a positive when south of the equator
-            long_offset = long_target - longitudex; //makes go E to target a positive when east of Grenwich          
-            // sort out bearing in each quadrant
-            if (lat_offset != 0){
-                bearing = (1000*long_offset)/lat_offset;
-                bearing = bearing / 1000;
-            }
-            if (long_offset  >= 0) {
-                if (lat_offset > 0){
-                    bearing = atan(bearing);
-                }
-                if (lat_offset < 0){
-                    bearing = 3.14159 + atan(bearing);
-                }
-                if (lat_offset == 0){
-                    bearing = 3.14159/2;
+            new_fix = (fix.seq != last_fix_seq);
+            last_fix_seq = fix.seq;
+            geo_offset_e7(&ref, &fix.position, &fix_north, &fix_east);
+            if (new_fix){
+                //filter the fix, then propagate from the filtered position and velocity. Dead reckoning scores its
+                //prediction against the fix as measured
+                int64_t t0 = esp_timer_get_time();
+                if (fix.gst_age <= GST_MAX_AGE && fix.err_lat > 0 && fix.err_lon > 0){
+                    nav_filter_update_position_sigma(&kf, fix_north, fix_east, fix.err_lat, fix.err_lon);
+                } else {
+                    nav_filter_update_position(&kf, fix_north, fix_east, fix.dop_h);
                 }
+                nav_filter_update_velocity(&kf, fix.speed, fix.cog);
+                kf_us += esp_timer_get_time() - t0;
+                dead_reckoning_fix(&dr, fix.time_us, kf.x[NAV_N], kf.x[NAV_E], fix_north, fix_east,
+                                   sqrtf(kf.x[NAV_VN]*kf.x[NAV_VN] + kf.x[NAV_VE]*kf.x[NAV_VE]),
+                                   geo_bearing_deg(kf.x[NAV_VN], kf.x[NAV_VE]), (port_duty + stbd_duty) / 2);
             }
-            if (long_offset < 0) {
-                if (lat_offset > 0){
-                    bearing = 2*3.14159 + atan(bearing);
-                }
-                if (lat_offset < 0){
-                    bearing = 3.14159 + atan(bearing);
-                }
-                if (lat_offset == 0){
-                    bearing = 1.5*3.14159;
-                }
+            //propagate the last fix to now, fall back to the raw fix once it is too old to extrapolate
+            if (!dead_reckoning_predict(&dr, start_us, nav_heading, (port_duty + stbd_duty) / 2, &est_north, &est_east)){
+                est_north = fix_north;
+                est_east = fix_east;
             }
-            //change from radians to degrees
-            bearing = bearing * 180;
-            bearing = bearing / 3.14159;    
-            //distance
-            distance = lat_offset*lat_offset + long_offset*long_offset;
-            distance = sqrt(distance);
-            distance = distance * 111204;  //changes pythag angles to metres         
+            //when following a route the target is the point to steer for on the active leg
+            geo_point_at(&ref, est_north, est_east, &est);
+            if (route.count > 0){
+                route_update(&route, &est, &route_st);
+                target = route_st.target;
+            }
+            geo_offset_e7(&ref, &target, &target_north, &target_east);
+            lat_offset = target_north - est_north;  //metres to go north
+            long_offset = target_east - est_east;   //metres to go east
+            bearing = geo_bearing_deg(lat_offset, long_offset);
+            distance = sqrtf(lat_offset*lat_offset + long_offset*long_offset);
         }
         Get_Heading(slave_addr, &heading, &xmagmax, &xmagmin, &ymagmax, &ymagmin);
+        //the limits only ever grow, so once the boat has swung round this settles to no writes at all
+        if (xmagmax != saved_settings.mag_x_max || xmagmin != saved_settings.mag_x_min ||
+            ymagmax != saved_settings.mag_y_max || ymagmin != saved_settings.mag_y_min){
+            saved_settings.mag_x_max = xmagmax;
+            saved_settings.mag_x_min = xmagmin;
+            saved_settings.mag_y_max = ymagmax;
+            saved_settings.mag_y_min = ymagmin;
+            settings_set_mag_calibration(xmagmax, xmagmin, ymagmax, ymagmin);
+        }
+        {
+            int64_t t0 = esp_timer_get_time();
+            nav_filter_update_heading(&kf, heading);
+            nav_heading = kf.x[NAV_PSI];
+            kf_us += esp_timer_get_time() - t0;
+        }
 
         //Create course correction, angle through which unit must turn, +ve is to starbord, -180 < coursecorrection < 180
-        coursecorrection = bearing - heading;
+        coursecorrection = bearing - nav_heading;
         if (coursecorrection >= 180){  //take shortest option to port
-            coursecorrection = (bearing - heading) - 360;
+            coursecorrection = (bearing - nav_heading) - 360;
         }
         else {
             if (coursecorrection < -180 ){  //take shortest option to starbord
-                coursecorrection = 360 + (bearing - heading);
+                coursecorrection = 360 + (bearing - nav_heading);
             }
         }
 
         //Check and record historical drift speed and direction, account for overshot
-            //build drift history
-            //detect overshot
-        //detect excursion
-        
-        //printf("Heading = %f, lat = %.05f°N, long = %.05f°E, Bearing = %f, Dist = %f, CC = %f\n", heading, latitudex, longitudex, bearing, distance, coursecorrection);
-        //Calculate output power response, use PD contorol loop to always drift short of target, prevent overshot and spinning
+        if (gps_active == 1 && new_fix){
+            //build drift history, one sample per fix with the duties that were applied while it was taken
+            drift_sample.t_us = fix.time_us;
+            drift_sample.north = fix_north;
+            drift_sample.east = fix_east;
+            drift_sample.port = port_duty;
+            drift_sample.stbd = stbd_duty;
+            //detect overshot and excursion
+            drift_history_add(&drift, &drift_sample, target_north, target_east);
+            drift_history_estimate(&drift, &drift_est);
+            //log where the boat sat and what the motors were doing, written to flash by the track log task
+            if (fix.utc_ms != 0){
+                track_point.t_ms = fix.utc_ms;
+                track_point.lat_e7 = fix.position.lat_e7;
+                track_point.lon_e7 = fix.position.lon_e7;
+                track_point.heading = (uint16_t)((lroundf(nav_heading * 10) % 3600 + 3600) % 3600);
+                track_point.port = (uint8_t)port_duty;
+                track_point.stbd = (uint8_t)stbd_duty;
+                track_log_add(&track_point);
+            }
+        }
+
+        //printf("Heading = %f, lat = %.05f°N, long = %.05f°E, Bearing = %f, Dist = %f, CC = %f\n", heading, fix.position.lat_e7 / 1e7, fix.position.lon_e7 / 1e7, bearing, distance, coursecorrection);
+        //Calculate output power response, PID on range with deadband and slew limiting, differential turn on course correction
+        if (gps_active == 1){
+            if (route.count > 0 && !route_st.arrived){
+                //the steer point sliding along a leg is not a new target, only a waypoint switch is
+                ctl_target = target;
+            }
+            if (target.lat_e7 != ctl_target.lat_e7 || target.lon_e7 != ctl_target.lon_e7){
+                //target was nudged, keep the derivative from kicking
+                ctl_target = target;
+                station_controller_retarget(&ctl);
+                drift_history_retarget(&drift);
+            }
+            ctl_in.range_m = distance;
+            ctl_in.bearing_error_deg = coursecorrection;
+            ctl_in.heading_deg = nav_heading;
+            ctl_in.gain = motorgain;
+            //feed forward against the drift component pushing the boat away from the target
+            ctl_in.drift_away_mps = 0;
+            if (drift_est.drift_valid){
+                ctl_in.drift_away_mps = -(drift_est.drift_vn * cosf(bearing * GEO_DEG_TO_RAD) +
+                                          drift_est.drift_ve * sinf(bearing * GEO_DEG_TO_RAD));
+            }
+            station_controller_update(&ctl, &ctl_in, &ctl_out);
+        }
+        //Keep inside the operating area and clear of no-go zones, whatever the target
+        port_out = ctl_out.port;
+        stbd_out = ctl_out.stbd;
+        fence_us = 0;
+        if (gps_active == 1 && fence.polygon_count > 0){
+            int64_t t0 = esp_timer_get_time();
+            geofence_check(&fence, &est, GEOFENCE_MARGIN_M, &fence_res);
+            geofence_limit_thrust(&fence_res, nav_heading, GEOFENCE_MARGIN_M, GEOFENCE_ESCAPE_DUTY * motorgain / 100.0f,
+                                  &port_out, &stbd_out);
+            fence_us = esp_timer_get_time() - t0;
+            if (fence_res.breached && !fence_alarm){
+                ESP_LOGW(TAG, "geofence breached, polygon %d", fence_res.polygon);
+                geofence_breaches++;
+            }
+            fence_alarm = fence_res.breached;
+        } else {
+            fence_res.polygon = -1;
+            fence_alarm = false;
+        }
         //Update motor commands
-        mcpwm_set_duty(MCPWM_UNIT_0, MCPWM_TIMER_0, MCPWM_OPR_A, 50);  //set to 50% dummy value
-        mcpwm_set_duty(MCPWM_UNIT_0, MCPWM_TIMER_0, MCPWM_OPR_B, 30);  //set to 30% dummy value
+        port_duty = port_out;
+        stbd_duty = stbd_out;
+        mcpwm_set_duty(MCPWM_UNIT_0, MCPWM_TIMER_0, MCPWM_OPR_A, port_duty);
+        mcpwm_set_duty(MCPWM_UNIT_0, MCPWM_TIMER_0, MCPWM_OPR_B, stbd_duty);
+        if (gps_active == 1){
+            boot_timing_end(BOOT_FIRST_CONTROL_OUTPUT);
+        }
+
+        //Publish the state, serialised and sent to clients later by the webserver. Its version, the ETag of
+        //the cached /api/state, only moves on with a new fix, a setpoint or the alarm, so polling clients get
+        //304 in between
+        if (++telemetry_count >= telemetry_cycles &&
+            (fix.seq != telemetry_fix_seq || target.lat_e7 != telemetry.target.lat_e7 ||
+             target.lon_e7 != telemetry.target.lon_e7 || motorgain != telemetry.gain ||
+             fence_alarm != telemetry.fence_alarm)){
+            telemetry_count = 0;
+            telemetry_fix_seq = fix.seq;
+            telemetry.version++;
+            telemetry.position = fix.position;
+            telemetry.target = target;
+            telemetry.range = distance;
+            telemetry.bearing = bearing;
+            telemetry.heading = nav_heading;
+            telemetry.port = port_duty;
+            telemetry.stbd = stbd_duty;
+            telemetry.gain = motorgain;
+            telemetry.waypoint = route.count > 0 ? (int)route_st.waypoint : -1;
+            telemetry.cross_track = route.count > 0 ? route_st.cross_track_m : 0;
+            telemetry.fence_alarm = fence_alarm;
+            telemetry_publish(&telemetry);
+        }
+
+        //Feed the chartplotter/autopilot and network clients, the sentences are queued so neither ever holds up the loop
+        if (NMEA_OUT_ENABLED && ++nmea_out_count >= nmea_out_cycles){
+            nmea_out_count = 0;
+            steer.valid = gps_active == 1;
+            steer.bearing_deg = bearing;
+            steer.steer_deg = bearing;
+            steer.origin_id = origin_id;
+            steer.dest_id = dest_id;
+            origin_id[0] = '\0';
+            if (route.count > 0){
+                //destination is the waypoint being headed for, not the steer point sliding along the leg
+                steer.dest = route.waypoints[route_st.waypoint];
+                steer.cross_track_m = route_st.cross_track_m;
+                steer.track_deg = route.approaching ? bearing : route.legs[route.leg].bearing_deg;
+                steer.passed = !route.approaching && route_st.to_go_m <= 0;
+                if (!route.approaching){
+                    origin_id[numfmt_int(origin_id, route.leg + 1)] = '\0';
+                }
+                dest_id[numfmt_int(dest_id, route_st.waypoint + 1)] = '\0';
+            } else {
+                //holding station, the target is a waypoint of its own straight ahead
+                steer.dest = target;
+                steer.cross_track_m = 0;
+                steer.track_deg = bearing;
+                steer.passed = false;
+                strcpy(dest_id, "TGT");
+            }
+            steer.range_m = 0;
+            steer.closing_mps = 0;
+            if (gps_active == 1){
+                geo_offset_e7(&ref, &steer.dest, &dest_north, &dest_east);
+                dest_north -= est_north;
+                dest_east -= est_east;
+                steer.range_m = sqrtf(dest_north*dest_north + dest_east*dest_east);
+                if (steer.range_m > 0){
+                    steer.closing_mps = (kf.x[NAV_VN] * dest_north + kf.x[NAV_VE] * dest_east) / steer.range_m;
+                }
+            }
+            steer.arrived = steer.valid && steer.range_m < route_config.arrival_radius_m;
+            nmea_output_steer(nmea_encode_apb, "GP", &steer);
+            nmea_output_steer(nmea_encode_xte, "GP", &steer);
+            nmea_output_steer(nmea_encode_rmb, "GP", &steer);
+            //compass heading, no deviation or variation applied
+            memset(&nmea_out_fix, 0, sizeof(nmea_out_fix));
+            nmea_out_fix.heading_magnetic = nav_heading;
+            nmea_output_gps(STATEMENT_HDG, "HC", &nmea_out_fix);
+            if (gps_active == 1){
+                nmea_out_fix.tim = fix.tim;
+                nmea_out_fix.date = fix.date;
+                nmea_out_fix.valid = fix.valid;
+                nmea_out_fix.latitude_e7 = fix.position.lat_e7;
+                nmea_out_fix.longitude_e7 = fix.position.lon_e7;
+                nmea_out_fix.speed = fix.speed;
+                nmea_out_fix.cog = fix.cog;
+                nmea_out_fix.variation = fix.variation;
+                nmea_output_gps(STATEMENT_RMC, "GP", &nmea_out_fix);
+            }
+        }
 
-        vTaskDelay(100 / portTICK_PERIOD_MS);
+        end_us = esp_timer_get_time();
+        portENTER_CRITICAL(&control_stats_lock);
+        control_stats_record(&control_stats, release_us, start_us, end_us, releases - 1);
+        drift_estimate = drift_est;
+        dr_quality = dr.quality;
+        nav_filter_us_last = (uint32_t)kf_us;
+        if (nav_filter_us_last > nav_filter_us_max){
+            nav_filter_us_max = nav_filter_us_last;
+        }
+        geofence_us_last = (uint32_t)fence_us;
+        if (geofence_us_last > geofence_us_max){
+            geofence_us_max = geofence_us_last;
+        }
+        if (geofence_us_last > GEOFENCE_BUDGET_US){
+            geofence_overruns++;
+        }
+        geofence_clearance = fence_res.polygon >= 0 ? fence_res.clearance_m : GEOFENCE_MARGIN_M;
+        portEXIT_CRITICAL(&control_stats_lock);
     }
-}
\ No newline at end of file
+}
+
+//Network bring-up, runs alongside the rest of boot so the GPS and the control loop don't wait for WiFi
+static void net_init_task(void *arg)
+{
+    //Wifi Access Point Start
+    boot_timing_begin(BOOT_STAGE_WIFI);
+    wifi_init_softap();
+    boot_timing_end(BOOT_STAGE_WIFI);
+    //Webserver Start
+    boot_timing_begin(BOOT_STAGE_HTTPD);
+    setup_server();
+    boot_timing_end(BOOT_STAGE_HTTPD);
+#if CONFIG_NMEA_SERVER
+    //Raw NMEA for navigation apps on the access point
+    {
+        const nmea_server_config_t nmea_srv_config = NMEA_SERVER_CONFIG_DEFAULT();
+        if (nmea_server_init(&nmea_srv_config) != ESP_OK){
+            ESP_LOGW(TAG, "NMEA server not started");
+        }
+    }
+#endif
+    vTaskDelete(NULL);
+}
+
+void app_main(void)
+{   
+    //GNSS first, the receiver is already talking and the UART should be listening as early as possible
+    boot_timing_begin(BOOT_STAGE_GNSS);
+    /* NMEA parser configuration */
+    nmea_parser_config_t config = NMEA_PARSER_CONFIG_DEFAULT();
+    /* init NMEA parser library */
+    nmea_hdl = nmea_parser_init(&config);
+    /* register event handler for NMEA parser library */
+    nmea_parser_add_handler(nmea_hdl, gps_event_handler, nmea_hdl);
+    nmea_parser_register_sentence(nmea_hdl, "--TXT", txt_schema, sizeof(txt_schema) / sizeof(txt_schema[0]),
+                                  gps_txt_handler, NULL);
+#if CONFIG_NMEA_SERVER
+    //everything the receiver sends that gets parsed is passed on to network clients as well, dropped until the server is up
+    nmea_parser_set_raw_handler(nmea_hdl, gps_forward_handler, NULL);
+#endif
+    boot_timing_end(BOOT_STAGE_GNSS);
+    //Initialise Magnetometer, address 1CH, 0x28, 001 1100
+    boot_timing_begin(BOOT_STAGE_MAG);
+    if (I2C_Setup_Mag(28) == 1){
+        printf("Magnetometer setup Good \n");
+    }
+    boot_timing_end(BOOT_STAGE_MAG);
+    boot_timing_begin(BOOT_STAGE_NVS);
+    nvs_init();
+    boot_timing_end(BOOT_STAGE_NVS);
+    //Restore the target, gain and compass calibration before the first fix, so a brownout doesn't lose the anchor point
+    boot_timing_begin(BOOT_STAGE_SETTINGS);
+    {
+        const settings_config_t settings_config = SETTINGS_CONFIG_DEFAULT();
+        settings_t saved;
+        if (settings_init(&settings_config, motorgain) == ESP_OK){
+            settings_get(&saved);
+            motorgain = saved.gain;
+            if (saved.target_valid){
+                target = saved.target;
+            }
+            ESP_LOGI(TAG, "restored settings, gain %d%%, target %s", motorgain, saved.target_valid ? "set" : "not set");
+        }
+    }
+    //Setpoint commands from the webserver, must be ready before the first request
+    command_queue_init(&command_queue);
+    //Resume the geofence and the route stored by the last uploads, the control task takes them on its first cycle.
+    //Queued before the webserver starts, the queue takes only one producer at a time
+    if (geofence_def_restore(&fence_def) == ESP_OK){
+        fence_upload = fence_def;
+        send_geofence();
+        ESP_LOGI(TAG, "restored %u geofence polygons", fence_def.polygon_count);
+    }
+    {
+        uint32_t count;
+        bool loop;
+        if (route_restore(route_upload, &count, &loop) == ESP_OK){
+            const command_t cmd = { .type = COMMAND_SET_ROUTE, .route = { .count = count, .loop = loop } };
+            atomic_store(&route_upload_busy, true);
+            command_queue_push(&command_queue, &cmd);
+            ESP_LOGI(TAG, "restored route of %u waypoints", count);
+        }
+    }
+    boot_timing_end(BOOT_STAGE_SETTINGS);
+    //WiFi and the webserver come up in their own task, sharing the core with this one, while the track log and control loop start here
+    xTaskCreatePinnedToCore(net_init_task, "net_init", 4096, NULL, 1, NULL, 0);
+    //Track log, carries on after the newest block in the track partition
+    boot_timing_begin(BOOT_STAGE_TRACK);
+    if (track_log_init() != ESP_OK){
+        ESP_LOGW(TAG, "no track partition, track not logged");
+    }
+    boot_timing_end(BOOT_STAGE_TRACK);
+    //Motor outputs start at 0% duty
+    boot_timing_begin(BOOT_STAGE_CONTROL);
+    init_pwm();
+    //NMEA sentences out to a chartplotter or autopilot, must be up before the control loop queues any
+    if (NMEA_OUT_ENABLED){
+        nmea_output_config_t nmea_out_config = NMEA_OUTPUT_CONFIG_DEFAULT();
+#if CONFIG_NMEA_SERVER
+        nmea_out_config.tap = nmea_server_publish;
+#endif
+        if (nmea_output_init(&nmea_out_config) != ESP_OK){
+            ESP_LOGW(TAG, "NMEA output not started");
+        }
+    }
+    //Start the fixed period control loop
+    xTaskCreatePinnedToCore(control_task, "control", CONFIG_CONTROL_TASK_STACK_SIZE, NULL,
+                            CONFIG_CONTROL_TASK_PRIORITY, &control_task_hdl, CONFIG_CONTROL_TASK_CORE);
+    boot_timing_end(BOOT_STAGE_CONTROL);
+    //Report where boot time went, once everything is up and again once the motors are first driven
+    boot_timing_wait(BOOT_STAGE_HTTPD, 30000);
+    boot_timing_log();
+    if (boot_timing_wait(BOOT_FIRST_CONTROL_OUTPUT, 600000)){
+        boot_timing_log();
+    }
+}
@@ -0,0 +1,224 @@
+/* NMEA sentence layouts
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+/*
+ * Every statement the parser knows is declared once here. The statement enum, the header matching, the
+ * per-item decoders, the set of statements compiled in and the NMEA encoder are all expanded from these
+ * lists, so adding a sentence means adding it to NMEA_STATEMENT_LIST, giving it a field list and a
+ * CONFIG_NMEA_STATEMENT_<NAME> option in Kconfig.projbuild. A statement without that option is compiled out.
+ *
+ * NMEA_STATEMENT_LIST(X) calls X(NAME, name, fields) per statement: the formatter, the lower case name
+ * used for the parse_ and encode_ functions, and the number of fields after the address.
+ *
+ * NMEA_FIELDS_<NAME>(F) calls F(index, type, dest, scale, arg) per field, in increasing index order:
+ *  - index: position after the address, starting at 1; fields that are not listed are skipped and
+ *    written empty
+ *  - type: how the field is read and written, see below
+ *  - dest: member of gps_t the field lands in, a member of gps_satellite_t for SAT, text for CONST. gps_t
+ *    itself is not generated from these lists, a field with a new dest needs its member added to gps_t in
+ *    nmea_gps.h by hand
+ *  - scale: the field is multiplied by scale when read and divided by it when written (FLOAT, ABS)
+ *  - arg: decimals written for FLOAT and ABS, zero padded width for INT, satellite slot for SAT
+ *
+ * Types:
+ *  - TIME: hhmmss.sss UTC time
+ *  - DATE: ddmmyy date
+ *  - LAT, LON: ddmm.mmmm or dddmm.mmmm, in degrees, and exactly in 1e-7 degrees in dest##_e7
+ *  - NS, EW: hemisphere of the position in dest, negates it and dest##_e7 for south and west
+ *  - SIGN_NS, SIGN_EW: hemisphere of a float that is not a position, negates it for south or west
+ *  - FLOAT: decimal number
+ *  - ABS: decimal number written without its sign, paired with SIGN_NS or SIGN_EW
+ *  - SUM: decimal number added to dest, written empty
+ *  - INT: decimal integer or enum
+ *  - ID: satellite number, written empty when 0
+ *  - YEAR: four digit year, dest counts from 2000
+ *  - VALID: 'A' for valid, 'V' for not
+ *  - STR: text copied into a char array
+ *  - CONST: fixed text such as a unit, nothing is read
+ *  - MSG_COUNT, MSG_NUM: number of sentences in the group and this sentence's number (GSV)
+ *  - SAT: a field of satellite slot arg of the current GSV sentence
+ *  - MODE: GNS mode indicator, also sets the fix status
+ *  - DEVIATION, DEVIATION_EW: HDG magnetic deviation, applied to dest, written empty
+ */
+
+#define NMEA_KNOTS (1.852f / 3.6f)     /*!< Scale of a speed in knots to m/s */
+#define NMEA_KMH (1.0f / 3.6f)         /*!< Scale of a speed in km/h to m/s */
+
+#define NMEA_STATEMENT_LIST(X) \
+    X(GGA, gga, 14)            \
+    X(GSA, gsa, 17)            \
+    X(RMC, rmc, 12)            \
+    X(GSV, gsv, 19)            \
+    X(GLL, gll, 7)             \
+    X(VTG, vtg, 9)             \
+    X(GST, gst, 8)             \
+    X(ZDA, zda, 6)             \
+    X(GNS, gns, 12)            \
+    X(GBS, gbs, 8)             \
+    X(HDT, hdt, 2)             \
+    X(HDG, hdg, 5)             \
+    X(DTM, dtm, 8)
+
+#define NMEA_FIELDS_GGA(F)                          \
+    F(1, TIME, tim, 1, 0)                           \
+    F(2, LAT, latitude, 1, 0)                       \
+    F(3, NS, latitude, 1, 0)                        \
+    F(4, LON, longitude, 1, 0)                      \
+    F(5, EW, longitude, 1, 0)                       \
+    F(6, INT, fix, 1, 0)                            \
+    F(7, INT, sats_in_use, 1, 2)                    \
+    F(8, FLOAT, dop_h, 1, 2)                        \
+    F(9, FLOAT, altitude, 1, 1)                     \
+    F(10, CONST, "M", 1, 0)                         \
+    F(11, SUM, altitude, 1, 0)                      \
+    F(12, CONST, "M", 1, 0)
+
+#define NMEA_FIELDS_GSA(F)                          \
+    F(1, CONST, "A", 1, 0)                          \
+    F(2, INT, fix_mode, 1, 0)                       \
+    F(3, ID, sats_id_in_use[0], 1, 0)               \
+    F(4, ID, sats_id_in_use[1], 1, 0)               \
+    F(5, ID, sats_id_in_use[2], 1, 0)               \
+    F(6, ID, sats_id_in_use[3], 1, 0)               \
+    F(7, ID, sats_id_in_use[4], 1, 0)               \
+    F(8, ID, sats_id_in_use[5], 1, 0)               \
+    F(9, ID, sats_id_in_use[6], 1, 0)               \
+    F(10, ID, sats_id_in_use[7], 1, 0)              \
+    F(11, ID, sats_id_in_use[8], 1, 0)              \
+    F(12, ID, sats_id_in_use[9], 1, 0)              \
+    F(13, ID, sats_id_in_use[10], 1, 0)             \
+    F(14, ID, sats_id_in_use[11], 1, 0)             \
+    F(15, FLOAT, dop_p, 1, 2)                       \
+    F(16, FLOAT, dop_h, 1, 2)                       \
+    F(17, FLOAT, dop_v, 1, 2)
+
+#define NMEA_FIELDS_RMC(F)                          \
+    F(1, TIME, tim, 1, 0)                           \
+    F(2, VALID, valid, 1, 0)                        \
+    F(3, LAT, latitude, 1, 0)                       \
+    F(4, NS, latitude, 1, 0)                        \
+    F(5, LON, longitude, 1, 0)                      \
+    F(6, EW, longitude, 1, 0)                       \
+    F(7, FLOAT, speed, NMEA_KNOTS, 2)               \
+    F(8, FLOAT, cog, 1, 1)                          \
+    F(9, DATE, date, 1, 0)                          \
+    F(10, ABS, variation, 1, 1)                     \
+    F(11, SIGN_EW, variation, 1, 0)
+
+#define NMEA_FIELDS_GSV(F)                          \
+    F(1, MSG_COUNT, sat_count, 1, 0)                \
+    F(2, MSG_NUM, sat_num, 1, 0)                    \
+    F(3, INT, sats_in_view, 1, 2)                   \
+    F(4, SAT, num, 1, 0)                            \
+    F(5, SAT, elevation, 1, 0)                      \
+    F(6, SAT, azimuth, 1, 0)                        \
+    F(7, SAT, snr, 1, 0)                            \
+    F(8, SAT, num, 1, 1)                            \
+    F(9, SAT, elevation, 1, 1)                      \
+    F(10, SAT, azimuth, 1, 1)                       \
+    F(11, SAT, snr, 1, 1)                           \
+    F(12, SAT, num, 1, 2)                           \
+    F(13, SAT, elevation, 1, 2)                     \
+    F(14, SAT, azimuth, 1, 2)                       \
+    F(15, SAT, snr, 1, 2)                           \
+    F(16, SAT, num, 1, 3)                           \
+    F(17, SAT, elevation, 1, 3)                     \
+    F(18, SAT, azimuth, 1, 3)                       \
+    F(19, SAT, snr, 1, 3)
+
+#define NMEA_FIELDS_GLL(F)                          \
+    F(1, LAT, latitude, 1, 0)                       \
+    F(2, NS, latitude, 1, 0)                        \
+    F(3, LON, longitude, 1, 0)                      \
+    F(4, EW, longitude, 1, 0)                       \
+    F(5, TIME, tim, 1, 0)                           \
+    F(6, VALID, valid, 1, 0)
+
+#define NMEA_FIELDS_VTG(F)                          \
+    F(1, FLOAT, cog, 1, 1)                          \
+    F(2, CONST, "T", 1, 0)                          \
+    F(4, CONST, "M", 1, 0)                          \
+    F(5, FLOAT, speed, NMEA_KNOTS, 2)               \
+    F(6, CONST, "N", 1, 0)                          \
+    F(7, FLOAT, speed, NMEA_KMH, 2)                 \
+    F(8, CONST, "K", 1, 0)
+
+#define NMEA_FIELDS_GST(F)                          \
+    F(1, TIME, tim, 1, 0)                           \
+    F(2, FLOAT, error.rms, 1, 2)                    \
+    F(3, FLOAT, error.major, 1, 2)                  \
+    F(4, FLOAT, error.minor, 1, 2)                  \
+    F(5, FLOAT, error.orientation, 1, 1)            \
+    F(6, FLOAT, error.lat, 1, 2)                    \
+    F(7, FLOAT, error.lon, 1, 2)                    \
+    F(8, FLOAT, error.alt, 1, 2)
+
+#define NMEA_FIELDS_ZDA(F)                          \
+    F(1, TIME, tim, 1, 0)                           \
+    F(2, INT, date.day, 1, 2)                       \
+    F(3, INT, date.month, 1, 2)                     \
+    F(4, YEAR, date.year, 1, 0)                     \
+    F(5, CONST, "00", 1, 0)                         \
+    F(6, CONST, "00", 1, 0)
+
+#define NMEA_FIELDS_GNS(F)                          \
+    F(1, TIME, tim, 1, 0)                           \
+    F(2, LAT, latitude, 1, 0)                       \
+    F(3, NS, latitude, 1, 0)                        \
+    F(4, LON, longitude, 1, 0)                      \
+    F(5, EW, longitude, 1, 0)                       \
+    F(6, MODE, mode, 1, 0)                          \
+    F(7, INT, sats_in_use, 1, 2)                    \
+    F(8, FLOAT, dop_h, 1, 2)                        \
+    F(9, FLOAT, altitude, 1, 1)                     \
+    F(10, SUM, altitude, 1, 0)
+
+#define NMEA_FIELDS_GBS(F)                          \
+    F(1, TIME, tim, 1, 0)                           \
+    F(2, FLOAT, fault.lat, 1, 1)                    \
+    F(3, FLOAT, fault.lon, 1, 1)                    \
+    F(4, FLOAT, fault.alt, 1, 1)                    \
+    F(5, ID, fault.sat, 1, 0)                       \
+    F(6, FLOAT, fault.probability, 1, 3)            \
+    F(7, FLOAT, fault.bias, 1, 1)                   \
+    F(8, FLOAT, fault.bias_sd, 1, 1)
+
+#define NMEA_FIELDS_HDT(F)                          \
+    F(1, FLOAT, heading, 1, 1)                      \
+    F(2, CONST, "T", 1, 0)
+
+#define NMEA_FIELDS_HDG(F)                          \
+    F(1, FLOAT, heading_magnetic, 1, 1)             \
+    F(2, DEVIATION, heading_magnetic, 1, 0)         \
+    F(3, DEVIATION_EW, heading_magnetic, 1, 0)      \
+    F(4, ABS, variation, 1, 1)                      \
+    F(5, SIGN_EW, variation, 1, 0)
+
+/* The local datum subcode in field 2 is skipped */
+#define NMEA_FIELDS_DTM(F)                          \
+    F(1, STR, datum, 1, 0)                          \
+    F(3, ABS, datum_offset.lat, 1, 4)               \
+    F(4, SIGN_NS, datum_offset.lat, 1, 0)           \
+    F(5, ABS, datum_offset.lon, 1, 4)               \
+    F(6, SIGN_EW, datum_offset.lon, 1, 0)           \
+    F(7, FLOAT, datum_offset.alt, 1, 1)             \
+    F(8, STR, datum_ref, 1, 0)
+
+/*
+ * NMEA_STATEMENT_BUILT(NAME) is 1 when CONFIG_NMEA_STATEMENT_<NAME> is set and 0 otherwise, usable in
+ * expressions so code for statements that are compiled out is dropped by the optimizer.
+ */
+#define NMEA_CONFIG_PLACEHOLDER_1 0,
+#define NMEA_TAKE_SECOND(ignored, value, ...) value
+#define NMEA_IS_ENABLED(option) NMEA_IS_ENABLED_(option)
+#define NMEA_IS_ENABLED_(value) NMEA_IS_ENABLED__(NMEA_CONFIG_PLACEHOLDER_##value)
+#define NMEA_IS_ENABLED__(arg_or_junk) NMEA_TAKE_SECOND(arg_or_junk 1, 0)
+#define NMEA_STATEMENT_BUILT(NAME) NMEA_IS_ENABLED(CONFIG_NMEA_STATEMENT_##NAME)
@@ -0,0 +1,104 @@
+/* Sentences registered by the application
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "nmea_sentence.h"
+
+esp_err_t nmea_sentence_add(nmea_sentence_table_t *table, const char *key, const nmea_field_type_t *schema,
+                            size_t num_fields, nmea_sentence_cb_t cb, void *ctx)
+{
+    const size_t key_len = strlen(key);
+
+    if (key_len == 0 || key_len >= NMEA_SENTENCE_KEY_LENGTH || num_fields > CONFIG_NMEA_PARSER_MAX_FIELDS || !cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const unsigned n = atomic_load_explicit(&table->num_sentences, memory_order_relaxed);
+    if (n >= CONFIG_NMEA_PARSER_MAX_SENTENCES) {
+        return ESP_ERR_NO_MEM;
+    }
+    nmea_sentence_t *sentence = &table->sentences[n];
+    memcpy(sentence->key, key, key_len + 1);
+    sentence->key_len = key_len;
+    sentence->num_fields = num_fields;
+    sentence->schema = schema;
+    sentence->cb = cb;
+    sentence->ctx = ctx;
+    atomic_store_explicit(&table->num_sentences, n + 1, memory_order_release);
+    return ESP_OK;
+}
+
+int nmea_sentence_find(const nmea_sentence_table_t *table, const char *address, size_t len, bool prefix)
+{
+    const unsigned n = atomic_load_explicit(&table->num_sentences, memory_order_acquire);
+    for (unsigned i = 0; i < n; i++) {
+        const nmea_sentence_t *sentence = &table->sentences[i];
+        size_t cmp_len = sentence->key_len;
+        if (prefix) {
+            cmp_len = cmp_len < len ? cmp_len : len;
+        } else if (cmp_len != len) {
+            continue;
+        }
+        size_t j = 0;
+        while (j < cmp_len && (sentence->key[j] == '-' || sentence->key[j] == address[j])) {
+            j++;
+        }
+        if (j == cmp_len) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+void nmea_sentence_dispatch(nmea_sentence_table_t *table, int index, char *line)
+{
+    const nmea_sentence_t *sentence = &table->sentences[index];
+    const char *field_str[CONFIG_NMEA_PARSER_MAX_FIELDS];
+    size_t received = 0;
+
+    /* The checksum passed, so the fields end at the '*' */
+    char *sep = line + strcspn(line, ",*");
+    while (*sep == ',') {
+        *sep++ = '\0';
+        if (received < CONFIG_NMEA_PARSER_MAX_FIELDS) {
+            field_str[received++] = sep;
+        }
+        sep += strcspn(sep, ",*");
+    }
+    *sep = '\0';
+    for (size_t k = 0; k < sentence->num_fields; k++) {
+        nmea_field_t *field = &table->fields[k];
+        const char *str = k < received ? field_str[k] : "";
+        field->present = str[0] != '\0';
+        field->value.u = 0;
+        if (!field->present) {
+            continue;
+        }
+        switch (sentence->schema[k]) {
+        case NMEA_FIELD_INT:
+            field->value.i = strtol(str, NULL, 10);
+            break;
+        case NMEA_FIELD_HEX:
+            field->value.u = strtoul(str, NULL, 16);
+            break;
+        case NMEA_FIELD_FLOAT:
+            field->value.f = strtof(str, NULL);
+            break;
+        case NMEA_FIELD_CHAR:
+            field->value.c = str[0];
+            break;
+        case NMEA_FIELD_STRING:
+            field->value.s = str;
+            break;
+        default:
+            break;
+        }
+    }
+    sentence->cb(line + 1, table->fields, sentence->num_fields, sentence->ctx);
+}
@@ -0,0 +1,134 @@
+/* Sentences registered by the application
+
+   The table behind nmea_parser_register_sentence(): matching a sentence address against the registered
+   keys and converting the fields of a sentence to the types in its schema. Holds no OS objects and does
+   no I/O, so the host tools build it too.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdatomic.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "nmea_decode.h"
+
+#define NMEA_SENTENCE_KEY_LENGTH (NMEA_MAX_STATEMENT_ITEM_LENGTH - 1) /* The address item also holds '$' */
+
+/**
+ * @brief Type of a field in a registered sentence
+ *
+ */
+typedef enum {
+    NMEA_FIELD_SKIP,   /*!< Not converted */
+    NMEA_FIELD_INT,    /*!< Decimal integer, in value.i */
+    NMEA_FIELD_FLOAT,  /*!< Decimal number, in value.f */
+    NMEA_FIELD_HEX,    /*!< Hexadecimal integer, in value.u */
+    NMEA_FIELD_CHAR,   /*!< Single character such as a status or hemisphere, in value.c */
+    NMEA_FIELD_STRING, /*!< Text, in value.s */
+} nmea_field_type_t;
+
+/**
+ * @brief Value of a field in a registered sentence
+ *
+ */
+typedef struct {
+    bool present;       /*!< The field is in the sentence and not empty */
+    union {
+        int32_t i;      /*!< NMEA_FIELD_INT */
+        uint32_t u;     /*!< NMEA_FIELD_HEX */
+        float f;        /*!< NMEA_FIELD_FLOAT */
+        char c;         /*!< NMEA_FIELD_CHAR */
+        const char *s;  /*!< NMEA_FIELD_STRING, points into the parser's buffer and is only valid during the callback */
+    } value;            /*!< Value, by the type in the schema */
+} nmea_field_t;
+
+/**
+ * @brief Callback for a registered sentence
+ *
+ * Runs on the NMEA parser task, so it should copy out what it needs and return quickly.
+ *
+ * @param address address field of the sentence without the '$', e.g. "GPTXT"
+ * @param fields one value per schema entry, fields missing from the sentence are not present
+ * @param num_fields number of schema entries
+ * @param ctx context given at registration
+ */
+typedef void (*nmea_sentence_cb_t)(const char *address, const nmea_field_t *fields, size_t num_fields, void *ctx);
+
+/**
+ * @brief Sentence registered by the application
+ *
+ */
+typedef struct {
+    char key[NMEA_SENTENCE_KEY_LENGTH];            /*!< Address to match, '-' matches any character */
+    uint8_t key_len;                               /*!< Characters in key */
+    uint8_t num_fields;                            /*!< Entries in schema */
+    const nmea_field_type_t *schema;               /*!< Type of each field */
+    nmea_sentence_cb_t cb;                         /*!< Called with the converted fields */
+    void *ctx;                                     /*!< Passed to cb */
+} nmea_sentence_t;
+
+/**
+ * @brief Registered sentences
+ *
+ * One task matches and dispatches while others may add entries: an entry is only counted once it is
+ * filled, so the reader needs no lock. Adding must be serialised by the caller.
+ */
+typedef struct {
+    nmea_sentence_t sentences[CONFIG_NMEA_PARSER_MAX_SENTENCES]; /*!< In the order they were added */
+    atomic_uint num_sentences;                                   /*!< Entries in use, published after they are filled */
+    nmea_field_t fields[CONFIG_NMEA_PARSER_MAX_FIELDS];          /*!< Converted fields of the sentence being dispatched */
+} nmea_sentence_table_t;
+
+/**
+ * @brief Add a sentence to the table
+ *
+ * @param table table, zeroed before the first call
+ * @param key address to match, '-' matches any character
+ * @param schema type of each field after the address, must stay valid while the table is used
+ * @param num_fields number of schema entries
+ * @param cb callback
+ * @param ctx passed to the callback
+ * @return esp_err_t ESP_OK, ESP_ERR_INVALID_ARG if the key is empty or too long, there are too many fields
+ *         or there is no callback, ESP_ERR_NO_MEM if the table is full
+ */
+esp_err_t nmea_sentence_add(nmea_sentence_table_t *table, const char *key, const nmea_field_type_t *schema,
+                            size_t num_fields, nmea_sentence_cb_t cb, void *ctx);
+
+/**
+ * @brief Find the registered sentence for an address
+ *
+ * @param table table
+ * @param address address characters, not terminated
+ * @param len number of address characters
+ * @param prefix only the start of the address is known, match keys on their first len characters
+ * @return int index in the table, -1 if none matches
+ */
+int nmea_sentence_find(const nmea_sentence_table_t *table, const char *address, size_t len, bool prefix);
+
+/**
+ * @brief Convert the fields of a registered sentence and hand them to its callback
+ *
+ * The separators are overwritten in place, so each field is a string in the line.
+ *
+ * @param table table
+ * @param index registered sentence, from nmea_sentence_find()
+ * @param line sentence from '$', terminated, with a checksum that has been checked
+ */
+void nmea_sentence_dispatch(nmea_sentence_table_t *table, int index, char *line);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,363 @@
+/* NMEA 0183 over TCP and UDP
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdatomic.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "nmea_server.h"
+
+static const char *NMEA_SERVER_TAG = "nmea_server";
+
+#define NMEA_SERVER_POLL_MS (20)    /* Longest a published sentence waits before it is sent */
+#define NMEA_SERVER_UDP_MAX (1024)  /* Largest datagram, cut at the end of a sentence */
+
+/*
+ * Every sentence is copied once, into one ring shared by all clients. Each client only has a cursor, the
+ * ring position of the next byte it is owed, and is sent straight from the ring. Positions count bytes
+ * since the start and wrap by the mask.
+ *
+ * Publishers may overwrite the ring up to floor + size, where floor is the cursor furthest behind. Only
+ * the server task moves cursors and floor, so bytes are never overwritten while they are being sent. A
+ * client more than half the ring behind is moved up and loses the oldest part of its backlog, so a
+ * slow or stalled client never holds the ring and publishers always find room while the task runs.
+ * It carries on from the first whole sentence in the newest half, a TCP client may see the sentence it
+ * was in the middle of cut short.
+ */
+typedef struct {
+    int fd;                             /*!< Socket, -1 if the slot is free */
+    uint32_t cursor;                    /*!< Next byte to send */
+    nmea_server_client_stats_t stats;   /*!< Counters, lag is filled when they are read */
+} nmea_client_t;
+
+static uint8_t *ring;
+static uint32_t ring_mask;
+static atomic_uint ring_head;           /*!< Written by publishers under server_lock */
+static atomic_uint ring_floor;          /*!< Written by the server task */
+static atomic_bool server_ready;        /*!< The ring is set up, published after it */
+static portMUX_TYPE server_lock = portMUX_INITIALIZER_UNLOCKED;
+
+/* Only used by the server task */
+static nmea_client_t clients[CONFIG_NMEA_SERVER_MAX_CLIENTS];
+static int listen_fd = -1;
+static int udp_fd = -1;
+static uint32_t udp_cursor;
+static struct sockaddr_in udp_dest;
+static uint32_t total_sent;
+
+static nmea_server_stats_t stats;       /*!< Guarded by server_lock */
+
+void nmea_server_publish(const char *sentence, size_t len)
+{
+    if (!atomic_load_explicit(&server_ready, memory_order_acquire)) {
+        return;
+    }
+    portENTER_CRITICAL(&server_lock);
+    uint32_t head = atomic_load_explicit(&ring_head, memory_order_relaxed);
+    uint32_t floor = atomic_load_explicit(&ring_floor, memory_order_acquire);
+    if (len <= ring_mask + 1 - (head - floor)) {
+        size_t off = head & ring_mask;
+        size_t first = ring_mask + 1 - off;
+        if (first > len) {
+            first = len;
+        }
+        memcpy(ring + off, sentence, first);
+        memcpy(ring, sentence + first, len - first);
+        atomic_store_explicit(&ring_head, head + len, memory_order_release);
+        stats.published++;
+        stats.published_bytes += len;
+    } else {
+        stats.dropped++;
+    }
+    portEXIT_CRITICAL(&server_lock);
+}
+
+/* The ring bytes from a position as one or two pieces */
+static int ring_iov(uint32_t from, uint32_t len, struct iovec *iov)
+{
+    size_t off = from & ring_mask;
+    size_t first = ring_mask + 1 - off;
+    iov[0].iov_base = ring + off;
+    if (len <= first) {
+        iov[0].iov_len = len;
+        return 1;
+    }
+    iov[0].iov_len = first;
+    iov[1].iov_base = ring;
+    iov[1].iov_len = len - first;
+    return 2;
+}
+
+static void close_client(nmea_client_t *client)
+{
+    ESP_LOGI(NMEA_SERVER_TAG, "client %d gone", (int)(client - clients));
+    close(client->fd);
+    client->fd = -1;
+    client->stats.connected = false;
+}
+
+static void accept_client(uint32_t head)
+{
+    struct sockaddr_in addr;
+    socklen_t addr_len = sizeof(addr);
+    int fd = accept(listen_fd, (struct sockaddr *)&addr, &addr_len);
+    if (fd < 0) {
+        return;
+    }
+    for (int i = 0; i < CONFIG_NMEA_SERVER_MAX_CLIENTS; i++) {
+        if (clients[i].fd < 0) {
+            fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+            clients[i].fd = fd;
+            /* New clients start with the next sentence */
+            clients[i].cursor = head;
+            clients[i].stats = (nmea_server_client_stats_t) {
+                .connected = true
+            };
+            portENTER_CRITICAL(&server_lock);
+            stats.accepted++;
+            portEXIT_CRITICAL(&server_lock);
+            ESP_LOGI(NMEA_SERVER_TAG, "client %d from %s", i, inet_ntoa(addr.sin_addr));
+            return;
+        }
+    }
+    close(fd);
+    portENTER_CRITICAL(&server_lock);
+    stats.rejected++;
+    portEXIT_CRITICAL(&server_lock);
+}
+
+/* Clients have nothing to say, read and discard so a close is seen */
+static void drain_client(nmea_client_t *client)
+{
+    char scratch[64];
+    int n = recv(client->fd, scratch, sizeof(scratch), MSG_DONTWAIT);
+    if (n == 0 || (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+        close_client(client);
+    }
+}
+
+/* Where a reader that is too far behind carries on: the first sentence that starts in the newest lag_limit bytes */
+static uint32_t skip_ahead(uint32_t head, uint32_t lag_limit)
+{
+    uint32_t to = head - lag_limit;
+    while (to != head && ring[(to - 1) & ring_mask] != '\n') {
+        to++;
+    }
+    return to;
+}
+
+/* Send a client as much of what it is owed as its socket takes, without waiting */
+static void send_client(nmea_client_t *client, uint32_t head, uint32_t lag_limit)
+{
+    uint32_t lag = head - client->cursor;
+    if (lag > lag_limit) {
+        uint32_t to = skip_ahead(head, lag_limit);
+        client->stats.skips++;
+        client->stats.skipped += to - client->cursor;
+        client->cursor = to;
+        lag = head - to;
+    }
+    if (lag == 0) {
+        return;
+    }
+    struct iovec iov[2];
+    struct msghdr msg = {
+        .msg_iov = iov,
+        .msg_iovlen = ring_iov(client->cursor, lag, iov),
+    };
+    int n = sendmsg(client->fd, &msg, MSG_DONTWAIT);
+    if (n > 0) {
+        client->cursor += n;
+        client->stats.sent += n;
+        total_sent += n;
+    } else if (n < 0 && errno != EAGAIN && errno != EWOULDBLOCK) {
+        close_client(client);
+    }
+}
+
+/* Broadcast whole sentences, a datagram never ends mid-sentence */
+static void send_udp(uint32_t head, uint32_t lag_limit)
+{
+    uint32_t lag = head - udp_cursor;
+    if (lag > lag_limit) {
+        udp_cursor = skip_ahead(head, lag_limit);
+        lag = head - udp_cursor;
+    }
+    while (lag > 0) {
+        uint32_t len = lag;
+        if (len > NMEA_SERVER_UDP_MAX) {
+            len = NMEA_SERVER_UDP_MAX;
+            while (len > 1 && ring[(udp_cursor + len - 1) & ring_mask] != '\n') {
+                len--;
+            }
+        }
+        struct iovec iov[2];
+        struct msghdr msg = {
+            .msg_name = &udp_dest,
+            .msg_namelen = sizeof(udp_dest),
+            .msg_iov = iov,
+            .msg_iovlen = ring_iov(udp_cursor, len, iov),
+        };
+        if (sendmsg(udp_fd, &msg, MSG_DONTWAIT) < 0) {
+            /* Out of buffers, try again next round */
+            return;
+        }
+        udp_cursor += len;
+        total_sent += len;
+        lag -= len;
+    }
+}
+
+static void nmea_server_task_entry(void *arg)
+{
+    const uint32_t lag_limit = (ring_mask + 1) / 2;
+    int64_t rate_start_us = esp_timer_get_time();
+    uint32_t rate_start_sent = 0;
+
+    while (1) {
+        fd_set rfds;
+        int max_fd = listen_fd;
+        FD_ZERO(&rfds);
+        FD_SET(listen_fd, &rfds);
+        for (int i = 0; i < CONFIG_NMEA_SERVER_MAX_CLIENTS; i++) {
+            if (clients[i].fd >= 0) {
+                FD_SET(clients[i].fd, &rfds);
+                if (clients[i].fd > max_fd) {
+                    max_fd = clients[i].fd;
+                }
+            }
+        }
+        struct timeval tv = {
+            .tv_sec = 0,
+            .tv_usec = NMEA_SERVER_POLL_MS * 1000,
+        };
+        if (select(max_fd + 1, &rfds, NULL, NULL, &tv) > 0) {
+            for (int i = 0; i < CONFIG_NMEA_SERVER_MAX_CLIENTS; i++) {
+                if (clients[i].fd >= 0 && FD_ISSET(clients[i].fd, &rfds)) {
+                    drain_client(&clients[i]);
+                }
+            }
+            if (FD_ISSET(listen_fd, &rfds)) {
+                accept_client(atomic_load_explicit(&ring_head, memory_order_acquire));
+            }
+        }
+
+        uint32_t head = atomic_load_explicit(&ring_head, memory_order_acquire);
+        uint32_t max_lag = 0;
+        for (int i = 0; i < CONFIG_NMEA_SERVER_MAX_CLIENTS; i++) {
+            if (clients[i].fd >= 0) {
+                send_client(&clients[i], head, lag_limit);
+            }
+            if (clients[i].fd >= 0 && head - clients[i].cursor > max_lag) {
+                max_lag = head - clients[i].cursor;
+            }
+        }
+        if (udp_fd >= 0) {
+            send_udp(head, lag_limit);
+            if (head - udp_cursor > max_lag) {
+                max_lag = head - udp_cursor;
+            }
+        }
+        /* Publishers may now reuse everything every client has been sent */
+        atomic_store_explicit(&ring_floor, head - max_lag, memory_order_release);
+
+        int64_t now_us = esp_timer_get_time();
+        portENTER_CRITICAL(&server_lock);
+        for (int i = 0; i < CONFIG_NMEA_SERVER_MAX_CLIENTS; i++) {
+            stats.clients[i] = clients[i].stats;
+            stats.clients[i].lag = clients[i].fd >= 0 ? head - clients[i].cursor : 0;
+        }
+        stats.udp_lag = udp_fd >= 0 ? head - udp_cursor : 0;
+        stats.sent = total_sent;
+        if (now_us - rate_start_us >= 1000000) {
+            stats.sent_per_s = (uint64_t)(total_sent - rate_start_sent) * 1000000 / (now_us - rate_start_us);
+            rate_start_us = now_us;
+            rate_start_sent = total_sent;
+        }
+        portEXIT_CRITICAL(&server_lock);
+    }
+}
+
+void nmea_server_get_stats(nmea_server_stats_t *out)
+{
+    portENTER_CRITICAL(&server_lock);
+    *out = stats;
+    portEXIT_CRITICAL(&server_lock);
+}
+
+esp_err_t nmea_server_init(const nmea_server_config_t *config)
+{
+    const int one = 1;
+    esp_err_t err = ESP_FAIL;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(config->port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+
+    if (config->ring_size == 0 || (config->ring_size & (config->ring_size - 1))) {
+        ESP_LOGE(NMEA_SERVER_TAG, "ring size %u is not a power of two", (unsigned)config->ring_size);
+        return ESP_ERR_INVALID_ARG;
+    }
+    ring = malloc(config->ring_size);
+    if (!ring) {
+        return ESP_ERR_NO_MEM;
+    }
+    ring_mask = config->ring_size - 1;
+    for (int i = 0; i < CONFIG_NMEA_SERVER_MAX_CLIENTS; i++) {
+        clients[i].fd = -1;
+    }
+    listen_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    if (listen_fd < 0) {
+        ESP_LOGE(NMEA_SERVER_TAG, "create socket failed");
+        goto err_socket;
+    }
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(listen_fd, 2) != 0) {
+        ESP_LOGE(NMEA_SERVER_TAG, "listen on port %u failed", config->port);
+        goto err_listen;
+    }
+    fcntl(listen_fd, F_SETFL, fcntl(listen_fd, F_GETFL, 0) | O_NONBLOCK);
+    if (config->udp_broadcast) {
+        udp_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        if (udp_fd < 0 || setsockopt(udp_fd, SOL_SOCKET, SO_BROADCAST, &one, sizeof(one)) != 0) {
+            ESP_LOGE(NMEA_SERVER_TAG, "create UDP socket failed");
+            goto err_udp;
+        }
+        udp_dest = addr;
+        udp_dest.sin_addr.s_addr = htonl(INADDR_BROADCAST);
+    }
+    if (xTaskCreate(nmea_server_task_entry, "nmea_server", config->task_stack_size, NULL,
+                    config->task_priority, NULL) != pdPASS) {
+        ESP_LOGE(NMEA_SERVER_TAG, "create server task failed");
+        err = ESP_ERR_NO_MEM;
+        goto err_udp;
+    }
+    atomic_store_explicit(&server_ready, true, memory_order_release);
+    ESP_LOGI(NMEA_SERVER_TAG, "NMEA on TCP port %u%s", config->port, udp_fd >= 0 ? " and UDP broadcast" : "");
+    return ESP_OK;
+err_udp:
+    if (udp_fd >= 0) {
+        close(udp_fd);
+        udp_fd = -1;
+    }
+err_listen:
+    close(listen_fd);
+    listen_fd = -1;
+err_socket:
+    free(ring);
+    ring = NULL;
+    return err;
+}
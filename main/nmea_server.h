@@ -0,0 +1,110 @@
+/* NMEA 0183 over TCP and UDP
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef CONFIG_NMEA_SERVER_UDP
+#define NMEA_SERVER_UDP_DEFAULT true
+#else
+#define NMEA_SERVER_UDP_DEFAULT false
+#endif
+
+/**
+ * @brief NMEA server configuration
+ *
+ */
+typedef struct {
+    uint16_t port;              /*!< TCP port clients connect to, also the UDP broadcast port */
+    size_t ring_size;           /*!< Bytes shared by all clients, a power of two */
+    bool udp_broadcast;         /*!< Also broadcast every sentence over UDP */
+    uint32_t task_stack_size;   /*!< Stack size of the server task */
+    uint32_t task_priority;     /*!< Priority of the server task */
+} nmea_server_config_t;
+
+/**
+ * @brief Default NMEA server configuration
+ *
+ */
+#define NMEA_SERVER_CONFIG_DEFAULT()                    \
+    {                                                   \
+        .port = CONFIG_NMEA_SERVER_PORT,                \
+        .ring_size = CONFIG_NMEA_SERVER_RING_SIZE,      \
+        .udp_broadcast = NMEA_SERVER_UDP_DEFAULT,       \
+        .task_stack_size = 3072,                        \
+        .task_priority = 3,                             \
+    }
+
+/**
+ * @brief Counters of one TCP client slot
+ *
+ */
+typedef struct {
+    bool connected;         /*!< A client holds the slot */
+    uint32_t sent;          /*!< Bytes sent to the client in the slot */
+    uint32_t lag;           /*!< Bytes published but not yet sent to it */
+    uint32_t skips;         /*!< Times it fell too far behind and skipped ahead */
+    uint32_t skipped;       /*!< Bytes it missed that way */
+} nmea_server_client_stats_t;
+
+/**
+ * @brief NMEA server counters
+ *
+ */
+typedef struct {
+    uint32_t published;     /*!< Sentences published */
+    uint32_t published_bytes; /*!< Bytes published */
+    uint32_t dropped;       /*!< Sentences dropped because the ring was still held by clients */
+    uint32_t accepted;      /*!< TCP connections accepted */
+    uint32_t rejected;      /*!< TCP connections closed straight away because every slot was taken */
+    uint32_t sent;          /*!< Bytes sent to all TCP clients and UDP */
+    uint32_t sent_per_s;    /*!< Bytes sent in the last second */
+    uint32_t udp_lag;       /*!< Bytes published but not yet broadcast */
+    nmea_server_client_stats_t clients[CONFIG_NMEA_SERVER_MAX_CLIENTS]; /*!< Per slot counters */
+} nmea_server_stats_t;
+
+/**
+ * @brief Start the server task, needs the network up
+ *
+ * @param config configuration
+ * @return esp_err_t ESP_OK on success, ESP_ERR_INVALID_ARG if the ring size is not a power of two,
+ *         ESP_ERR_NO_MEM if the ring or the task can't be created, ESP_FAIL if the sockets can't be opened
+ */
+esp_err_t nmea_server_init(const nmea_server_config_t *config);
+
+/**
+ * @brief Publish one sentence to every client
+ *
+ * Safe from any task, takes a spinlock for the copy into the ring and never waits for a client. The
+ * sentence is dropped if clients still hold the space, which only happens if the server task stalls.
+ * Does nothing before nmea_server_init().
+ *
+ * @param sentence sentence from '$' to "\r\n"
+ * @param len length of the sentence
+ */
+void nmea_server_publish(const char *sentence, size_t len);
+
+/**
+ * @brief Read the counters
+ *
+ * @param stats filled with the counters, all zero before nmea_server_init()
+ */
+void nmea_server_get_stats(nmea_server_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
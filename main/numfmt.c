@@ -0,0 +1,153 @@
+/* Small integer and fixed point number formatting
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <math.h>
+#include "numfmt.h"
+
+static const uint32_t pow10_tab[10] = {
+    1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000, 1000000000
+};
+
+/**
+ * @brief Civil date of a number of days since 1970-01-01
+ *
+ */
+static void civil_from_days(int32_t z, int32_t *y, uint32_t *m, uint32_t *d)
+{
+    z += 719468;
+    int32_t era = (z >= 0 ? z : z - 146096) / 146097;
+    uint32_t doe = (uint32_t)(z - era * 146097);
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    *d = doy - (153 * mp + 2) / 5 + 1;
+    *m = mp < 10 ? mp + 3 : mp - 9;
+    *y = (int32_t)yoe + era * 400 + (*m <= 2);
+}
+
+int32_t numfmt_days_from_civil(int32_t y, uint32_t m, uint32_t d)
+{
+    y -= m <= 2;
+    int32_t era = (y >= 0 ? y : y - 399) / 400;
+    uint32_t yoe = (uint32_t)(y - era * 400);
+    uint32_t doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    uint32_t doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int32_t)doe - 719468;
+}
+
+/**
+ * @brief Write the digits of an unsigned value, at least min_digits with leading zeros
+ *
+ */
+static int put_digits(char *buf, uint32_t value, int min_digits)
+{
+    char tmp[10];
+    int n = 0;
+    do {
+        tmp[n++] = '0' + value % 10;
+        value /= 10;
+    } while (value || n < min_digits);
+    for (int i = 0; i < n; i++) {
+        buf[i] = tmp[n - 1 - i];
+    }
+    return n;
+}
+
+int numfmt_int(char *buf, int32_t value)
+{
+    int n = 0;
+    uint32_t mag = (uint32_t)value;
+    if (value < 0) {
+        buf[n++] = '-';
+        mag = 0u - mag;
+    }
+    return n + put_digits(buf + n, mag, 1);
+}
+
+int numfmt_fixed(char *buf, float value, uint8_t decimals)
+{
+    int n = 0;
+    if (decimals > 9) {
+        decimals = 9;
+    }
+    if (isnan(value)) {
+        buf[0] = 'n';
+        buf[1] = 'a';
+        buf[2] = 'n';
+        return 3;
+    }
+    float mag = value < 0 ? -value : value;
+    uint32_t whole, frac;
+    if (mag >= 4294967296.0f) {
+        /* Infinite or beyond the integer part, saturate */
+        whole = UINT32_MAX;
+        frac = 0;
+    } else {
+        /* Split off the integer part first, the fraction alone keeps full float precision when scaled.
+           Floats just below 2^32 are whole numbers, so the carry can't overflow */
+        whole = (uint32_t)mag;
+        frac = (uint32_t)((mag - whole) * pow10_tab[decimals] + 0.5f);
+        if (frac >= pow10_tab[decimals]) {
+            whole++;
+            frac -= pow10_tab[decimals];
+        }
+    }
+    if (value < 0 && (whole || frac)) {
+        buf[n++] = '-';
+    }
+    n += put_digits(buf + n, whole, 1);
+    if (decimals) {
+        buf[n++] = '.';
+        n += put_digits(buf + n, frac, decimals);
+    }
+    return n;
+}
+
+int numfmt_scaled(char *buf, int32_t value, uint8_t decimals)
+{
+    int n = 0;
+    uint32_t mag = (uint32_t)value;
+    if (decimals > 9) {
+        decimals = 9;
+    }
+    if (value < 0) {
+        buf[n++] = '-';
+        mag = 0u - mag;
+    }
+    n += put_digits(buf + n, mag / pow10_tab[decimals], 1);
+    if (decimals) {
+        buf[n++] = '.';
+        n += put_digits(buf + n, mag % pow10_tab[decimals], decimals);
+    }
+    return n;
+}
+
+int numfmt_utc(char *buf, int64_t t_ms)
+{
+    int32_t days = (int32_t)(t_ms / 86400000);
+    uint32_t ms = (uint32_t)(t_ms % 86400000);
+    int32_t y;
+    uint32_t m, d;
+    civil_from_days(days, &y, &m, &d);
+    int n = numfmt_int(buf, y);
+    buf[n++] = '-';
+    n += put_digits(buf + n, m, 2);
+    buf[n++] = '-';
+    n += put_digits(buf + n, d, 2);
+    buf[n++] = 'T';
+    n += put_digits(buf + n, ms / 3600000, 2);
+    buf[n++] = ':';
+    n += put_digits(buf + n, ms / 60000 % 60, 2);
+    buf[n++] = ':';
+    n += put_digits(buf + n, ms / 1000 % 60, 2);
+    buf[n++] = '.';
+    n += put_digits(buf + n, ms % 1000, 3);
+    buf[n++] = 'Z';
+    return n;
+}
@@ -0,0 +1,82 @@
+/* Small integer and fixed point number formatting
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Largest number of characters written by any numfmt function
+ *
+ */
+#define NUMFMT_MAX_LEN (21)
+
+/**
+ * @brief Largest number of characters written by numfmt_utc
+ *
+ */
+#define NUMFMT_UTC_MAX_LEN (31)
+
+/**
+ * @brief Write a signed decimal integer, no terminator
+ *
+ * @param buf output, must have room for NUMFMT_MAX_LEN characters
+ * @param value value
+ * @return int number of characters written
+ */
+int numfmt_int(char *buf, int32_t value);
+
+/**
+ * @brief Write a number with a fixed number of decimals, rounded, no terminator
+ *
+ * NaN is written as "nan". Infinities and magnitudes of 2^32 or more are saturated to +/-4294967295.
+ *
+ * @param buf output, must have room for NUMFMT_MAX_LEN characters
+ * @param value value
+ * @param decimals number of decimals, 0..9
+ * @return int number of characters written
+ */
+int numfmt_fixed(char *buf, float value, uint8_t decimals);
+
+/**
+ * @brief Write a fixed point integer exactly, e.g. 1e-7 degrees with 7 decimals, no terminator
+ *
+ * @param buf output, must have room for NUMFMT_MAX_LEN characters
+ * @param value value in units of 10^-decimals
+ * @param decimals number of decimals, 0..9
+ * @return int number of characters written
+ */
+int numfmt_scaled(char *buf, int32_t value, uint8_t decimals);
+
+/**
+ * @brief Write an ISO 8601 UTC time with milliseconds, e.g. 2024-05-01T12:34:56.789Z, no terminator
+ *
+ * @param buf output, must have room for NUMFMT_UTC_MAX_LEN characters
+ * @param t_ms UTC, milliseconds since 1970, not before 1970
+ * @return int number of characters written
+ */
+int numfmt_utc(char *buf, int64_t t_ms);
+
+/**
+ * @brief Days since 1970-01-01 of a civil date, the inverse of the date numfmt_utc writes
+ *
+ * @param y year, e.g. 2024
+ * @param m month, 1..12
+ * @param d day of the month, 1..31
+ * @return int32_t days, negative before 1970
+ */
+int32_t numfmt_days_from_civil(int32_t y, uint32_t m, uint32_t d);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,80 @@
+/* Versioned response cache for the webserver
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_system.h"
+#include "page_cache.h"
+
+void page_cache_init(page_cache_t *cache, char *buf, size_t cap)
+{
+    memset(cache, 0, sizeof(page_cache_t));
+    cache->buf = buf;
+    cache->body = buf;
+    cache->cap = cap;
+    cache->salt = esp_random();
+}
+
+static void set_etag(page_cache_t *cache)
+{
+    snprintf(cache->etag, sizeof(cache->etag), "\"%08x%08x\"", cache->salt, cache->version);
+}
+
+void page_cache_init_static(page_cache_t *cache, const char *body, size_t len)
+{
+    memset(cache, 0, sizeof(page_cache_t));
+    cache->body = body;
+    cache->len = len;
+    cache->salt = esp_random();
+    cache->valid = true;
+    set_etag(cache);
+}
+
+/**
+ * @brief Check whether the request's If-None-Match names the cached body
+ *
+ */
+static bool etag_matches(page_cache_t *cache, httpd_req_t *req)
+{
+    char tag[sizeof(cache->etag)];
+    size_t len = httpd_req_get_hdr_value_len(req, "If-None-Match");
+    if (len == 0 || len >= sizeof(tag)) {
+        return false;
+    }
+    if (httpd_req_get_hdr_value_str(req, "If-None-Match", tag, sizeof(tag)) != ESP_OK) {
+        return false;
+    }
+    return strcmp(tag, cache->etag) == 0;
+}
+
+esp_err_t page_cache_serve(page_cache_t *cache, httpd_req_t *req, uint32_t version, const char *content_type,
+                           page_render_fn_t render, void *ctx)
+{
+    if (render && (!cache->valid || cache->version != version)) {
+        cache->len = render(cache->buf, cache->cap, ctx);
+        cache->version = version;
+        cache->valid = true;
+        set_etag(cache);
+        cache->misses++;
+    } else {
+        cache->hits++;
+    }
+
+    httpd_resp_set_hdr(req, "ETag", cache->etag);
+    /* Let clients keep the body but make them revalidate every time */
+    httpd_resp_set_hdr(req, "Cache-Control", "no-cache");
+    if (etag_matches(cache, req)) {
+        cache->not_modified++;
+        cache->bytes_saved += cache->len;
+        httpd_resp_set_status(req, "304 Not Modified");
+        return httpd_resp_send(req, NULL, 0);
+    }
+    httpd_resp_set_type(req, content_type);
+    return httpd_resp_send(req, cache->body, cache->len);
+}
@@ -0,0 +1,91 @@
+/* Versioned response cache for the webserver
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include <esp_http_server.h>
+
+/**
+ * @brief Render a response body into buf
+ *
+ * @param buf output buffer
+ * @param cap size of the output buffer
+ * @param ctx user context
+ * @return size_t length of the body
+ */
+typedef size_t (*page_render_fn_t)(char *buf, size_t cap, void *ctx);
+
+/**
+ * @brief A response rendered once per content version and shared by every request
+ *
+ * Only used from the httpd task, which serves one request at a time, so it needs no locking.
+ */
+typedef struct {
+    char *buf;              /*!< Rendered body */
+    const char *body;       /*!< Body sent to clients, buf or a static body */
+    size_t cap;             /*!< Size of buf */
+    size_t len;             /*!< Length of the rendered body */
+    uint32_t version;       /*!< Content version the body was rendered for */
+    bool valid;             /*!< A body has been rendered */
+    char etag[20];          /*!< Quoted entity tag of the rendered body */
+    uint32_t salt;          /*!< Random per boot, keeps tags from a previous boot from matching */
+    uint32_t hits;          /*!< Requests served from the rendered body */
+    uint32_t misses;        /*!< Requests that had to render the body */
+    uint32_t not_modified;  /*!< Requests answered with 304 Not Modified */
+    uint32_t bytes_saved;   /*!< Body bytes not sent thanks to 304 responses */
+} page_cache_t;
+
+/**
+ * @brief Initialise a cache over a caller supplied buffer
+ *
+ * @param cache cache
+ * @param buf storage for the rendered body
+ * @param cap size of buf
+ */
+void page_cache_init(page_cache_t *cache, char *buf, size_t cap);
+
+/**
+ * @brief Initialise a cache holding a body that never changes, e.g. a page in flash
+ *
+ * The body is served in place, never copied or rendered. Pass a NULL render function to
+ * page_cache_serve for such a cache.
+ *
+ * @param cache cache
+ * @param body static body
+ * @param len length of body
+ */
+void page_cache_init_static(page_cache_t *cache, const char *body, size_t len);
+
+/**
+ * @brief Serve a request from the cache, rendering it first if the content version changed
+ *
+ * Sends an ETag with every body and answers a matching If-None-Match with 304 Not Modified.
+ *
+ * @param cache cache
+ * @param req request to answer
+ * @param version current version of the content, must change whenever the rendered body would
+ * @param content_type content type of the body
+ * @param render renders the body, NULL for a static cache
+ * @param ctx passed to render
+ * @return esp_err_t result of sending the response
+ */
+esp_err_t page_cache_serve(page_cache_t *cache, httpd_req_t *req, uint32_t version, const char *content_type,
+                           page_render_fn_t render, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
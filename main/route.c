@@ -0,0 +1,200 @@
+/* Waypoint route following
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <math.h>
+#include "nvs.h"
+#include "route.h"
+
+#define ROUTE_NVS_NAMESPACE "route"
+
+#define ROUTE_METRES_PER_E7 (GEO_METRES_PER_DEG / GEO_E7_PER_DEG)
+
+/**
+ * @brief Offset of a position from the start of a leg, in metres north and east
+ *
+ */
+static inline void leg_offset(const route_leg_t *leg, const geo_point_t *p, float *north, float *east)
+{
+    *north = (float)((int64_t)p->lat_e7 - leg->origin.lat_e7) * ROUTE_METRES_PER_E7;
+    *east = (float)((int64_t)p->lon_e7 - leg->origin.lon_e7) * ROUTE_METRES_PER_E7 * leg->cos_lat0;
+}
+
+void route_init(route_t *route, const route_config_t *config)
+{
+    memset(route, 0, sizeof(route_t));
+    route->config = *config;
+}
+
+esp_err_t route_load(route_t *route, const geo_point_t *waypoints, uint32_t count, bool loop)
+{
+    if (count > ROUTE_MAX_WAYPOINTS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    memcpy(route->waypoints, waypoints, count * sizeof(geo_point_t));
+    route->count = count;
+    route->loop = loop && count > 1;
+    route->leg_count = count < 2 ? 0 : (route->loop ? count : count - 1);
+    for (uint32_t i = 0; i < route->leg_count; i++) {
+        route_leg_t *leg = &route->legs[i];
+        const geo_point_t *end = &waypoints[(i + 1) % count];
+        float n, e;
+        leg->origin = waypoints[i];
+        leg->cos_lat0 = cosf((float)leg->origin.lat_e7 / GEO_E7_PER_DEG * GEO_DEG_TO_RAD);
+        leg_offset(leg, end, &n, &e);
+        leg->length = sqrtf(n * n + e * e);
+        if (leg->length > 0.01f) {
+            leg->un = n / leg->length;
+            leg->ue = e / leg->length;
+        } else {
+            /* Repeated waypoint, any direction will do and it is passed at once */
+            leg->un = 1.0f;
+            leg->ue = 0.0f;
+        }
+        leg->bearing_deg = geo_bearing_deg(leg->un, leg->ue);
+    }
+    route->leg = 0;
+    route->approaching = count > 0;
+    route->finished = false;
+    return ESP_OK;
+}
+
+/**
+ * @brief Steer straight for one waypoint
+ *
+ */
+static void head_for(const route_t *route, uint32_t index, const geo_point_t *position, route_status_t *status)
+{
+    float n, e;
+    geo_offset_e7(&route->waypoints[index], position, &n, &e);
+    status->target = route->waypoints[index];
+    status->cross_track_m = 0;
+    status->along_track_m = 0;
+    status->to_go_m = sqrtf(n * n + e * e);
+    status->waypoint = index;
+}
+
+/**
+ * @brief Position of the boat in the frame of the active leg
+ *
+ */
+static void leg_position(const route_leg_t *leg, const geo_point_t *position, float *along, float *cross)
+{
+    float n, e;
+    leg_offset(leg, position, &n, &e);
+    *along = n * leg->un + e * leg->ue;
+    *cross = e * leg->un - n * leg->ue;
+}
+
+/**
+ * @brief Steer for a point lookahead_m further along the active leg, never past its end
+ *
+ */
+static void follow_leg(const route_t *route, const geo_point_t *position, route_status_t *status)
+{
+    const route_leg_t *leg = &route->legs[route->leg];
+    float along, cross, carrot;
+    leg_position(leg, position, &along, &cross);
+    carrot = (along > 0 ? along : 0) + route->config.lookahead_m;
+    if (carrot > leg->length) {
+        carrot = leg->length;
+    }
+    status->target.lat_e7 = leg->origin.lat_e7 + (int32_t)lroundf(leg->un * carrot / ROUTE_METRES_PER_E7);
+    status->target.lon_e7 = leg->origin.lon_e7 + (int32_t)lroundf(leg->ue * carrot / (ROUTE_METRES_PER_E7 * leg->cos_lat0));
+    status->cross_track_m = cross;
+    status->along_track_m = along;
+    status->to_go_m = leg->length - along;
+    status->waypoint = (route->leg + 1) % route->count;
+}
+
+void route_update(route_t *route, const geo_point_t *position, route_status_t *status)
+{
+    status->arrived = false;
+    if (route->approaching) {
+        head_for(route, 0, position, status);
+        if (status->to_go_m > route->config.arrival_radius_m) {
+            return;
+        }
+        status->arrived = true;
+        route->approaching = false;
+        route->finished = route->leg_count == 0;
+    }
+    if (route->finished) {
+        /* Station keeping on the last waypoint */
+        head_for(route, route->count - 1, position, status);
+        return;
+    }
+
+    const route_leg_t *leg = &route->legs[route->leg];
+    float along, cross, dn, de;
+    leg_position(leg, position, &along, &cross);
+    leg_offset(leg, position, &dn, &de);
+    dn -= leg->un * leg->length;
+    de -= leg->ue * leg->length;
+    /* Inside the arrival circle, or past the line square to the leg through its end */
+    if (along >= leg->length || dn * dn + de * de <= route->config.arrival_radius_m * route->config.arrival_radius_m) {
+        status->arrived = true;
+        route->leg++;
+        if (route->leg == route->leg_count) {
+            if (route->loop) {
+                route->leg = 0;
+            } else {
+                route->leg = route->leg_count - 1;
+                route->finished = true;
+                head_for(route, route->count - 1, position, status);
+                return;
+            }
+        }
+    }
+    follow_leg(route, position, status);
+}
+
+esp_err_t route_save(const geo_point_t *waypoints, uint32_t count, bool loop)
+{
+    nvs_handle_t handle;
+    esp_err_t err = nvs_open(ROUTE_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (count == 0) {
+        err = nvs_erase_key(handle, "waypoints");
+        if (err == ESP_ERR_NVS_NOT_FOUND) {
+            err = ESP_OK;
+        }
+    } else {
+        err = nvs_set_blob(handle, "waypoints", waypoints, count * sizeof(geo_point_t));
+        if (err == ESP_OK) {
+            err = nvs_set_u32(handle, "loop", loop);
+        }
+    }
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+esp_err_t route_restore(geo_point_t *waypoints, uint32_t *count, bool *loop)
+{
+    nvs_handle_t handle;
+    size_t len = ROUTE_MAX_WAYPOINTS * sizeof(geo_point_t);
+    uint32_t loop_flag = 0;
+    esp_err_t err = nvs_open(ROUTE_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_get_blob(handle, "waypoints", waypoints, &len);
+    if (err == ESP_OK) {
+        nvs_get_u32(handle, "loop", &loop_flag);
+        *count = len / sizeof(geo_point_t);
+        *loop = loop_flag != 0;
+    }
+    nvs_close(handle);
+    return err;
+}
@@ -0,0 +1,143 @@
+/* Waypoint route following
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "geo.h"
+
+/**
+ * @brief Most waypoints a route can hold
+ *
+ */
+#define ROUTE_MAX_WAYPOINTS (32)
+
+/**
+ * @brief Route following configuration
+ *
+ */
+typedef struct {
+    float arrival_radius_m; /*!< A waypoint is reached inside this distance */
+    float lookahead_m;      /*!< Distance along the leg ahead of the boat that is steered for */
+} route_config_t;
+
+/**
+ * @brief Default route following configuration
+ *
+ */
+#define ROUTE_CONFIG_DEFAULT()          \
+    {                                   \
+        .arrival_radius_m = 5.0f,       \
+        .lookahead_m = 10.0f,           \
+    }
+
+/**
+ * @brief One leg, precomputed when the route is loaded
+ *
+ * Each leg has its own local frame around its start waypoint, so the per cycle work is one projection
+ * and two dot products whatever the length of the route. Offsets are taken from the waypoint in 1e-7
+ * degrees, so they keep centimetres wherever the route is.
+ */
+typedef struct {
+    geo_point_t origin; /*!< Start waypoint */
+    float cos_lat0;     /*!< cos of the origin latitude, scales longitude to metres east */
+    float un;           /*!< North component of the unit vector along the leg */
+    float ue;           /*!< East component of the unit vector along the leg */
+    float length;       /*!< Length of the leg (metres) */
+    float bearing_deg;  /*!< Bearing of the leg (degrees) */
+} route_leg_t;
+
+/**
+ * @brief Route following state
+ *
+ */
+typedef struct {
+    route_config_t config;                          /*!< Configuration */
+    geo_point_t waypoints[ROUTE_MAX_WAYPOINTS];     /*!< Waypoints in order */
+    route_leg_t legs[ROUTE_MAX_WAYPOINTS];          /*!< Leg i runs from waypoint i to waypoint i + 1 (or 0 when looping) */
+    uint32_t count;                                 /*!< Number of waypoints, 0 when no route is loaded */
+    uint32_t leg_count;                             /*!< Number of legs */
+    uint32_t leg;                                   /*!< Active leg */
+    bool loop;                                      /*!< Return to the first waypoint after the last */
+    bool approaching;                               /*!< Heading straight for the first waypoint */
+    bool finished;                                  /*!< Holding on the last waypoint */
+} route_t;
+
+/**
+ * @brief Result of one route update
+ *
+ */
+typedef struct {
+    geo_point_t target;     /*!< Point to steer for */
+    float cross_track_m;    /*!< Distance off the leg, positive right of track */
+    float along_track_m;    /*!< Distance along the leg from its start */
+    float to_go_m;          /*!< Distance along the leg still to go */
+    uint32_t waypoint;      /*!< Waypoint being headed for */
+    bool arrived;           /*!< A waypoint was reached this update */
+} route_status_t;
+
+/**
+ * @brief Initialise an empty route
+ *
+ * @param route route
+ * @param config configuration
+ */
+void route_init(route_t *route, const route_config_t *config);
+
+/**
+ * @brief Load waypoints and precompute the legs
+ *
+ * Following starts by heading straight for the first waypoint.
+ *
+ * @param route route
+ * @param waypoints waypoints in order
+ * @param count number of waypoints, 0 clears the route
+ * @param loop return to the first waypoint after the last
+ * @return esp_err_t ESP_OK, or ESP_ERR_INVALID_ARG if count is more than ROUTE_MAX_WAYPOINTS
+ */
+esp_err_t route_load(route_t *route, const geo_point_t *waypoints, uint32_t count, bool loop);
+
+/**
+ * @brief Advance along the route from the current position, constant time
+ *
+ * @param route route with at least one waypoint
+ * @param position current position
+ * @param status filled with the point to steer for and the track errors
+ */
+void route_update(route_t *route, const geo_point_t *position, route_status_t *status);
+
+/**
+ * @brief Store waypoints in NVS
+ *
+ * @param waypoints waypoints in order
+ * @param count number of waypoints, 0 erases the stored route
+ * @param loop return to the first waypoint after the last
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t route_save(const geo_point_t *waypoints, uint32_t count, bool loop);
+
+/**
+ * @brief Read waypoints stored by route_save
+ *
+ * @param waypoints filled with up to ROUTE_MAX_WAYPOINTS waypoints
+ * @param count number of waypoints read
+ * @param loop whether the route loops
+ * @return esp_err_t ESP_OK, ESP_ERR_NVS_NOT_FOUND if no route is stored
+ */
+esp_err_t route_restore(geo_point_t *waypoints, uint32_t *count, bool *loop);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,166 @@
+/* Persistent settings with coalesced writes
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "nvs.h"
+#include "settings.h"
+
+static const char *SETTINGS_TAG = "settings";
+
+#define SETTINGS_NVS_NAMESPACE "settings"
+#define SETTINGS_NVS_KEY "settings"
+#define SETTINGS_VERSION (1)
+#define SETTINGS_TASK_STACK_SIZE (3072)
+#define SETTINGS_TASK_PRIORITY (1)
+
+/**
+ * @brief Layout of the NVS blob, a different version or size is ignored
+ *
+ */
+typedef struct {
+    uint32_t version;       /*!< SETTINGS_VERSION */
+    settings_t settings;    /*!< Settings */
+} settings_blob_t;
+
+static settings_config_t settings_config;
+static settings_t current;          /*!< Latest settings, guarded by current_lock */
+static settings_t saved;            /*!< Settings as last written, writer task only */
+static portMUX_TYPE current_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t writer_task_hdl;
+static uint32_t write_count;
+
+static esp_err_t settings_write(const settings_t *settings)
+{
+    nvs_handle_t handle;
+    settings_blob_t blob = { .version = SETTINGS_VERSION, .settings = *settings };
+    esp_err_t err = nvs_open(SETTINGS_NVS_NAMESPACE, NVS_READWRITE, &handle);
+    if (err != ESP_OK) {
+        return err;
+    }
+    err = nvs_set_blob(handle, SETTINGS_NVS_KEY, &blob, sizeof(blob));
+    if (err == ESP_OK) {
+        err = nvs_commit(handle);
+    }
+    nvs_close(handle);
+    return err;
+}
+
+static void settings_task_entry(void *arg)
+{
+    const TickType_t quiet = pdMS_TO_TICKS(settings_config.quiet_ms);
+    settings_t copy;
+    while (1) {
+        /* Sleep until the first change, then until changes stop or the longest delay has passed */
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t deadline_us = esp_timer_get_time() + (int64_t)settings_config.max_delay_ms * 1000;
+        while (ulTaskNotifyTake(pdTRUE, quiet) > 0 && esp_timer_get_time() < deadline_us) {
+        }
+        portENTER_CRITICAL(&current_lock);
+        copy = current;
+        portEXIT_CRITICAL(&current_lock);
+        /* Changes that were undone before the write cost nothing */
+        if (memcmp(&copy, &saved, sizeof(copy)) == 0) {
+            continue;
+        }
+        esp_err_t err = settings_write(&copy);
+        if (err == ESP_OK) {
+            saved = copy;
+            write_count++;
+        } else {
+            ESP_LOGW(SETTINGS_TAG, "write failed: %s", esp_err_to_name(err));
+        }
+    }
+}
+
+/* Called from the setters once current has changed */
+static void settings_changed(void)
+{
+    if (writer_task_hdl) {
+        xTaskNotifyGive(writer_task_hdl);
+    }
+}
+
+esp_err_t settings_init(const settings_config_t *config, int32_t default_gain)
+{
+    nvs_handle_t handle;
+    settings_blob_t blob;
+    size_t len = sizeof(blob);
+    esp_err_t err;
+
+    settings_config = *config;
+    /* Zeroed so padding compares equal in the writer task */
+    memset(&current, 0, sizeof(current));
+    current.gain = default_gain;
+    err = nvs_open(SETTINGS_NVS_NAMESPACE, NVS_READONLY, &handle);
+    if (err == ESP_OK) {
+        err = nvs_get_blob(handle, SETTINGS_NVS_KEY, &blob, &len);
+        nvs_close(handle);
+    }
+    if (err == ESP_OK && (len != sizeof(blob) || blob.version != SETTINGS_VERSION)) {
+        ESP_LOGW(SETTINGS_TAG, "stored settings are from another version, using defaults");
+        err = ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (err == ESP_OK) {
+        current = blob.settings;
+    } else {
+        err = ESP_ERR_NVS_NOT_FOUND;
+    }
+    saved = current;
+
+    if (xTaskCreate(settings_task_entry, "settings", SETTINGS_TASK_STACK_SIZE, NULL,
+                    SETTINGS_TASK_PRIORITY, &writer_task_hdl) != pdTRUE) {
+        return ESP_ERR_NO_MEM;
+    }
+    return err;
+}
+
+void settings_get(settings_t *settings)
+{
+    portENTER_CRITICAL(&current_lock);
+    *settings = current;
+    portEXIT_CRITICAL(&current_lock);
+}
+
+void settings_set_target(const geo_point_t *target)
+{
+    portENTER_CRITICAL(&current_lock);
+    current.target_valid = true;
+    current.target = *target;
+    portEXIT_CRITICAL(&current_lock);
+    settings_changed();
+}
+
+void settings_set_gain(int32_t gain)
+{
+    portENTER_CRITICAL(&current_lock);
+    current.gain = gain;
+    portEXIT_CRITICAL(&current_lock);
+    settings_changed();
+}
+
+void settings_set_mag_calibration(int32_t x_max, int32_t x_min, int32_t y_max, int32_t y_min)
+{
+    portENTER_CRITICAL(&current_lock);
+    current.mag_valid = true;
+    current.mag_x_max = x_max;
+    current.mag_x_min = x_min;
+    current.mag_y_max = y_max;
+    current.mag_y_min = y_min;
+    portEXIT_CRITICAL(&current_lock);
+    settings_changed();
+}
+
+uint32_t settings_get_write_count(void)
+{
+    return write_count;
+}
@@ -0,0 +1,111 @@
+/* Persistent settings with coalesced writes
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "geo.h"
+
+/**
+ * @brief Settings kept across reboots
+ *
+ */
+typedef struct {
+    bool target_valid;      /*!< A target has been set */
+    geo_point_t target;     /*!< Station keeping target */
+    int32_t gain;           /*!< Motor gain, % */
+    bool mag_valid;         /*!< The magnetometer limits have been seen to move */
+    int32_t mag_x_max;      /*!< Magnetometer calibration, largest x reading */
+    int32_t mag_x_min;      /*!< Magnetometer calibration, smallest x reading */
+    int32_t mag_y_max;      /*!< Magnetometer calibration, largest y reading */
+    int32_t mag_y_min;      /*!< Magnetometer calibration, smallest y reading */
+} settings_t;
+
+/**
+ * @brief Settings writer configuration
+ *
+ */
+typedef struct {
+    uint32_t quiet_ms;      /*!< Write once there have been no changes for this long */
+    uint32_t max_delay_ms;  /*!< Write at the latest this long after the first unsaved change */
+} settings_config_t;
+
+/**
+ * @brief Default settings writer configuration
+ *
+ */
+#define SETTINGS_CONFIG_DEFAULT()                       \
+    {                                                   \
+        .quiet_ms = CONFIG_SETTINGS_QUIET_MS,           \
+        .max_delay_ms = CONFIG_SETTINGS_MAX_DELAY_MS,   \
+    }
+
+/**
+ * @brief Read the stored settings and start the writer task
+ *
+ * NVS must already be initialised. When nothing valid is stored the settings start out as defaults,
+ * with no target, the given gain and no calibration.
+ *
+ * @param config writer configuration
+ * @param default_gain gain used when none is stored
+ * @return esp_err_t ESP_OK if settings were restored, ESP_ERR_NVS_NOT_FOUND if defaults are used,
+ *         ESP_ERR_NO_MEM if the writer task could not be started
+ */
+esp_err_t settings_init(const settings_config_t *config, int32_t default_gain);
+
+/**
+ * @brief Get a copy of the current settings, including changes not yet written
+ *
+ * @param settings filled with the settings
+ */
+void settings_get(settings_t *settings);
+
+/**
+ * @brief Change the target
+ *
+ * Never blocks. The change is kept in RAM and written together with any other changes once they stop
+ * coming, so a burst of nudges costs one flash write.
+ *
+ * @param target target
+ */
+void settings_set_target(const geo_point_t *target);
+
+/**
+ * @brief Change the motor gain, see settings_set_target
+ *
+ * @param gain gain, %
+ */
+void settings_set_gain(int32_t gain);
+
+/**
+ * @brief Change the magnetometer calibration, see settings_set_target
+ *
+ * @param x_max largest x reading
+ * @param x_min smallest x reading
+ * @param y_max largest y reading
+ * @param y_min smallest y reading
+ */
+void settings_set_mag_calibration(int32_t x_max, int32_t x_min, int32_t y_max, int32_t y_min);
+
+/**
+ * @brief Count of flash writes made since boot
+ *
+ * @return uint32_t writes
+ */
+uint32_t settings_get_write_count(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,105 @@
+/* Station keeping controller
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <math.h>
+#include "station_controller.h"
+#include "geo.h"
+
+static inline float clampf(float v, float lo, float hi)
+{
+    return v < lo ? lo : (v > hi ? hi : v);
+}
+
+/**
+ * @brief Move a duty towards its demand, no faster than the slew limit
+ *
+ */
+static inline float slew(float current, float demand, float max_step)
+{
+    return current + clampf(demand - current, -max_step, max_step);
+}
+
+void station_controller_init(station_controller_t *ctl, const station_controller_config_t *config)
+{
+    memset(ctl, 0, sizeof(station_controller_t));
+    ctl->config = *config;
+}
+
+void station_controller_reset(station_controller_t *ctl)
+{
+    ctl->integral = 0;
+    ctl->range_rate = 0;
+    ctl->primed = false;
+    ctl->holding = false;
+}
+
+void station_controller_retarget(station_controller_t *ctl)
+{
+    ctl->primed = false;
+    ctl->holding = false;
+}
+
+void station_controller_update(station_controller_t *ctl, const station_controller_input_t *in,
+                               station_controller_output_t *out)
+{
+    const station_controller_config_t *cfg = &ctl->config;
+    float heading_rate = 0;
+    float surge, turn, port, stbd;
+
+    /* Derivatives on measurement, the first cycle after a reset or retarget only primes the history */
+    if (ctl->primed && in->dt > 0) {
+        float rate = (in->range_m - ctl->prev_range) / in->dt;
+        ctl->range_rate += cfg->d_filter * (rate - ctl->range_rate);
+        heading_rate = geo_wrap180(in->heading_deg - ctl->prev_heading) / in->dt;
+    }
+    ctl->prev_range = in->range_m;
+    ctl->prev_heading = in->heading_deg;
+    ctl->primed = true;
+
+    /* Deadband with hysteresis, motors idle near the target until the boat drifts clear of it */
+    if (ctl->holding) {
+        ctl->holding = in->range_m < cfg->deadband_exit_m;
+    } else {
+        ctl->holding = in->range_m < cfg->deadband_m;
+    }
+
+    if (ctl->holding) {
+        /* The range error never goes negative outside the deadband, so the integrator only unwinds here */
+        ctl->integral -= ctl->integral * clampf(cfg->i_leak * in->dt, 0, 1);
+        port = 0;
+        stbd = 0;
+    } else {
+        /* Surge PID on the range outside the deadband */
+        float error = in->range_m - cfg->deadband_m;
+        float p = cfg->kp * error;
+        float d = cfg->kd * ctl->range_rate;
+        float ff = cfg->kff * in->drift_away_mps;
+        float unsat = p + ctl->integral + d + ff;
+        /* Anti-windup: only integrate while the output has room or the error would unwind it */
+        if ((unsat < cfg->max_duty || error < 0) && (unsat > 0 || error > 0)) {
+            ctl->integral = clampf(ctl->integral + cfg->ki * error * in->dt, 0, cfg->i_limit);
+        }
+        surge = clampf(p + ctl->integral + d + ff, 0, cfg->max_duty);
+        /* Only push towards the target when roughly facing it, prevents driving past it while turning */
+        surge *= fmaxf(0, cosf(in->bearing_error_deg * GEO_DEG_TO_RAD));
+
+        /* Differential turn towards the target, derivative on the measured heading damps spinning */
+        turn = cfg->heading_kp * in->bearing_error_deg - cfg->heading_kd * heading_rate;
+        turn = clampf(turn, -cfg->turn_limit, cfg->turn_limit);
+
+        port = clampf((surge + turn) * in->gain / 100.0f, 0, cfg->max_duty);
+        stbd = clampf((surge - turn) * in->gain / 100.0f, 0, cfg->max_duty);
+    }
+
+    ctl->out.port = slew(ctl->out.port, port, cfg->slew_rate * in->dt);
+    ctl->out.stbd = slew(ctl->out.stbd, stbd, cfg->slew_rate * in->dt);
+    ctl->out.holding = ctl->holding;
+    *out = ctl->out;
+}
@@ -0,0 +1,137 @@
+/* Station keeping controller
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/**
+ * @brief Tuning of the station keeping controller
+ *
+ */
+typedef struct {
+    float kp;               /*!< Surge proportional gain, % duty per metre outside the deadband */
+    float ki;               /*!< Surge integral gain, % duty per metre second */
+    float kd;               /*!< Surge derivative gain, % duty per m/s of range rate */
+    float i_limit;          /*!< Largest contribution of the integrator, % duty */
+    float i_leak;           /*!< Fraction of the integrator bled off per second while holding in the deadband */
+    float d_filter;         /*!< Low pass coefficient of the range rate (0..1, 1 = unfiltered) */
+    float kff;              /*!< Surge feed-forward, % duty per m/s of drift away from the target */
+    float heading_kp;       /*!< Turn proportional gain, % duty differential per degree of bearing error */
+    float heading_kd;       /*!< Turn derivative gain, % duty differential per deg/s of heading rate */
+    float turn_limit;       /*!< Largest duty differential between the motors, limits spinning */
+    float deadband_m;       /*!< Motors are idle while the range stays inside this radius */
+    float deadband_exit_m;  /*!< Range at which the motors engage again, must be above deadband_m */
+    float slew_rate;        /*!< Largest change of each duty, % per second */
+    float max_duty;         /*!< Upper limit of each duty, % */
+} station_controller_config_t;
+
+/**
+ * @brief Default tuning of the station keeping controller
+ *
+ */
+#define STATION_CONTROLLER_CONFIG_DEFAULT() \
+    {                                       \
+        .kp = 15.0f,                        \
+        .ki = 0.5f,                         \
+        .kd = 20.0f,                        \
+        .i_limit = 30.0f,                   \
+        .i_leak = 0.05f,                    \
+        .d_filter = 0.3f,                   \
+        .kff = 40.0f,                       \
+        .heading_kp = 0.5f,                 \
+        .heading_kd = 0.1f,                 \
+        .turn_limit = 40.0f,                \
+        .deadband_m = 2.0f,                 \
+        .deadband_exit_m = 3.0f,            \
+        .slew_rate = 50.0f,                 \
+        .max_duty = 100.0f                  \
+    }
+
+/**
+ * @brief Controller input for one cycle
+ *
+ */
+typedef struct {
+    float range_m;           /*!< Distance to the target (metres) */
+    float bearing_error_deg; /*!< Bearing to target minus heading, -180..180, +ve is to starboard */
+    float heading_deg;       /*!< Measured heading (degrees), used for the turn derivative */
+    float drift_away_mps;    /*!< Estimated current/wind drift away from the target (m/s), 0 if unknown */
+    int gain;                /*!< Overall motor gain, 0..100 % */
+    float dt;                /*!< Time since the previous update (seconds) */
+} station_controller_input_t;
+
+/**
+ * @brief Controller output for one cycle
+ *
+ */
+typedef struct {
+    float port;    /*!< Port motor duty, % */
+    float stbd;    /*!< Starboard motor duty, % */
+    bool holding;  /*!< Boat is inside the deadband and the motors are idle */
+} station_controller_output_t;
+
+/**
+ * @brief Station keeping controller state
+ *
+ */
+typedef struct {
+    station_controller_config_t config; /*!< Tuning */
+    float integral;                     /*!< Integrator contribution, % duty */
+    float prev_range;                   /*!< Range of the previous update */
+    float range_rate;                   /*!< Filtered range rate (m/s) */
+    float prev_heading;                 /*!< Heading of the previous update */
+    bool primed;                        /*!< Previous values are valid */
+    bool holding;                       /*!< Deadband state */
+    station_controller_output_t out;    /*!< Last output, for the slew limiter */
+} station_controller_t;
+
+/**
+ * @brief Initialise the controller with the given tuning
+ *
+ * @param ctl controller
+ * @param config tuning
+ */
+void station_controller_init(station_controller_t *ctl, const station_controller_config_t *config);
+
+/**
+ * @brief Clear integrator and derivative history, motors ramp from their current duty
+ *
+ * @param ctl controller
+ */
+void station_controller_reset(station_controller_t *ctl);
+
+/**
+ * @brief Notify the controller that the target moved
+ *
+ * The derivative acts on the measured position, so a step of the target must not kick it. This re-bases the
+ * range history on the next update.
+ *
+ * @param ctl controller
+ */
+void station_controller_retarget(station_controller_t *ctl);
+
+/**
+ * @brief Run one controller cycle
+ *
+ * @param ctl controller
+ * @param in measurements of this cycle
+ * @param out motor duties to apply
+ */
+void station_controller_update(station_controller_t *ctl, const station_controller_input_t *in,
+                               station_controller_output_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,223 @@
+/* JSON telemetry API and WebSocket push
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_log.h"
+#include "telemetry.h"
+#include "page_cache.h"
+#include "numfmt.h"
+
+static const char *TELEMETRY_TAG = "telemetry";
+
+/* Most clients the server can hold, matches the httpd default max_open_sockets */
+#define TELEMETRY_MAX_CLIENTS (7)
+/* Longest frame read from a client, anything longer closes its connection */
+#define TELEMETRY_WS_RX_MAX (128)
+
+static httpd_handle_t telemetry_server;
+static telemetry_state_t latest;                 /*!< Last published state, guarded by latest_lock */
+static portMUX_TYPE latest_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool broadcast_pending;          /*!< A broadcast is queued on the httpd task */
+
+/* Only used on the httpd task */
+static char state_buf[TELEMETRY_JSON_MAX];
+static page_cache_t state_cache;
+
+/**
+ * @brief Append "key":value with the given number of decimals
+ *
+ */
+static size_t put_field(char *buf, size_t n, const char *key, float value, uint8_t decimals)
+{
+    buf[n++] = '"';
+    size_t klen = strlen(key);
+    memcpy(buf + n, key, klen);
+    n += klen;
+    buf[n++] = '"';
+    buf[n++] = ':';
+    if (decimals) {
+        n += numfmt_fixed(buf + n, value, decimals);
+    } else {
+        n += numfmt_int(buf + n, (int32_t)value);
+    }
+    buf[n++] = ',';
+    return n;
+}
+
+/**
+ * @brief Append "key":value for a 1e-7 degree coordinate, every digit kept
+ *
+ */
+static size_t put_e7(char *buf, size_t n, const char *key, int32_t value)
+{
+    buf[n++] = '"';
+    size_t klen = strlen(key);
+    memcpy(buf + n, key, klen);
+    n += klen;
+    buf[n++] = '"';
+    buf[n++] = ':';
+    n += numfmt_scaled(buf + n, value, 7);
+    buf[n++] = ',';
+    return n;
+}
+
+size_t telemetry_to_json(const telemetry_state_t *state, char *buf, size_t cap)
+{
+    size_t n = 0;
+    if (cap < TELEMETRY_JSON_MAX) {
+        return 0;
+    }
+    buf[n++] = '{';
+    n = put_e7(buf, n, "lat", state->position.lat_e7);
+    n = put_e7(buf, n, "lon", state->position.lon_e7);
+    n = put_e7(buf, n, "tlat", state->target.lat_e7);
+    n = put_e7(buf, n, "tlon", state->target.lon_e7);
+    n = put_field(buf, n, "range", state->range, 2);
+    n = put_field(buf, n, "brg", state->bearing, 1);
+    n = put_field(buf, n, "hdg", state->heading, 1);
+    n = put_field(buf, n, "port", state->port, 1);
+    n = put_field(buf, n, "stbd", state->stbd, 1);
+    n = put_field(buf, n, "gain", state->gain, 0);
+    n = put_field(buf, n, "wp", state->waypoint, 0);
+    n = put_field(buf, n, "xte", state->cross_track, 1);
+    n = put_field(buf, n, "alarm", state->fence_alarm, 0);
+    buf[n - 1] = '}'; /* replaces the trailing comma */
+    return n;
+}
+
+/**
+ * @brief Take a consistent copy of the latest state
+ *
+ */
+static void snapshot(telemetry_state_t *state)
+{
+    portENTER_CRITICAL(&latest_lock);
+    *state = latest;
+    portEXIT_CRITICAL(&latest_lock);
+}
+
+static size_t render_state(char *buf, size_t cap, void *ctx)
+{
+    return telemetry_to_json((const telemetry_state_t *)ctx, buf, cap);
+}
+
+/**
+ * @brief GET /api/state, rendered once per state version and shared by all clients
+ *
+ */
+static esp_err_t state_handler(httpd_req_t *req)
+{
+    telemetry_state_t state;
+    snapshot(&state);
+    return page_cache_serve(&state_cache, req, state.version, "application/json", render_state, &state);
+}
+
+/**
+ * @brief /ws, accepts the handshake and discards anything clients send
+ *
+ */
+static esp_err_t ws_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        ESP_LOGI(TELEMETRY_TAG, "websocket client connected");
+        return ESP_OK;
+    }
+    /* Only used on the httpd task */
+    static uint8_t rx_buf[TELEMETRY_WS_RX_MAX];
+    httpd_ws_frame_t frame = { 0 };
+    /* The header first, the payload has to be read off the socket too or it is taken as the next frame */
+    esp_err_t err = httpd_ws_recv_frame(req, &frame, 0);
+    if (err != ESP_OK) {
+        return err;
+    }
+    if (frame.len > sizeof(rx_buf)) {
+        /* Clients have nothing to say, a large frame is not worth reading: the failure closes the connection */
+        ESP_LOGW(TELEMETRY_TAG, "websocket frame of %u bytes, closing", (unsigned)frame.len);
+        return ESP_FAIL;
+    }
+    if (frame.len == 0) {
+        return ESP_OK;
+    }
+    /* Read and dropped, the payload is not used */
+    frame.payload = rx_buf;
+    return httpd_ws_recv_frame(req, &frame, frame.len);
+}
+
+/**
+ * @brief Broadcast the latest state to every WebSocket client, runs on the httpd task
+ *
+ */
+static void broadcast_work(void *arg)
+{
+    static char ws_buf[TELEMETRY_JSON_MAX];
+    telemetry_state_t state;
+    size_t nfds = TELEMETRY_MAX_CLIENTS;
+    int fds[TELEMETRY_MAX_CLIENTS];
+
+    broadcast_pending = false;
+    snapshot(&state);
+    /* One serialisation per update regardless of the number of clients */
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = HTTPD_WS_TYPE_TEXT,
+        .payload = (uint8_t *)ws_buf,
+        .len = telemetry_to_json(&state, ws_buf, sizeof(ws_buf))
+    };
+    if (httpd_get_client_list(telemetry_server, &nfds, fds) != ESP_OK) {
+        return;
+    }
+    for (size_t i = 0; i < nfds; i++) {
+        if (httpd_ws_get_fd_info(telemetry_server, fds[i]) == HTTPD_WS_CLIENT_WEBSOCKET) {
+            httpd_ws_send_frame_async(telemetry_server, fds[i], &frame);
+        }
+    }
+}
+
+void telemetry_publish(const telemetry_state_t *state)
+{
+    portENTER_CRITICAL(&latest_lock);
+    latest = *state;
+    portEXIT_CRITICAL(&latest_lock);
+    /* Coalesce: at most one broadcast queued, it always sends the newest state */
+    if (telemetry_server && !broadcast_pending) {
+        broadcast_pending = true;
+        if (httpd_queue_work(telemetry_server, broadcast_work, NULL) != ESP_OK) {
+            broadcast_pending = false;
+        }
+    }
+}
+
+esp_err_t telemetry_init(httpd_handle_t server)
+{
+    static const httpd_uri_t uri_state = {
+        .uri = "/api/state",
+        .method = HTTP_GET,
+        .handler = state_handler,
+        .user_ctx = NULL
+    };
+    static const httpd_uri_t uri_ws = {
+        .uri = "/ws",
+        .method = HTTP_GET,
+        .handler = ws_handler,
+        .user_ctx = NULL,
+        .is_websocket = true
+    };
+    esp_err_t err;
+
+    page_cache_init(&state_cache, state_buf, sizeof(state_buf));
+    err = httpd_register_uri_handler(server, &uri_state);
+    if (err == ESP_OK) {
+        err = httpd_register_uri_handler(server, &uri_ws);
+    }
+    if (err == ESP_OK) {
+        telemetry_server = server;
+    }
+    return err;
+}
@@ -0,0 +1,75 @@
+/* JSON telemetry API and WebSocket push
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "geo.h"
+#include <esp_http_server.h>
+
+/**
+ * @brief Snapshot of the station keeping state published to clients
+ *
+ */
+typedef struct {
+    uint32_t version;       /*!< Moves on with each new fix, setpoint or alarm, the ETag of /api/state follows it */
+    geo_point_t position;   /*!< Last fix */
+    geo_point_t target;     /*!< Target, or the point steered for on a route leg */
+    float range;        /*!< Estimated distance to the target (metres) */
+    float bearing;      /*!< Bearing to the target (degrees) */
+    float heading;      /*!< Filtered heading (degrees) */
+    float port;         /*!< Port motor duty, % */
+    float stbd;         /*!< Starboard motor duty, % */
+    int gain;           /*!< Overall motor gain, % */
+    int waypoint;       /*!< Route waypoint being headed for, -1 without a route */
+    float cross_track;  /*!< Distance off the active route leg, positive right of track (metres) */
+    bool fence_alarm;   /*!< Over a geofence boundary */
+} telemetry_state_t;
+
+/**
+ * @brief Register the /api/state and /ws handlers on a running server
+ *
+ * @param server webserver handle
+ * @return esp_err_t ESP_OK on success
+ */
+esp_err_t telemetry_init(httpd_handle_t server);
+
+/**
+ * @brief Publish a new state, called from the control task
+ *
+ * Copies the state and schedules one broadcast on the httpd task. The state is serialised once per
+ * broadcast however many WebSocket clients are connected. Never blocks. Only publish a state whose
+ * version differs from the last one, a state with the same version is taken to be unchanged.
+ *
+ * @param state new state
+ */
+void telemetry_publish(const telemetry_state_t *state);
+
+/**
+ * @brief Serialise a state as a JSON object
+ *
+ * @param state state
+ * @param buf output buffer
+ * @param cap size of the output buffer, TELEMETRY_JSON_MAX is always enough
+ * @return size_t length of the JSON text
+ */
+size_t telemetry_to_json(const telemetry_state_t *state, char *buf, size_t cap);
+
+#define TELEMETRY_JSON_MAX (384)
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,183 @@
+/* Track log block layout and point coding
+
+   The on-flash format of the track log, kept free of ESP-IDF headers so the host tools read partition
+   dumps with the same code the firmware writes them with.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define TRACK_LOG_BLOCK_SIZE (512)      /*!< Bytes written to flash at once, two flash pages */
+#define TRACK_LOG_SECTOR_SIZE (4096)    /*!< Erase unit, the log uses whole sectors */
+#define TRACK_LOG_BLOCKS_PER_SECTOR (TRACK_LOG_SECTOR_SIZE / TRACK_LOG_BLOCK_SIZE)
+#define TRACK_LOG_MAGIC (0x4b435254)    /*!< "TRCK" */
+#define TRACK_LOG_POINT_MAX (24)        /*!< Longest encoded point: 5 + 5 + 5 + 3 + 3 + 3 */
+
+/**
+ * @brief One logged point
+ *
+ */
+typedef struct {
+    int64_t t_ms;       /*!< UTC, milliseconds since 1970 */
+    int32_t lat_e7;     /*!< Latitude, 1e-7 degrees */
+    int32_t lon_e7;     /*!< Longitude, 1e-7 degrees */
+    uint16_t heading;   /*!< Heading, 0.1 degrees */
+    uint8_t port;       /*!< Port motor duty, % */
+    uint8_t stbd;       /*!< Starboard motor duty, % */
+} track_point_t;
+
+/**
+ * @brief Block header, the first point of the block is stored in full here
+ *
+ * Little endian, as written by the ESP32. The CRC is the standard CRC-32 (esp_rom_crc32_le() from 0).
+ *
+ */
+typedef struct {
+    uint32_t magic;     /*!< TRACK_LOG_MAGIC, anything else is an empty or foreign block */
+    uint32_t seq;       /*!< Increases by one per block written, orders the blocks */
+    uint32_t crc;       /*!< CRC32 from count to the end of the data */
+    uint16_t count;     /*!< Points in the block, including the first */
+    uint16_t len;       /*!< Bytes of delta encoded points after the header */
+    int64_t t_ms;       /*!< First point */
+    int32_t lat_e7;     /*!< First point */
+    int32_t lon_e7;     /*!< First point */
+    uint16_t heading;   /*!< First point */
+    uint8_t port;       /*!< First point */
+    uint8_t stbd;       /*!< First point */
+    uint32_t reserved;  /*!< Keeps the data 8 byte aligned */
+} track_block_header_t;
+
+_Static_assert(sizeof(track_block_header_t) == 40, "track block header layout changed");
+
+typedef union {
+    track_block_header_t header;
+    uint8_t bytes[TRACK_LOG_BLOCK_SIZE];
+} track_block_t;
+
+#define TRACK_LOG_DATA_MAX (TRACK_LOG_BLOCK_SIZE - sizeof(track_block_header_t))
+
+static inline size_t track_put_varint(uint8_t *p, uint32_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80) {
+        p[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (uint8_t)value;
+    return n;
+}
+
+static inline size_t track_put_zigzag(uint8_t *p, int32_t value)
+{
+    return track_put_varint(p, ((uint32_t)value << 1) ^ (uint32_t)(value >> 31));
+}
+
+static inline bool track_get_varint(const uint8_t **p, const uint8_t *end, uint32_t *value)
+{
+    uint32_t v = 0;
+    for (int shift = 0; shift < 35 && *p < end; shift += 7) {
+        uint8_t byte = *(*p)++;
+        v |= (uint32_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = v;
+            return true;
+        }
+    }
+    return false;
+}
+
+static inline bool track_get_zigzag(const uint8_t **p, const uint8_t *end, int32_t *value)
+{
+    uint32_t v;
+    if (!track_get_varint(p, end, &v)) {
+        return false;
+    }
+    *value = (int32_t)(v >> 1) ^ -(int32_t)(v & 1);
+    return true;
+}
+
+/**
+ * @brief Delta encode a point after the one before it
+ *
+ * @param last the point before
+ * @param point the point to encode
+ * @param p filled with the delta, room for TRACK_LOG_POINT_MAX bytes
+ * @return size_t bytes written, 0 if time went backwards or the step is too large for a delta
+ */
+static inline size_t track_block_delta(const track_point_t *last, const track_point_t *point, uint8_t *p)
+{
+    size_t n = 0;
+    int64_t dt = point->t_ms - last->t_ms;
+    int64_t dlat = (int64_t)point->lat_e7 - last->lat_e7;
+    int64_t dlon = (int64_t)point->lon_e7 - last->lon_e7;
+
+    if (dt < 0 || dt > UINT32_MAX || dlat < INT32_MIN || dlat > INT32_MAX || dlon < INT32_MIN || dlon > INT32_MAX) {
+        return 0;
+    }
+    n += track_put_varint(p + n, (uint32_t)dt);
+    n += track_put_zigzag(p + n, (int32_t)dlat);
+    n += track_put_zigzag(p + n, (int32_t)dlon);
+    n += track_put_zigzag(p + n, (int32_t)point->heading - last->heading);
+    n += track_put_zigzag(p + n, (int32_t)point->port - last->port);
+    n += track_put_zigzag(p + n, (int32_t)point->stbd - last->stbd);
+    return n;
+}
+
+/**
+ * @brief The first point of a block, from its header
+ *
+ * @param header block header
+ * @param point filled with the point
+ */
+static inline void track_block_first(const track_block_header_t *header, track_point_t *point)
+{
+    point->t_ms = header->t_ms;
+    point->lat_e7 = header->lat_e7;
+    point->lon_e7 = header->lon_e7;
+    point->heading = header->heading;
+    point->port = header->port;
+    point->stbd = header->stbd;
+}
+
+/**
+ * @brief Apply the next delta of a block to a point
+ *
+ * @param p position in the block data, moved past the delta
+ * @param end end of the block data
+ * @param point the point before, updated to the next one
+ * @return true if a whole delta was read
+ */
+static inline bool track_block_next(const uint8_t **p, const uint8_t *end, track_point_t *point)
+{
+    uint32_t dt;
+    int32_t dlat, dlon, dheading, dport, dstbd;
+    if (!track_get_varint(p, end, &dt) || !track_get_zigzag(p, end, &dlat) || !track_get_zigzag(p, end, &dlon) ||
+            !track_get_zigzag(p, end, &dheading) || !track_get_zigzag(p, end, &dport) ||
+            !track_get_zigzag(p, end, &dstbd)) {
+        return false;
+    }
+    point->t_ms += dt;
+    point->lat_e7 += dlat;
+    point->lon_e7 += dlon;
+    point->heading += dheading;
+    point->port += dport;
+    point->stbd += dstbd;
+    return true;
+}
+
+#ifdef __cplusplus
+}
+#endif
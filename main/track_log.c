@@ -0,0 +1,271 @@
+/* Compressed track log in a flash partition
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include <stddef.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "track_log.h"
+
+static const char *TRACK_LOG_TAG = "track_log";
+
+#define TRACK_LOG_QUEUE_LEN (16)
+#define TRACK_LOG_TASK_STACK_SIZE (3072)
+#define TRACK_LOG_TASK_PRIORITY (2)
+
+static const esp_partition_t *partition;
+static uint32_t block_count;
+static uint32_t next_block;                 /*!< Block written next, changed under current_lock after init */
+static uint32_t next_seq;                   /*!< Sequence number of the next block, changed under current_lock after init */
+static QueueHandle_t point_queue;
+static track_block_t current;               /*!< Block being filled, guarded by current_lock */
+static track_point_t last;                  /*!< Last point encoded into current */
+static portMUX_TYPE current_lock = portMUX_INITIALIZER_UNLOCKED;
+static track_log_stats_t stats;
+static uint32_t bytes_logged;
+
+static uint32_t block_crc(const track_block_t *block)
+{
+    size_t start = offsetof(track_block_header_t, count);
+    return esp_rom_crc32_le(0, block->bytes + start, sizeof(track_block_header_t) - start + block->header.len);
+}
+
+/**
+ * @brief Write the current block to flash and start an empty one, writer task only
+ *
+ * The points stay in current until the block is on flash, and the block only counts once next_seq has
+ * moved past it, so a reader always finds every point either in flash or in current.
+ */
+static void flush_block(void)
+{
+    static track_block_t out;
+    size_t offset = next_block * TRACK_LOG_BLOCK_SIZE;
+
+    portENTER_CRITICAL(&current_lock);
+    out = current;
+    portEXIT_CRITICAL(&current_lock);
+    if (out.header.count == 0) {
+        return;
+    }
+    out.header.magic = TRACK_LOG_MAGIC;
+    out.header.seq = next_seq;
+    out.header.crc = block_crc(&out);
+    /* Erase a sector only on entering it, that drops its oldest blocks */
+    if (next_block % TRACK_LOG_BLOCKS_PER_SECTOR == 0) {
+        esp_partition_erase_range(partition, offset, TRACK_LOG_SECTOR_SIZE);
+    }
+    if (esp_partition_write(partition, offset, out.bytes, TRACK_LOG_BLOCK_SIZE) != ESP_OK) {
+        ESP_LOGW(TRACK_LOG_TAG, "write of block %u failed", next_block);
+    }
+    portENTER_CRITICAL(&current_lock);
+    current.header.count = 0;
+    current.header.len = 0;
+    next_block = (next_block + 1) % block_count;
+    next_seq++;
+    portEXIT_CRITICAL(&current_lock);
+    stats.blocks_written++;
+}
+
+/**
+ * @brief Delta encode a point into the current block, writer task only
+ *
+ */
+static void encode_point(const track_point_t *point)
+{
+    uint8_t tmp[TRACK_LOG_POINT_MAX];
+    size_t n = current.header.count > 0 ? track_block_delta(&last, point, tmp) : 0;
+
+    if (n > 0 && current.header.len + n <= TRACK_LOG_DATA_MAX) {
+        portENTER_CRITICAL(&current_lock);
+        memcpy(current.bytes + sizeof(track_block_header_t) + current.header.len, tmp, n);
+        current.header.len += n;
+        current.header.count++;
+        portEXIT_CRITICAL(&current_lock);
+        last = *point;
+        bytes_logged += n;
+        return;
+    }
+    /* Block full, time went backwards or a jump too large for a delta: start a block with this point */
+    flush_block();
+    portENTER_CRITICAL(&current_lock);
+    current.header.t_ms = point->t_ms;
+    current.header.lat_e7 = point->lat_e7;
+    current.header.lon_e7 = point->lon_e7;
+    current.header.heading = point->heading;
+    current.header.port = point->port;
+    current.header.stbd = point->stbd;
+    current.header.count = 1;
+    current.header.len = 0;
+    portEXIT_CRITICAL(&current_lock);
+    last = *point;
+    bytes_logged += sizeof(track_block_header_t);
+}
+
+static void track_log_task_entry(void *arg)
+{
+    track_point_t point;
+    while (1) {
+        if (xQueueReceive(point_queue, &point, portMAX_DELAY) == pdTRUE) {
+            encode_point(&point);
+            stats.points_logged++;
+            stats.bytes_per_point = bytes_logged * 100 / stats.points_logged;
+        }
+    }
+}
+
+esp_err_t track_log_init(void)
+{
+    track_block_header_t header;
+    uint32_t newest = 0;
+    bool found = false;
+
+    partition = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, TRACK_LOG_PARTITION);
+    if (!partition) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    /* Whole sectors only */
+    block_count = partition->size / TRACK_LOG_SECTOR_SIZE * TRACK_LOG_BLOCKS_PER_SECTOR;
+    stats.capacity_blocks = block_count;
+    /* Carry on after the newest block, only headers are read so the scan stays short */
+    for (uint32_t i = 0; i < block_count; i++) {
+        if (esp_partition_read(partition, i * TRACK_LOG_BLOCK_SIZE, &header, sizeof(header)) != ESP_OK) {
+            continue;
+        }
+        if (header.magic == TRACK_LOG_MAGIC && (!found || (int32_t)(header.seq - next_seq) > 0)) {
+            next_seq = header.seq;
+            newest = i;
+            found = true;
+        }
+    }
+    if (found) {
+        next_seq++;
+        next_block = (newest + 1) % block_count;
+        /* A block torn by a power cut can't be written over, move on to the next sector, which is erased first */
+        if (next_block % TRACK_LOG_BLOCKS_PER_SECTOR != 0) {
+            static track_block_t blank;
+            esp_partition_read(partition, next_block * TRACK_LOG_BLOCK_SIZE, blank.bytes, TRACK_LOG_BLOCK_SIZE);
+            for (size_t i = 0; i < TRACK_LOG_BLOCK_SIZE; i++) {
+                if (blank.bytes[i] != 0xff) {
+                    next_block = (next_block / TRACK_LOG_BLOCKS_PER_SECTOR + 1) * TRACK_LOG_BLOCKS_PER_SECTOR % block_count;
+                    break;
+                }
+            }
+        }
+    } else {
+        next_seq = 1;
+        next_block = 0;
+    }
+    ESP_LOGI(TRACK_LOG_TAG, "%u blocks, next block %u", block_count, next_block);
+
+    point_queue = xQueueCreate(TRACK_LOG_QUEUE_LEN, sizeof(track_point_t));
+    if (!point_queue) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(track_log_task_entry, "track_log", TRACK_LOG_TASK_STACK_SIZE, NULL,
+                    TRACK_LOG_TASK_PRIORITY, NULL) != pdTRUE) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void track_log_add(const track_point_t *point)
+{
+    if (!point_queue || xQueueSend(point_queue, point, 0) != pdTRUE) {
+        stats.points_dropped++;
+    }
+}
+
+/**
+ * @brief Decode one block and pass the points in range to cb
+ *
+ * @return esp_err_t ESP_OK to go on, ESP_ERR_NOT_FINISHED once past to_ms, or the error from cb
+ */
+static esp_err_t decode_block(const track_block_t *block, int64_t from_ms, int64_t to_ms, track_log_cb_t cb, void *ctx)
+{
+    const uint8_t *p = block->bytes + sizeof(track_block_header_t);
+    const uint8_t *end = p + block->header.len;
+    track_point_t point;
+    esp_err_t err;
+
+    track_block_first(&block->header, &point);
+    for (uint32_t i = 0; i < block->header.count; i++) {
+        if (i > 0 && !track_block_next(&p, end, &point)) {
+            return ESP_OK;
+        }
+        if (point.t_ms > to_ms) {
+            return ESP_ERR_NOT_FINISHED;
+        }
+        if (point.t_ms >= from_ms) {
+            err = cb(&point, ctx);
+            if (err != ESP_OK) {
+                return err;
+            }
+        }
+    }
+    return ESP_OK;
+}
+
+esp_err_t track_log_read(int64_t from_ms, int64_t to_ms, track_log_cb_t cb, void *ctx)
+{
+    /* Only used by the reading task, one reader at a time */
+    static track_block_t block, unwritten;
+    uint32_t start, end_seq;
+    uint32_t pending = UINT32_MAX;
+    track_block_header_t header;
+    esp_err_t err = ESP_OK;
+
+    if (!partition) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    /* The log as it is now: the blocks before end_seq and the points not yet written. Blocks the writer
+       finishes while this runs come after end_seq, their points are in the copy of current */
+    portENTER_CRITICAL(&current_lock);
+    unwritten = current;
+    start = next_block;
+    end_seq = next_seq;
+    portEXIT_CRITICAL(&current_lock);
+    /* Oldest first. A block is decoded once the next one is known to start after from_ms, so blocks wholly
+       before the range cost only a header read */
+    for (uint32_t i = 0; i <= block_count && err == ESP_OK; i++) {
+        uint32_t index = (start + i) % block_count;
+        bool valid = false;
+        if (i < block_count && esp_partition_read(partition, index * TRACK_LOG_BLOCK_SIZE, &header, sizeof(header)) == ESP_OK) {
+            valid = header.magic == TRACK_LOG_MAGIC && header.len <= TRACK_LOG_DATA_MAX &&
+                    (int32_t)(header.seq - end_seq) < 0;
+        }
+        if (i < block_count && (!valid || header.t_ms <= from_ms)) {
+            if (valid) {
+                pending = index;
+            }
+            continue;
+        }
+        if (pending != UINT32_MAX) {
+            if (esp_partition_read(partition, pending * TRACK_LOG_BLOCK_SIZE, block.bytes, TRACK_LOG_BLOCK_SIZE) == ESP_OK &&
+                    block.header.len <= TRACK_LOG_DATA_MAX && block_crc(&block) == block.header.crc &&
+                    (int32_t)(block.header.seq - end_seq) < 0) {
+                err = decode_block(&block, from_ms, to_ms, cb, ctx);
+            }
+        }
+        pending = valid ? index : UINT32_MAX;
+    }
+    /* Then the points not yet written to flash */
+    if (err == ESP_OK && unwritten.header.count > 0) {
+        err = decode_block(&unwritten, from_ms, to_ms, cb, ctx);
+    }
+    return err == ESP_ERR_NOT_FINISHED ? ESP_OK : err;
+}
+
+void track_log_get_stats(track_log_stats_t *out)
+{
+    *out = stats;
+}
@@ -0,0 +1,84 @@
+/* Compressed track log in a flash partition
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "track_block.h"
+
+#define TRACK_LOG_PARTITION "track"     /*!< Label of the data partition holding the log */
+
+/**
+ * @brief Log statistics
+ *
+ */
+typedef struct {
+    uint32_t capacity_blocks;   /*!< Blocks in the partition */
+    uint32_t blocks_written;    /*!< Blocks written since boot */
+    uint32_t points_logged;     /*!< Points encoded since boot */
+    uint32_t points_dropped;    /*!< Points lost because the writer fell behind */
+    uint32_t bytes_per_point;   /*!< Average encoded size of a point in hundredths of a byte */
+} track_log_stats_t;
+
+/**
+ * @brief Called for each point read back, in time order
+ *
+ * @param point point
+ * @param ctx user context
+ * @return esp_err_t ESP_OK to continue, anything else stops the read and is returned by track_log_read
+ */
+typedef esp_err_t (*track_log_cb_t)(const track_point_t *point, void *ctx);
+
+/**
+ * @brief Open the log partition, find the newest block and start the writer task
+ *
+ * @return esp_err_t ESP_OK, ESP_ERR_NOT_FOUND if there is no track partition
+ */
+esp_err_t track_log_init(void);
+
+/**
+ * @brief Queue a point for logging, never blocks
+ *
+ * Points are delta encoded into a block in RAM by the writer task. A full block is written to flash in one
+ * go, and a 4 kB sector is erased only when the log wraps into it.
+ *
+ * @param point point
+ */
+void track_log_add(const track_point_t *point);
+
+/**
+ * @brief Read back every point in a time range, oldest first
+ *
+ * Decodes one block at a time, including the block still being filled, so memory use does not depend on
+ * the size of the log or of the range.
+ *
+ * @param from_ms first time wanted, UTC milliseconds
+ * @param to_ms last time wanted, UTC milliseconds
+ * @param cb called for each point
+ * @param ctx passed to cb
+ * @return esp_err_t ESP_OK, or the first error returned by cb or the flash
+ */
+esp_err_t track_log_read(int64_t from_ms, int64_t to_ms, track_log_cb_t cb, void *ctx);
+
+/**
+ * @brief Get the log statistics
+ *
+ * @param stats filled with the statistics
+ */
+void track_log_get_stats(track_log_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,198 @@
+/* u-blox UBX binary protocol decoder
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include "ubx.h"
+
+/* Decoder states, 0 is waiting for a frame */
+enum {
+    UBX_STATE_IDLE,
+    UBX_STATE_SYNC_2,
+    UBX_STATE_CLASS,
+    UBX_STATE_ID,
+    UBX_STATE_LEN_LO,
+    UBX_STATE_LEN_HI,
+    UBX_STATE_PAYLOAD,
+    UBX_STATE_CK_A,
+    UBX_STATE_CK_B,
+};
+
+/* NAV-PVT fixType */
+enum {
+    UBX_FIX_NONE,
+    UBX_FIX_DR,
+    UBX_FIX_2D,
+    UBX_FIX_3D,
+    UBX_FIX_GNSS_DR,
+    UBX_FIX_TIME,
+};
+
+#define UBX_PVT_VALID_DATE (0x01)
+#define UBX_PVT_VALID_TIME (0x02)
+#define UBX_PVT_FLAGS_FIX_OK (0x01)
+#define UBX_PVT_FLAGS_DIFF (0x02)
+
+static inline uint16_t get_u16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline int32_t get_i32(const uint8_t *p)
+{
+    return (int32_t)get_u32(p);
+}
+
+static inline void checksum_add(ubx_decoder_t *dec, uint8_t byte)
+{
+    dec->ck_a += byte;
+    dec->ck_b += dec->ck_a;
+}
+
+void ubx_decoder_reset(ubx_decoder_t *dec)
+{
+    dec->state = UBX_STATE_IDLE;
+}
+
+ubx_result_t ubx_decode_byte(ubx_decoder_t *dec, uint8_t byte)
+{
+    switch (dec->state) {
+    case UBX_STATE_IDLE:
+        if (byte != UBX_SYNC_1) {
+            return UBX_NOT_FRAME;
+        }
+        dec->state = UBX_STATE_SYNC_2;
+        break;
+    case UBX_STATE_SYNC_2:
+        if (byte == UBX_SYNC_1) {
+            break;
+        }
+        if (byte != UBX_SYNC_2) {
+            dec->state = UBX_STATE_IDLE;
+            return UBX_NOT_FRAME;
+        }
+        dec->ck_a = 0;
+        dec->ck_b = 0;
+        dec->state = UBX_STATE_CLASS;
+        break;
+    case UBX_STATE_CLASS:
+        dec->cls = byte;
+        checksum_add(dec, byte);
+        dec->state = UBX_STATE_ID;
+        break;
+    case UBX_STATE_ID:
+        dec->id = byte;
+        checksum_add(dec, byte);
+        dec->state = UBX_STATE_LEN_LO;
+        break;
+    case UBX_STATE_LEN_LO:
+        dec->len = byte;
+        checksum_add(dec, byte);
+        dec->state = UBX_STATE_LEN_HI;
+        break;
+    case UBX_STATE_LEN_HI:
+        dec->len |= byte << 8;
+        checksum_add(dec, byte);
+        dec->pos = 0;
+        dec->state = dec->len ? UBX_STATE_PAYLOAD : UBX_STATE_CK_A;
+        break;
+    case UBX_STATE_PAYLOAD:
+        /* Frames too long to store are still followed to their end, so the stream stays in step */
+        if (dec->pos < UBX_MAX_PAYLOAD) {
+            dec->payload[dec->pos] = byte;
+        }
+        checksum_add(dec, byte);
+        if (++dec->pos == dec->len) {
+            dec->state = UBX_STATE_CK_A;
+        }
+        break;
+    case UBX_STATE_CK_A:
+        dec->state = byte == dec->ck_a ? UBX_STATE_CK_B : UBX_STATE_IDLE;
+        if (dec->state == UBX_STATE_IDLE) {
+            return UBX_BAD_CHECKSUM;
+        }
+        break;
+    case UBX_STATE_CK_B:
+        dec->state = UBX_STATE_IDLE;
+        if (byte != dec->ck_b) {
+            return UBX_BAD_CHECKSUM;
+        }
+        return dec->len > UBX_MAX_PAYLOAD ? UBX_TOO_LONG : UBX_FRAME;
+    default:
+        dec->state = UBX_STATE_IDLE;
+        break;
+    }
+    return UBX_MORE;
+}
+
+bool ubx_nav_pvt_to_gps(const uint8_t *payload, uint16_t len, gps_t *gps)
+{
+    if (len != UBX_NAV_PVT_LEN) {
+        return false;
+    }
+    const uint8_t valid = payload[11];
+    const uint8_t fix_type = payload[20];
+    const uint8_t flags = payload[21];
+    const bool fix_ok = (flags & UBX_PVT_FLAGS_FIX_OK) &&
+                        (fix_type == UBX_FIX_2D || fix_type == UBX_FIX_3D || fix_type == UBX_FIX_GNSS_DR);
+
+    if (valid & UBX_PVT_VALID_DATE) {
+        gps->date.year = get_u16(payload + 4) - 2000;
+        gps->date.month = payload[6];
+        gps->date.day = payload[7];
+    }
+    if (valid & UBX_PVT_VALID_TIME) {
+        /* nano is the signed fraction to add to the rounded second, it can make the millisecond negative */
+        int32_t ms = get_i32(payload + 16) / 1000000;
+        gps->tim.hour = payload[8];
+        gps->tim.minute = payload[9];
+        gps->tim.second = payload[10];
+        gps->tim.thousand = ms < 0 ? 0 : ms;
+    }
+    gps->fix = fix_ok ? ((flags & UBX_PVT_FLAGS_DIFF) ? GPS_FIX_DGPS : GPS_FIX_GPS) : GPS_FIX_INVALID;
+    gps->fix_mode = !fix_ok ? GPS_MODE_INVALID : (fix_type == UBX_FIX_2D ? GPS_MODE_2D : GPS_MODE_3D);
+    gps->valid = fix_ok;
+    gps->sats_in_use = payload[23];
+    if (fix_ok) {
+        gps->longitude_e7 = get_i32(payload + 24);
+        gps->latitude_e7 = get_i32(payload + 28);
+        gps->longitude = gps->longitude_e7 * 1e-7f;
+        gps->latitude = gps->latitude_e7 * 1e-7f;
+        gps->altitude = get_i32(payload + 36) * 1e-3f;
+        gps->speed = get_i32(payload + 60) * 1e-3f;
+        gps->cog = get_i32(payload + 64) * 1e-5f;
+    }
+    gps->dop_p = get_u16(payload + 76) * 0.01f;
+    gps->dop_h = gps->dop_p;
+    return true;
+}
+
+size_t ubx_build_frame(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len, uint8_t *out)
+{
+    ubx_decoder_t ck = { 0 };
+    out[0] = UBX_SYNC_1;
+    out[1] = UBX_SYNC_2;
+    out[2] = cls;
+    out[3] = id;
+    out[4] = len & 0xff;
+    out[5] = len >> 8;
+    if (len) {
+        memcpy(out + 6, payload, len);
+    }
+    for (size_t i = 2; i < 6u + len; i++) {
+        checksum_add(&ck, out[i]);
+    }
+    out[6 + len] = ck.ck_a;
+    out[7 + len] = ck.ck_b;
+    return 8u + len;
+}
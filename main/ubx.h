@@ -0,0 +1,116 @@
+/* u-blox UBX binary protocol decoder
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+#include "nmea_gps.h"
+
+#define UBX_SYNC_1 (0xB5)               /*!< First sync character, never appears in NMEA */
+#define UBX_SYNC_2 (0x62)               /*!< Second sync character */
+#define UBX_CLASS_NAV (0x01)            /*!< Navigation results */
+#define UBX_CLASS_ACK (0x05)            /*!< Acknowledgements */
+#define UBX_CLASS_CFG (0x06)            /*!< Configuration */
+#define UBX_ID_NAV_PVT (0x07)           /*!< Position, velocity and time solution */
+#define UBX_ID_ACK_NAK (0x00)           /*!< Message not acknowledged */
+#define UBX_ID_ACK_ACK (0x01)           /*!< Message acknowledged */
+#define UBX_NAV_PVT_LEN (92)            /*!< Payload length of NAV-PVT */
+#define UBX_MAX_PAYLOAD (100)           /*!< Longer frames are skipped without being stored */
+
+/**
+ * @brief Result of feeding one byte to the frame decoder
+ *
+ */
+typedef enum {
+    UBX_NOT_FRAME,      /*!< The byte is not part of a frame, it belongs to another protocol on the same line */
+    UBX_MORE,           /*!< Frame not complete yet */
+    UBX_FRAME,          /*!< A frame with a good checksum is in the decoder */
+    UBX_BAD_CHECKSUM,   /*!< A frame ended with a bad checksum and was dropped */
+    UBX_TOO_LONG,       /*!< A frame longer than UBX_MAX_PAYLOAD ended and was dropped */
+} ubx_result_t;
+
+/**
+ * @brief Frame decoder state
+ *
+ */
+typedef struct {
+    uint8_t state;                      /*!< Position in the frame */
+    uint8_t cls;                        /*!< Message class */
+    uint8_t id;                         /*!< Message id */
+    uint8_t ck_a;                       /*!< Running Fletcher checksum */
+    uint8_t ck_b;                       /*!< Running Fletcher checksum */
+    uint16_t len;                       /*!< Payload length */
+    uint16_t pos;                       /*!< Payload bytes received */
+    uint8_t payload[UBX_MAX_PAYLOAD];   /*!< Payload, valid up to len once UBX_FRAME is returned */
+} ubx_decoder_t;
+
+/**
+ * @brief Reset a decoder to wait for a sync character
+ *
+ * @param dec decoder
+ */
+void ubx_decoder_reset(ubx_decoder_t *dec);
+
+/**
+ * @brief Check whether the decoder is inside a frame
+ *
+ * @param dec decoder
+ * @return true once UBX_SYNC_1 has been seen and until the frame ends
+ */
+static inline bool ubx_decoder_busy(const ubx_decoder_t *dec)
+{
+    return dec->state != 0;
+}
+
+/**
+ * @brief Feed one byte to the decoder
+ *
+ * A sync character that is not followed by the second one gives UBX_NOT_FRAME for the byte after it,
+ * so the caller can hand that byte to the NMEA parser instead.
+ *
+ * @param dec decoder
+ * @param byte byte from the receiver
+ * @return ubx_result_t UBX_FRAME when a frame with a good checksum has been completed
+ */
+ubx_result_t ubx_decode_byte(ubx_decoder_t *dec, uint8_t byte);
+
+/**
+ * @brief Fill a GPS object from a NAV-PVT payload
+ *
+ * NAV-PVT carries no HDOP, so dop_h is set to PDOP, which is never smaller. Satellite details are left
+ * untouched.
+ *
+ * @param payload NAV-PVT payload
+ * @param len payload length
+ * @param gps filled with the solution
+ * @return true if the payload is a NAV-PVT payload
+ */
+bool ubx_nav_pvt_to_gps(const uint8_t *payload, uint16_t len, gps_t *gps);
+
+/**
+ * @brief Build a UBX frame
+ *
+ * @param cls message class
+ * @param id message id
+ * @param payload payload, may be NULL when len is 0
+ * @param len payload length
+ * @param out frame, len + 8 bytes
+ * @return size_t frame length
+ */
+size_t ubx_build_frame(uint8_t cls, uint8_t id, const uint8_t *payload, uint16_t len, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,445 @@
+/* Dead reckoning replay
+
+   Replays fixes through main/nav_filter.c and main/dead_reckoning.c the way the control loop runs them:
+   the filter is stepped every cycle, each fix updates the filter, the predictor starts over from the filtered
+   position and velocity, and it gives the position every cycle in between. Reports the error of the
+   prediction against each measured fix next to the error of holding the previous fix, as /metrics does.
+
+   Logs carry no motor duty or compass, so only the ground velocity part of the prediction is replayed from
+   them. With -s a simulated boat changes its duty and turns in a current, and its compass and receiver are
+   fed through the same path, with the fixes written by main/nmea_encoder.c and read back by
+   main/nmea_decode.c. The estimate of every cycle is then also scored against the true track. Exits with 1
+   if the simulated prediction is not better than holding the last fix.
+
+   dr_replay [-s] [-n fixes] [file...]
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include "nmea_decode.h"
+#include "nmea_encoder.h"
+#include "nav_filter.h"
+#include "dead_reckoning.h"
+#include "numfmt.h"
+#include "geo.h"
+
+#define REPLAY_RATE_HZ (10)             /* CONFIG_CONTROL_LOOP_RATE_HZ */
+#define REPLAY_PERIOD_US (1000000 / REPLAY_RATE_HZ)
+#define REPLAY_LINE_MAX (160)
+#define REPLAY_GST_MAX_AGE (3)          /* GST_MAX_AGE of the control loop */
+#define YEAR_BASE (2000)                /* date in GPS starts from 2000 */
+#define SIM_FIXES (1800)                /* Length of the simulated run, one fix a second */
+#define SIM_STEPS (10)                  /* Steps of the boat model per control cycle */
+#define SIM_LEG_S (15)                  /* Seconds between changes of duty and turn rate */
+#define SIM_SURGE_TAU (3.0f)            /* Seconds for the boat to come up to speed */
+#define SIM_MAX_TURN (6.0f)             /* deg/s */
+#define SIM_CURRENT_N (0.2f)            /* m/s */
+#define SIM_CURRENT_E (0.3f)            /* m/s */
+#define SIM_NOISE_M (0.8f)              /* Slow wander of the receiver position, each axis */
+#define SIM_NOISE_TAU (20.0f)           /* Seconds the wander is correlated over */
+#define SIM_JITTER_M (0.2f)             /* White noise of the receiver position, each axis */
+#define SIM_SPEED_SIGMA (0.05f)         /* Noise of each component of the receiver velocity (m/s) */
+#define SIM_COMPASS_SIGMA (3.0f)        /* Noise of the compass (degrees) */
+#define SIM_START_DAYS (19844)          /* 2024-05-01 */
+
+/**
+ * @brief One fix as the GPS event handler hands it to the control loop
+ *
+ */
+typedef struct {
+    int64_t t_us;           /*!< UTC of the fix, microseconds since 1970 */
+    geo_point_t p;
+    float speed;            /*!< m/s */
+    float cog;
+    float dop_h;
+    bool gst;               /*!< GST arrived with this fix */
+    float err_lat, err_lon;
+} replay_fix_t;
+
+/**
+ * @brief Control loop state that the position estimate depends on
+ *
+ */
+typedef struct {
+    nav_filter_t kf;
+    dead_reckoning_t dr;
+    geo_point_t ref;            /*!< Local reference, the first fix */
+    bool started;
+    int64_t cycle_us;           /*!< Time of the last cycle */
+    uint8_t gst_age;
+    float err_lat, err_lon;
+    float fix_north, fix_east;  /*!< Last fix in the local frame, what the loop held before dead reckoning */
+    uint32_t restarts;
+} replay_t;
+
+static uint32_t seed = 12345;
+
+static uint32_t next_rand(void)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+/* Uniform in [lo, hi] */
+static float rand_float(float lo, float hi)
+{
+    return lo + (hi - lo) * (next_rand() / (float)(1 << 24));
+}
+
+/* Normal with the given standard deviation */
+static float rand_normal(float sigma)
+{
+    float u = (next_rand() + 1.0f) / (float)(1 << 24);
+    return sigma * sqrtf(-2.0f * logf(u)) * cosf(2.0f * 3.14159265f * rand_float(0, 1));
+}
+
+static void replay_init(replay_t *r)
+{
+    const nav_filter_config_t kf_config = NAV_FILTER_CONFIG_DEFAULT();
+    const dead_reckoning_config_t dr_config = DEAD_RECKONING_CONFIG_DEFAULT();
+
+    memset(r, 0, sizeof(*r));
+    nav_filter_init(&r->kf, &kf_config);
+    dead_reckoning_init(&r->dr, &dr_config);
+    r->gst_age = UINT8_MAX;
+}
+
+/* Start over after a gap the predictor can't bridge, keeping the reference and the scores */
+static void replay_restart(replay_t *r, int64_t t_us)
+{
+    replay_t old = *r;
+    replay_init(r);
+    r->dr.quality = old.dr.quality;
+    r->ref = old.ref;
+    r->started = true;
+    r->cycle_us = t_us;
+    r->restarts = old.restarts + 1;
+}
+
+/**
+ * @brief One control cycle: step the filter, take the fix if there is one, and predict the position
+ *
+ */
+static void replay_cycle(replay_t *r, int64_t t_us, const replay_fix_t *fix, float heading, float thrust,
+                         float *north, float *east)
+{
+    nav_filter_predict(&r->kf, (t_us - r->cycle_us) / 1000000.0f);
+    r->cycle_us = t_us;
+    if (fix) {
+        geo_offset_e7(&r->ref, &fix->p, &r->fix_north, &r->fix_east);
+        if (fix->gst) {
+            r->err_lat = fix->err_lat;
+            r->err_lon = fix->err_lon;
+            r->gst_age = 0;
+        } else if (r->gst_age < UINT8_MAX) {
+            r->gst_age++;
+        }
+        if (r->gst_age <= REPLAY_GST_MAX_AGE && r->err_lat > 0 && r->err_lon > 0) {
+            nav_filter_update_position_sigma(&r->kf, r->fix_north, r->fix_east, r->err_lat, r->err_lon);
+        } else {
+            nav_filter_update_position(&r->kf, r->fix_north, r->fix_east, fix->dop_h);
+        }
+        nav_filter_update_velocity(&r->kf, fix->speed, fix->cog);
+        dead_reckoning_fix(&r->dr, fix->t_us, r->kf.x[NAV_N], r->kf.x[NAV_E], r->fix_north, r->fix_east,
+                           sqrtf(r->kf.x[NAV_VN] * r->kf.x[NAV_VN] + r->kf.x[NAV_VE] * r->kf.x[NAV_VE]),
+                           geo_bearing_deg(r->kf.x[NAV_VN], r->kf.x[NAV_VE]), thrust);
+    }
+    if (!dead_reckoning_predict(&r->dr, t_us, heading, thrust, north, east)) {
+        *north = r->fix_north;
+        *east = r->fix_east;
+    }
+}
+
+/**
+ * @brief Decode a line, true when it completes a valid fix
+ *
+ */
+static bool decode_fix(nmea_decoder_t *dec, const char *line, replay_fix_t *fix)
+{
+    if (nmea_decode_line(dec, line, 1 << STATEMENT_RMC) != NMEA_DECODE_UPDATE) {
+        return false;
+    }
+    const gps_t *gps = &dec->gps;
+    if (!gps->valid || gps->date.month == 0 || gps->date.day == 0) {
+        return false;
+    }
+    int64_t days = numfmt_days_from_civil(gps->date.year + YEAR_BASE, gps->date.month, gps->date.day);
+    int64_t ms = ((days * 24 + gps->tim.hour) * 60 + gps->tim.minute) * 60000 + gps->tim.second * 1000 +
+                 gps->tim.thousand;
+    fix->t_us = ms * 1000;
+    fix->p.lat_e7 = gps->latitude_e7;
+    fix->p.lon_e7 = gps->longitude_e7;
+    fix->speed = gps->speed;
+    fix->cog = gps->cog;
+    fix->dop_h = gps->dop_h;
+    fix->gst = gps->statements & (1 << STATEMENT_GST);
+    fix->err_lat = gps->error.lat;
+    fix->err_lon = gps->error.lon;
+    return true;
+}
+
+/**
+ * @brief Feed a fix from a log, running the cycles since the last one without a fix
+ *
+ */
+static void replay_log_fix(replay_t *r, const replay_fix_t *fix)
+{
+    float north, east;
+
+    if (!r->started) {
+        r->ref = fix->p;
+        r->started = true;
+        r->cycle_us = fix->t_us;
+    } else if (fix->t_us <= r->dr.fix_us || fix->t_us - r->dr.fix_us > r->dr.config.horizon_s * 1000000) {
+        replay_restart(r, fix->t_us);
+    }
+    while (r->cycle_us + REPLAY_PERIOD_US < fix->t_us) {
+        replay_cycle(r, r->cycle_us + REPLAY_PERIOD_US, NULL, 0, 0, &north, &east);
+    }
+    replay_cycle(r, fix->t_us, fix, 0, 0, &north, &east);
+}
+
+static void print_header(void)
+{
+    printf("%-24s %7s %8s %9s %9s %10s\n", "source", "fixes", "restarts", "dr_rms_m", "dr_max_m", "hold_rms_m");
+}
+
+static void print_quality(const char *source, const replay_t *r)
+{
+    const dead_reckoning_quality_t *q = &r->dr.quality;
+    uint32_t n = q->fixes > 0 ? q->fixes : 1;
+    printf("%-24s %7u %8u %9.2f %9.2f %10.2f\n", source, (unsigned)q->fixes, (unsigned)r->restarts,
+           sqrtf(q->sum_sq_err / n), q->max_err_m, sqrtf(q->sum_sq_stale / n));
+}
+
+static bool replay_file(const char *path)
+{
+    static nmea_decoder_t dec;
+    char line[REPLAY_LINE_MAX + 2];
+    replay_fix_t fix;
+    replay_t r;
+
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return false;
+    }
+    nmea_decoder_init(&dec);
+    replay_init(&r);
+    while (fgets(line, sizeof(line), f)) {
+        /* A log may put a time stamp or a source in front of the sentence */
+        const char *dollar = strchr(line, '$');
+        if (dollar && decode_fix(&dec, dollar, &fix)) {
+            replay_log_fix(&r, &fix);
+        }
+    }
+    fclose(f);
+    print_quality(path, &r);
+    return true;
+}
+
+/**
+ * @brief State of the simulated boat, in metres from where it starts
+ *
+ */
+typedef struct {
+    float north, east;
+    float heading;
+    float speed;            /*!< Through the water */
+    float turn;             /*!< deg/s */
+    float duty;             /*!< Mean motor duty, % */
+    float noise_n, noise_e; /*!< Slow wander of the receiver */
+} sim_boat_t;
+
+static void sim_step(sim_boat_t *b, float thrust_mps, float dt)
+{
+    b->speed += (thrust_mps * b->duty / 100.0f - b->speed) * dt / SIM_SURGE_TAU;
+    b->heading = fmodf(b->heading + b->turn * dt + 360.0f, 360.0f);
+    b->north += (b->speed * cosf(b->heading * GEO_DEG_TO_RAD) + SIM_CURRENT_N) * dt;
+    b->east += (b->speed * sinf(b->heading * GEO_DEG_TO_RAD) + SIM_CURRENT_E) * dt;
+}
+
+/* The receiver's fix of the boat as GGA and RMC */
+static int sim_sentences(const sim_boat_t *b, const geo_point_t *ref, int64_t t_ms, char *out, size_t size)
+{
+    char utc[NUMFMT_UTC_MAX_LEN + 1];
+    gps_t gps = { 0 };
+    int year, month, day, hour, minute, second, ms;
+    float vn = b->speed * cosf(b->heading * GEO_DEG_TO_RAD) + SIM_CURRENT_N + rand_normal(SIM_SPEED_SIGMA);
+    float ve = b->speed * sinf(b->heading * GEO_DEG_TO_RAD) + SIM_CURRENT_E + rand_normal(SIM_SPEED_SIGMA);
+    geo_point_t p;
+
+    geo_point_at(ref, b->north + b->noise_n + rand_normal(SIM_JITTER_M),
+                 b->east + b->noise_e + rand_normal(SIM_JITTER_M), &p);
+    utc[numfmt_utc(utc, t_ms)] = '\0';
+    sscanf(utc, "%d-%d-%dT%d:%d:%d.%d", &year, &month, &day, &hour, &minute, &second, &ms);
+    gps.tim = (gps_time_t) { hour, minute, second, ms };
+    gps.date = (gps_date_t) { day, month, year - YEAR_BASE };
+    gps.valid = true;
+    gps.fix = GPS_FIX_GPS;
+    gps.sats_in_use = 12;
+    gps.dop_h = 0.9f;
+    gps.latitude_e7 = p.lat_e7;
+    gps.longitude_e7 = p.lon_e7;
+    gps.speed = sqrtf(vn * vn + ve * ve);
+    gps.cog = geo_bearing_deg(vn, ve);
+    int len = nmea_encode(STATEMENT_GGA, "GP", &gps, out, size);
+    int rmc = len > 0 ? nmea_encode(STATEMENT_RMC, "GP", &gps, out + len, size - len) : -1;
+    return rmc > 0 ? len + rmc : -1;
+}
+
+/**
+ * @brief Run the simulated boat, returns false if dead reckoning did no better than holding the last fix
+ *
+ */
+static bool replay_sim(int fixes)
+{
+    static nmea_decoder_t dec;
+    const dead_reckoning_config_t dr_config = DEAD_RECKONING_CONFIG_DEFAULT();
+    const float dt = 1.0f / (REPLAY_RATE_HZ * SIM_STEPS);
+    const float noise_decay = expf(-dt / SIM_NOISE_TAU);
+    const float noise_drive = SIM_NOISE_M * sqrtf(1.0f - noise_decay * noise_decay);
+    const geo_point_t ref = { -338567844, 1512152967 };
+    char buf[2 * NMEA_MAX_SENTENCE_LEN + 1];
+    sim_boat_t b = { 0 };
+    double sq_est = 0, sq_hold = 0;
+    float max_est = 0, max_hold = 0;
+    uint32_t cycles = 0;
+    bool ok = true;
+    replay_t r;
+
+    nmea_decoder_init(&dec);
+    replay_init(&r);
+    r.ref = ref;
+    r.started = true;
+    b.heading = rand_float(0, 360);
+    for (int64_t c = 0; c < (int64_t)fixes * REPLAY_RATE_HZ; c++) {
+        const int64_t t_ms = (int64_t)SIM_START_DAYS * 86400000 + 12 * 3600000 + c * 1000 / REPLAY_RATE_HZ;
+        replay_fix_t fix;
+        const replay_fix_t *cycle_fix = NULL;
+        float north, east;
+
+        if (c % (SIM_LEG_S * REPLAY_RATE_HZ) == 0) {
+            b.duty = rand_float(0, 100);
+            b.turn = rand_float(-SIM_MAX_TURN, SIM_MAX_TURN);
+        }
+        for (int s = 0; s < SIM_STEPS; s++) {
+            sim_step(&b, dr_config.thrust_mps, dt);
+            b.noise_n = b.noise_n * noise_decay + rand_normal(noise_drive);
+            b.noise_e = b.noise_e * noise_decay + rand_normal(noise_drive);
+        }
+        if (c % REPLAY_RATE_HZ == 0) {
+            if (sim_sentences(&b, &ref, t_ms, buf, sizeof(buf)) < 0) {
+                printf("simulated fix does not encode\n");
+                return false;
+            }
+            char *eol = strchr(buf, '\n');
+            decode_fix(&dec, buf, &fix);
+            if (eol && decode_fix(&dec, eol + 1, &fix)) {
+                cycle_fix = &fix;
+            }
+        }
+        if (c == 0) {
+            r.cycle_us = t_ms * 1000;
+        }
+        replay_cycle(&r, t_ms * 1000, cycle_fix, r.kf.x[NAV_PSI], b.duty, &north, &east);
+        /* The compass is read after the position, as in the control loop */
+        nav_filter_update_heading(&r.kf, fmodf(b.heading + rand_normal(SIM_COMPASS_SIGMA) + 360.0f, 360.0f));
+
+        /* Score every cycle once the filter has had a few fixes to settle */
+        if (c >= 10 * REPLAY_RATE_HZ) {
+            float est = hypotf(north - b.north, east - b.east);
+            float hold = hypotf(r.fix_north - b.north, r.fix_east - b.east);
+            sq_est += est * est;
+            sq_hold += hold * hold;
+            max_est = est > max_est ? est : max_est;
+            max_hold = hold > max_hold ? hold : max_hold;
+            cycles++;
+        }
+    }
+    print_quality("simulated", &r);
+
+    const dead_reckoning_quality_t *q = &r.dr.quality;
+    if (q->fixes + 1 < (uint32_t)fixes || cycles == 0) {
+        printf("simulated fixes lost: %u of %d\n", (unsigned)q->fixes + 1, fixes);
+        return false;
+    }
+    float rms_est = sqrt(sq_est / cycles), rms_hold = sqrt(sq_hold / cycles);
+    printf("every cycle against the true track: dead reckoning rms %.2f m max %.2f m, last fix rms %.2f m "
+           "max %.2f m\n", rms_est, max_est, rms_hold, max_hold);
+    if (q->sum_sq_err >= q->sum_sq_stale) {
+        printf("prediction at the fixes is no better than holding the last fix\n");
+        ok = false;
+    }
+    if (rms_est >= rms_hold) {
+        printf("estimate between fixes is no better than holding the last fix\n");
+        ok = false;
+    }
+    return ok;
+}
+
+/* Cost of one prediction in the control loop, on a fix moving at 1 m/s */
+static double predict_ns(void)
+{
+    const dead_reckoning_config_t dr_config = DEAD_RECKONING_CONFIG_DEFAULT();
+    const int repeats = 200000;
+    dead_reckoning_t dr;
+    struct timespec t0, t1;
+    volatile float sink = 0;
+    float north, east;
+
+    dead_reckoning_init(&dr, &dr_config);
+    dead_reckoning_fix(&dr, 0, 0, 0, 0, 0, 1.0f, 45.0f, 50.0f);
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    /* Steps of 10 us stay inside the horizon */
+    for (int i = 1; i <= repeats; i++) {
+        dead_reckoning_predict(&dr, i * 10, 90.0f, 60.0f, &north, &east);
+        sink += north + east;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    return ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / repeats;
+}
+
+int main(int argc, char **argv)
+{
+    int fixes = SIM_FIXES;
+    bool sim = false;
+    bool ok = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "sn:")) != -1) {
+        if (opt == 's') {
+            sim = true;
+        } else if (opt == 'n' && atoi(optarg) > 10) {
+            fixes = atoi(optarg);
+        } else {
+            fprintf(stderr, "usage: %s [-s] [-n fixes] [file...]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (!sim && optind >= argc) {
+        fprintf(stderr, "usage: %s [-s] [-n fixes] [file...]\n", argv[0]);
+        return 2;
+    }
+
+    print_header();
+    for (int i = optind; i < argc; i++) {
+        ok &= replay_file(argv[i]);
+    }
+    if (sim) {
+        ok &= replay_sim(fixes);
+    }
+    printf("dead_reckoning_predict %.0f ns\n", predict_ns());
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,165 @@
+/* Geofence check cost
+
+   Times main/geofence.c with the fence full: 32 polygons and 500 vertices, an operating area with 31 no-go
+   zones in it. The control loop checks the position and limits the motors once a cycle, and the pair is
+   timed the same way here for many positions. In the scattered case the zones are spread over the area and
+   most bounding boxes are skipped. In the clustered case every zone is within the margin of the boat, so
+   every edge is looked at. Reports the mean and largest time of a check per case, and the largest scaled
+   by how much slower the ESP32 is taken to run this code than the host. That factor is an estimate, not
+   measured on the board. Exits with 1 if a scaled check goes over the budget of the control loop.
+
+   geofence_cost [-x slowdown]
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include "geofence.h"
+#include "geo.h"
+
+#define COST_BUDGET_US (500)            /* GEOFENCE_BUDGET_US of the control loop */
+#define COST_MARGIN_M (10.0f)           /* GEOFENCE_MARGIN_M */
+#define COST_ESCAPE_DUTY (40.0f)        /* GEOFENCE_ESCAPE_DUTY */
+#define COST_SLOWDOWN (40.0f)           /* ESP32 at 240 MHz against one desktop core, an estimate */
+#define COST_AREA_VERTICES (97)         /* Operating area, a circle */
+#define COST_ZONE_VERTICES (13)         /* Each no-go zone, a smaller circle */
+#define COST_AREA_M (1000.0f)           /* Radius of the operating area */
+#define COST_POSITIONS (2000)
+#define COST_ROUNDS (5)                 /* Each position is timed this many times, the fastest counts */
+
+static geofence_def_t def;
+static geofence_t fence;
+
+static uint32_t seed = 12345;
+
+static uint32_t next_rand(void)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+/* Uniform in [lo, hi] */
+static float rand_float(float lo, float hi)
+{
+    return lo + (hi - lo) * (next_rand() / (float)(1 << 24));
+}
+
+static void add_circle(const geo_point_t *ref, float north, float east, float radius_m, int count,
+                       geofence_kind_t kind)
+{
+    geo_point_t v[COST_AREA_VERTICES];
+    for (int i = 0; i < count; i++) {
+        float a = 2.0f * 3.14159265f * i / count;
+        geo_point_at(ref, north + radius_m * cosf(a), east + radius_m * sinf(a), &v[i]);
+    }
+    if (geofence_def_add(&def, kind, v, count) != ESP_OK) {
+        printf("polygon not added\n");
+        exit(1);
+    }
+}
+
+/**
+ * @brief Build the fence, no-go zones of radius zone_m with centres up to spread_m from the centre
+ *
+ */
+static void build(const geo_point_t *ref, float spread_m, float zone_m)
+{
+    geofence_def_clear(&def);
+    add_circle(ref, 0, 0, COST_AREA_M, COST_AREA_VERTICES, GEOFENCE_KEEP_IN);
+    for (int z = 1; z < GEOFENCE_MAX_POLYGONS; z++) {
+        float a = 2.0f * 3.14159265f * z / (GEOFENCE_MAX_POLYGONS - 1);
+        float r = spread_m * (z % 4 + 1) / 4.0f;
+        add_circle(ref, r * cosf(a), r * sinf(a), zone_m, COST_ZONE_VERTICES, GEOFENCE_KEEP_OUT);
+    }
+    geofence_build(&fence, &def);
+}
+
+static double elapsed_ns(const struct timespec *t0, const struct timespec *t1)
+{
+    return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+/**
+ * @brief Time a check and thrust limit at positions up to range_m from the centre, mean and worst in ns
+ *
+ */
+static void time_checks(const geo_point_t *ref, float range_m, double *mean_ns, double *max_ns, int *breaches)
+{
+    static geo_point_t positions[COST_POSITIONS];
+    static double best[COST_POSITIONS];
+    geofence_result_t res;
+
+    for (int i = 0; i < COST_POSITIONS; i++) {
+        geo_point_at(ref, rand_float(-range_m, range_m), rand_float(-range_m, range_m), &positions[i]);
+    }
+    *breaches = 0;
+    for (int round = 0; round < COST_ROUNDS; round++) {
+        for (int i = 0; i < COST_POSITIONS; i++) {
+            struct timespec t0, t1;
+            float port = 60, stbd = 40;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            geofence_check(&fence, &positions[i], COST_MARGIN_M, &res);
+            geofence_limit_thrust(&res, i % 360, COST_MARGIN_M, COST_ESCAPE_DUTY, &port, &stbd);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            double ns = elapsed_ns(&t0, &t1);
+            if (round == 0 || ns < best[i]) {
+                best[i] = ns;
+            }
+            if (round == 0) {
+                *breaches += res.breached;
+            }
+        }
+    }
+    *mean_ns = 0;
+    *max_ns = 0;
+    for (int i = 0; i < COST_POSITIONS; i++) {
+        *mean_ns += best[i] / COST_POSITIONS;
+        *max_ns = best[i] > *max_ns ? best[i] : *max_ns;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    const geo_point_t ref = { -338567844, 1512152967 };
+    float slowdown = COST_SLOWDOWN;
+    bool ok = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "x:")) != -1) {
+        if (opt == 'x' && atof(optarg) > 0) {
+            slowdown = atof(optarg);
+        } else {
+            fprintf(stderr, "usage: %s [-x slowdown]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("%-12s %8s %9s %8s %8s %10s\n", "case", "vertices", "breached", "mean_ns", "max_ns", "esp32_us");
+    for (int c = 0; c < 2; c++) {
+        const bool clustered = c == 1;
+        double mean_ns, max_ns;
+        int breaches;
+
+        /* Clustered zones overlap around the centre, and the boat is never more than the margin from them */
+        build(&ref, clustered ? 15.0f : 0.8f * COST_AREA_M, clustered ? 5.0f : 40.0f);
+        time_checks(&ref, clustered ? 10.0f : COST_AREA_M, &mean_ns, &max_ns, &breaches);
+        double esp32_us = max_ns * slowdown / 1000;
+        printf("%-12s %8u %9d %8.0f %8.0f %10.1f\n", clustered ? "clustered" : "scattered",
+               (unsigned)def.vertex_total, breaches, mean_ns, max_ns, esp32_us);
+        if (esp32_us > COST_BUDGET_US) {
+            printf("%s: a check would take longer than the %d us budget\n", clustered ? "clustered" : "scattered",
+                   COST_BUDGET_US);
+            ok = false;
+        }
+    }
+    return ok ? 0 : 1;
+}
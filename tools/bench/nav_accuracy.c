@@ -0,0 +1,200 @@
+/* Navigation filter accuracy
+
+   Runs main/nav_filter.c the way the control loop does, stepped every cycle with a compass reading each cycle
+   and a receiver fix with speed and course once a second, against a simulated true track. The fixes and the
+   compass carry white noise the size the filter's default noise model allows for. Each case reports the RMS
+   position error of the filter against the true track next to that of the raw fixes, both taken at the fixes,
+   and the RMS heading error of the filter next to that of the raw compass. Ends with the cost of a predict and
+   of each update. Exits with 1 if the filter does no better than the raw measurements in any case.
+
+   nav_accuracy [-n seconds]
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <math.h>
+#include <time.h>
+#include "nav_filter.h"
+#include "geo.h"
+
+#define ACC_RATE_HZ (10)                /* CONFIG_CONTROL_LOOP_RATE_HZ */
+#define ACC_FIX_HZ (1)                  /* Receiver rate */
+#define ACC_SECONDS (1200)              /* Length of a case */
+#define ACC_SETTLE_S (20)               /* Errors are only counted after this */
+#define ACC_LEG_S (15)                  /* Seconds between changes of speed and turn rate when manoeuvring */
+#define ACC_FIX_SIGMA (1.5f)            /* Receiver position noise, each axis (m) */
+#define ACC_DOP_H (0.9f)                /* HDOP the receiver reports */
+#define ACC_SPEED_SIGMA (0.1f)          /* Receiver velocity noise, each component (m/s) */
+#define ACC_COMPASS_SIGMA (5.0f)        /* Compass noise (degrees) */
+#define ACC_COST_REPEATS (200000)
+
+/**
+ * @brief One simulated track
+ *
+ */
+typedef struct {
+    const char *name;
+    float speed;            /*!< m/s over ground */
+    float turn;             /*!< deg/s */
+    float swing;            /*!< Amplitude of a slow swing of the heading (degrees), as when holding station */
+    bool manoeuvre;         /*!< Pick a new speed and turn rate every ACC_LEG_S */
+} acc_case_t;
+
+static const acc_case_t cases[] = {
+    { "holding, 20 deg swing", 0, 0, 20, false },
+    { "steady 1 m/s", 1.0f, 0, 0, false },
+    { "1 m/s, 5 deg/s turn", 1.0f, 5.0f, 0, false },
+    { "manoeuvring", 0, 0, 0, true },
+};
+
+static uint32_t seed = 12345;
+
+static uint32_t next_rand(void)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+/* Uniform in [lo, hi] */
+static float rand_float(float lo, float hi)
+{
+    return lo + (hi - lo) * (next_rand() / (float)(1 << 24));
+}
+
+/* Normal with the given standard deviation */
+static float rand_normal(float sigma)
+{
+    float u = (next_rand() + 1.0f) / (float)(1 << 24);
+    return sigma * sqrtf(-2.0f * logf(u)) * cosf(2.0f * 3.14159265f * rand_float(0, 1));
+}
+
+static double elapsed_ns(const struct timespec *t0, const struct timespec *t1)
+{
+    return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+/**
+ * @brief Cost of each call the control loop makes, on a settled filter
+ *
+ */
+static void print_cost(const nav_filter_t *settled)
+{
+    nav_filter_t kf = *settled;
+    struct timespec t0, t1;
+    double ns[4];
+
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < ACC_COST_REPEATS; i++) {
+        nav_filter_predict(&kf, 1.0f / ACC_RATE_HZ);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns[0] = elapsed_ns(&t0, &t1);
+    kf = *settled;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < ACC_COST_REPEATS; i++) {
+        nav_filter_update_position(&kf, (i & 7) * 0.1f, (i & 3) * 0.1f, ACC_DOP_H);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns[1] = elapsed_ns(&t0, &t1);
+    kf = *settled;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < ACC_COST_REPEATS; i++) {
+        nav_filter_update_velocity(&kf, 1.0f, (i & 7) * 10.0f);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns[2] = elapsed_ns(&t0, &t1);
+    kf = *settled;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    for (int i = 0; i < ACC_COST_REPEATS; i++) {
+        nav_filter_update_heading(&kf, (i & 7) * 45.0f);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    ns[3] = elapsed_ns(&t0, &t1);
+    printf("ns per call: predict %.0f, position %.0f, velocity %.0f, heading %.0f\n", ns[0] / ACC_COST_REPEATS,
+           ns[1] / ACC_COST_REPEATS, ns[2] / ACC_COST_REPEATS, ns[3] / ACC_COST_REPEATS);
+}
+
+int main(int argc, char **argv)
+{
+    const nav_filter_config_t config = NAV_FILTER_CONFIG_DEFAULT();
+    const float dt = 1.0f / ACC_RATE_HZ;
+    int seconds = ACC_SECONDS;
+    nav_filter_t kf;
+    bool ok = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n' && atoi(optarg) > 2 * ACC_SETTLE_S) {
+            seconds = atoi(optarg);
+        } else {
+            fprintf(stderr, "usage: %s [-n seconds]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("%-24s %9s %9s %11s %11s\n", "case", "kf_pos_m", "fix_pos_m", "kf_hdg_deg", "compass_deg");
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const acc_case_t *ac = &cases[c];
+        float north = 0, east = 0, course = rand_float(0, 360), heading = course;
+        float speed = ac->speed, turn = ac->turn;
+        double sq_kf = 0, sq_fix = 0, sq_kf_hdg = 0, sq_compass = 0;
+        int fixes = 0, cycles = 0;
+
+        nav_filter_init(&kf, &config);
+        for (int i = 0; i < seconds * ACC_RATE_HZ; i++) {
+            const float t = i * dt;
+            const bool counted = t >= ACC_SETTLE_S;
+
+            if (ac->manoeuvre && i % (ACC_LEG_S * ACC_RATE_HZ) == 0) {
+                speed = rand_float(0, 1.5f);
+                turn = rand_float(-6.0f, 6.0f);
+            }
+            course = fmodf(course + turn * dt + 360.0f, 360.0f);
+            heading = fmodf(course + ac->swing * sinf(2.0f * 3.14159265f * t / 60.0f) + 360.0f, 360.0f);
+            north += speed * cosf(course * GEO_DEG_TO_RAD) * dt;
+            east += speed * sinf(course * GEO_DEG_TO_RAD) * dt;
+
+            /* The order of the control loop: predict, the fix when there is one, then the compass */
+            nav_filter_predict(&kf, i > 0 ? dt : 0);
+            if (i % (ACC_RATE_HZ / ACC_FIX_HZ) == 0) {
+                float fn = north + rand_normal(ACC_FIX_SIGMA), fe = east + rand_normal(ACC_FIX_SIGMA);
+                float vn = speed * cosf(course * GEO_DEG_TO_RAD) + rand_normal(ACC_SPEED_SIGMA);
+                float ve = speed * sinf(course * GEO_DEG_TO_RAD) + rand_normal(ACC_SPEED_SIGMA);
+                nav_filter_update_position(&kf, fn, fe, ACC_DOP_H);
+                nav_filter_update_velocity(&kf, sqrtf(vn * vn + ve * ve), geo_bearing_deg(vn, ve));
+                if (counted) {
+                    float en = kf.x[NAV_N] - north, ee = kf.x[NAV_E] - east;
+                    sq_kf += en * en + ee * ee;
+                    sq_fix += (fn - north) * (fn - north) + (fe - east) * (fe - east);
+                    fixes++;
+                }
+            }
+            float compass = fmodf(heading + rand_normal(ACC_COMPASS_SIGMA) + 360.0f, 360.0f);
+            nav_filter_update_heading(&kf, compass);
+            if (counted) {
+                float e_kf = geo_wrap180(kf.x[NAV_PSI] - heading);
+                float e_compass = geo_wrap180(compass - heading);
+                sq_kf_hdg += e_kf * e_kf;
+                sq_compass += e_compass * e_compass;
+                cycles++;
+            }
+        }
+        double kf_pos = sqrt(sq_kf / fixes), fix_pos = sqrt(sq_fix / fixes);
+        double kf_hdg = sqrt(sq_kf_hdg / cycles), compass_hdg = sqrt(sq_compass / cycles);
+        printf("%-24s %9.2f %9.2f %11.2f %11.2f\n", ac->name, kf_pos, fix_pos, kf_hdg, compass_hdg);
+        if (!(kf_pos < fix_pos) || !(kf_hdg < compass_hdg)) {
+            printf("%s: the filter is no better than the raw measurements\n", ac->name);
+            ok = false;
+        }
+    }
+    print_cost(&kf);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,513 @@
+/* Schema encoder and decoder, round trip and cost
+
+   Writes a run of made up fixes with nmea_encode() and reads each sentence back with the decoder, both
+   expanded from main/nmea_schema.h, and checks every field the schema lists comes back to within the
+   decimals it is written with. Then times both per statement, and times the decoder generated from the
+   schema against switches written out by hand in the form the parser had before the schema, for the
+   statements it had them for. Exits with 1 if a field doesn't come back.
+
+   The decoder is compiled into this file, so the hand written switches use its item conversions and
+   tokenizer and only the per-statement switches differ.
+
+   schema_codec [-n fixes]
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <time.h>
+#include <math.h>
+#include "../../main/nmea_decode.c"
+#include "nmea_encoder.h"
+
+#define BENCH_FIXES (2000)
+#define BENCH_ROUNDS (5)                /* Each statement is timed this many times, the fastest counts */
+#define BENCH_OUT_MAX (4 * NMEA_MAX_SENTENCE_LEN + 1)   /* A GSV group of four sentences */
+#define BENCH_REQUIRED (1 << STATEMENT_GGA)             /* Never complete in a round trip of one statement */
+
+static uint32_t seed = 12345;
+
+static uint32_t next_rand(void)
+{
+    seed = seed * 1664525u + 1013904223u;
+    return seed >> 8;
+}
+
+/* Uniform in [lo, hi] */
+static float rand_float(float lo, float hi)
+{
+    return lo + (hi - lo) * (next_rand() / (float)(1 << 24));
+}
+
+static int rand_int(int lo, int hi)
+{
+    return lo + (int)(next_rand() % (uint32_t)(hi - lo + 1));
+}
+
+/**
+ * @brief A fix with every field the schema lists filled in, in the ranges the fields are written for
+ *
+ */
+static void make_fix(gps_t *gps)
+{
+    static const char modes[] = "ADNRFE";
+
+    memset(gps, 0, sizeof(*gps));
+    gps->latitude_e7 = rand_int(-900000000, 900000000);
+    gps->longitude_e7 = rand_int(-1800000000, 1800000000);
+    gps->latitude = gps->latitude_e7 / 1e7f;
+    gps->longitude = gps->longitude_e7 / 1e7f;
+    gps->altitude = rand_float(-100, 4000);
+    gps->fix = rand_int(GPS_FIX_INVALID, GPS_FIX_DGPS);
+    gps->sats_in_use = rand_int(0, 40);
+    gps->tim = (gps_time_t) {
+        rand_int(0, 23), rand_int(0, 59), rand_int(0, 59), rand_int(0, 999)
+    };
+    gps->fix_mode = rand_int(GPS_MODE_INVALID, GPS_MODE_3D);
+    for (int i = 0; i < GPS_MAX_SATELLITES_IN_USE; i++) {
+        gps->sats_id_in_use[i] = rand_int(0, 1) ? rand_int(1, 99) : 0;
+    }
+    gps->dop_h = rand_float(0.5f, 25);
+    gps->dop_p = rand_float(0.5f, 25);
+    gps->dop_v = rand_float(0.5f, 25);
+    gps->sats_in_view = rand_int(0, GPS_MAX_SATELLITES_IN_VIEW);
+    for (int i = 0; i < gps->sats_in_view; i++) {
+        gps->sats_desc_in_view[i] = (gps_satellite_t) {
+            rand_int(1, 99), rand_int(0, 90), rand_int(0, 359), rand_int(0, 99)
+        };
+    }
+    gps->date = (gps_date_t) {
+        rand_int(1, 28), rand_int(1, 12), rand_int(0, 99)
+    };
+    gps->valid = rand_int(0, 1);
+    gps->speed = rand_float(0, 40);
+    gps->cog = rand_float(0, 359.9f);
+    gps->variation = rand_float(-30, 30);
+    gps->error = (gps_error_t) {
+        rand_float(0, 50), rand_float(0, 50), rand_float(0, 50), rand_float(0, 179.9f),
+        rand_float(0, 50), rand_float(0, 50), rand_float(0, 50)
+    };
+    gps->fault = (gps_fault_t) {
+        rand_float(0, 50), rand_float(0, 50), rand_float(0, 50), rand_int(0, 99),
+        rand_float(0, 1), rand_float(-99, 99), rand_float(0, 50)
+    };
+    int systems = rand_int(1, GPS_MAX_SYSTEMS);
+    for (int i = 0; i < systems; i++) {
+        gps->mode[i] = modes[rand_int(0, sizeof(modes) - 2)];
+    }
+    gps->heading = rand_float(0, 359.9f);
+    gps->heading_magnetic = rand_float(0, 359.9f);
+    strcpy(gps->datum, rand_int(0, 1) ? "W84" : "999");
+    gps->datum_offset = (gps_datum_offset_t) {
+        rand_float(-1, 1), rand_float(-1, 1), rand_float(-50, 50)
+    };
+    strcpy(gps->datum_ref, "W84");
+}
+
+/* Field checks by field type: true when the decoded value is what was written, to the decimals written */
+#define SAME_TIME(in, out, dest, scale, arg)                                            \
+    ((in)->dest.hour == (out)->dest.hour && (in)->dest.minute == (out)->dest.minute &&  \
+     (in)->dest.second == (out)->dest.second && (in)->dest.thousand == (out)->dest.thousand)
+#define SAME_DATE(in, out, dest, scale, arg)                                            \
+    ((in)->dest.day == (out)->dest.day && (in)->dest.month == (out)->dest.month &&      \
+     (in)->dest.year == (out)->dest.year)
+/* Written to 1e-4 minute, which is 16.7e-7 degrees, so back to within half that and a rounding */
+#define SAME_LAT(in, out, dest, scale, arg) (abs((in)->dest##_e7 - (out)->dest##_e7) <= 9)
+#define SAME_LON(in, out, dest, scale, arg) SAME_LAT(in, out, dest, scale, arg)
+#define SAME_NS(in, out, dest, scale, arg) true
+#define SAME_EW(in, out, dest, scale, arg) true
+#define SAME_SIGN_NS(in, out, dest, scale, arg) true
+#define SAME_SIGN_EW(in, out, dest, scale, arg) true
+#define SAME_FLOAT(in, out, dest, scale, arg) \
+    (fabsf((in)->dest - (out)->dest) <= (0.5f * powf(10, -(arg)) + 1e-5f * fabsf((in)->dest)) * (scale))
+#define SAME_ABS(in, out, dest, scale, arg) SAME_FLOAT(in, out, dest, scale, arg)
+#define SAME_SUM(in, out, dest, scale, arg) true
+#define SAME_INT(in, out, dest, scale, arg) ((in)->dest == (out)->dest)
+#define SAME_ID(in, out, dest, scale, arg) SAME_INT(in, out, dest, scale, arg)
+#define SAME_YEAR(in, out, dest, scale, arg) SAME_INT(in, out, dest, scale, arg)
+#define SAME_VALID(in, out, dest, scale, arg) SAME_INT(in, out, dest, scale, arg)
+#define SAME_STR(in, out, dest, scale, arg) (strcmp((in)->dest, (out)->dest) == 0)
+#define SAME_CONST(in, out, dest, scale, arg) true
+#define SAME_MSG_COUNT(in, out, dest, scale, arg) true
+#define SAME_MSG_NUM(in, out, dest, scale, arg) true
+#define SAME_SAT(in, out, dest, scale, arg) same_sats(in, out)
+#define SAME_MODE(in, out, dest, scale, arg) SAME_STR(in, out, dest, scale, arg)
+#define SAME_DEVIATION(in, out, dest, scale, arg) true
+#define SAME_DEVIATION_EW(in, out, dest, scale, arg) true
+
+/* The satellites in view, the slots past them are not written */
+static bool same_sats(const gps_t *in, const gps_t *out)
+{
+    for (int i = 0; i < in->sats_in_view; i++) {
+        if (memcmp(&in->sats_desc_in_view[i], &out->sats_desc_in_view[i], sizeof(gps_satellite_t))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+#define CHECK_FIELD(index, type, dest, scale, arg)                                      \
+    if (!SAME_##type(in, out, dest, scale, arg)) {                                      \
+        printf("%s field %d (%s) does not come back\n", name, index, #dest);            \
+        return false;                                                                   \
+    }
+
+/* check_gga(), check_gsa()... every field of one statement */
+#define CHECK_FUNC(NAME, name_, fields)                                                 \
+    static bool check_##name_(const gps_t *in, const gps_t *out)                        \
+    {                                                                                   \
+        const char *name = #NAME;                                                       \
+        NMEA_FIELDS_##NAME(CHECK_FIELD)                                                 \
+        return true;                                                                    \
+    }
+NMEA_STATEMENT_LIST(CHECK_FUNC)
+
+static bool check_statement(nmea_statement_t statement, const gps_t *in, const gps_t *out)
+{
+    switch (statement) {
+#define CHECK_CASE(NAME, name, fields)      \
+    case STATEMENT_##NAME:                  \
+        return check_##name(in, out);
+        NMEA_STATEMENT_LIST(CHECK_CASE)
+#undef CHECK_CASE
+    default:
+        return false;
+    }
+}
+
+/**
+ * @brief Hand written GGA, GSA and RMC switches, as the parser had them before the schema
+ *
+ */
+static void ref_parse_gga(nmea_decoder_t *dec)
+{
+    switch (dec->item_num) {
+    case 1: /* Process UTC time */
+        parse_utc_time(dec, &dec->gps.tim);
+        break;
+    case 2: /* Latitude */
+        dec->gps.latitude = parse_lat_long(dec, &dec->gps.latitude_e7);
+        break;
+    case 3: /* Latitude north(1)/south(-1) information */
+        if (dec->item_str[0] == 'S' || dec->item_str[0] == 's') {
+            dec->gps.latitude *= -1;
+            dec->gps.latitude_e7 *= -1;
+        }
+        break;
+    case 4: /* Longitude */
+        dec->gps.longitude = parse_lat_long(dec, &dec->gps.longitude_e7);
+        break;
+    case 5: /* Longitude east(1)/west(-1) information */
+        if (dec->item_str[0] == 'W' || dec->item_str[0] == 'w') {
+            dec->gps.longitude *= -1;
+            dec->gps.longitude_e7 *= -1;
+        }
+        break;
+    case 6: /* Fix status */
+        dec->gps.fix = (gps_fix_t)item_int(dec);
+        break;
+    case 7: /* Satellites in use */
+        dec->gps.sats_in_use = (uint8_t)item_int(dec);
+        break;
+    case 8: /* HDOP */
+        dec->gps.dop_h = item_float(dec);
+        break;
+    case 9: /* Altitude */
+        dec->gps.altitude = item_float(dec);
+        break;
+    case 11: /* Altitude above ellipsoid */
+        dec->gps.altitude += item_float(dec);
+        break;
+    default:
+        break;
+    }
+}
+
+static void ref_parse_gsa(nmea_decoder_t *dec)
+{
+    switch (dec->item_num) {
+    case 2: /* Process fix mode */
+        dec->gps.fix_mode = (gps_fix_mode_t)item_int(dec);
+        break;
+    case 15: /* Process PDOP */
+        dec->gps.dop_p = item_float(dec);
+        break;
+    case 16: /* Process HDOP */
+        dec->gps.dop_h = item_float(dec);
+        break;
+    case 17: /* Process VDOP */
+        dec->gps.dop_v = item_float(dec);
+        break;
+    default:
+        /* Parse satellite IDs */
+        if (dec->item_num >= 3 && dec->item_num <= 14) {
+            dec->gps.sats_id_in_use[dec->item_num - 3] = (uint8_t)item_int(dec);
+        }
+        break;
+    }
+}
+
+static void ref_parse_rmc(nmea_decoder_t *dec)
+{
+    switch (dec->item_num) {
+    case 1: /* Process UTC time */
+        parse_utc_time(dec, &dec->gps.tim);
+        break;
+    case 2: /* Process valid status */
+        dec->gps.valid = (dec->item_str[0] == 'A');
+        break;
+    case 3: /* Latitude */
+        dec->gps.latitude = parse_lat_long(dec, &dec->gps.latitude_e7);
+        break;
+    case 4: /* Latitude north(1)/south(-1) information */
+        if (dec->item_str[0] == 'S' || dec->item_str[0] == 's') {
+            dec->gps.latitude *= -1;
+            dec->gps.latitude_e7 *= -1;
+        }
+        break;
+    case 5: /* Longitude */
+        dec->gps.longitude = parse_lat_long(dec, &dec->gps.longitude_e7);
+        break;
+    case 6: /* Longitude east(1)/west(-1) information */
+        if (dec->item_str[0] == 'W' || dec->item_str[0] == 'w') {
+            dec->gps.longitude *= -1;
+            dec->gps.longitude_e7 *= -1;
+        }
+        break;
+    case 7: /* Process ground speed in unit m/s */
+        dec->gps.speed = item_float(dec) * NMEA_KNOTS;
+        break;
+    case 8: /* Process true course over ground */
+        dec->gps.cog = item_float(dec);
+        break;
+    case 9: /* Process date */
+        dec->gps.date.day = convert_two_digit2number(dec->item_str + 0);
+        dec->gps.date.month = convert_two_digit2number(dec->item_str + 2);
+        dec->gps.date.year = convert_two_digit2number(dec->item_str + 4);
+        break;
+    case 10: /* Process magnetic variation */
+        dec->gps.variation = item_float(dec);
+        break;
+    case 11: /* Magnetic variation east or west */
+        if (dec->item_str[0] == 'W' || dec->item_str[0] == 'w') {
+            dec->gps.variation *= -1;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+static void ref_parse_item(nmea_decoder_t *dec)
+{
+    if (dec->item_num == 0 && dec->item_str[0] == '$') {
+        if (strstr(dec->item_str, "GGA")) {
+            dec->statement = STATEMENT_GGA;
+        } else if (strstr(dec->item_str, "GSA")) {
+            dec->statement = STATEMENT_GSA;
+        } else if (strstr(dec->item_str, "RMC")) {
+            dec->statement = STATEMENT_RMC;
+        } else {
+            dec->statement = STATEMENT_UNKNOWN;
+        }
+        return;
+    }
+    if (dec->statement == STATEMENT_GGA) {
+        ref_parse_gga(dec);
+    } else if (dec->statement == STATEMENT_GSA) {
+        ref_parse_gsa(dec);
+    } else if (dec->statement == STATEMENT_RMC) {
+        ref_parse_rmc(dec);
+    }
+}
+
+/**
+ * @brief nmea_decode_line() with the hand written switches
+ *
+ */
+static nmea_decode_result_t ref_decode_line(nmea_decoder_t *dec, const char *line)
+{
+    uint8_t crc = 0;
+    bool asterisk = false;
+    size_t item_pos = 0;
+
+    for (const char *d = line; *d && *d != '\r' && *d != '\n'; d++) {
+        if (*d == '$') {
+            asterisk = false;
+            item_pos = 0;
+            crc = 0;
+            dec->item_num = 0;
+            dec->statement = STATEMENT_UNKNOWN;
+            dec->item_str[item_pos++] = *d;
+        } else if (*d == ',') {
+            dec->item_str[item_pos] = '\0';
+            ref_parse_item(dec);
+            crc ^= (uint8_t)(*d);
+            item_pos = 0;
+            dec->item_num++;
+        } else if (*d == '*') {
+            dec->item_str[item_pos] = '\0';
+            ref_parse_item(dec);
+            asterisk = true;
+            item_pos = 0;
+            dec->item_num++;
+        } else {
+            if (!asterisk) {
+                crc ^= (uint8_t)(*d);
+            }
+            if (item_pos < NMEA_MAX_STATEMENT_ITEM_LENGTH - 1) {
+                dec->item_str[item_pos++] = *d;
+            }
+        }
+    }
+    dec->item_str[item_pos] = '\0';
+    if (!asterisk || (uint8_t)strtol(dec->item_str, NULL, 16) != crc) {
+        return NMEA_DECODE_CRC_ERROR;
+    }
+    return NMEA_DECODE_OK;
+}
+
+/* Sentences of one statement for every fix, one line after another */
+typedef struct {
+    char *text;
+    size_t len;
+    int lines;
+} run_t;
+
+static double now_ns(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+/* Decode every line of a run, with the schema's decoder or the hand written one */
+static double time_decode(const run_t *run, bool reference)
+{
+    static nmea_decoder_t dec;
+    double best = 0;
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        nmea_decoder_init(&dec);
+        double t0 = now_ns();
+        for (const char *line = run->text; *line; line += strcspn(line, "\n") + 1) {
+            if (reference) {
+                ref_decode_line(&dec, line);
+            } else {
+                nmea_decode_line(&dec, line, BENCH_REQUIRED);
+            }
+        }
+        double ns = now_ns() - t0;
+        if (round == 0 || ns < best) {
+            best = ns;
+        }
+    }
+    return best / run->lines;
+}
+
+int main(int argc, char **argv)
+{
+    static const struct {
+        nmea_statement_t statement;
+        const char *name;
+        bool has_reference;
+    } statements[] = {
+#define BENCH_ENTRY(NAME, name, fields) { STATEMENT_##NAME, #NAME,                                      \
+            STATEMENT_##NAME == STATEMENT_GGA || STATEMENT_##NAME == STATEMENT_GSA ||                   \
+            STATEMENT_##NAME == STATEMENT_RMC },
+        NMEA_STATEMENT_LIST(BENCH_ENTRY)
+#undef BENCH_ENTRY
+    };
+    static nmea_decoder_t dec;
+    int fixes = BENCH_FIXES;
+    bool ok = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n' && atoi(optarg) > 0) {
+            fixes = atoi(optarg);
+        } else {
+            fprintf(stderr, "usage: %s [-n fixes]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    gps_t *run_fixes = malloc(fixes * sizeof(gps_t));
+    if (!run_fixes) {
+        return 2;
+    }
+    for (int i = 0; i < fixes; i++) {
+        make_fix(&run_fixes[i]);
+    }
+
+    printf("%-4s %6s %10s %10s %10s\n", "stmt", "lines", "encode ns", "decode ns", "by hand ns");
+    for (size_t s = 0; s < sizeof(statements) / sizeof(statements[0]); s++) {
+        const nmea_statement_t statement = statements[s].statement;
+        run_t run = { .text = malloc((size_t)fixes * BENCH_OUT_MAX + 1) };
+        bool round_trip = true;
+
+        if (!run.text) {
+            return 2;
+        }
+        /* Round trip, each fix into a clean decoder so nothing is left over from the fix before */
+        for (int i = 0; i < fixes && round_trip; i++) {
+            char *out = run.text + run.len;
+            int n = nmea_encode(statement, "GN", &run_fixes[i], out, BENCH_OUT_MAX);
+            if (n < 0) {
+                printf("%s does not fit\n", statements[s].name);
+                round_trip = false;
+                break;
+            }
+            nmea_decoder_init(&dec);
+            for (const char *line = out; *line; line += strcspn(line, "\n") + 1) {
+                if (nmea_decode_line(&dec, line, BENCH_REQUIRED) == NMEA_DECODE_CRC_ERROR ||
+                        dec.statement != statement) {
+                    printf("%s does not decode: %.*s\n", statements[s].name, (int)strcspn(line, "\r"), line);
+                    round_trip = false;
+                    break;
+                }
+                run.lines++;
+            }
+            if (round_trip && !check_statement(statement, &run_fixes[i], &dec.gps)) {
+                printf("  in %.*s\n", (int)strcspn(out, "\r"), out);
+                round_trip = false;
+            }
+            run.len += n;
+        }
+        if (!round_trip) {
+            ok = false;
+            free(run.text);
+            continue;
+        }
+
+        double best_encode = 0;
+        for (int round = 0; round < BENCH_ROUNDS; round++) {
+            char out[BENCH_OUT_MAX];
+            double t0 = now_ns();
+            for (int i = 0; i < fixes; i++) {
+                nmea_encode(statement, "GN", &run_fixes[i], out, sizeof(out));
+            }
+            double ns = now_ns() - t0;
+            if (round == 0 || ns < best_encode) {
+                best_encode = ns;
+            }
+        }
+        printf("%-4s %6d %10.0f %10.0f", statements[s].name, run.lines, best_encode / run.lines,
+               time_decode(&run, false));
+        if (statements[s].has_reference) {
+            printf(" %10.0f", time_decode(&run, true));
+        }
+        printf("\n");
+        free(run.text);
+    }
+    free(run_fixes);
+    return ok ? 0 : 1;
+}
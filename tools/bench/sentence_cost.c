@@ -0,0 +1,107 @@
+/* Decode cost per sentence
+
+   Decodes one typical sentence of each statement over and over through main/nmea_decode.c, the way the
+   parser task decodes a line, and reports the time per sentence and per byte. A proprietary sentence the
+   decoder doesn't know shows the cost of checksumming alone. Exits with 1 if a sentence doesn't decode
+   as its own statement.
+
+   sentence_cost [-n repeats]
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <time.h>
+#include "nmea_decode.h"
+
+#define COST_REPEATS (200000)
+#define COST_ROUNDS (5)                 /* Each sentence is timed this many times, the fastest counts */
+
+/**
+ * @brief One sentence to time, the checksum is added at start up
+ *
+ */
+typedef struct {
+    const char *name;
+    nmea_statement_t statement;
+    const char *body;
+} cost_case_t;
+
+static const cost_case_t cases[] = {
+    { "GGA", STATEMENT_GGA, "GNGGA,123456.70,5130.12345,N,00006.54321,W,2,14,0.8,12.3,M,47.0,M,,"},
+    { "GSA", STATEMENT_GSA, "GNGSA,A,3,02,05,07,09,13,15,18,20,23,26,30,31,1.4,0.8,1.1"},
+    { "RMC", STATEMENT_RMC, "GNRMC,123456.70,A,5130.12345,N,00006.54321,W,2.0,271.5,010524,1.2,W,D"},
+    { "GSV", STATEMENT_GSV, "GPGSV,1,1,04,02,45,123,41,05,30,045,38,07,62,300,44,09,12,210,30"},
+    { "GLL", STATEMENT_GLL, "GNGLL,5130.12345,N,00006.54321,W,123456.70,A,D"},
+    { "VTG", STATEMENT_VTG, "GNVTG,271.5,T,272.7,M,2.0,N,3.7,K,D"},
+    { "GST", STATEMENT_GST, "GNGST,123456.70,1.5,2.1,1.1,35.0,1.3,1.8,2.9"},
+    { "ZDA", STATEMENT_ZDA, "GNZDA,123456.70,01,05,2024,00,00"},
+    { "GNS", STATEMENT_GNS, "GNGNS,123456.70,5130.12345,N,00006.54321,W,DAN,14,0.8,12.3,47.0,,"},
+    { "GBS", STATEMENT_GBS, "GNGBS,123456.70,1.4,1.9,3.2,18,0.012,-21.5,3.4"},
+    { "HDT", STATEMENT_HDT, "HEHDT,274.2,T"},
+    { "HDG", STATEMENT_HDG, "HCHDG,358.0,3.5,E,1.2,W"},
+    { "DTM", STATEMENT_DTM, "GPDTM,W84,,0.0,N,0.0,E,0.0,W84"},
+    { "PUBX", STATEMENT_UNKNOWN, "PUBX,00,123456.70,5130.12345,N,00006.54321,W,59.3,G3,1.3,1.8,0.0,0.0,0.0,,0.8,1.1,0.9,14,0,0"},
+};
+
+int main(int argc, char **argv)
+{
+    static nmea_decoder_t dec;
+    int repeats = COST_REPEATS;
+    bool ok = true;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n' && atoi(optarg) > 0) {
+            repeats = atoi(optarg);
+        } else {
+            fprintf(stderr, "usage: %s [-n repeats]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    printf("%-6s %6s %9s %8s\n", "stmt", "bytes", "ns", "ns/byte");
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const cost_case_t *cc = &cases[c];
+        char line[160];
+        uint8_t crc = 0;
+        double best_ns = 0;
+
+        for (const char *p = cc->body; *p; p++) {
+            crc ^= (uint8_t)*p;
+        }
+        int len = snprintf(line, sizeof(line), "$%s*%02X\r\n", cc->body, crc);
+
+        /* Only this statement is required, so every line is an update as it would be at the end of an epoch */
+        const uint32_t required = cc->statement == STATEMENT_UNKNOWN ? 1 << STATEMENT_GGA : 1 << cc->statement;
+        nmea_decoder_init(&dec);
+        nmea_decode_result_t res = nmea_decode_line(&dec, line, required);
+        if (res == NMEA_DECODE_CRC_ERROR || dec.statement != cc->statement) {
+            printf("%-6s does not decode\n", cc->name);
+            ok = false;
+            continue;
+        }
+        for (int round = 0; round < COST_ROUNDS; round++) {
+            struct timespec t0, t1;
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            for (int i = 0; i < repeats; i++) {
+                nmea_decode_line(&dec, line, required);
+            }
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            double ns = (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+            if (round == 0 || ns < best_ns) {
+                best_ns = ns;
+            }
+        }
+        printf("%-6s %6d %9.0f %8.2f\n", cc->name, len, best_ns / repeats, best_ns / repeats / len);
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,337 @@
+/* NMEA server over loopback, throughput and lag
+
+   Runs main/nmea_server.c on the host and connects TCP clients to it over loopback: readers that take
+   everything as it comes, and one that never reads, with a small receive buffer. Sentences are published
+   at each rate in turn, in steps of a millisecond, each carrying a sequence number and the time it was
+   published. For each rate it reports the time a publish takes, sentences dropped because the ring was
+   full, the share of sentences the readers got with their delay from publish to receipt, and how often
+   the readers and the stalled client skipped ahead. Exits with 1 if a reader gets a sentence broken
+   or out of order, or misses any at the first rate.
+
+   UDP broadcast is left off, a host without a network interface has nowhere to broadcast.
+
+   server_loopback [-p port] [-r rate,rate...] [-d ms per rate]
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <unistd.h>
+#include <time.h>
+#include <pthread.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "sdkconfig.h"
+#include "esp_timer.h"
+#include "nmea_server.h"
+
+#define LOOP_READERS (CONFIG_NMEA_SERVER_MAX_CLIENTS - 1)   /* The last slot is the stalled client */
+#define LOOP_MAX_RATES (8)
+#define LOOP_STALLED_RCVBUF (2048)
+#define LOOP_MISSING (UINT32_MAX)
+
+/* The server's rate counter runs on the host clock, the test clock in host/esp_timer.c is not linked */
+int64_t esp_timer_get_time(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec * 1000000LL + t.tv_nsec / 1000;
+}
+
+/**
+ * @brief A reading client
+ *
+ */
+typedef struct {
+    int fd;
+    pthread_t thread;
+    uint32_t *delay_us;         /*!< Per sequence number, LOOP_MISSING until it arrives */
+    uint32_t total;             /*!< Sentences that will be published */
+    uint32_t bad;               /*!< Sentences with a wrong checksum or out of order */
+    uint32_t cut;               /*!< Sentences cut short by a skip, the next one runs on from them */
+} reader_t;
+
+static atomic_bool publishing_done;
+
+static int connect_client(uint16_t port, int rcvbuf)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_LOOPBACK),
+    };
+    struct timeval timeout = { .tv_sec = 1 };
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    if (rcvbuf) {
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    }
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* Check one received sentence and note when it came */
+static void reader_line(reader_t *r, const char *line, size_t len, int64_t now_us, uint32_t *next_seq)
+{
+    uint8_t crc = 0;
+    size_t i;
+    unsigned seq, sum;
+    long long sent_us;
+
+    for (i = 1; i < len && line[i] != '*'; i++) {
+        crc ^= (uint8_t)line[i];
+    }
+    /* The server may cut the sentence it was in the middle of when a client skips ahead */
+    if (memchr(line + 1, '$', len - 1)) {
+        r->cut++;
+        return;
+    }
+    if (line[0] != '$' || sscanf(line, "$PLOOP,%u,%lld,", &seq, &sent_us) != 2 || i + 3 > len ||
+            sscanf(line + i, "*%2X", &sum) != 1 || sum != crc || seq >= r->total || seq < *next_seq) {
+        r->bad++;
+        return;
+    }
+    r->delay_us[seq] = (uint32_t)(now_us - sent_us);
+    *next_seq = seq + 1;
+}
+
+static void *reader_entry(void *arg)
+{
+    reader_t *r = arg;
+    char buf[4096];
+    size_t have = 0;
+    uint32_t next_seq = 0;
+
+    while (1) {
+        ssize_t n = recv(r->fd, buf + have, sizeof(buf) - have, 0);
+        if (n <= 0) {
+            /* Nothing for a second after the last sentence, or the server closed */
+            if (n < 0 && !atomic_load(&publishing_done)) {
+                continue;
+            }
+            break;
+        }
+        int64_t now_us = esp_timer_get_time();
+        have += n;
+        char *start = buf;
+        char *end;
+        while ((end = memchr(start, '\n', buf + have - start))) {
+            reader_line(r, start, end + 1 - start, now_us, &next_seq);
+            start = end + 1;
+        }
+        have = buf + have - start;
+        memmove(buf, start, have);
+        if (have == sizeof(buf)) {
+            r->bad++;
+            have = 0;
+        }
+    }
+    return NULL;
+}
+
+/* Sleep until an absolute time on the monotonic clock */
+static void sleep_until(int64_t us)
+{
+    struct timespec t = { .tv_sec = us / 1000000, .tv_nsec = us % 1000000 * 1000 };
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL);
+}
+
+static bool wait_accepted(uint32_t count)
+{
+    nmea_server_stats_t stats;
+    for (int i = 0; i < 200; i++) {
+        nmea_server_get_stats(&stats);
+        if (stats.accepted >= count) {
+            return true;
+        }
+        usleep(10000);
+    }
+    return false;
+}
+
+int main(int argc, char **argv)
+{
+    nmea_server_config_t config = NMEA_SERVER_CONFIG_DEFAULT();
+    uint32_t rates[LOOP_MAX_RATES] = { 500, 2000, 8000 };
+    int num_rates = 3;
+    int phase_ms = 1000;
+    static reader_t readers[LOOP_READERS];
+    static nmea_server_stats_t stats;
+    bool ok = true;
+    int opt;
+
+    config.udp_broadcast = false;
+    while ((opt = getopt(argc, argv, "p:r:d:")) != -1) {
+        if (opt == 'p' && atoi(optarg) > 0) {
+            config.port = atoi(optarg);
+        } else if (opt == 'r') {
+            num_rates = 0;
+            for (char *s = strtok(optarg, ","); s && num_rates < LOOP_MAX_RATES; s = strtok(NULL, ",")) {
+                rates[num_rates] = atoi(s);
+                if (rates[num_rates] > 0) {
+                    num_rates++;
+                }
+            }
+        } else if (opt == 'd' && atoi(optarg) > 0) {
+            phase_ms = atoi(optarg);
+        } else {
+            fprintf(stderr, "usage: %s [-p port] [-r rate,rate...] [-d ms per rate]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (num_rates == 0) {
+        return 2;
+    }
+
+    uint32_t total = 0;
+    uint32_t first_seq[LOOP_MAX_RATES + 1];
+    for (int p = 0; p < num_rates; p++) {
+        first_seq[p] = total;
+        total += (uint64_t)rates[p] * phase_ms / 1000;
+    }
+    first_seq[num_rates] = total;
+
+    if (nmea_server_init(&config) != ESP_OK) {
+        return 2;
+    }
+    for (int c = 0; c < LOOP_READERS; c++) {
+        reader_t *r = &readers[c];
+        r->total = total;
+        r->delay_us = malloc(total * sizeof(uint32_t));
+        r->fd = connect_client(config.port, 0);
+        if (!r->delay_us || r->fd < 0 || !wait_accepted(c + 1)) {
+            fprintf(stderr, "reader %d could not connect\n", c);
+            return 2;
+        }
+        memset(r->delay_us, 0xff, total * sizeof(uint32_t));
+        pthread_create(&r->thread, NULL, reader_entry, r);
+    }
+    int stalled_fd = connect_client(config.port, LOOP_STALLED_RCVBUF);
+    if (stalled_fd < 0 || !wait_accepted(LOOP_READERS + 1)) {
+        fprintf(stderr, "stalled client could not connect\n");
+        return 2;
+    }
+
+    printf("%d readers and a stalled client, %u byte ring, %d ms per rate\n", LOOP_READERS,
+           (unsigned)config.ring_size, phase_ms);
+    printf("%6s %7s %10s %8s %9s %8s %8s %6s %8s\n", "rate/s", "kB/s", "publish ns", "dropped", "received",
+           "mean ms", "max ms", "skips", "stalled");
+
+    uint32_t seq = 0;
+    uint32_t dropped_before = 0;
+    uint32_t skips_before[CONFIG_NMEA_SERVER_MAX_CLIENTS] = { 0 };
+    double phase_publish_ns[LOOP_MAX_RATES];
+    uint32_t phase_bytes[LOOP_MAX_RATES];
+    uint32_t phase_dropped[LOOP_MAX_RATES];
+    uint32_t phase_skips[LOOP_MAX_RATES];       /* By the readers */
+    uint32_t phase_stalled_skips[LOOP_MAX_RATES];
+
+    for (int p = 0; p < num_rates; p++) {
+        const int ticks = phase_ms;
+        double publish_ns = 0;
+        uint32_t bytes = 0;
+        int64_t tick_us = esp_timer_get_time();
+
+        for (int t = 0; t < ticks; t++) {
+            /* Spread the rate over the millisecond ticks */
+            uint32_t due = first_seq[p] + (uint64_t)rates[p] * (t + 1) / 1000;
+            if (due > first_seq[p + 1]) {
+                due = first_seq[p + 1];
+            }
+            for (; seq < due; seq++) {
+                char body[96], line[104];
+                int64_t now_us = esp_timer_get_time();
+                uint8_t crc = 0;
+                snprintf(body, sizeof(body), "PLOOP,%u,%lld,ABCDEFGHIJKLMNOPQRSTUVWXYZ", (unsigned)seq,
+                         (long long)now_us);
+                for (const char *c = body; *c; c++) {
+                    crc ^= (uint8_t)*c;
+                }
+                int len = snprintf(line, sizeof(line), "$%s*%02X\r\n", body, crc);
+                struct timespec t0, t1;
+                clock_gettime(CLOCK_MONOTONIC, &t0);
+                nmea_server_publish(line, len);
+                clock_gettime(CLOCK_MONOTONIC, &t1);
+                publish_ns += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+                bytes += len;
+            }
+            tick_us += 1000;
+            sleep_until(tick_us);
+        }
+        /* Let the server catch up before the next rate */
+        usleep(100000);
+        nmea_server_get_stats(&stats);
+        phase_publish_ns[p] = publish_ns / (first_seq[p + 1] - first_seq[p]);
+        phase_bytes[p] = bytes;
+        phase_dropped[p] = stats.dropped - dropped_before;
+        phase_skips[p] = 0;
+        for (int c = 0; c < LOOP_READERS; c++) {
+            phase_skips[p] += stats.clients[c].skips - skips_before[c];
+        }
+        phase_stalled_skips[p] = stats.clients[LOOP_READERS].skips - skips_before[LOOP_READERS];
+        dropped_before = stats.dropped;
+        for (int c = 0; c < CONFIG_NMEA_SERVER_MAX_CLIENTS; c++) {
+            skips_before[c] = stats.clients[c].skips;
+        }
+    }
+    atomic_store(&publishing_done, true);
+    for (int c = 0; c < LOOP_READERS; c++) {
+        pthread_join(readers[c].thread, NULL);
+    }
+
+    for (int p = 0; p < num_rates; p++) {
+        const uint32_t count = first_seq[p + 1] - first_seq[p];
+        uint32_t received = 0;
+        uint32_t max_us = 0;
+        double sum_us = 0;
+        for (int c = 0; c < LOOP_READERS; c++) {
+            for (uint32_t s = first_seq[p]; s < first_seq[p + 1]; s++) {
+                uint32_t d = readers[c].delay_us[s];
+                if (d != LOOP_MISSING) {
+                    received++;
+                    sum_us += d;
+                    if (d > max_us) {
+                        max_us = d;
+                    }
+                }
+            }
+        }
+        printf("%6u %7.1f %10.0f %8u %8.1f%% %8.2f %8.2f %6u %8u\n", (unsigned)rates[p],
+               phase_bytes[p] / 1000.0 / (phase_ms / 1000.0), phase_publish_ns[p], (unsigned)phase_dropped[p],
+               100.0 * received / ((double)count * LOOP_READERS), received ? sum_us / received / 1000 : 0,
+               max_us / 1000.0, (unsigned)phase_skips[p], (unsigned)phase_stalled_skips[p]);
+        if (p == 0 && received != count * LOOP_READERS) {
+            printf("readers missed sentences at %u/s\n", (unsigned)rates[p]);
+            ok = false;
+        }
+    }
+    for (int c = 0; c < LOOP_READERS; c++) {
+        if (readers[c].bad) {
+            printf("reader %d got %u broken or out of order sentences\n", c, (unsigned)readers[c].bad);
+            ok = false;
+        }
+        if (readers[c].cut) {
+            printf("reader %d got %u sentences cut short by skipping ahead\n", c, (unsigned)readers[c].cut);
+        }
+    }
+    nmea_server_get_stats(&stats);
+    printf("stalled client: %u skips, %u bytes skipped, %u bytes sent\n", (unsigned)stats.clients[LOOP_READERS].skips,
+           (unsigned)stats.clients[LOOP_READERS].skipped, (unsigned)stats.clients[LOOP_READERS].sent);
+    close(stalled_fd);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,147 @@
+/* Station keeping controller step response
+
+   Runs main/station_controller.c against a simple model of the boat: two fixed forward thrusters, thrust
+   against quadratic drag along the heading and differential thrust against yaw damping, plus a steady
+   current. Each case puts the target some distance away at some bearing relative to the bow and steps the
+   controller at the control loop rate until the boat has been holding for a while. Reports how long the
+   boat took to reach the deadband, how far it went past the target, where it settled, the duty spent and
+   the cost of one controller update. Exits with 1 if a case never settles.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <math.h>
+#include <time.h>
+#include "station_controller.h"
+#include "geo.h"
+
+#define STEP_RATE_HZ (10)               /* CONFIG_CONTROL_LOOP_RATE_HZ */
+#define STEP_SECONDS (300)              /* Length of a case */
+#define STEP_SETTLE_SECONDS (60)        /* Final range is averaged over the end of the case */
+#define BOAT_MAX_SPEED (1.5f)           /* m/s at full duty on both motors */
+#define BOAT_SURGE_TAU (3.0f)           /* Seconds to come up to speed */
+#define BOAT_MAX_YAW_RATE (40.0f)       /* deg/s with one motor full and the other off */
+#define BOAT_YAW_TAU (1.0f)             /* Seconds for the turn rate to settle */
+
+/**
+ * @brief One step of the target
+ *
+ */
+typedef struct {
+    const char *name;
+    float range_m;          /*!< Target distance at the start */
+    float relative_deg;     /*!< Target bearing from the bow at the start */
+    float current_mps;      /*!< Current, setting the boat away from the target */
+} step_case_t;
+
+/**
+ * @brief Boat state, north/east relative to the target
+ *
+ */
+typedef struct {
+    float north, east;      /*!< Position (metres) */
+    float heading;          /*!< Degrees true */
+    float speed;            /*!< Through the water along the heading (m/s) */
+    float yaw_rate;         /*!< deg/s */
+} boat_t;
+
+static const step_case_t cases[] = {
+    { "10 m ahead", 10, 0, 0 },
+    { "20 m ahead", 20, 0, 0 },
+    { "50 m ahead", 50, 0, 0 },
+    { "20 m abeam", 20, 90, 0 },
+    { "20 m astern", 20, 180, 0 },
+    { "20 m, 0.2 m/s set", 20, 0, 0.2f },
+    { "20 m abeam, 0.3 m/s set", 20, 90, 0.3f },
+};
+
+static void boat_step(boat_t *boat, float port, float stbd, float set_deg, float current, float dt)
+{
+    float thrust = (port + stbd) / 200.0f;
+    float turn = (port - stbd) / 100.0f;
+    float target_speed = BOAT_MAX_SPEED * sqrtf(thrust);    /* thrust balances drag growing with speed squared */
+    float heading = boat->heading * GEO_DEG_TO_RAD;
+
+    boat->speed += (target_speed - boat->speed) * dt / BOAT_SURGE_TAU;
+    boat->yaw_rate += (BOAT_MAX_YAW_RATE * turn - boat->yaw_rate) * dt / BOAT_YAW_TAU;
+    boat->heading = fmodf(boat->heading + boat->yaw_rate * dt + 360.0f, 360.0f);
+    boat->north += (boat->speed * cosf(heading) + current * cosf(set_deg * GEO_DEG_TO_RAD)) * dt;
+    boat->east += (boat->speed * sinf(heading) + current * sinf(set_deg * GEO_DEG_TO_RAD)) * dt;
+}
+
+int main(void)
+{
+    const station_controller_config_t config = STATION_CONTROLLER_CONFIG_DEFAULT();
+    const int steps = STEP_SECONDS * STEP_RATE_HZ;
+    const float dt = 1.0f / STEP_RATE_HZ;
+    station_controller_t ctl;
+    station_controller_input_t in = { .gain = 100, .dt = dt };
+    station_controller_output_t out;
+    struct timespec t0, t1;
+    double update_ns = 0;
+    long updates = 0;
+    bool ok = true;
+
+    printf("%-26s %8s %9s %9s %9s %9s %6s\n", "case", "arrive_s", "past_m", "settle_m", "max_m", "duty_%", "hold_%");
+    for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++) {
+        const step_case_t *sc = &cases[c];
+        /* Boat at the origin heading north, the target placed relative to the bow */
+        boat_t boat = {
+            .north = -sc->range_m * cosf(sc->relative_deg * GEO_DEG_TO_RAD),
+            .east = -sc->range_m * sinf(sc->relative_deg * GEO_DEG_TO_RAD),
+        };
+        float approach_n = -boat.north / sc->range_m, approach_e = -boat.east / sc->range_m;
+        float set_deg = geo_bearing_deg(boat.north, boat.east);
+        float arrive_s = -1, past_m = 0, max_m = 0, duty = 0, settle_sum = 0;
+        int holding = 0, settle_n = 0;
+
+        station_controller_init(&ctl, &config);
+        for (int i = 0; i < steps; i++) {
+            float range = sqrtf(boat.north * boat.north + boat.east * boat.east);
+            in.range_m = range;
+            in.bearing_error_deg = geo_wrap180(geo_bearing_deg(-boat.north, -boat.east) - boat.heading);
+            in.heading_deg = boat.heading;
+            /* What a converged drift estimate would give */
+            in.drift_away_mps = sc->current_mps;
+
+            clock_gettime(CLOCK_MONOTONIC, &t0);
+            station_controller_update(&ctl, &in, &out);
+            clock_gettime(CLOCK_MONOTONIC, &t1);
+            update_ns += (t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec);
+            updates++;
+
+            if (arrive_s < 0 && range < config.deadband_m) {
+                arrive_s = i * dt;
+            }
+            if (arrive_s >= 0) {
+                /* Distance beyond the target along the line it was approached on */
+                float beyond = boat.north * approach_n + boat.east * approach_e;
+                past_m = fmaxf(past_m, beyond);
+                max_m = fmaxf(max_m, range);
+            }
+            if (i >= steps - STEP_SETTLE_SECONDS * STEP_RATE_HZ) {
+                settle_sum += range;
+                settle_n++;
+            }
+            holding += out.holding;
+            duty += (out.port + out.stbd) / 2;
+            boat_step(&boat, out.port, out.stbd, set_deg, sc->current_mps, dt);
+        }
+        float settle_m = settle_sum / settle_n;
+        printf("%-26s %8.1f %9.2f %9.2f %9.2f %9.1f %6.1f\n", sc->name, arrive_s, past_m, settle_m, max_m,
+               duty / steps, 100.0f * holding / steps);
+        if (arrive_s < 0 || settle_m > config.deadband_exit_m) {
+            printf("  did not settle inside %.1f m\n", config.deadband_exit_m);
+            ok = false;
+        }
+    }
+    printf("update: %.0f ns\n", update_ns / updates);
+    return ok ? 0 : 1;
+}
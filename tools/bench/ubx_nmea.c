@@ -0,0 +1,232 @@
+/* CPU per epoch, UBX NAV-PVT against NMEA
+
+   Builds the same run of fixes twice: as one NAV-PVT frame per epoch, and as the NMEA set the parser waits
+   for by default (GGA, GSA, RMC, three GSV, GLL and VTG). Each stream is then decoded the way the parser
+   task does it, UBX byte by byte through main/ubx.c and NMEA line by line through main/nmea_decode.c.
+   Reports bytes and decode time per epoch for both. Exits with 1 if either stream gives a different count
+   of updates or a position that doesn't match the fix it was built from.
+
+   ubx_nmea [-n epochs]
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <unistd.h>
+#include <time.h>
+#include "nmea_decode.h"
+#include "ubx.h"
+
+#define BENCH_EPOCHS (20000)
+#define BENCH_ROUNDS (5)                /* Each stream is decoded this many times, the fastest counts */
+#define BENCH_NMEA_MAX (600)            /* Bytes of one NMEA epoch, at most */
+#define BENCH_REQUIRED ((1 << STATEMENT_GGA) | (1 << STATEMENT_GSA) | (1 << STATEMENT_RMC) | \
+                        (1 << STATEMENT_GSV) | (1 << STATEMENT_GLL) | (1 << STATEMENT_VTG))
+
+/**
+ * @brief One fix of the run
+ *
+ */
+typedef struct {
+    int32_t lat_e7, lon_e7;
+    int sec;
+} fix_t;
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void put_i32(uint8_t *p, int32_t v)
+{
+    uint32_t u = (uint32_t)v;
+    for (int i = 0; i < 4; i++) {
+        p[i] = (u >> (8 * i)) & 0xff;
+    }
+}
+
+/**
+ * @brief Append a sentence with its checksum and line end
+ *
+ */
+static size_t put_sentence(char *out, const char *body)
+{
+    uint8_t crc = 0;
+    for (const char *c = body; *c; c++) {
+        crc ^= (uint8_t)*c;
+    }
+    return sprintf(out, "$%s*%02X\r\n", body, crc);
+}
+
+/**
+ * @brief Write a coordinate as degrees and minutes to 1e-5 minute, which is as close as receivers give
+ *
+ */
+static void put_coord(char *out, int32_t e7, int deg_digits, char pos, char neg)
+{
+    uint64_t mag = e7 < 0 ? -(int64_t)e7 : e7;
+    uint64_t min_1e5 = (mag * 60 + 50) / 100;
+    sprintf(out, "%0*u%02u.%05u,%c", deg_digits, (unsigned)(min_1e5 / 6000000),
+            (unsigned)(min_1e5 % 6000000 / 100000), (unsigned)(min_1e5 % 100000), e7 < 0 ? neg : pos);
+}
+
+static size_t build_nmea(const fix_t *fix, char *out)
+{
+    char lat[24], lon[24], body[160];
+    char utc[16];
+    size_t n = 0;
+
+    put_coord(lat, fix->lat_e7, 2, 'N', 'S');
+    put_coord(lon, fix->lon_e7, 3, 'E', 'W');
+    sprintf(utc, "%02d%02d%02d.00", 12 + fix->sec / 3600 % 12, fix->sec / 60 % 60, fix->sec % 60);
+    snprintf(body, sizeof(body), "GPGGA,%s,%s,%s,1,11,0.9,12.3,M,47.0,M,,", utc, lat, lon);
+    n += put_sentence(out + n, body);
+    n += put_sentence(out + n, "GPGSA,A,3,02,05,07,09,13,15,18,20,23,26,30,1.4,0.9,1.1");
+    snprintf(body, sizeof(body), "GPRMC,%s,A,%s,%s,2.5,270.1,010524,,,A", utc, lat, lon);
+    n += put_sentence(out + n, body);
+    n += put_sentence(out + n, "GPGSV,3,1,12,02,45,123,41,05,30,045,38,07,62,300,44,09,12,210,30");
+    n += put_sentence(out + n, "GPGSV,3,2,12,13,55,090,42,15,20,150,35,18,70,010,45,20,08,330,28");
+    n += put_sentence(out + n, "GPGSV,3,3,12,23,40,260,40,26,25,100,37,30,15,190,33,31,05,020,20");
+    snprintf(body, sizeof(body), "GPGLL,%s,%s,%s,A,A", lat, lon, utc);
+    n += put_sentence(out + n, body);
+    n += put_sentence(out + n, "GPVTG,270.1,T,,M,2.5,N,4.6,K,A");
+    return n;
+}
+
+static size_t build_ubx(const fix_t *fix, uint8_t *out)
+{
+    uint8_t payload[UBX_NAV_PVT_LEN] = { 0 };
+
+    put_u16(payload + 4, 2024);
+    payload[6] = 5;
+    payload[7] = 1;
+    payload[8] = 12 + fix->sec / 3600 % 12;
+    payload[9] = fix->sec / 60 % 60;
+    payload[10] = fix->sec % 60;
+    payload[11] = 0x03;
+    payload[20] = 3;
+    payload[21] = 0x01;
+    payload[23] = 11;
+    put_i32(payload + 24, fix->lon_e7);
+    put_i32(payload + 28, fix->lat_e7);
+    put_i32(payload + 36, 12300);
+    put_i32(payload + 60, 1286);
+    put_i32(payload + 64, 27010000);
+    put_u16(payload + 76, 140);
+    return ubx_build_frame(UBX_CLASS_NAV, UBX_ID_NAV_PVT, payload, UBX_NAV_PVT_LEN, out);
+}
+
+static double elapsed_ns(const struct timespec *t0, const struct timespec *t1)
+{
+    return (t1->tv_sec - t0->tv_sec) * 1e9 + (t1->tv_nsec - t0->tv_nsec);
+}
+
+/**
+ * @brief Check an update against the fix it came from
+ *
+ * NMEA carries 1e-5 minute, which rounds the position by up to 1e-7 degree.
+ */
+static bool same_fix(const gps_t *gps, const fix_t *fix, int32_t tol_e7)
+{
+    return gps->valid && labs((long)gps->latitude_e7 - fix->lat_e7) <= tol_e7 &&
+           labs((long)gps->longitude_e7 - fix->lon_e7) <= tol_e7 && gps->tim.second == fix->sec % 60;
+}
+
+int main(int argc, char **argv)
+{
+    int epochs = BENCH_EPOCHS;
+    int opt;
+
+    while ((opt = getopt(argc, argv, "n:")) != -1) {
+        if (opt == 'n' && atoi(optarg) > 0) {
+            epochs = atoi(optarg);
+        } else {
+            fprintf(stderr, "usage: %s [-n epochs]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    fix_t *fixes = malloc(epochs * sizeof(fix_t));
+    char *nmea = malloc((size_t)epochs * BENCH_NMEA_MAX);
+    uint8_t *ubx = malloc((size_t)epochs * (UBX_NAV_PVT_LEN + 8));
+    if (!fixes || !nmea || !ubx) {
+        fprintf(stderr, "out of memory\n");
+        return 2;
+    }
+
+    /* A boat wandering at 1 Hz, across the equator and the prime meridian so both signs are used */
+    size_t nmea_len = 0, ubx_len = 0;
+    uint32_t seed = 11;
+    fix_t fix = { .lat_e7 = -20000, .lon_e7 = 30000 };
+    for (int i = 0; i < epochs; i++) {
+        seed = seed * 1103515245 + 12345;
+        fix.lat_e7 += (int32_t)((seed >> 8) % 201) - 95;
+        fix.lon_e7 += (int32_t)((seed >> 16) % 201) - 105;
+        fix.sec = i;
+        fixes[i] = fix;
+        nmea_len += build_nmea(&fix, nmea + nmea_len);
+        ubx_len += build_ubx(&fix, ubx + ubx_len);
+    }
+
+    double nmea_ns = 0, ubx_ns = 0;
+    int nmea_updates = 0, ubx_updates = 0, nmea_bad = 0, ubx_bad = 0;
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        static nmea_decoder_t dec;
+        static ubx_decoder_t ubx_dec;
+        static gps_t pvt;
+        struct timespec t0, t1;
+
+        /* NMEA: lines are found and decoded in turn, the parser task does the same per byte */
+        nmea_decoder_init(&dec);
+        nmea_updates = nmea_bad = 0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (const char *line = nmea, *end = nmea + nmea_len; line < end;) {
+            const char *eol = memchr(line, '\n', end - line);
+            if (nmea_decode_line(&dec, line, BENCH_REQUIRED) == NMEA_DECODE_UPDATE) {
+                nmea_bad += nmea_updates >= epochs || !same_fix(&dec.gps, &fixes[nmea_updates], 1);
+                nmea_updates++;
+            }
+            line = eol + 1;
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        if (round == 0 || elapsed_ns(&t0, &t1) < nmea_ns) {
+            nmea_ns = elapsed_ns(&t0, &t1);
+        }
+
+        /* UBX: every byte through the frame decoder, the payload converted once the checksum is good */
+        ubx_decoder_reset(&ubx_dec);
+        ubx_updates = ubx_bad = 0;
+        clock_gettime(CLOCK_MONOTONIC, &t0);
+        for (size_t i = 0; i < ubx_len; i++) {
+            if (ubx_decode_byte(&ubx_dec, ubx[i]) == UBX_FRAME && ubx_dec.cls == UBX_CLASS_NAV &&
+                    ubx_dec.id == UBX_ID_NAV_PVT && ubx_nav_pvt_to_gps(ubx_dec.payload, ubx_dec.len, &pvt)) {
+                ubx_bad += ubx_updates >= epochs || !same_fix(&pvt, &fixes[ubx_updates], 0);
+                ubx_updates++;
+            }
+        }
+        clock_gettime(CLOCK_MONOTONIC, &t1);
+        if (round == 0 || elapsed_ns(&t0, &t1) < ubx_ns) {
+            ubx_ns = elapsed_ns(&t0, &t1);
+        }
+    }
+
+    printf("%-6s %8s %9s %10s %9s %8s\n", "stream", "epochs", "bytes/ep", "ns/epoch", "ns/byte", "bad");
+    printf("%-6s %8d %9.1f %10.0f %9.2f %8d\n", "nmea", nmea_updates, (double)nmea_len / epochs,
+           nmea_ns / epochs, nmea_ns / nmea_len, nmea_bad);
+    printf("%-6s %8d %9.1f %10.0f %9.2f %8d\n", "ubx", ubx_updates, (double)ubx_len / epochs,
+           ubx_ns / epochs, ubx_ns / ubx_len, ubx_bad);
+    printf("ubx/nmea: %.2f of the time, %.2f of the bytes\n", ubx_ns / nmea_ns, (double)ubx_len / nmea_len);
+
+    free(fixes);
+    free(nmea);
+    free(ubx);
+    return nmea_updates == epochs && ubx_updates == epochs && !nmea_bad && !ubx_bad ? 0 : 1;
+}
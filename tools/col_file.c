@@ -0,0 +1,361 @@
+/* Columnar track file
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "col_file.h"
+
+#define COL_COPY_BUF (1 << 16)
+
+static uint32_t crc_table[256];
+
+uint32_t col_crc32(uint32_t crc, const void *buf, size_t len)
+{
+    const uint8_t *p = buf;
+    if (!crc_table[1]) {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? 0xedb88320 ^ (c >> 1) : c >> 1;
+            }
+            crc_table[i] = c;
+        }
+    }
+    crc = ~crc;
+    while (len--) {
+        crc = crc_table[(crc ^ *p++) & 0xff] ^ (crc >> 8);
+    }
+    return ~crc;
+}
+
+static inline size_t put_varint(uint8_t *p, uint64_t value)
+{
+    size_t n = 0;
+    while (value >= 0x80) {
+        p[n++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    p[n++] = (uint8_t)value;
+    return n;
+}
+
+static inline size_t put_zigzag(uint8_t *p, int64_t value)
+{
+    return put_varint(p, ((uint64_t)value << 1) ^ (uint64_t)(value >> 63));
+}
+
+static inline bool get_zigzag(const uint8_t **p, const uint8_t *end, int64_t *value)
+{
+    uint64_t v = 0;
+    for (int shift = 0; shift < 70 && *p < end; shift += 7) {
+        uint8_t byte = *(*p)++;
+        v |= (uint64_t)(byte & 0x7f) << shift;
+        if (!(byte & 0x80)) {
+            *value = (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Encode the block being filled and write it out
+ *
+ */
+static bool flush_block(col_writer_t *w)
+{
+    col_block_header_t header = {
+        .magic = COL_BLOCK_MAGIC,
+        .count = w->count,
+    };
+    col_index_entry_t entry = {
+        .offset = w->offset,
+        .count = w->count,
+    };
+    size_t len = 0;
+
+    if (w->count == 0) {
+        return true;
+    }
+    for (int c = 0; c < COL_COUNT; c++) {
+        const int64_t *v = w->col[c];
+        int64_t min = v[0], max = v[0];
+        for (uint32_t i = 1; i < w->count; i++) {
+            min = v[i] < min ? v[i] : min;
+            max = v[i] > max ? v[i] : max;
+        }
+        header.min[c] = min;
+        header.max[c] = max;
+        if (min == max) {
+            continue;
+        }
+        size_t start = len;
+        int64_t prev = min;
+        if (c == COL_T) {
+            int64_t prev_delta = 0;
+            for (uint32_t i = 0; i < w->count; i++) {
+                int64_t delta = v[i] - prev;
+                len += put_zigzag(w->data + len, delta - prev_delta);
+                prev_delta = delta;
+                prev = v[i];
+            }
+        } else {
+            for (uint32_t i = 0; i < w->count; i++) {
+                len += put_zigzag(w->data + len, v[i] - prev);
+                prev = v[i];
+            }
+        }
+        header.col_len[c] = (uint32_t)(len - start);
+    }
+    header.len = (uint32_t)len;
+    header.crc = col_crc32(0, w->data, len);
+    entry.t_min = header.min[COL_T];
+    entry.t_max = header.max[COL_T];
+    if (fwrite(&header, sizeof(header), 1, w->out) != 1 || fwrite(w->data, 1, len, w->out) != len ||
+            fwrite(&entry, sizeof(entry), 1, w->index) != 1) {
+        return false;
+    }
+    w->offset += sizeof(header) + len;
+    w->footer.blocks++;
+    w->footer.points += w->count;
+    w->count = 0;
+    return true;
+}
+
+static void writer_free(col_writer_t *w)
+{
+    if (w->index) {
+        fclose(w->index);
+    }
+    free(w->data);
+    w->index = NULL;
+    w->data = NULL;
+    for (int c = 0; c < COL_COUNT; c++) {
+        free(w->col[c]);
+        w->col[c] = NULL;
+    }
+}
+
+bool col_writer_open(col_writer_t *w, FILE *out, uint32_t block_points, col_source_t source)
+{
+    col_file_header_t header = {
+        .magic = COL_FILE_MAGIC,
+        .version = COL_FILE_VERSION,
+        .columns = COL_COUNT,
+        .block_points = block_points,
+        .source = source,
+    };
+
+    memset(w, 0, sizeof(*w));
+    if (block_points == 0 || block_points > COL_BLOCK_POINTS_MAX) {
+        errno = EINVAL;
+        return false;
+    }
+    w->out = out;
+    w->block_points = block_points;
+    w->footer.magic = COL_FOOTER_MAGIC;
+    w->footer.flags = COL_SORTED;
+    w->last_t = INT64_MIN;
+    /* The index is only known at the end, it waits in a temporary file rather than in memory */
+    w->index = tmpfile();
+    w->data = malloc((size_t)block_points * COL_COUNT * COL_VARINT_MAX);
+    bool ok = w->index && w->data;
+    for (int c = 0; c < COL_COUNT; c++) {
+        w->col[c] = malloc(block_points * sizeof(int64_t));
+        ok = ok && w->col[c];
+    }
+    if (!ok) {
+        writer_free(w);
+        errno = ENOMEM;
+        return false;
+    }
+    if (fwrite(&header, sizeof(header), 1, out) != 1) {
+        writer_free(w);
+        return false;
+    }
+    w->offset = sizeof(header);
+    return true;
+}
+
+bool col_writer_add(col_writer_t *w, const int64_t row[COL_COUNT])
+{
+    for (int c = 0; c < COL_COUNT; c++) {
+        w->col[c][w->count] = row[c];
+    }
+    if (row[COL_T] < w->last_t) {
+        w->footer.flags &= ~COL_SORTED;
+    }
+    w->last_t = row[COL_T];
+    if (++w->count == w->block_points) {
+        return flush_block(w);
+    }
+    return true;
+}
+
+bool col_writer_close(col_writer_t *w)
+{
+    static char buf[COL_COPY_BUF];
+    bool ok = flush_block(w);
+
+    if (ok) {
+        w->footer.index_offset = w->offset;
+        rewind(w->index);
+        size_t n;
+        while ((n = fread(buf, 1, sizeof(buf), w->index)) > 0) {
+            if (fwrite(buf, 1, n, w->out) != n) {
+                ok = false;
+                break;
+            }
+        }
+        ok = ok && !ferror(w->index) && fwrite(&w->footer, sizeof(w->footer), 1, w->out) == 1 && fflush(w->out) == 0;
+        w->offset += w->footer.blocks * sizeof(col_index_entry_t) + sizeof(w->footer);
+    }
+    writer_free(w);
+    return ok;
+}
+
+static bool read_at(int fd, void *buf, size_t len, uint64_t offset)
+{
+    uint8_t *p = buf;
+    while (len > 0) {
+        ssize_t n = pread(fd, p, len, (off_t)offset);
+        if (n <= 0) {
+            return false;
+        }
+        p += n;
+        len -= n;
+        offset += n;
+    }
+    return true;
+}
+
+const char *col_reader_open(col_reader_t *r, const char *path)
+{
+    struct stat st;
+
+    memset(r, 0, sizeof(*r));
+    r->fd = open(path, O_RDONLY);
+    if (r->fd < 0) {
+        return strerror(errno);
+    }
+    if (fstat(r->fd, &st) < 0 || st.st_size < (off_t)(sizeof(r->header) + sizeof(r->footer)) ||
+            !read_at(r->fd, &r->header, sizeof(r->header), 0) ||
+            !read_at(r->fd, &r->footer, sizeof(r->footer), st.st_size - sizeof(r->footer)) ||
+            memcmp(r->header.magic, COL_FILE_MAGIC, sizeof(r->header.magic)) != 0 ||
+            r->footer.magic != COL_FOOTER_MAGIC) {
+        col_reader_close(r);
+        return "not a column file, or not completely written";
+    }
+    if (r->header.version != COL_FILE_VERSION || r->header.columns != COL_COUNT ||
+            r->header.block_points == 0 || r->header.block_points > COL_BLOCK_POINTS_MAX ||
+            r->footer.index_offset + r->footer.blocks * sizeof(col_index_entry_t) + sizeof(r->footer) !=
+            (uint64_t)st.st_size) {
+        col_reader_close(r);
+        return "unsupported version or damaged index";
+    }
+    r->data = malloc((size_t)r->header.block_points * COL_COUNT * COL_VARINT_MAX);
+    if (!r->data) {
+        col_reader_close(r);
+        return strerror(ENOMEM);
+    }
+    return NULL;
+}
+
+void col_reader_close(col_reader_t *r)
+{
+    if (r->fd >= 0) {
+        close(r->fd);
+    }
+    free(r->data);
+    r->fd = -1;
+    r->data = NULL;
+}
+
+bool col_reader_entry(col_reader_t *r, uint64_t block, col_index_entry_t *entry)
+{
+    return block < r->footer.blocks &&
+           read_at(r->fd, entry, sizeof(*entry), r->footer.index_offset + block * sizeof(*entry));
+}
+
+uint64_t col_reader_seek(col_reader_t *r, int64_t from_ms)
+{
+    col_index_entry_t entry;
+    uint64_t lo = 0, hi = r->footer.blocks;
+
+    if (!(r->footer.flags & COL_SORTED)) {
+        return 0;
+    }
+    /* First block ending at or after from_ms, log2 of the blocks in reads */
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (!col_reader_entry(r, mid, &entry)) {
+            return 0;
+        }
+        if (entry.t_max < from_ms) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+bool col_reader_header(col_reader_t *r, const col_index_entry_t *entry, col_block_header_t *header)
+{
+    return read_at(r->fd, header, sizeof(*header), entry->offset) && header->magic == COL_BLOCK_MAGIC &&
+           header->count == entry->count && header->count > 0 && header->count <= r->header.block_points &&
+           header->len <= (size_t)r->header.block_points * COL_COUNT * COL_VARINT_MAX;
+}
+
+bool col_reader_decode(col_reader_t *r, const col_index_entry_t *entry, const col_block_header_t *header,
+                       int64_t *col[COL_COUNT])
+{
+    const uint8_t *p = r->data;
+    const uint8_t *end = r->data + header->len;
+
+    if (!read_at(r->fd, r->data, header->len, entry->offset + sizeof(*header)) ||
+            col_crc32(0, r->data, header->len) != header->crc) {
+        return false;
+    }
+    for (int c = 0; c < COL_COUNT; c++) {
+        const uint8_t *col_end = p + header->col_len[c];
+        int64_t *v = col[c];
+        if (col_end > end) {
+            return false;
+        }
+        if (!v) {
+            p = col_end;
+            continue;
+        }
+        if (header->col_len[c] == 0) {
+            for (uint32_t i = 0; i < header->count; i++) {
+                v[i] = header->min[c];
+            }
+            continue;
+        }
+        int64_t prev = header->min[c];
+        int64_t delta = 0;
+        for (uint32_t i = 0; i < header->count; i++) {
+            int64_t d;
+            if (!get_zigzag(&p, col_end, &d)) {
+                return false;
+            }
+            /* Time is stored as deltas of deltas */
+            delta = c == COL_T ? delta + d : d;
+            prev += delta;
+            v[i] = prev;
+        }
+        p = col_end;
+    }
+    return true;
+}
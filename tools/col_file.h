@@ -0,0 +1,246 @@
+/* Columnar track file
+
+   A file of fixes stored by column in blocks, for analysing long sessions without parsing NMEA again.
+   Layout, all little endian:
+
+     col_file_header_t
+     blocks: col_block_header_t, then each column's values one after another
+     index:  col_index_entry_t per block
+     col_footer_t
+
+   Every column is kept as int64 fixed point (see col_id_t for the units). A block stores each column
+   as zigzag varint deltas from the column's minimum in the block, the time as deltas of its deltas, so a
+   steady 1 Hz stream costs one byte per time stamp. A column with the same value all through the
+   block takes no bytes at all. Block headers carry every column's minimum and maximum so a reader
+   can skip a block by time or position from the header alone, and the index at the end gives each
+   block's offset and time span for seeking without reading the blocks.
+
+   Writing and reading hold one block at a time; memory does not depend on the size of the file.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define COL_FILE_MAGIC "NMEACOL1"
+#define COL_FILE_VERSION (1)
+#define COL_BLOCK_MAGIC (0x4b4c4243)    /*!< "CBLK" */
+#define COL_FOOTER_MAGIC (0x58444943)   /*!< "CIDX" */
+#define COL_BLOCK_POINTS_DEFAULT (4096)
+#define COL_BLOCK_POINTS_MAX (65536)
+#define COL_VARINT_MAX (10)             /*!< Longest varint of a 64 bit value */
+
+/**
+ * @brief Columns, in the order they are stored
+ *
+ */
+typedef enum {
+    COL_T,          /*!< UTC, milliseconds since 1970 */
+    COL_LAT,        /*!< Latitude, 1e-7 degrees */
+    COL_LON,        /*!< Longitude, 1e-7 degrees */
+    COL_ALT,        /*!< Altitude, cm */
+    COL_SPEED,      /*!< Speed over ground, cm/s */
+    COL_COURSE,     /*!< Course over ground, or heading for the track log, 0.1 degrees */
+    COL_HDOP,       /*!< Horizontal dilution of precision, hundredths */
+    COL_SATS,       /*!< Satellites in use */
+    COL_FIX,        /*!< GGA fix quality */
+    COL_PORT,       /*!< Port motor duty, % */
+    COL_STBD,       /*!< Starboard motor duty, % */
+    COL_COUNT,
+} col_id_t;
+
+/**
+ * @brief Where the points came from
+ *
+ */
+typedef enum {
+    COL_SOURCE_NMEA = 1,    /*!< NMEA sentences, the motor columns are 0 */
+    COL_SOURCE_TRACK = 2,   /*!< Track log partition, only time, position, heading and motors are set */
+} col_source_t;
+
+#define COL_SORTED (1 << 0)     /*!< Footer flag: time never goes back, the index can be searched */
+
+typedef struct {
+    char magic[8];              /*!< COL_FILE_MAGIC, not terminated */
+    uint32_t version;           /*!< COL_FILE_VERSION */
+    uint32_t columns;           /*!< COL_COUNT */
+    uint32_t block_points;      /*!< Most points in a block */
+    uint32_t source;            /*!< col_source_t */
+    uint64_t reserved;
+} col_file_header_t;
+
+typedef struct {
+    uint32_t magic;             /*!< COL_BLOCK_MAGIC */
+    uint32_t count;             /*!< Points */
+    uint32_t len;               /*!< Bytes of column data after the header */
+    uint32_t crc;               /*!< CRC-32 of the column data */
+    int64_t min[COL_COUNT];     /*!< Smallest value per column */
+    int64_t max[COL_COUNT];     /*!< Largest value per column */
+    uint32_t col_len[COL_COUNT]; /*!< Bytes per column, 0 if min == max */
+    uint32_t reserved;
+} col_block_header_t;
+
+typedef struct {
+    uint64_t offset;            /*!< Offset of the block header in the file */
+    int64_t t_min;              /*!< Earliest time in the block */
+    int64_t t_max;              /*!< Latest time in the block */
+    uint32_t count;             /*!< Points */
+    uint32_t reserved;
+} col_index_entry_t;
+
+typedef struct {
+    uint64_t index_offset;      /*!< Offset of the first index entry */
+    uint64_t blocks;            /*!< Blocks, and index entries */
+    uint64_t points;            /*!< Points in all blocks */
+    uint32_t flags;             /*!< COL_SORTED */
+    uint32_t magic;             /*!< COL_FOOTER_MAGIC */
+} col_footer_t;
+
+_Static_assert(sizeof(col_file_header_t) == 32, "column file header layout changed");
+_Static_assert(sizeof(col_block_header_t) == 240, "column block header layout changed");
+_Static_assert(sizeof(col_index_entry_t) == 32, "column index entry layout changed");
+_Static_assert(sizeof(col_footer_t) == 32, "column footer layout changed");
+
+/**
+ * @brief Writer state
+ *
+ */
+typedef struct {
+    FILE *out;                  /*!< Output, written in order only so it may be a pipe */
+    FILE *index;                /*!< Index entries until the blocks are all out */
+    uint64_t offset;            /*!< Bytes written to out */
+    uint32_t block_points;      /*!< Points per block */
+    uint32_t count;             /*!< Points in the block being filled */
+    int64_t *col[COL_COUNT];    /*!< Values of the block being filled, block_points per column */
+    uint8_t *data;              /*!< Encoded column data */
+    int64_t last_t;             /*!< Time of the last point added */
+    col_footer_t footer;        /*!< Counts so far */
+} col_writer_t;
+
+/**
+ * @brief Reader state
+ *
+ */
+typedef struct {
+    int fd;
+    col_file_header_t header;
+    col_footer_t footer;
+    uint8_t *data;              /*!< Column data of the block being read */
+} col_reader_t;
+
+/**
+ * @brief CRC-32 as used by zlib and by the ESP32 ROM
+ *
+ * @param crc CRC of the data before, 0 to start
+ * @param buf data
+ * @param len bytes of data
+ * @return uint32_t CRC including buf
+ */
+uint32_t col_crc32(uint32_t crc, const void *buf, size_t len);
+
+/**
+ * @brief Start a file
+ *
+ * @param w writer
+ * @param out stream to write to
+ * @param block_points points per block, 1..COL_BLOCK_POINTS_MAX
+ * @param source col_source_t
+ * @return true on success, false with errno set
+ */
+bool col_writer_open(col_writer_t *w, FILE *out, uint32_t block_points, col_source_t source);
+
+/**
+ * @brief Add one point, writes a block once it is full
+ *
+ * @param w writer
+ * @param row values, COL_COUNT of them in col_id_t order
+ * @return true on success, false with errno set
+ */
+bool col_writer_add(col_writer_t *w, const int64_t row[COL_COUNT]);
+
+/**
+ * @brief Write the last block, the index and the footer, and free the writer
+ *
+ * Does not close out. The counts in the writer are kept: offset is the size of the file and footer what
+ * was written at its end.
+ *
+ * @param w writer
+ * @return true on success, false with errno set
+ */
+bool col_writer_close(col_writer_t *w);
+
+/**
+ * @brief Open a file and check its header and footer
+ *
+ * @param r reader
+ * @param path file
+ * @return NULL on success, otherwise what is wrong
+ */
+const char *col_reader_open(col_reader_t *r, const char *path);
+
+/**
+ * @brief Close a file
+ *
+ * @param r reader
+ */
+void col_reader_close(col_reader_t *r);
+
+/**
+ * @brief Read an index entry
+ *
+ * @param r reader
+ * @param block block number, below footer.blocks
+ * @param entry filled with the entry
+ * @return true on success
+ */
+bool col_reader_entry(col_reader_t *r, uint64_t block, col_index_entry_t *entry);
+
+/**
+ * @brief First block that may hold a time at or after from_ms
+ *
+ * A binary search of the index if the file is sorted, otherwise 0.
+ *
+ * @param r reader
+ * @param from_ms UTC, milliseconds since 1970
+ * @return uint64_t block number, footer.blocks if every block is earlier
+ */
+uint64_t col_reader_seek(col_reader_t *r, int64_t from_ms);
+
+/**
+ * @brief Read a block header
+ *
+ * @param r reader
+ * @param entry index entry of the block
+ * @param header filled with the header
+ * @return true if the header was read and is a block header
+ */
+bool col_reader_header(col_reader_t *r, const col_index_entry_t *entry, col_block_header_t *header);
+
+/**
+ * @brief Read and decode the columns of a block
+ *
+ * @param r reader
+ * @param entry index entry of the block
+ * @param header its header
+ * @param col filled with the values, header->count per column; NULL columns are not decoded
+ * @return true on success, false if the block can't be read or its CRC is wrong
+ */
+bool col_reader_decode(col_reader_t *r, const col_index_entry_t *entry, const col_block_header_t *header,
+                       int64_t *col[COL_COUNT]);
+
+#ifdef __cplusplus
+}
+#endif
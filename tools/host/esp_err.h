@@ -0,0 +1,37 @@
+/* ESP-IDF error codes for the firmware modules built on the host
+
+   The codes the modules use, with the values ESP-IDF gives them, and their names.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdint.h>
+
+typedef int esp_err_t;
+
+#define ESP_OK (0)
+#define ESP_FAIL (-1)
+#define ESP_ERR_NO_MEM (0x101)
+#define ESP_ERR_INVALID_ARG (0x102)
+#define ESP_ERR_INVALID_STATE (0x103)
+#define ESP_ERR_INVALID_SIZE (0x104)
+#define ESP_ERR_NOT_FOUND (0x105)
+#define ESP_ERR_NOT_SUPPORTED (0x106)
+#define ESP_ERR_TIMEOUT (0x107)
+#define ESP_ERR_INVALID_RESPONSE (0x108)
+#define ESP_ERR_INVALID_CRC (0x109)
+#define ESP_ERR_NOT_FINISHED (0x10c)
+
+/**
+ * @brief Name of an error code
+ *
+ * @param code error code
+ * @return const char* the macro name, "UNKNOWN ERROR" for codes not listed here
+ */
+const char *esp_err_to_name(esp_err_t code);
@@ -0,0 +1,22 @@
+/* esp_timer clock for the firmware modules built on the host
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include "esp_timer.h"
+
+static int64_t now_us;
+
+int64_t esp_timer_get_time(void)
+{
+    return now_us;
+}
+
+void esp_timer_host_advance(int64_t us)
+{
+    now_us += us;
+}
@@ -0,0 +1,37 @@
+/* esp_timer clock for the firmware modules built on the host
+
+   The clock only moves when esp_timer_host_advance() is called, so a fake device can account for the time
+   its replies take and waits with long timeouts run at once.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+/**
+ * @brief Time since boot
+ *
+ * @return int64_t microseconds, starting at 0
+ */
+int64_t esp_timer_get_time(void);
+
+/**
+ * @brief Move the clock on
+ *
+ * @param us microseconds to add
+ */
+void esp_timer_host_advance(int64_t us);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,62 @@
+/* FreeRTOS tasks for the firmware modules built on the host
+
+   A task is a detached thread. Stack size and priority are not used, the host scheduler decides.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+
+typedef void (*TaskFunction_t)(void *arg);
+typedef pthread_t *TaskHandle_t;
+
+/* What the thread is started with */
+typedef struct {
+    TaskFunction_t fn;
+    void *arg;
+} host_task_start_t;
+
+static inline void *host_task_entry(void *start)
+{
+    host_task_start_t task = *(host_task_start_t *)start;
+    free(start);
+    task.fn(task.arg);
+    return NULL;
+}
+
+static inline BaseType_t xTaskCreate(TaskFunction_t fn, const char *name, uint32_t stack_size, void *arg,
+                                     UBaseType_t priority, TaskHandle_t *handle)
+{
+    static pthread_t threads[8];
+    static int num_threads;
+    host_task_start_t *start = malloc(sizeof(*start));
+    pthread_attr_t attr;
+
+    if (!start || num_threads == sizeof(threads) / sizeof(threads[0])) {
+        free(start);
+        return pdFAIL;
+    }
+    *start = (host_task_start_t) {
+        fn, arg
+    };
+    pthread_attr_init(&attr);
+    pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+    int err = pthread_create(&threads[num_threads], &attr, host_task_entry, start);
+    pthread_attr_destroy(&attr);
+    if (err) {
+        free(start);
+        return pdFAIL;
+    }
+    if (handle) {
+        *handle = &threads[num_threads];
+    }
+    num_threads++;
+    return pdPASS;
+}
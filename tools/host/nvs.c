@@ -0,0 +1,186 @@
+/* In-memory NVS for the firmware modules built on the host
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "nvs.h"
+
+#define NVS_HOST_ENTRIES (32)
+#define NVS_HOST_NAMESPACES (8)
+#define NVS_HOST_KEY_MAX (16)       /*!< Namespace and key names, as in ESP-IDF: 15 characters */
+
+typedef struct {
+    uint32_t ns;                    /*!< Namespace index + 1, 0 for a free entry */
+    char key[NVS_HOST_KEY_MAX];
+    void *value;
+    size_t length;
+} nvs_host_entry_t;
+
+static char namespaces[NVS_HOST_NAMESPACES][NVS_HOST_KEY_MAX];
+static nvs_host_entry_t entries[NVS_HOST_ENTRIES];
+
+/* A handle is the namespace index + 1, with the top bit set when opened read only */
+#define NVS_HOST_READ_ONLY (0x80000000u)
+
+static nvs_host_entry_t *find(nvs_handle_t handle, const char *key)
+{
+    uint32_t ns = handle & ~NVS_HOST_READ_ONLY;
+    for (int i = 0; i < NVS_HOST_ENTRIES; i++) {
+        if (entries[i].ns == ns && strcmp(entries[i].key, key) == 0) {
+            return &entries[i];
+        }
+    }
+    return NULL;
+}
+
+static bool valid(nvs_handle_t handle)
+{
+    uint32_t ns = handle & ~NVS_HOST_READ_ONLY;
+    return ns >= 1 && ns <= NVS_HOST_NAMESPACES && namespaces[ns - 1][0];
+}
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle)
+{
+    int free_ns = -1;
+    if (strlen(name) >= NVS_HOST_KEY_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < NVS_HOST_NAMESPACES; i++) {
+        if (strcmp(namespaces[i], name) == 0) {
+            *out_handle = (i + 1) | (open_mode == NVS_READONLY ? NVS_HOST_READ_ONLY : 0);
+            return ESP_OK;
+        }
+        if (free_ns < 0 && !namespaces[i][0]) {
+            free_ns = i;
+        }
+    }
+    /* As on the device, a namespace that was never written can't be opened read only */
+    if (open_mode == NVS_READONLY) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    if (free_ns < 0) {
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    strcpy(namespaces[free_ns], name);
+    *out_handle = free_ns + 1;
+    return ESP_OK;
+}
+
+void nvs_close(nvs_handle_t handle)
+{
+}
+
+esp_err_t nvs_commit(nvs_handle_t handle)
+{
+    return valid(handle) ? ESP_OK : ESP_ERR_NVS_INVALID_HANDLE;
+}
+
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key)
+{
+    nvs_host_entry_t *entry;
+    if (!valid(handle)) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (handle & NVS_HOST_READ_ONLY) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    entry = find(handle, key);
+    if (!entry) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    free(entry->value);
+    memset(entry, 0, sizeof(*entry));
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length)
+{
+    nvs_host_entry_t *entry;
+    void *copy;
+    if (!valid(handle)) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    if (handle & NVS_HOST_READ_ONLY) {
+        return ESP_ERR_NVS_READ_ONLY;
+    }
+    if (strlen(key) >= NVS_HOST_KEY_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    entry = find(handle, key);
+    for (int i = 0; !entry && i < NVS_HOST_ENTRIES; i++) {
+        if (!entries[i].ns) {
+            entry = &entries[i];
+        }
+    }
+    copy = malloc(length ? length : 1);
+    if (!entry || !copy) {
+        free(copy);
+        return ESP_ERR_NVS_NOT_ENOUGH_SPACE;
+    }
+    memcpy(copy, value, length);
+    free(entry->value);
+    entry->ns = handle;
+    strcpy(entry->key, key);
+    entry->value = copy;
+    entry->length = length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length)
+{
+    nvs_host_entry_t *entry;
+    if (!valid(handle)) {
+        return ESP_ERR_NVS_INVALID_HANDLE;
+    }
+    entry = find(handle, key);
+    if (!entry) {
+        return ESP_ERR_NVS_NOT_FOUND;
+    }
+    /* Without a buffer only the length is returned */
+    if (out_value && *length < entry->length) {
+        return ESP_ERR_NVS_INVALID_LENGTH;
+    }
+    if (out_value) {
+        memcpy(out_value, entry->value, entry->length);
+    }
+    *length = entry->length;
+    return ESP_OK;
+}
+
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value)
+{
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value)
+{
+    size_t length = sizeof(*out_value);
+    return nvs_get_blob(handle, key, out_value, &length);
+}
+
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char *key, int32_t value)
+{
+    return nvs_set_blob(handle, key, &value, sizeof(value));
+}
+
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char *key, int32_t *out_value)
+{
+    size_t length = sizeof(*out_value);
+    return nvs_get_blob(handle, key, out_value, &length);
+}
+
+void nvs_host_reset(void)
+{
+    for (int i = 0; i < NVS_HOST_ENTRIES; i++) {
+        free(entries[i].value);
+    }
+    memset(entries, 0, sizeof(entries));
+    memset(namespaces, 0, sizeof(namespaces));
+}
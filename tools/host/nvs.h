@@ -0,0 +1,55 @@
+/* In-memory NVS for the firmware modules built on the host
+
+   The calls the modules use, backed by a table in RAM that starts empty. nvs_host_reset() empties it
+   between tests. Writes are seen at once, nvs_commit() does nothing.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+#define ESP_ERR_NVS_NOT_FOUND (0x1102)
+#define ESP_ERR_NVS_NOT_ENOUGH_SPACE (0x1105)
+#define ESP_ERR_NVS_INVALID_HANDLE (0x1107)
+#define ESP_ERR_NVS_READ_ONLY (0x1108)
+#define ESP_ERR_NVS_INVALID_LENGTH (0x110c)
+
+typedef uint32_t nvs_handle_t;
+
+typedef enum {
+    NVS_READONLY,
+    NVS_READWRITE,
+} nvs_open_mode_t;
+
+esp_err_t nvs_open(const char *name, nvs_open_mode_t open_mode, nvs_handle_t *out_handle);
+void nvs_close(nvs_handle_t handle);
+esp_err_t nvs_commit(nvs_handle_t handle);
+esp_err_t nvs_erase_key(nvs_handle_t handle, const char *key);
+esp_err_t nvs_set_blob(nvs_handle_t handle, const char *key, const void *value, size_t length);
+esp_err_t nvs_get_blob(nvs_handle_t handle, const char *key, void *out_value, size_t *length);
+esp_err_t nvs_set_u32(nvs_handle_t handle, const char *key, uint32_t value);
+esp_err_t nvs_get_u32(nvs_handle_t handle, const char *key, uint32_t *out_value);
+esp_err_t nvs_set_i32(nvs_handle_t handle, const char *key, int32_t value);
+esp_err_t nvs_get_i32(nvs_handle_t handle, const char *key, int32_t *out_value);
+
+/**
+ * @brief Forget every stored value
+ *
+ */
+void nvs_host_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,28 @@
+/* Configuration of the parser code when it is built for the host
+
+   Stands in for the sdkconfig.h ESP-IDF generates. The tools read logs from any receiver, so every
+   statement is compiled in.
+*/
+
+#pragma once
+
+#define CONFIG_NMEA_STATEMENT_GGA 1
+#define CONFIG_NMEA_STATEMENT_GSA 1
+#define CONFIG_NMEA_STATEMENT_RMC 1
+#define CONFIG_NMEA_STATEMENT_GSV 1
+#define CONFIG_NMEA_STATEMENT_GLL 1
+#define CONFIG_NMEA_STATEMENT_VTG 1
+#define CONFIG_NMEA_STATEMENT_GST 1
+#define CONFIG_NMEA_STATEMENT_ZDA 1
+#define CONFIG_NMEA_STATEMENT_GNS 1
+#define CONFIG_NMEA_STATEMENT_GBS 1
+#define CONFIG_NMEA_STATEMENT_HDT 1
+#define CONFIG_NMEA_STATEMENT_HDG 1
+#define CONFIG_NMEA_STATEMENT_DTM 1
+
+#define CONFIG_NMEA_PARSER_MAX_SENTENCES 4
+#define CONFIG_NMEA_PARSER_MAX_FIELDS 24
+
+#define CONFIG_NMEA_SERVER_PORT 10110
+#define CONFIG_NMEA_SERVER_MAX_CLIENTS 4
+#define CONFIG_NMEA_SERVER_RING_SIZE 8192
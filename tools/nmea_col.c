@@ -0,0 +1,802 @@
+/* NMEA and track log to columnar file converter, and queries on the result
+
+   convert streams NMEA from files or stdin through the parser code the firmware runs
+   (main/nmea_decode.c), or reads a dump of the track partition, and writes one point per fix to a
+   column file (col_file.h). query seeks the file's index to a time range, skips blocks by their time and
+   position bounds, and writes the points left as CSV, GPX or GeoJSON. info sums up a file. Every one of
+   them holds a read buffer and one block at a time, whatever the size of the input.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <time.h>
+#include <sys/stat.h>
+#include "nmea_decode.h"
+#include "track_block.h"
+#include "numfmt.h"
+#include "col_file.h"
+
+#define COL_READ_BUF (1 << 20)          /* NMEA is read this much at a time */
+#define COL_LINE_MAX (128)              /* Longest line decoded, from its '$', NMEA allows 82 */
+#define COL_OUT_BUF (1 << 16)           /* Export output is written this much at a time */
+#define COL_POINT_OUT_MAX (512)         /* Longest exported point in any format */
+#define COL_MS_PER_DAY (86400000)
+#define COL_E7_PER_DEG (10000000)
+#define YEAR_BASE (2000)                /* Date in GPS starts from 2000 */
+
+typedef enum {
+    FORMAT_CSV,
+    FORMAT_GPX,
+    FORMAT_GEOJSON,
+} format_t;
+
+/**
+ * @brief NMEA input state, kept across files so a session split over several logs is one stream
+ *
+ */
+typedef struct {
+    nmea_decoder_t dec;
+    uint32_t required;          /*!< Statements making up an epoch */
+    bool dated;                 /*!< A sentence with a date has been read */
+    int32_t date_days;          /*!< Its date, days since 1970 */
+    int32_t date_tod_ms;        /*!< Its time of day */
+    int32_t last_tod_ms;        /*!< Time of day of the last point, -1 before the first */
+    int32_t undated_days;       /*!< Midnights passed before any date from the receiver */
+    uint64_t bytes;
+    uint64_t lines;
+    uint64_t other_lines;       /*!< Lines without a '$' */
+    uint64_t long_lines;        /*!< Lines too long to be NMEA */
+    uint64_t sentences;         /*!< Lines with a good checksum */
+    uint64_t crc_errors;
+    uint64_t no_fix;            /*!< Epochs without a fix, not written */
+} nmea_input_t;
+
+/**
+ * @brief Export state
+ *
+ */
+typedef struct {
+    format_t format;
+    col_source_t source;
+    uint64_t points;
+    int64_t first_ms;
+    int64_t last_ms;
+    size_t len;
+    char buf[COL_OUT_BUF];
+} export_t;
+
+static const char *const statement_names[] = {
+    "unknown",
+#define COL_STATEMENT_NAME(NAME, name, fields) #name,
+    NMEA_STATEMENT_LIST(COL_STATEMENT_NAME)
+#undef COL_STATEMENT_NAME
+};
+
+static const char *const column_names[COL_COUNT] = {
+    "time", "lat", "lon", "alt", "speed", "course", "hdop", "sats", "fix", "port", "stbd",
+};
+
+/* Append a string literal to a buffer at numchars, advancing numchars */
+#define APPEND_LITERAL(buf, numchars, literal) \
+    do { memcpy((buf) + (numchars), literal, sizeof(literal) - 1); (numchars) += sizeof(literal) - 1; } while (0)
+
+static double now_s(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+static int32_t time_of_day_ms(const gps_time_t *tim)
+{
+    return ((tim->hour * 60 + tim->minute) * 60 + tim->second) * 1000 + tim->thousand;
+}
+
+/*
+ * UTC of the epoch. The date is the one of the last RMC or ZDA, moved by a day if the epoch is on the other
+ * side of midnight from it: an epoch whose RMC was lost still gets the date from the one before. Before any
+ * date, days are counted from the midnights seen.
+ */
+static int64_t epoch_ms(nmea_input_t *in, const gps_t *gps)
+{
+    int32_t tod = time_of_day_ms(&gps->tim);
+    int32_t days;
+    if (in->dated) {
+        days = in->date_days;
+        if (tod < in->date_tod_ms - COL_MS_PER_DAY / 2) {
+            days++;
+        } else if (tod > in->date_tod_ms + COL_MS_PER_DAY / 2) {
+            days--;
+        }
+    } else {
+        if (in->last_tod_ms >= 0 && tod < in->last_tod_ms - COL_MS_PER_DAY / 2) {
+            in->undated_days++;
+        }
+        days = in->undated_days;
+    }
+    in->last_tod_ms = tod;
+    return (int64_t)days * COL_MS_PER_DAY + tod;
+}
+
+/* Keep the date of a sentence that has one */
+static void read_date(nmea_input_t *in, const gps_t *gps)
+{
+    if (gps->date.month != 0 && gps->date.day != 0) {
+        in->dated = true;
+        in->date_days = numfmt_days_from_civil(gps->date.year + YEAR_BASE, gps->date.month, gps->date.day);
+        in->date_tod_ms = time_of_day_ms(&gps->tim);
+    }
+}
+
+static bool add_epoch(nmea_input_t *in, col_writer_t *w)
+{
+    const gps_t *gps = &in->dec.gps;
+    int64_t row[COL_COUNT] = {0};
+    bool fix = gps->statements & (1 << STATEMENT_GGA) ? gps->fix != GPS_FIX_INVALID : gps->valid;
+
+    if (!fix) {
+        in->no_fix++;
+        return true;
+    }
+    row[COL_T] = epoch_ms(in, gps);
+    row[COL_LAT] = gps->latitude_e7;
+    row[COL_LON] = gps->longitude_e7;
+    row[COL_ALT] = lroundf(gps->altitude * 100);
+    row[COL_SPEED] = lroundf(gps->speed * 100);
+    row[COL_COURSE] = lroundf(gps->cog * 10);
+    row[COL_HDOP] = lroundf(gps->dop_h * 100);
+    row[COL_SATS] = gps->sats_in_use;
+    row[COL_FIX] = gps->fix;
+    return col_writer_add(w, row);
+}
+
+/* Decode the line from p to the '\n' at eol */
+static bool add_line(nmea_input_t *in, col_writer_t *w, const char *p, const char *eol)
+{
+    in->lines++;
+    /* A log may put a time stamp or a source in front of the sentence */
+    const char *dollar = memchr(p, '$', eol - p);
+    if (!dollar) {
+        in->other_lines++;
+        return true;
+    }
+    if (eol - dollar > COL_LINE_MAX) {
+        in->long_lines++;
+        return true;
+    }
+    nmea_decode_result_t result = nmea_decode_line(&in->dec, dollar, in->required);
+    if (result == NMEA_DECODE_CRC_ERROR) {
+        in->crc_errors++;
+        return true;
+    }
+    in->sentences++;
+    if (in->dec.statement == STATEMENT_RMC || in->dec.statement == STATEMENT_ZDA) {
+        read_date(in, &in->dec.gps);
+    }
+    return result != NMEA_DECODE_UPDATE || add_epoch(in, w);
+}
+
+static bool convert_nmea(int fd, nmea_input_t *in, col_writer_t *w)
+{
+    /* One more byte for a '\n' after a last line that has none */
+    static char buf[COL_READ_BUF + 1];
+    size_t have = 0;
+    bool skipping = false;
+
+    while (1) {
+        ssize_t n = read(fd, buf + have, COL_READ_BUF - have);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        in->bytes += n;
+        have += n;
+        if (n == 0 && have > 0) {
+            buf[have++] = '\n';
+        }
+        const char *p = buf;
+        const char *end = buf + have;
+        const char *eol;
+        while ((eol = memchr(p, '\n', end - p)) != NULL) {
+            if (!skipping && !add_line(in, w, p, eol)) {
+                return false;
+            }
+            skipping = false;
+            p = eol + 1;
+        }
+        have = end - p;
+        if (have == COL_READ_BUF) {
+            /* No line end in the whole buffer, not NMEA; drop it up to the next line end */
+            in->lines++;
+            in->long_lines++;
+            skipping = true;
+            have = 0;
+        }
+        memmove(buf, p, have);
+        if (n == 0) {
+            return true;
+        }
+    }
+}
+
+static bool convert_track(int fd, col_writer_t *w, uint64_t *bytes, uint64_t *bad_blocks)
+{
+    static track_block_t block;
+    struct stat st;
+    uint32_t newest = 0, newest_seq = 0;
+    bool found = false;
+
+    if (fstat(fd, &st) < 0) {
+        return false;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        fprintf(stderr, "a track partition dump must be a file, its blocks are read out of order\n");
+        errno = EINVAL;
+        return false;
+    }
+    uint64_t block_count = st.st_size / TRACK_LOG_BLOCK_SIZE;
+    /* The partition is a ring, the oldest block is the one after the newest */
+    for (uint64_t i = 0; i < block_count; i++) {
+        if (pread(fd, &block.header, sizeof(block.header), i * TRACK_LOG_BLOCK_SIZE) != sizeof(block.header)) {
+            return false;
+        }
+        if (block.header.magic == TRACK_LOG_MAGIC && (!found || (int32_t)(block.header.seq - newest_seq) > 0)) {
+            newest_seq = block.header.seq;
+            newest = i;
+            found = true;
+        }
+    }
+    for (uint64_t i = 1; found && i <= block_count; i++) {
+        uint64_t index = (newest + i) % block_count;
+        if (pread(fd, block.bytes, TRACK_LOG_BLOCK_SIZE, index * TRACK_LOG_BLOCK_SIZE) != TRACK_LOG_BLOCK_SIZE) {
+            return false;
+        }
+        *bytes += TRACK_LOG_BLOCK_SIZE;
+        if (block.header.magic != TRACK_LOG_MAGIC) {
+            continue;
+        }
+        size_t start = offsetof(track_block_header_t, count);
+        if (block.header.len > TRACK_LOG_DATA_MAX ||
+                col_crc32(0, block.bytes + start, sizeof(track_block_header_t) - start + block.header.len) != block.header.crc) {
+            (*bad_blocks)++;
+            continue;
+        }
+        const uint8_t *p = block.bytes + sizeof(track_block_header_t);
+        const uint8_t *end = p + block.header.len;
+        track_point_t point;
+        track_block_first(&block.header, &point);
+        for (uint32_t j = 0; j < block.header.count; j++) {
+            if (j > 0 && !track_block_next(&p, end, &point)) {
+                break;
+            }
+            int64_t row[COL_COUNT] = {0};
+            row[COL_T] = point.t_ms;
+            row[COL_LAT] = point.lat_e7;
+            row[COL_LON] = point.lon_e7;
+            row[COL_COURSE] = point.heading;
+            row[COL_PORT] = point.port;
+            row[COL_STBD] = point.stbd;
+            if (!col_writer_add(w, row)) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+static uint32_t parse_statements(const char *list)
+{
+    uint32_t mask = 0;
+    char name[8];
+    while (*list) {
+        size_t len = strcspn(list, ",");
+        int s = 0;
+        if (len < sizeof(name)) {
+            memcpy(name, list, len);
+            name[len] = '\0';
+            for (s = 1; s < (int)(sizeof(statement_names) / sizeof(statement_names[0])); s++) {
+                if (strcasecmp(name, statement_names[s]) == 0) {
+                    break;
+                }
+            }
+        }
+        if (s == 0 || s == (int)(sizeof(statement_names) / sizeof(statement_names[0]))) {
+            return 0;
+        }
+        mask |= 1 << s;
+        list += len + (list[len] == ',');
+    }
+    return mask;
+}
+
+static int cmd_convert(int argc, char **argv)
+{
+    static nmea_input_t in;
+    col_writer_t w;
+    col_source_t source = COL_SOURCE_NMEA;
+    uint32_t block_points = COL_BLOCK_POINTS_DEFAULT;
+    const char *out_path = NULL;
+    uint64_t bad_blocks = 0;
+    int opt;
+
+    nmea_decoder_init(&in.dec);
+    in.required = (1 << STATEMENT_GGA) | (1 << STATEMENT_RMC);
+    in.last_tod_ms = -1;
+    while ((opt = getopt(argc, argv, "i:r:b:o:")) != -1) {
+        switch (opt) {
+        case 'i':
+            if (strcmp(optarg, "track") == 0) {
+                source = COL_SOURCE_TRACK;
+            } else if (strcmp(optarg, "nmea") != 0) {
+                return -1;
+            }
+            break;
+        case 'r':
+            in.required = parse_statements(optarg);
+            if (!in.required) {
+                fprintf(stderr, "unknown statement in %s\n", optarg);
+                return 1;
+            }
+            break;
+        case 'b':
+            block_points = strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            out_path = optarg;
+            break;
+        default:
+            return -1;
+        }
+    }
+    if (!out_path || block_points == 0 || block_points > COL_BLOCK_POINTS_MAX) {
+        return -1;
+    }
+    if (source == COL_SOURCE_TRACK && (optind >= argc || strcmp(argv[optind], "-") == 0)) {
+        return -1;
+    }
+
+    FILE *out = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "wb");
+    if (!out) {
+        perror(out_path);
+        return 1;
+    }
+    setvbuf(out, NULL, _IOFBF, COL_OUT_BUF);
+    if (!col_writer_open(&w, out, block_points, source)) {
+        perror(out_path);
+        return 1;
+    }
+
+    double t0 = now_s();
+    int num_inputs = optind < argc ? argc - optind : 1;
+    for (int i = 0; i < num_inputs; i++) {
+        const char *path = optind < argc ? argv[optind + i] : "-";
+        int fd = strcmp(path, "-") == 0 ? STDIN_FILENO : open(path, O_RDONLY);
+        if (fd < 0) {
+            perror(path);
+            return 1;
+        }
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        bool ok = source == COL_SOURCE_TRACK ? convert_track(fd, &w, &in.bytes, &bad_blocks) :
+                  convert_nmea(fd, &in, &w);
+        if (!ok) {
+            perror(path);
+            return 1;
+        }
+        if (fd != STDIN_FILENO) {
+            close(fd);
+        }
+    }
+    if (!col_writer_close(&w) || (out != stdout && fclose(out) != 0)) {
+        perror(out_path);
+        return 1;
+    }
+    double secs = now_s() - t0;
+
+    uint64_t points = w.footer.points;
+    uint64_t out_bytes = w.offset;
+    if (source == COL_SOURCE_NMEA) {
+        fprintf(stderr, "%llu lines, %llu sentences, %llu checksum errors, %llu too long, %llu epochs without a fix\n",
+                (unsigned long long)in.lines, (unsigned long long)in.sentences, (unsigned long long)in.crc_errors,
+                (unsigned long long)in.long_lines, (unsigned long long)in.no_fix);
+    } else {
+        fprintf(stderr, "%llu blocks with a bad checksum\n", (unsigned long long)bad_blocks);
+    }
+    fprintf(stderr, "%llu points, %.3f MB, %.2f bytes a point\n", (unsigned long long)points, out_bytes / 1e6,
+            points ? (double)out_bytes / points : 0.0);
+    fprintf(stderr, "%.3f GB in %.3f s, %.3f GB/s\n", in.bytes / 1e9, secs, secs > 0 ? in.bytes / 1e9 / secs : 0.0);
+    return 0;
+}
+
+/* Seconds since 1970, or an ISO 8601 UTC date and time such as 2024-05-01T12:00:00 */
+static bool parse_time(const char *s, int64_t *ms)
+{
+    int y;
+    unsigned mo, d, h = 0, mi = 0;
+    double sec = 0;
+    char *end;
+
+    if (sscanf(s, "%4d-%2u-%2u", &y, &mo, &d) == 3) {
+        const char *t = strchr(s, 'T');
+        if (t && sscanf(t + 1, "%2u:%2u:%lf", &h, &mi, &sec) < 2) {
+            return false;
+        }
+        *ms = (int64_t)numfmt_days_from_civil(y, mo, d) * COL_MS_PER_DAY + (h * 60 + mi) * 60000 + llround(sec * 1000);
+        return true;
+    }
+    double v = strtod(s, &end);
+    *ms = llround(v * 1000);
+    return end != s && *end == '\0';
+}
+
+static void export_flush(export_t *ex)
+{
+    fwrite(ex->buf, 1, ex->len, stdout);
+    ex->len = 0;
+}
+
+static void export_begin(export_t *ex)
+{
+    switch (ex->format) {
+    case FORMAT_CSV:
+        if (ex->source == COL_SOURCE_TRACK) {
+            APPEND_LITERAL(ex->buf, ex->len, "time,lat,lon,heading,port,stbd\n");
+        } else {
+            APPEND_LITERAL(ex->buf, ex->len, "time,lat,lon,alt,speed,course,hdop,sats,fix\n");
+        }
+        break;
+    case FORMAT_GPX:
+        APPEND_LITERAL(ex->buf, ex->len, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n"
+                       "<gpx version=\"1.1\" creator=\"nmea_col\" xmlns=\"http://www.topografix.com/GPX/1/1\">"
+                       "<trk><name>spotlock</name><trkseg>\n");
+        break;
+    case FORMAT_GEOJSON:
+        APPEND_LITERAL(ex->buf, ex->len, "{\"type\":\"FeatureCollection\",\"features\":[{\"type\":\"Feature\","
+                       "\"geometry\":{\"type\":\"LineString\",\"coordinates\":[\n");
+        break;
+    }
+}
+
+static void export_point(export_t *ex, int64_t *const col[COL_COUNT], uint32_t i)
+{
+    char *buf = ex->buf;
+    size_t numchars = ex->len;
+    bool nmea = ex->source != COL_SOURCE_TRACK;
+
+    switch (ex->format) {
+    case FORMAT_CSV:
+        numchars += numfmt_utc(buf + numchars, col[COL_T][i]);
+        buf[numchars++] = ',';
+        numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_LAT][i], 7);
+        buf[numchars++] = ',';
+        numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_LON][i], 7);
+        buf[numchars++] = ',';
+        if (nmea) {
+            numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_ALT][i], 2);
+            buf[numchars++] = ',';
+            numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_SPEED][i], 2);
+            buf[numchars++] = ',';
+            numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_COURSE][i], 1);
+            buf[numchars++] = ',';
+            numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_HDOP][i], 2);
+            buf[numchars++] = ',';
+            numchars += numfmt_int(buf + numchars, (int32_t)col[COL_SATS][i]);
+            buf[numchars++] = ',';
+            numchars += numfmt_int(buf + numchars, (int32_t)col[COL_FIX][i]);
+        } else {
+            numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_COURSE][i], 1);
+            buf[numchars++] = ',';
+            numchars += numfmt_int(buf + numchars, (int32_t)col[COL_PORT][i]);
+            buf[numchars++] = ',';
+            numchars += numfmt_int(buf + numchars, (int32_t)col[COL_STBD][i]);
+        }
+        buf[numchars++] = '\n';
+        break;
+    case FORMAT_GPX:
+        APPEND_LITERAL(buf, numchars, "<trkpt lat=\"");
+        numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_LAT][i], 7);
+        APPEND_LITERAL(buf, numchars, "\" lon=\"");
+        numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_LON][i], 7);
+        APPEND_LITERAL(buf, numchars, "\">");
+        if (nmea) {
+            APPEND_LITERAL(buf, numchars, "<ele>");
+            numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_ALT][i], 2);
+            APPEND_LITERAL(buf, numchars, "</ele>");
+        }
+        APPEND_LITERAL(buf, numchars, "<time>");
+        numchars += numfmt_utc(buf + numchars, col[COL_T][i]);
+        APPEND_LITERAL(buf, numchars, "</time>");
+        if (nmea) {
+            APPEND_LITERAL(buf, numchars, "<sat>");
+            numchars += numfmt_int(buf + numchars, (int32_t)col[COL_SATS][i]);
+            APPEND_LITERAL(buf, numchars, "</sat><hdop>");
+            numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_HDOP][i], 2);
+            APPEND_LITERAL(buf, numchars, "</hdop>");
+        }
+        APPEND_LITERAL(buf, numchars, "</trkpt>\n");
+        break;
+    case FORMAT_GEOJSON:
+        if (ex->points > 0) {
+            buf[numchars++] = ',';
+        }
+        buf[numchars++] = '[';
+        numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_LON][i], 7);
+        buf[numchars++] = ',';
+        numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_LAT][i], 7);
+        if (nmea) {
+            buf[numchars++] = ',';
+            numchars += numfmt_scaled(buf + numchars, (int32_t)col[COL_ALT][i], 2);
+        }
+        buf[numchars++] = ']';
+        buf[numchars++] = '\n';
+        break;
+    }
+    if (ex->points == 0) {
+        ex->first_ms = col[COL_T][i];
+    }
+    ex->last_ms = col[COL_T][i];
+    ex->points++;
+    ex->len = numchars;
+    if (ex->len > sizeof(ex->buf) - COL_POINT_OUT_MAX) {
+        export_flush(ex);
+    }
+}
+
+static void export_end(export_t *ex)
+{
+    switch (ex->format) {
+    case FORMAT_CSV:
+        break;
+    case FORMAT_GPX:
+        APPEND_LITERAL(ex->buf, ex->len, "</trkseg></trk></gpx>\n");
+        break;
+    case FORMAT_GEOJSON:
+        /* The properties follow the geometry, the time span is only known once the points are out */
+        ex->len += sprintf(ex->buf + ex->len, "]},\"properties\":{\"points\":%llu", (unsigned long long)ex->points);
+        if (ex->points > 0) {
+            APPEND_LITERAL(ex->buf, ex->len, ",\"start\":\"");
+            ex->len += numfmt_utc(ex->buf + ex->len, ex->first_ms);
+            APPEND_LITERAL(ex->buf, ex->len, "\",\"end\":\"");
+            ex->len += numfmt_utc(ex->buf + ex->len, ex->last_ms);
+            ex->buf[ex->len++] = '"';
+        }
+        APPEND_LITERAL(ex->buf, ex->len, "}}]}\n");
+        break;
+    }
+    export_flush(ex);
+}
+
+static int cmd_query(int argc, char **argv)
+{
+    static export_t ex;
+    col_reader_t r;
+    int64_t from_ms = INT64_MIN, to_ms = INT64_MAX;
+    int32_t lat_min = INT32_MIN, lat_max = INT32_MAX, lon_min = INT32_MIN, lon_max = INT32_MAX;
+    uint64_t skipped_time = 0, skipped_area = 0, decoded = 0, bad = 0, bytes = 0;
+    int opt;
+
+    ex.format = FORMAT_CSV;
+    while ((opt = getopt(argc, argv, "f:t:a:o:")) != -1) {
+        switch (opt) {
+        case 'f':
+            if (!parse_time(optarg, &from_ms)) {
+                return -1;
+            }
+            break;
+        case 't':
+            if (!parse_time(optarg, &to_ms)) {
+                return -1;
+            }
+            /* Up to the end of that second, like /track */
+            to_ms += 999;
+            break;
+        case 'a': {
+            double lat0, lon0, lat1, lon1;
+            if (sscanf(optarg, "%lf,%lf,%lf,%lf", &lat0, &lon0, &lat1, &lon1) != 4) {
+                return -1;
+            }
+            lat_min = lround(fmin(lat0, lat1) * COL_E7_PER_DEG);
+            lat_max = lround(fmax(lat0, lat1) * COL_E7_PER_DEG);
+            lon_min = lround(fmin(lon0, lon1) * COL_E7_PER_DEG);
+            lon_max = lround(fmax(lon0, lon1) * COL_E7_PER_DEG);
+            break;
+        }
+        case 'o':
+            if (strcmp(optarg, "csv") == 0) {
+                ex.format = FORMAT_CSV;
+            } else if (strcmp(optarg, "gpx") == 0) {
+                ex.format = FORMAT_GPX;
+            } else if (strcmp(optarg, "geojson") == 0) {
+                ex.format = FORMAT_GEOJSON;
+            } else {
+                return -1;
+            }
+            break;
+        default:
+            return -1;
+        }
+    }
+    if (optind + 1 != argc) {
+        return -1;
+    }
+    const char *err = col_reader_open(&r, argv[optind]);
+    if (err) {
+        fprintf(stderr, "%s: %s\n", argv[optind], err);
+        return 1;
+    }
+    int64_t *col[COL_COUNT];
+    for (int c = 0; c < COL_COUNT; c++) {
+        col[c] = malloc(r.header.block_points * sizeof(int64_t));
+        if (!col[c]) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+    }
+
+    double t0 = now_s();
+    ex.source = r.header.source;
+    export_begin(&ex);
+    /* Blocks before the one the index search lands on count as skipped by time, as do those after the break */
+    uint64_t b = col_reader_seek(&r, from_ms);
+    skipped_time = b;
+    for (; b < r.footer.blocks; b++) {
+        col_index_entry_t entry;
+        col_block_header_t header;
+        if (!col_reader_entry(&r, b, &entry)) {
+            fprintf(stderr, "%s: index unreadable\n", argv[optind]);
+            return 1;
+        }
+        if (entry.t_min > to_ms && (r.footer.flags & COL_SORTED)) {
+            skipped_time += r.footer.blocks - b;
+            break;
+        }
+        if (entry.t_max < from_ms || entry.t_min > to_ms) {
+            skipped_time++;
+            continue;
+        }
+        if (!col_reader_header(&r, &entry, &header)) {
+            bad++;
+            continue;
+        }
+        if (header.max[COL_LAT] < lat_min || header.min[COL_LAT] > lat_max ||
+                header.max[COL_LON] < lon_min || header.min[COL_LON] > lon_max) {
+            skipped_area++;
+            continue;
+        }
+        if (!col_reader_decode(&r, &entry, &header, col)) {
+            bad++;
+            continue;
+        }
+        decoded++;
+        bytes += sizeof(header) + header.len;
+        for (uint32_t i = 0; i < header.count; i++) {
+            if (col[COL_T][i] >= from_ms && col[COL_T][i] <= to_ms &&
+                    col[COL_LAT][i] >= lat_min && col[COL_LAT][i] <= lat_max &&
+                    col[COL_LON][i] >= lon_min && col[COL_LON][i] <= lon_max) {
+                export_point(&ex, col, i);
+            }
+        }
+    }
+    export_end(&ex);
+    double secs = now_s() - t0;
+    fprintf(stderr, "%llu points from %llu of %llu blocks, %llu skipped by time, %llu by area, %llu damaged; "
+            "%.3f MB decoded in %.3f s\n", (unsigned long long)ex.points, (unsigned long long)decoded,
+            (unsigned long long)r.footer.blocks, (unsigned long long)skipped_time, (unsigned long long)skipped_area,
+            (unsigned long long)bad, bytes / 1e6, secs);
+    col_reader_close(&r);
+    return 0;
+}
+
+static void print_time(const char *name, int64_t ms)
+{
+    char buf[NUMFMT_UTC_MAX_LEN + 1];
+    buf[numfmt_utc(buf, ms)] = '\0';
+    printf("%s%s", name, buf);
+}
+
+static int cmd_info(int argc, char **argv)
+{
+    col_reader_t r;
+    col_block_header_t all = {0};
+    uint64_t col_bytes[COL_COUNT] = {0};
+    uint64_t bad = 0;
+
+    if (argc != 2) {
+        return -1;
+    }
+    const char *err = col_reader_open(&r, argv[1]);
+    if (err) {
+        fprintf(stderr, "%s: %s\n", argv[1], err);
+        return 1;
+    }
+    /* Block headers only, the bounds and column sizes are all in them */
+    for (uint64_t b = 0; b < r.footer.blocks; b++) {
+        col_index_entry_t entry;
+        col_block_header_t header;
+        if (!col_reader_entry(&r, b, &entry) || !col_reader_header(&r, &entry, &header)) {
+            bad++;
+            continue;
+        }
+        for (int c = 0; c < COL_COUNT; c++) {
+            if (all.count == 0 || header.min[c] < all.min[c]) {
+                all.min[c] = header.min[c];
+            }
+            if (all.count == 0 || header.max[c] > all.max[c]) {
+                all.max[c] = header.max[c];
+            }
+            col_bytes[c] += header.col_len[c];
+        }
+        all.count += header.count;
+    }
+    uint64_t size = r.footer.index_offset + r.footer.blocks * sizeof(col_index_entry_t) + sizeof(col_footer_t);
+    uint64_t points = r.footer.points;
+
+    printf("%s: %s, %llu points in %llu blocks of up to %u, %s\n", argv[1],
+           r.header.source == COL_SOURCE_TRACK ? "track log" : "NMEA", (unsigned long long)points,
+           (unsigned long long)r.footer.blocks, r.header.block_points,
+           r.footer.flags & COL_SORTED ? "in time order" : "not in time order, queries read every block");
+    printf("  %.3f MB, %.2f bytes a point, damaged blocks %llu\n", size / 1e6, points ? (double)size / points : 0.0,
+           (unsigned long long)bad);
+    if (all.count > 0) {
+        print_time("  time ", all.min[COL_T]);
+        print_time(" .. ", all.max[COL_T]);
+        printf("\n  lat %.7f .. %.7f, lon %.7f .. %.7f\n", all.min[COL_LAT] / 1e7, all.max[COL_LAT] / 1e7,
+               all.min[COL_LON] / 1e7, all.max[COL_LON] / 1e7);
+    }
+    printf("  bytes a point by column:");
+    for (int c = 0; c < COL_COUNT; c++) {
+        printf(" %s %.2f", column_names[c], points ? (double)col_bytes[c] / points : 0.0);
+    }
+    printf("\n");
+    col_reader_close(&r);
+    return 0;
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s convert [-i nmea|track] [-r gga,rmc] [-b points] -o out.col [file...]\n"
+            "  -i  input: NMEA logs, or a dump of the track partition; NMEA is read from stdin without files\n"
+            "  -r  statements that make up an epoch, one point is written per epoch with a fix, default gga,rmc\n"
+            "  -b  points per block, default %d\n"
+            "  -o  output file, - for stdout\n"
+            "       %s query [-f from] [-t to] [-a lat0,lon0,lat1,lon1] [-o csv|gpx|geojson] file.col\n"
+            "  -f  -t  time range, seconds since 1970 or UTC as 2024-05-01T12:00:00\n"
+            "  -a  area, two opposite corners in degrees\n"
+            "  -o  output format to stdout, default csv\n"
+            "       %s info file.col\n", prog, COL_BLOCK_POINTS_DEFAULT, prog, prog);
+}
+
+int main(int argc, char **argv)
+{
+    int ret = -1;
+
+    if (argc >= 2 && strcmp(argv[1], "convert") == 0) {
+        ret = cmd_convert(argc - 1, argv + 1);
+    } else if (argc >= 2 && strcmp(argv[1], "query") == 0) {
+        ret = cmd_query(argc - 1, argv + 1);
+    } else if (argc >= 2 && strcmp(argv[1], "info") == 0) {
+        ret = cmd_info(argc - 1, argv + 1);
+    }
+    if (ret < 0) {
+        usage(argv[0]);
+        return 1;
+    }
+    return ret;
+}
@@ -0,0 +1,645 @@
+/* NMEA log statistics
+
+   Reads NMEA logs through the parser code the firmware runs (main/nmea_decode.c), on every core. The
+   files are mapped, not read, and cut into chunks at line ends; each thread decodes whole chunks and
+   the chunk results are merged in file order. Everything counted is known from a single line, so the
+   figures don't depend on where the chunks fall or on the number of threads.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <string.h>
+#include <math.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <pthread.h>
+#include <time.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "nmea_decode.h"
+#include "geo.h"
+
+#define STATS_LINE_MAX (128)            /* Longest line decoded, from its '$', NMEA allows 82 */
+#define STATS_CHUNK_MIN (1 << 20)       /* Chunks are at least this size... */
+#define STATS_CHUNK_MAX (64 << 20)      /* ...and at most this */
+#define STATS_CHUNKS_PER_THREAD (8)     /* Enough to even out the threads at the end of the run */
+#define STATS_MS_PER_DAY (86400000)
+#define HIST_BINS (1024)                /* The last bin also counts everything above it */
+#define FIX_QUALITIES (10)              /* GGA quality 0..8, the last counts anything else */
+
+/**
+ * @brief Histogram with fixed bins from 0
+ *
+ */
+typedef struct {
+    double step;                /*!< Width of a bin */
+    uint64_t count;             /*!< Values added */
+    double sum;                 /*!< Sum of the values */
+    double max;                 /*!< Largest value */
+    uint64_t bin[HIST_BINS];    /*!< Counts */
+} hist_t;
+
+/**
+ * @brief Running mean and spread of the fixes, merged with Chan's parallel update
+ *
+ */
+typedef struct {
+    uint64_t n;                 /*!< Fixes */
+    double lat;                 /*!< Mean latitude (degrees) */
+    double lon;                 /*!< Mean longitude (degrees) */
+    double m2_lat;              /*!< Sum of squared latitude deviations */
+    double m2_lon;              /*!< Sum of squared longitude deviations */
+} station_t;
+
+/**
+ * @brief Gaps between fixes
+ *
+ */
+typedef struct {
+    uint64_t count;             /*!< Intervals longer than the gap threshold */
+    uint64_t back;              /*!< Times a fix was not later than the one before, e.g. the receiver restarted */
+    double total_s;             /*!< Time in those gaps */
+    double max_s;               /*!< Longest interval */
+    int32_t max_end_ms;         /*!< UTC time of day of the fix ending the longest interval */
+    uint64_t max_end_at;        /*!< Byte offset in the file of that fix */
+} gaps_t;
+
+/**
+ * @brief A part of a file and what was found in it
+ *
+ * Holds what the merge needs in file order; the distributions are in the thread's tally_t.
+ *
+ */
+typedef struct {
+    int file;                   /*!< Index of the file */
+    size_t start;               /*!< Offset of the first byte, the start of a line */
+    size_t end;                 /*!< Offset after the last byte, the end of a line or of the file */
+    uint64_t lines;             /*!< Lines */
+    uint64_t sentences;         /*!< Lines with a good checksum */
+    uint64_t crc_errors;        /*!< Lines with a '$' and a bad or missing checksum */
+    uint64_t fixes;             /*!< GGA with a fix */
+    uint64_t no_fix;            /*!< GGA without a fix */
+    int32_t first_fix_ms;       /*!< UTC time of day of the first fix, -1 if none */
+    int32_t last_fix_ms;        /*!< UTC time of day of the last fix, -1 if none */
+    gaps_t gaps;                /*!< Gaps between the fixes of this chunk */
+    station_t station;          /*!< Spread of the fixes */
+} chunk_t;
+
+/**
+ * @brief Distributions, one per thread and added up at the end
+ *
+ */
+typedef struct {
+    uint64_t statements[STATEMENT_DTM + 1];     /*!< Sentences with a good checksum per statement, unknown at 0 */
+    uint64_t other_lines;                       /*!< Lines without a '$' */
+    uint64_t long_lines;                        /*!< Lines too long to be NMEA */
+    uint64_t fix_quality[FIX_QUALITIES];        /*!< GGA per quality indicator */
+    uint64_t snr_untracked;                     /*!< GSV satellites without an SNR */
+    hist_t interval;                            /*!< Seconds between fixes */
+    hist_t hdop;                                /*!< GGA HDOP of the fixes */
+    hist_t pdop;                                /*!< GSA PDOP */
+    hist_t vdop;                                /*!< GSA VDOP */
+    hist_t snr;                                 /*!< GSV SNR (dB-Hz) */
+    hist_t dist;                                /*!< Distance from the target (metres), with -t */
+} tally_t;
+
+/**
+ * @brief A mapped log file
+ *
+ */
+typedef struct {
+    const char *path;
+    const char *data;           /*!< Mapping, NULL if the file is empty or can't be read */
+    size_t size;
+} log_file_t;
+
+static const char *const statement_names[] = {
+    "other",
+#define STATS_STATEMENT_NAME(NAME, name, fields) #NAME,
+    NMEA_STATEMENT_LIST(STATS_STATEMENT_NAME)
+#undef STATS_STATEMENT_NAME
+};
+
+static log_file_t *files;
+static chunk_t *chunks;
+static size_t num_chunks;
+static atomic_size_t next_chunk;
+static int32_t gap_ms = 2000;
+static bool has_target;
+static geo_point_t target;
+
+static void hist_init(hist_t *h, double step)
+{
+    memset(h, 0, sizeof(*h));
+    h->step = step;
+}
+
+static void hist_add(hist_t *h, double value)
+{
+    size_t i = value > 0 ? (size_t)(value / h->step) : 0;
+    h->bin[i < HIST_BINS ? i : HIST_BINS - 1]++;
+    h->count++;
+    h->sum += value;
+    if (value > h->max) {
+        h->max = value;
+    }
+}
+
+static void hist_merge(hist_t *h, const hist_t *other)
+{
+    for (size_t i = 0; i < HIST_BINS; i++) {
+        h->bin[i] += other->bin[i];
+    }
+    h->count += other->count;
+    h->sum += other->sum;
+    if (other->max > h->max) {
+        h->max = other->max;
+    }
+}
+
+/* Upper edge of the bin holding quantile q, the largest value if that is in the last bin */
+static double hist_quantile(const hist_t *h, double q)
+{
+    uint64_t rank = (uint64_t)ceil(q * h->count);
+    uint64_t seen = 0;
+    for (size_t i = 0; i < HIST_BINS - 1; i++) {
+        seen += h->bin[i];
+        if (seen >= rank && seen > 0) {
+            double edge = (i + 1) * h->step;
+            return edge < h->max ? edge : h->max;
+        }
+    }
+    return h->max;
+}
+
+static void station_add(station_t *s, double lat, double lon)
+{
+    s->n++;
+    double d_lat = lat - s->lat;
+    double d_lon = lon - s->lon;
+    s->lat += d_lat / s->n;
+    s->lon += d_lon / s->n;
+    s->m2_lat += d_lat * (lat - s->lat);
+    s->m2_lon += d_lon * (lon - s->lon);
+}
+
+static void station_merge(station_t *s, const station_t *other)
+{
+    if (other->n == 0) {
+        return;
+    }
+    if (s->n == 0) {
+        *s = *other;
+        return;
+    }
+    double n = (double)s->n + other->n;
+    double d_lat = other->lat - s->lat;
+    double d_lon = other->lon - s->lon;
+    s->m2_lat += other->m2_lat + d_lat * d_lat * s->n * other->n / n;
+    s->m2_lon += other->m2_lon + d_lon * d_lon * s->n * other->n / n;
+    s->lat += d_lat * other->n / n;
+    s->lon += d_lon * other->n / n;
+    s->n += other->n;
+}
+
+/* Sum of the squared distances from the mean position, in square metres */
+static double station_m2_metres(const station_t *s)
+{
+    double north = GEO_METRES_PER_DEG;
+    double east = GEO_METRES_PER_DEG * cos(s->lat * M_PI / 180.0);
+    return s->m2_lat * north * north + s->m2_lon * east * east;
+}
+
+static void gaps_merge(gaps_t *g, const gaps_t *other)
+{
+    g->count += other->count;
+    g->back += other->back;
+    g->total_s += other->total_s;
+    if (other->max_s > g->max_s) {
+        g->max_s = other->max_s;
+        g->max_end_ms = other->max_end_ms;
+        g->max_end_at = other->max_end_at;
+    }
+}
+
+/* Account for the time from one fix to the next, the times are UTC time of day */
+static void add_interval(gaps_t *g, hist_t *interval, int32_t prev_ms, int32_t ms, uint64_t at)
+{
+    int32_t dt = ms - prev_ms;
+    if (dt < -STATS_MS_PER_DAY / 2) {
+        /* Past midnight */
+        dt += STATS_MS_PER_DAY;
+    }
+    if (dt <= 0) {
+        g->back++;
+        return;
+    }
+    double dt_s = dt / 1000.0;
+    hist_add(interval, dt_s);
+    if (dt > gap_ms) {
+        g->count++;
+        g->total_s += dt_s;
+    }
+    if (dt_s > g->max_s) {
+        g->max_s = dt_s;
+        g->max_end_ms = ms;
+        g->max_end_at = at;
+    }
+}
+
+static void add_gga(chunk_t *c, tally_t *t, const gps_t *gps, uint64_t at)
+{
+    t->fix_quality[gps->fix < FIX_QUALITIES ? gps->fix : FIX_QUALITIES - 1]++;
+    if (gps->fix == GPS_FIX_INVALID) {
+        c->no_fix++;
+        return;
+    }
+    c->fixes++;
+    int32_t ms = ((gps->tim.hour * 60 + gps->tim.minute) * 60 + gps->tim.second) * 1000 + gps->tim.thousand;
+    if (c->last_fix_ms >= 0) {
+        add_interval(&c->gaps, &t->interval, c->last_fix_ms, ms, at);
+    } else {
+        c->first_fix_ms = ms;
+    }
+    c->last_fix_ms = ms;
+    if (gps->dop_h > 0) {
+        hist_add(&t->hdop, gps->dop_h);
+    }
+    /* The exact position from the sentence, the float one is only good to about a metre at large longitudes */
+    station_add(&c->station, (double)gps->latitude_e7 / GEO_E7_PER_DEG, (double)gps->longitude_e7 / GEO_E7_PER_DEG);
+    if (has_target) {
+        const geo_point_t p = { gps->latitude_e7, gps->longitude_e7 };
+        float north, east;
+        geo_offset_e7(&target, &p, &north, &east);
+        hist_add(&t->dist, hypotf(north, east));
+    }
+}
+
+static void add_gsv(tally_t *t, const nmea_decoder_t *dec)
+{
+    /* The sentence filled up to four slots from 4 * (number - 1), the rest of the slots are older */
+    int first = 4 * (dec->sat_num - 1);
+    for (int i = first; i < first + 4 && i < dec->gps.sats_in_view && i < GPS_MAX_SATELLITES_IN_VIEW; i++) {
+        if (i < 0) {
+            break;
+        }
+        if (dec->gps.sats_desc_in_view[i].snr) {
+            hist_add(&t->snr, dec->gps.sats_desc_in_view[i].snr);
+        } else {
+            t->snr_untracked++;
+        }
+    }
+}
+
+static void process_chunk(chunk_t *c, tally_t *t)
+{
+    const log_file_t *f = &files[c->file];
+    nmea_decoder_t dec;
+    char line[STATS_LINE_MAX + 1];
+    const char *p = f->data + c->start;
+    const char *end = f->data + c->end;
+
+    nmea_decoder_init(&dec);
+    c->first_fix_ms = -1;
+    c->last_fix_ms = -1;
+    while (p < end) {
+        const char *eol = memchr(p, '\n', end - p);
+        if (!eol) {
+            eol = end;
+        }
+        c->lines++;
+        /* A log may put a time stamp or a source in front of the sentence */
+        const char *dollar = memchr(p, '$', eol - p);
+        if (!dollar) {
+            t->other_lines++;
+        } else if (eol - dollar > STATS_LINE_MAX) {
+            t->long_lines++;
+        } else {
+            size_t len = eol - dollar;
+            memcpy(line, dollar, len);
+            line[len] = '\0';
+            if (nmea_decode_line(&dec, line, 0) == NMEA_DECODE_CRC_ERROR) {
+                c->crc_errors++;
+            } else {
+                c->sentences++;
+                t->statements[dec.statement]++;
+                switch (dec.statement) {
+                case STATEMENT_GGA:
+                    add_gga(c, t, &dec.gps, dollar - f->data);
+                    break;
+                case STATEMENT_GSA:
+                    if (dec.gps.fix_mode >= GPS_MODE_2D && dec.gps.dop_p > 0) {
+                        hist_add(&t->pdop, dec.gps.dop_p);
+                        hist_add(&t->vdop, dec.gps.dop_v);
+                    }
+                    break;
+                case STATEMENT_GSV:
+                    add_gsv(t, &dec);
+                    break;
+                default:
+                    break;
+                }
+            }
+        }
+        p = eol + 1;
+    }
+}
+
+static void tally_init(tally_t *t)
+{
+    memset(t, 0, sizeof(*t));
+    hist_init(&t->interval, 0.01);
+    hist_init(&t->hdop, 0.1);
+    hist_init(&t->pdop, 0.1);
+    hist_init(&t->vdop, 0.1);
+    hist_init(&t->snr, 1);
+    hist_init(&t->dist, 0.1);
+}
+
+static void tally_merge(tally_t *t, const tally_t *other)
+{
+    for (size_t i = 0; i < sizeof(t->statements) / sizeof(t->statements[0]); i++) {
+        t->statements[i] += other->statements[i];
+    }
+    for (size_t i = 0; i < FIX_QUALITIES; i++) {
+        t->fix_quality[i] += other->fix_quality[i];
+    }
+    t->other_lines += other->other_lines;
+    t->long_lines += other->long_lines;
+    t->snr_untracked += other->snr_untracked;
+    hist_merge(&t->interval, &other->interval);
+    hist_merge(&t->hdop, &other->hdop);
+    hist_merge(&t->pdop, &other->pdop);
+    hist_merge(&t->vdop, &other->vdop);
+    hist_merge(&t->snr, &other->snr);
+    hist_merge(&t->dist, &other->dist);
+}
+
+static void *worker(void *arg)
+{
+    tally_t *t = arg;
+    size_t i;
+    while ((i = atomic_fetch_add(&next_chunk, 1)) < num_chunks) {
+        process_chunk(&chunks[i], t);
+    }
+    return NULL;
+}
+
+static int map_file(log_file_t *f)
+{
+    int fd = open(f->path, O_RDONLY);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) < 0) {
+        perror(f->path);
+        if (fd >= 0) {
+            close(fd);
+        }
+        return -1;
+    }
+    f->size = st.st_size;
+    if (f->size) {
+        void *data = mmap(NULL, f->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            perror(f->path);
+            close(fd);
+            return -1;
+        }
+        madvise(data, f->size, MADV_SEQUENTIAL);
+        f->data = data;
+    }
+    close(fd);
+    return 0;
+}
+
+/* Cut the files into chunks of about chunk_size bytes that end at a line end */
+static int split_files(int num_files, size_t chunk_size)
+{
+    size_t cap = 0;
+    for (int i = 0; i < num_files; i++) {
+        cap += files[i].size / chunk_size + 1;
+    }
+    chunks = calloc(cap, sizeof(*chunks));
+    if (!chunks) {
+        return -1;
+    }
+    for (int i = 0; i < num_files; i++) {
+        const log_file_t *f = &files[i];
+        size_t start = 0;
+        while (start < f->size) {
+            size_t end = f->size;
+            if (f->size - start > chunk_size) {
+                const char *eol = memchr(f->data + start + chunk_size, '\n', f->size - start - chunk_size);
+                end = eol ? (size_t)(eol - f->data) + 1 : f->size;
+            }
+            chunk_t *c = &chunks[num_chunks++];
+            c->file = i;
+            c->start = start;
+            c->end = end;
+            start = end;
+        }
+    }
+    return 0;
+}
+
+static void print_hist(const char *name, const hist_t *h, const char *unit)
+{
+    if (h->count == 0) {
+        printf("  %-9s none\n", name);
+        return;
+    }
+    printf("  %-9s mean %6.2f  p50 %6.2f  p95 %6.2f  p99 %6.2f  max %7.2f %s  (%llu)\n", name, h->sum / h->count,
+           hist_quantile(h, 0.5), hist_quantile(h, 0.95), hist_quantile(h, 0.99), h->max, unit,
+           (unsigned long long)h->count);
+}
+
+static void print_time_of_day(int32_t ms)
+{
+    printf("%02d:%02d:%02d.%03d", ms / 3600000, ms / 60000 % 60, ms / 1000 % 60, ms % 1000);
+}
+
+static void usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [-j threads] [-g gap_s] [-t lat,lon] file...\n"
+            "  -j  threads, default one per core\n"
+            "  -g  interval between fixes counted as a gap, default 2 s\n"
+            "  -t  station keeping target, distance of each fix from it\n", prog);
+}
+
+int main(int argc, char **argv)
+{
+    long threads = sysconf(_SC_NPROCESSORS_ONLN);
+    int opt;
+
+    while ((opt = getopt(argc, argv, "j:g:t:h")) != -1) {
+        switch (opt) {
+        case 'j':
+            threads = strtol(optarg, NULL, 10);
+            break;
+        case 'g':
+            gap_ms = (int32_t)(strtod(optarg, NULL) * 1000);
+            break;
+        case 't': {
+            double lat, lon;
+            if (sscanf(optarg, "%lf,%lf", &lat, &lon) != 2 || fabs(lat) > 90 || fabs(lon) > 180) {
+                usage(argv[0]);
+                return 1;
+            }
+            target.lat_e7 = lround(lat * GEO_E7_PER_DEG);
+            target.lon_e7 = lround(lon * GEO_E7_PER_DEG);
+            has_target = true;
+            break;
+        }
+        default:
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (optind >= argc || threads < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int num_files = argc - optind;
+    files = calloc(num_files, sizeof(*files));
+    size_t total = 0;
+    for (int i = 0; i < num_files; i++) {
+        files[i].path = argv[optind + i];
+        if (map_file(&files[i]) != 0) {
+            return 1;
+        }
+        total += files[i].size;
+    }
+    size_t chunk_size = total / (threads * STATS_CHUNKS_PER_THREAD);
+    chunk_size = chunk_size < STATS_CHUNK_MIN ? STATS_CHUNK_MIN : chunk_size > STATS_CHUNK_MAX ? STATS_CHUNK_MAX : chunk_size;
+
+    struct timespec t0, t1;
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+    tally_t *tallies = malloc(threads * sizeof(*tallies));
+    pthread_t *tids = malloc(threads * sizeof(*tids));
+    if (!tallies || !tids || split_files(num_files, chunk_size) != 0) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (long i = 0; i < threads; i++) {
+        tally_init(&tallies[i]);
+        if (pthread_create(&tids[i], NULL, worker, &tallies[i]) != 0) {
+            perror("pthread_create");
+            return 1;
+        }
+    }
+    for (long i = 0; i < threads; i++) {
+        pthread_join(tids[i], NULL);
+        if (i > 0) {
+            tally_merge(&tallies[0], &tallies[i]);
+        }
+    }
+    tally_t *all = &tallies[0];
+
+    /* Merge the chunks of each file in order, the interval across a chunk boundary is only known here */
+    chunk_t *per_file = calloc(num_files, sizeof(*per_file));
+    chunk_t total_chunk = {0};
+    for (int i = 0; i < num_files; i++) {
+        per_file[i].first_fix_ms = -1;
+        per_file[i].last_fix_ms = -1;
+    }
+    for (size_t i = 0; i < num_chunks; i++) {
+        const chunk_t *c = &chunks[i];
+        chunk_t *f = &per_file[c->file];
+        if (f->last_fix_ms >= 0 && c->first_fix_ms >= 0) {
+            add_interval(&f->gaps, &all->interval, f->last_fix_ms, c->first_fix_ms, c->start);
+        }
+        if (f->first_fix_ms < 0) {
+            f->first_fix_ms = c->first_fix_ms;
+        }
+        if (c->last_fix_ms >= 0) {
+            f->last_fix_ms = c->last_fix_ms;
+        }
+        f->lines += c->lines;
+        f->sentences += c->sentences;
+        f->crc_errors += c->crc_errors;
+        f->fixes += c->fixes;
+        f->no_fix += c->no_fix;
+        gaps_merge(&f->gaps, &c->gaps);
+        station_merge(&f->station, &c->station);
+    }
+    double pooled_m2 = 0;
+    for (int i = 0; i < num_files; i++) {
+        total_chunk.lines += per_file[i].lines;
+        total_chunk.sentences += per_file[i].sentences;
+        total_chunk.crc_errors += per_file[i].crc_errors;
+        total_chunk.fixes += per_file[i].fixes;
+        total_chunk.no_fix += per_file[i].no_fix;
+        total_chunk.station.n += per_file[i].station.n;
+        gaps_merge(&total_chunk.gaps, &per_file[i].gaps);
+        pooled_m2 += station_m2_metres(&per_file[i].station);
+    }
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    double secs = (t1.tv_sec - t0.tv_sec) + (t1.tv_nsec - t0.tv_nsec) / 1e9;
+
+    printf("%-32s %9s %12s %9s %10s %6s %6s %9s %7s\n", "file", "MB", "sentences", "crc err", "fixes", "fix %",
+           "gaps", "max gap s", "rms m");
+    for (int i = 0; i < num_files; i++) {
+        const chunk_t *f = &per_file[i];
+        uint64_t gga = f->fixes + f->no_fix;
+        printf("%-32s %9.1f %12llu %9llu %10llu %6.1f %6llu %9.1f %7.2f\n", files[i].path, files[i].size / 1e6,
+               (unsigned long long)f->sentences, (unsigned long long)f->crc_errors, (unsigned long long)f->fixes,
+               gga ? 100.0 * f->fixes / gga : 0.0, (unsigned long long)f->gaps.count, f->gaps.max_s,
+               f->station.n ? sqrt(station_m2_metres(&f->station) / f->station.n) : 0.0);
+    }
+
+    const chunk_t *tc = &total_chunk;
+    printf("\nlines %llu, sentences %llu, crc errors %llu (%.3f%%), no '$' %llu, too long %llu\n",
+           (unsigned long long)tc->lines, (unsigned long long)tc->sentences, (unsigned long long)tc->crc_errors,
+           tc->sentences + tc->crc_errors ? 100.0 * tc->crc_errors / (tc->sentences + tc->crc_errors) : 0.0,
+           (unsigned long long)all->other_lines, (unsigned long long)all->long_lines);
+    printf("sentences:");
+    for (size_t i = 0; i < sizeof(all->statements) / sizeof(all->statements[0]); i++) {
+        if (all->statements[i]) {
+            printf(" %s %llu", statement_names[i], (unsigned long long)all->statements[i]);
+        }
+    }
+    printf("\nGGA quality:");
+    for (size_t i = 0; i < FIX_QUALITIES; i++) {
+        if (all->fix_quality[i]) {
+            printf(" %zu%s: %llu", i, i == FIX_QUALITIES - 1 ? "+" : "", (unsigned long long)all->fix_quality[i]);
+        }
+    }
+    printf("\n\nfix interval\n");
+    print_hist("interval", &all->interval, "s");
+    printf("  gaps over %.1f s: %llu, %.1f s in all, time going back %llu\n", gap_ms / 1000.0,
+           (unsigned long long)tc->gaps.count, tc->gaps.total_s, (unsigned long long)tc->gaps.back);
+    if (tc->gaps.max_s > 0) {
+        printf("  longest %.1f s, up to the fix at ", tc->gaps.max_s);
+        print_time_of_day(tc->gaps.max_end_ms);
+        printf(" (byte %llu)\n", (unsigned long long)tc->gaps.max_end_at);
+    }
+    printf("\nDOP\n");
+    print_hist("HDOP", &all->hdop, "");
+    print_hist("PDOP", &all->pdop, "");
+    print_hist("VDOP", &all->vdop, "");
+    printf("\nSNR, %llu satellites not tracked\n", (unsigned long long)all->snr_untracked);
+    print_hist("SNR", &all->snr, "dB-Hz");
+    printf("\nstation keeping\n");
+    if (tc->station.n) {
+        printf("  rms distance from each file's mean position %.2f m\n", sqrt(pooled_m2 / tc->station.n));
+    }
+    if (has_target) {
+        printf("  distance from %.7f,%.7f\n", (double)target.lat_e7 / GEO_E7_PER_DEG,
+               (double)target.lon_e7 / GEO_E7_PER_DEG);
+        print_hist("distance", &all->dist, "m");
+    }
+    printf("\n%.3f GB in %.3f s, %.2f GB/s on %ld threads, %zu chunks\n", total / 1e9, secs,
+           secs > 0 ? total / 1e9 / secs : 0.0, threads, num_chunks);
+    return 0;
+}
@@ -0,0 +1,47 @@
+/* Minimal checks for the host tests
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#pragma once
+
+#include <stdio.h>
+#include <math.h>
+
+static int test_failures;
+
+/**
+ * @brief Report a failed condition and carry on, the test exits non-zero at the end
+ *
+ */
+#define CHECK(cond)                                                             \
+    do {                                                                        \
+        if (!(cond)) {                                                          \
+            printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond);     \
+            test_failures++;                                                    \
+        }                                                                       \
+    } while (0)
+
+/**
+ * @brief Check that two numbers agree within a tolerance
+ *
+ */
+#define CHECK_NEAR(a, b, tol)                                                           \
+    do {                                                                                \
+        double a_ = (a), b_ = (b);                                                      \
+        if (!(fabs(a_ - b_) <= (tol))) {                                                \
+            printf("%s:%d: CHECK_NEAR(%s, %s) failed: %g vs %g\n", __FILE__, __LINE__,  \
+                   #a, #b, a_, b_);                                                     \
+            test_failures++;                                                            \
+        }                                                                               \
+    } while (0)
+
+/**
+ * @brief Exit status of the test
+ *
+ */
+#define TEST_RESULT() (test_failures ? (printf("%d checks failed\n", test_failures), 1) : 0)
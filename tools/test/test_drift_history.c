@@ -0,0 +1,149 @@
+/* Tests of the drift history
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include "drift_history.h"
+#include "test.h"
+
+#define DRIFT_VN (0.10f)
+#define DRIFT_VE (-0.05f)
+
+/**
+ * @brief Drift idle for a while, then motor back to the target, over and over
+ *
+ * The boat drifts at a steady rate while idle and is returned to the target while driven, so pooling the
+ * idle samples into one line gives a slope near zero.
+ */
+static void test_segments(int idle_s, int driven_s, int laps)
+{
+    drift_history_t hist;
+    drift_estimate_t est;
+    drift_sample_t s = { 0 };
+    int64_t t_us = 1000000;
+
+    drift_history_init(&hist, 10);
+    for (int lap = 0; lap < laps; lap++) {
+        for (int i = 0; i < idle_s; i++) {
+            s.t_us = t_us;
+            s.north = DRIFT_VN * i;
+            s.east = DRIFT_VE * i;
+            s.port = s.stbd = 0;
+            drift_history_add(&hist, &s, 0, 0);
+            t_us += 1000000;
+        }
+        for (int i = 0; i < driven_s; i++) {
+            float left = 1.0f - (float)(i + 1) / driven_s;
+            s.t_us = t_us;
+            s.north = DRIFT_VN * idle_s * left;
+            s.east = DRIFT_VE * idle_s * left;
+            s.port = s.stbd = 40;
+            drift_history_add(&hist, &s, 0, 0);
+            t_us += 1000000;
+        }
+    }
+    drift_history_estimate(&hist, &est);
+    CHECK(est.drift_valid);
+    CHECK_NEAR(est.drift_vn, DRIFT_VN, 0.002);
+    CHECK_NEAR(est.drift_ve, DRIFT_VE, 0.002);
+    CHECK(hist.seg_count <= DRIFT_SEGMENTS_MAX);
+}
+
+/**
+ * @brief Runs with one idle sample each carry no slope
+ *
+ */
+static void test_single_samples(void)
+{
+    drift_history_t hist;
+    drift_estimate_t est;
+    drift_sample_t s = { 0 };
+
+    drift_history_init(&hist, 10);
+    for (int i = 0; i < 3 * DRIFT_HISTORY_LEN; i++) {
+        s.t_us = (int64_t)i * 1000000;
+        s.north = i;
+        s.port = s.stbd = i % 2 ? 30 : 0;
+        drift_history_add(&hist, &s, 0, 0);
+    }
+    drift_history_estimate(&hist, &est);
+    CHECK(!est.drift_valid);
+    CHECK(est.valid);
+    CHECK_NEAR(est.vn, 1.0, 1e-3);
+    CHECK(hist.seg_count == DRIFT_HISTORY_LEN / 2);
+}
+
+/**
+ * @brief The incremental fit agrees with one recomputed from the samples at every step
+ *
+ */
+static void test_incremental(void)
+{
+    drift_history_t hist;
+    drift_estimate_t est;
+    drift_sample_t s = { 0 };
+    uint32_t seed = 1;
+
+    drift_history_init(&hist, 10);
+    for (int i = 0; i < 5 * DRIFT_HISTORY_LEN + 7; i++) {
+        seed = seed * 1103515245 + 12345;
+        s.t_us = (int64_t)i * 1000000 + (seed >> 16) % 200000;
+        s.north += 0.2f * ((seed >> 8) % 100) / 100.0f - 0.05f;
+        s.east += 0.1f;
+        s.port = s.stbd = (seed >> 20) % 3 == 0 ? 50 : 0;
+        drift_history_add(&hist, &s, 0, 0);
+        drift_history_estimate(&hist, &est);
+
+        /* Brute force: centred sums per idle run, oldest sample first */
+        double stt = 0, stn = 0, ste = 0, n = 0;
+        int start = -1;
+        for (int k = 0; k <= hist.count; k++) {
+            const drift_sample_t *p = k < hist.count ?
+                                      &hist.samples[(hist.head + DRIFT_HISTORY_LEN - hist.count + k) % DRIFT_HISTORY_LEN] : NULL;
+            bool idle = p && p->port == 0 && p->stbd == 0;
+            if (idle && start < 0) {
+                start = k;
+            }
+            if (!idle && start >= 0) {
+                int len = k - start;
+                double mt = 0, mn = 0, me = 0;
+                for (int j = start; j < k; j++) {
+                    const drift_sample_t *q = &hist.samples[(hist.head + DRIFT_HISTORY_LEN - hist.count + j) % DRIFT_HISTORY_LEN];
+                    mt += q->t_us / 1e6 / len;
+                    mn += q->north / len;
+                    me += q->east / len;
+                }
+                for (int j = start; j < k && len >= 2; j++) {
+                    const drift_sample_t *q = &hist.samples[(hist.head + DRIFT_HISTORY_LEN - hist.count + j) % DRIFT_HISTORY_LEN];
+                    double dt = q->t_us / 1e6 - mt;
+                    stt += dt * dt;
+                    stn += dt * (q->north - mn);
+                    ste += dt * (q->east - me);
+                }
+                n += len >= 2 ? len : 0;
+                start = -1;
+            }
+        }
+        bool valid = n >= 4 && stt > 1e-6;
+        CHECK(est.drift_valid == valid);
+        if (valid && est.drift_valid) {
+            CHECK_NEAR(est.drift_vn, stn / stt, 1e-3);
+            CHECK_NEAR(est.drift_ve, ste / stt, 1e-3);
+        }
+    }
+}
+
+int main(void)
+{
+    test_segments(10, 5, 20);
+    test_segments(3, 2, 40);
+    test_segments(DRIFT_HISTORY_LEN * 2, 0, 1);
+    test_single_samples();
+    test_incremental();
+    return TEST_RESULT();
+}
@@ -0,0 +1,267 @@
+/* Tests of the geofence
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include "geofence.h"
+#include "nvs.h"
+#include "test.h"
+
+#define MARGIN_M (10.0f)
+#define ESCAPE_DUTY (40.0f)
+
+static geofence_def_t def;
+static geofence_t fence;
+
+/**
+ * @brief Add a square polygon, half_m either side of a point offset from ref
+ *
+ */
+static void add_square(const geo_point_t *ref, float north, float east, float half_m, geofence_kind_t kind)
+{
+    geo_point_t v[4];
+    geo_point_at(ref, north - half_m, east - half_m, &v[0]);
+    geo_point_at(ref, north - half_m, east + half_m, &v[1]);
+    geo_point_at(ref, north + half_m, east + half_m, &v[2]);
+    geo_point_at(ref, north + half_m, east - half_m, &v[3]);
+    CHECK(geofence_def_add(&def, kind, v, 4) == ESP_OK);
+}
+
+static void check_at(const geo_point_t *ref, float north, float east, geofence_result_t *res)
+{
+    geo_point_t p;
+    geo_point_at(ref, north, east, &p);
+    geofence_check(&fence, &p, MARGIN_M, res);
+}
+
+/**
+ * @brief Containment, clearance and the direction of danger for an operating area with a no-go zone in it
+ *
+ */
+static void test_check(void)
+{
+    const geo_point_t ref = { 515000000, -1000000 };
+    geofence_result_t res;
+
+    geofence_def_clear(&def);
+    add_square(&ref, 0, 0, 100, GEOFENCE_KEEP_IN);
+    add_square(&ref, 50, 0, 10, GEOFENCE_KEEP_OUT);
+    geofence_build(&fence, &def);
+    CHECK(fence.polygon_count == 2);
+
+    /* Well inside, nothing within the margin of a boundary */
+    check_at(&ref, -50, 0, &res);
+    CHECK(!res.breached);
+    CHECK(res.polygon < 0 || res.clearance_m >= MARGIN_M);
+
+    /* 4 m inside the east edge of the area, danger is east */
+    check_at(&ref, -50, 96, &res);
+    CHECK(!res.breached);
+    CHECK(res.polygon == 0);
+    CHECK_NEAR(res.clearance_m, 4, 0.02);
+    CHECK_NEAR(res.danger_e, 1, 1e-3);
+
+    /* 3 m outside the east edge, breached, danger stays east, further out */
+    check_at(&ref, -50, 103, &res);
+    CHECK(res.breached);
+    CHECK(res.polygon == 0);
+    CHECK_NEAR(res.clearance_m, -3, 0.02);
+    CHECK_NEAR(res.danger_e, 1, 1e-3);
+
+    /* 2 m south of the no-go zone, danger is north */
+    check_at(&ref, 38, 0, &res);
+    CHECK(!res.breached);
+    CHECK(res.polygon == 1);
+    CHECK_NEAR(res.clearance_m, 2, 0.02);
+    CHECK_NEAR(res.danger_n, 1, 1e-3);
+
+    /* 3 m into the no-go zone from the south, danger is deeper in */
+    check_at(&ref, 43, 0, &res);
+    CHECK(res.breached);
+    CHECK(res.polygon == 1);
+    CHECK_NEAR(res.clearance_m, -3, 0.02);
+    CHECK_NEAR(res.danger_n, 1, 1e-3);
+}
+
+/**
+ * @brief Centimetres are kept far from the equator and the meridian, where float degrees only resolve decimetres
+ *
+ */
+static void test_precision(void)
+{
+    const geo_point_t ref = { 600000000, 1799000000 };
+    geofence_result_t res;
+
+    geofence_def_clear(&def);
+    add_square(&ref, 0, 0, 1, GEOFENCE_KEEP_IN);
+    geofence_build(&fence, &def);
+    for (int cm = -95; cm <= 95; cm += 5) {
+        check_at(&ref, 0, cm / 100.0f, &res);
+        CHECK(!res.breached);
+        CHECK_NEAR(res.clearance_m, 1 - fabsf(cm / 100.0f), 0.01);
+    }
+    check_at(&ref, 0, 1.05f, &res);
+    CHECK(res.breached);
+}
+
+/**
+ * @brief Near a boundary only forward thrust towards it is cut, the turn is kept
+ *
+ */
+static void test_limit_near(void)
+{
+    geofence_result_t res = { .breached = false, .clearance_m = 5, .danger_n = 0, .danger_e = 1, .polygon = 0 };
+    float port, stbd;
+
+    /* Heading east at the boundary: forward thrust halves at half the margin, the turn is unchanged */
+    port = 60;
+    stbd = 20;
+    geofence_limit_thrust(&res, 90, MARGIN_M, ESCAPE_DUTY, &port, &stbd);
+    CHECK_NEAR((port + stbd) / 2, 20, 1e-3);
+    CHECK_NEAR((port - stbd) / 2, 20, 1e-3);
+
+    /* Heading west, away from it: untouched */
+    port = 60;
+    stbd = 20;
+    geofence_limit_thrust(&res, 270, MARGIN_M, ESCAPE_DUTY, &port, &stbd);
+    CHECK_NEAR(port, 60, 1e-3);
+    CHECK_NEAR(stbd, 20, 1e-3);
+
+    /* No boundary within the margin */
+    res.polygon = -1;
+    port = 60;
+    stbd = 20;
+    geofence_limit_thrust(&res, 90, MARGIN_M, ESCAPE_DUTY, &port, &stbd);
+    CHECK_NEAR(port, 60, 1e-3);
+    CHECK_NEAR(stbd, 20, 1e-3);
+}
+
+/**
+ * @brief Once breached the boat comes round to the way out and drives out, even with the controller idle
+ *
+ */
+static void test_limit_breached(void)
+{
+    geofence_result_t res = { .breached = true, .clearance_m = -3, .danger_n = 0, .danger_e = 1, .polygon = 0 };
+    float port, stbd;
+
+    /* Heading east, further in: no forward thrust, full turn, either way round */
+    port = 50;
+    stbd = 50;
+    geofence_limit_thrust(&res, 90, MARGIN_M, ESCAPE_DUTY, &port, &stbd);
+    CHECK_NEAR(port + stbd, ESCAPE_DUTY, 1e-3);
+    CHECK(port == 0 || stbd == 0);
+
+    /* Heading north, the way out is west: turn to port, no forward thrust yet */
+    port = 0;
+    stbd = 0;
+    geofence_limit_thrust(&res, 0, MARGIN_M, ESCAPE_DUTY, &port, &stbd);
+    CHECK_NEAR(port, 0, 1e-3);
+    CHECK_NEAR(stbd, ESCAPE_DUTY, 1e-3);
+
+    /* Heading west, straight out: drives out at the escape duty */
+    port = 0;
+    stbd = 0;
+    geofence_limit_thrust(&res, 270, MARGIN_M, ESCAPE_DUTY, &port, &stbd);
+    CHECK_NEAR(port, ESCAPE_DUTY, 1e-3);
+    CHECK_NEAR(stbd, ESCAPE_DUTY, 1e-3);
+
+    /* The controller pushing out harder is kept */
+    port = 80;
+    stbd = 80;
+    geofence_limit_thrust(&res, 270, MARGIN_M, ESCAPE_DUTY, &port, &stbd);
+    CHECK_NEAR(port, 80, 1e-3);
+    CHECK_NEAR(stbd, 80, 1e-3);
+}
+
+/**
+ * @brief A boat in a no-go zone, bow pointing further in and the controller idle, leaves it
+ *
+ * Same boat as the station keeping benchmark in kinematic form: speed follows the mean duty, turn
+ * rate the duty difference.
+ */
+static void test_escape(void)
+{
+    const geo_point_t ref = { 515000000, -1000000 };
+    const float dt = 0.1f;
+    geofence_result_t res;
+    float north = 47, east = 5, heading = 10, speed = 0;
+    bool out = false;
+
+    geofence_def_clear(&def);
+    add_square(&ref, 50, 0, 10, GEOFENCE_KEEP_OUT);
+    geofence_build(&fence, &def);
+    for (int i = 0; i < 600 && !out; i++) {
+        float port = 0, stbd = 0;
+        check_at(&ref, north, east, &res);
+        out = !res.breached;
+        geofence_limit_thrust(&res, heading, MARGIN_M, ESCAPE_DUTY, &port, &stbd);
+        speed += (1.5f * (port + stbd) / 200.0f - speed) * dt / 3.0f;
+        heading = fmodf(heading + 40.0f * (port - stbd) / 100.0f * dt + 360.0f, 360.0f);
+        north += speed * cosf(heading * GEO_DEG_TO_RAD) * dt;
+        east += speed * sinf(heading * GEO_DEG_TO_RAD) * dt;
+    }
+    CHECK(out);
+}
+
+/**
+ * @brief Polygons survive a reboot, clearing them erases the stored copy
+ *
+ */
+static void test_store(void)
+{
+    const geo_point_t ref = { -338000000, 1512000000 };
+    geofence_def_t restored;
+
+    nvs_host_reset();
+    CHECK(geofence_def_restore(&restored) != ESP_OK);
+    CHECK(restored.polygon_count == 0);
+
+    geofence_def_clear(&def);
+    add_square(&ref, 0, 0, 100, GEOFENCE_KEEP_IN);
+    add_square(&ref, 20, 20, 5, GEOFENCE_KEEP_OUT);
+    CHECK(geofence_def_save(&def) == ESP_OK);
+    CHECK(geofence_def_restore(&restored) == ESP_OK);
+    CHECK(restored.polygon_count == 2);
+    CHECK(restored.vertex_total == 8);
+    CHECK(restored.kind[1] == GEOFENCE_KEEP_OUT);
+    CHECK(memcmp(restored.vertices, def.vertices, 8 * sizeof(geo_point_t)) == 0);
+
+    geofence_def_clear(&def);
+    CHECK(geofence_def_save(&def) == ESP_OK);
+    CHECK(geofence_def_restore(&restored) != ESP_OK);
+    CHECK(restored.polygon_count == 0);
+}
+
+/**
+ * @brief Polygons that don't fit are refused whole
+ *
+ */
+static void test_limits(void)
+{
+    static geo_point_t v[GEOFENCE_MAX_VERTICES];
+
+    geofence_def_clear(&def);
+    CHECK(geofence_def_add(&def, GEOFENCE_KEEP_IN, v, 2) == ESP_ERR_INVALID_ARG);
+    CHECK(geofence_def_add(&def, GEOFENCE_KEEP_IN, v, GEOFENCE_MAX_VERTICES - 2) == ESP_OK);
+    CHECK(geofence_def_add(&def, GEOFENCE_KEEP_OUT, v, 3) == ESP_ERR_NO_MEM);
+    CHECK(def.polygon_count == 1);
+    CHECK(def.vertex_total == GEOFENCE_MAX_VERTICES - 2);
+}
+
+int main(void)
+{
+    test_check();
+    test_precision();
+    test_limit_near();
+    test_limit_breached();
+    test_escape();
+    test_store();
+    test_limits();
+    return TEST_RESULT();
+}
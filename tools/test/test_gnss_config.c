@@ -0,0 +1,397 @@
+/* Tests of the receiver configuration against a fake receiver
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "nmea_gps.h"
+#include "ubx.h"
+#include "gnss_config.h"
+#include "test.h"
+
+#define FAKE_OUT_MAX (512)
+#define FAKE_READ_MAX (7)               /* Replies come in small pieces, so frames are split across reads */
+#define FAKE_EPOCH_US (1000000)
+#define FAKE_NO_CMD (-1)
+#define FAKE_CMD_MAX (1000)             /* PMTK numbers go up to 999 */
+
+#define CFG_PRT (0x00)
+#define CFG_MSG (0x01)
+#define CFG_RATE (0x08)
+
+/**
+ * @brief A receiver on the other end of the link
+ *
+ */
+typedef struct {
+    gnss_receiver_t type;
+    uint32_t baud;                  /*!< Rate the receiver talks at */
+    uint32_t link_baud;             /*!< Rate the link is set to */
+    bool present;                   /*!< Sends a sentence every epoch */
+    bool keep_baud;                 /*!< Ignores baud rate changes */
+    int nak_cmd;                    /*!< CFG id or PMTK number refused, FAKE_NO_CMD for none */
+    int silent_cmd;                 /*!< CFG id or PMTK number never answered */
+    int drop;                       /*!< Commands ignored before the receiver starts listening */
+    int64_t next_epoch_us;
+    uint8_t out[FAKE_OUT_MAX];      /*!< Bytes waiting to be read */
+    size_t out_len;
+    ubx_decoder_t ubx;              /*!< Commands from the host */
+    char line[96];
+    size_t line_len;
+    int cmd_count[FAKE_CMD_MAX];    /*!< Commands heard, by CFG id or PMTK number */
+    int set_baud_count;
+    uint16_t rate_ms;               /*!< Last measurement period set */
+    uint8_t msg_rate[2][256];       /*!< Last output rate set, NMEA ids and NAV ids */
+    char pmtk314[64];               /*!< Last sentence selection, MTK */
+} fake_rx_t;
+
+static fake_rx_t fake;
+
+static void fake_reset(gnss_receiver_t type, uint32_t baud)
+{
+    memset(&fake, 0, sizeof(fake));
+    fake.type = type;
+    fake.baud = baud;
+    fake.present = true;
+    fake.nak_cmd = FAKE_NO_CMD;
+    fake.silent_cmd = FAKE_NO_CMD;
+    fake.next_epoch_us = esp_timer_get_time() + FAKE_EPOCH_US / 3;
+    memset(fake.msg_rate, 0xff, sizeof(fake.msg_rate));
+}
+
+static void fake_send(const void *data, size_t len)
+{
+    if (fake.out_len + len <= FAKE_OUT_MAX) {
+        memcpy(fake.out + fake.out_len, data, len);
+        fake.out_len += len;
+    }
+}
+
+static void fake_send_nmea(const char *body)
+{
+    char buf[96];
+    uint8_t crc = 0;
+    for (const char *p = body; *p; p++) {
+        crc ^= (uint8_t)*p;
+    }
+    fake_send(buf, snprintf(buf, sizeof(buf), "$%s*%02X\r\n", body, crc));
+}
+
+static void fake_send_ack(uint8_t id, bool ack)
+{
+    const uint8_t msg[2] = { UBX_CLASS_CFG, id };
+    uint8_t frame[10];
+    fake_send(frame, ubx_build_frame(UBX_CLASS_ACK, ack ? UBX_ID_ACK_ACK : UBX_ID_ACK_NAK, msg, 2, frame));
+}
+
+/**
+ * @brief Count a command, return true if the receiver answers it
+ *
+ */
+static bool fake_heard(int cmd)
+{
+    fake.cmd_count[cmd]++;
+    if (fake.drop > 0) {
+        fake.drop--;
+        return false;
+    }
+    return cmd != fake.silent_cmd;
+}
+
+static void fake_ubx_command(void)
+{
+    const ubx_decoder_t *ubx = &fake.ubx;
+    if (fake.type != GNSS_RECEIVER_UBLOX || ubx->cls != UBX_CLASS_CFG || !fake_heard(ubx->id)) {
+        return;
+    }
+    switch (ubx->id) {
+    case CFG_PRT:
+        /* Switches at once, the acknowledgement at the old rate is lost */
+        if (!fake.keep_baud) {
+            fake.baud = ubx->payload[8] | ubx->payload[9] << 8 | ubx->payload[10] << 16 | (uint32_t)ubx->payload[11] << 24;
+        }
+        return;
+    case CFG_MSG:
+        fake.msg_rate[ubx->payload[0] == UBX_CLASS_NAV][ubx->payload[1]] = ubx->payload[2];
+        break;
+    case CFG_RATE:
+        fake.rate_ms = ubx->payload[0] | ubx->payload[1] << 8;
+        break;
+    default:
+        break;
+    }
+    fake_send_ack(ubx->id, ubx->id != fake.nak_cmd);
+}
+
+static void fake_mtk_command(void)
+{
+    char ack[24];
+    int cmd;
+    if (fake.type != GNSS_RECEIVER_MTK || sscanf(fake.line, "$PMTK%d", &cmd) != 1 || cmd < 0 || cmd >= FAKE_CMD_MAX ||
+            !fake_heard(cmd)) {
+        return;
+    }
+    if (cmd == 251) {
+        if (!fake.keep_baud) {
+            fake.baud = strtoul(fake.line + 9, NULL, 10);
+        }
+        return;
+    }
+    if (cmd == 220) {
+        fake.rate_ms = strtoul(fake.line + 9, NULL, 10);
+    } else if (cmd == 314) {
+        snprintf(fake.pmtk314, sizeof(fake.pmtk314), "%.*s", (int)strcspn(fake.line + 9, "*"), fake.line + 9);
+    }
+    snprintf(ack, sizeof(ack), "PMTK001,%d,%d", cmd, cmd == fake.nak_cmd ? 1 : 3);
+    fake_send_nmea(ack);
+}
+
+static esp_err_t link_set_baud(void *ctx, uint32_t baud)
+{
+    fake.link_baud = baud;
+    fake.set_baud_count++;
+    return ESP_OK;
+}
+
+static int link_write(void *ctx, const uint8_t *data, size_t len)
+{
+    esp_timer_host_advance(len * 10000000LL / fake.link_baud);
+    /* At the wrong rate the receiver only sees framing errors */
+    if (fake.link_baud != fake.baud) {
+        return len;
+    }
+    for (size_t i = 0; i < len; i++) {
+        ubx_result_t res = ubx_decode_byte(&fake.ubx, data[i]);
+        if (res == UBX_FRAME) {
+            fake_ubx_command();
+        }
+        if (res != UBX_NOT_FRAME) {
+            continue;
+        }
+        if (data[i] == '$') {
+            fake.line_len = 0;
+        }
+        if (data[i] == '\n') {
+            fake.line[fake.line_len] = '\0';
+            fake_mtk_command();
+            fake.line_len = 0;
+        } else if (fake.line_len < sizeof(fake.line) - 1) {
+            fake.line[fake.line_len++] = data[i];
+        }
+    }
+    return len;
+}
+
+static int link_read(void *ctx, uint8_t *buf, size_t len, uint32_t timeout_ms)
+{
+    const int64_t deadline_us = esp_timer_get_time() + timeout_ms * 1000LL;
+    if (fake.out_len == 0 && fake.present) {
+        if (fake.next_epoch_us > deadline_us) {
+            esp_timer_host_advance(deadline_us - esp_timer_get_time());
+            return 0;
+        }
+        if (fake.next_epoch_us > esp_timer_get_time()) {
+            esp_timer_host_advance(fake.next_epoch_us - esp_timer_get_time());
+        }
+        fake.next_epoch_us += FAKE_EPOCH_US;
+        fake_send_nmea("GPGGA,123456.00,5130.00000,N,00006.00000,W,1,09,1.0,12.3,M,47.0,M,,");
+    }
+    if (fake.out_len == 0) {
+        esp_timer_host_advance(timeout_ms * 1000LL);
+        return 0;
+    }
+    size_t n = fake.out_len < len ? fake.out_len : len;
+    n = n < FAKE_READ_MAX ? n : FAKE_READ_MAX;
+    if (fake.link_baud == fake.baud) {
+        memcpy(buf, fake.out, n);
+    } else {
+        memset(buf, 0xfe, n);
+    }
+    memmove(fake.out, fake.out + n, fake.out_len - n);
+    fake.out_len -= n;
+    esp_timer_host_advance(n * 10000000LL / fake.link_baud);
+    return n;
+}
+
+static const gnss_link_t link = { link_set_baud, link_write, link_read, NULL };
+
+static gnss_config_t make_config(gnss_receiver_t type)
+{
+    gnss_config_t config = {
+        .type = type,
+        .baud_rate = 115200,
+        .rate_hz = 5,
+        .statements = (1 << STATEMENT_GGA) | (1 << STATEMENT_RMC),
+        .ubx_pvt = false,
+    };
+    return config;
+}
+
+/**
+ * @brief A u-blox receiver at the default rate is moved up and every setting is acknowledged
+ *
+ */
+static void test_ublox(void)
+{
+    gnss_config_t config = make_config(GNSS_RECEIVER_UBLOX);
+    uint32_t baud = 9600;
+
+    fake_reset(GNSS_RECEIVER_UBLOX, 9600);
+    CHECK(gnss_config_run(&link, &config, &baud) == ESP_OK);
+    CHECK(baud == 115200);
+    CHECK(fake.baud == 115200 && fake.link_baud == 115200);
+    CHECK(fake.cmd_count[CFG_PRT] == 1);
+    CHECK(fake.rate_ms == 200);
+    CHECK(fake.msg_rate[0][0x00] == 1);     /* GGA */
+    CHECK(fake.msg_rate[0][0x04] == 1);     /* RMC */
+    CHECK(fake.msg_rate[0][0x03] == 0);     /* GSV */
+    CHECK(fake.msg_rate[0][0x02] == 0);     /* GSA */
+    CHECK(fake.msg_rate[1][UBX_ID_NAV_PVT] == 0);
+    /* Each setting went once */
+    CHECK(fake.cmd_count[CFG_RATE] == 1);
+    CHECK(fake.cmd_count[CFG_MSG] == 12);
+
+    /* NAV-PVT replaces every sentence */
+    config.ubx_pvt = true;
+    baud = 115200;
+    fake_reset(GNSS_RECEIVER_UBLOX, 115200);
+    CHECK(gnss_config_run(&link, &config, &baud) == ESP_OK);
+    CHECK(fake.cmd_count[CFG_PRT] == 0);
+    CHECK(fake.msg_rate[0][0x00] == 0);
+    CHECK(fake.msg_rate[0][0x04] == 0);
+    CHECK(fake.msg_rate[1][UBX_ID_NAV_PVT] == 1);
+}
+
+/**
+ * @brief The receiver is found wherever an earlier boot left it, and missing is reported
+ *
+ */
+static void test_detect(void)
+{
+    gnss_config_t config = make_config(GNSS_RECEIVER_UBLOX);
+    uint32_t baud;
+
+    /* Left at the target: found there, no baud change sent */
+    baud = 9600;
+    fake_reset(GNSS_RECEIVER_UBLOX, 115200);
+    CHECK(gnss_config_run(&link, &config, &baud) == ESP_OK);
+    CHECK(baud == 115200);
+    CHECK(fake.cmd_count[CFG_PRT] == 0);
+
+    /* At one of the usual rates */
+    baud = 9600;
+    fake_reset(GNSS_RECEIVER_UBLOX, 38400);
+    CHECK(gnss_config_run(&link, &config, &baud) == ESP_OK);
+    CHECK(baud == 115200);
+    CHECK(fake.baud == 115200);
+
+    /* Not there at all: every rate is tried once and the link is put back */
+    baud = 9600;
+    fake_reset(GNSS_RECEIVER_UBLOX, 9600);
+    fake.present = false;
+    int64_t start_us = esp_timer_get_time();
+    CHECK(gnss_config_run(&link, &config, &baud) == ESP_ERR_NOT_FOUND);
+    CHECK(baud == 9600);
+    CHECK(fake.link_baud == 9600);
+    CHECK(fake.set_baud_count == 7 + 1);
+    CHECK(esp_timer_get_time() - start_us >= 7 * 1500000LL);
+
+    /* Nothing to configure, nothing sent */
+    config.type = GNSS_RECEIVER_NONE;
+    fake_reset(GNSS_RECEIVER_UBLOX, 9600);
+    CHECK(gnss_config_run(&link, &config, &baud) == ESP_OK);
+    CHECK(fake.set_baud_count == 0);
+}
+
+/**
+ * @brief Refused and unanswered settings are reported, and the settings after them still go out
+ *
+ */
+static void test_nak_timeout(void)
+{
+    gnss_config_t config = make_config(GNSS_RECEIVER_UBLOX);
+    uint32_t baud;
+
+    /* Sentence selection refused: not repeated, the rate is still set */
+    baud = 115200;
+    fake_reset(GNSS_RECEIVER_UBLOX, 115200);
+    fake.nak_cmd = CFG_MSG;
+    CHECK(gnss_config_run(&link, &config, &baud) == ESP_ERR_NOT_SUPPORTED);
+    CHECK(fake.cmd_count[CFG_MSG] == 12);
+    CHECK(fake.rate_ms == 200);
+
+    /* Rate never answered: three tries, half a second each */
+    baud = 115200;
+    fake_reset(GNSS_RECEIVER_UBLOX, 115200);
+    fake.silent_cmd = CFG_RATE;
+    CHECK(gnss_config_run(&link, &config, &baud) == ESP_ERR_TIMEOUT);
+    CHECK(fake.cmd_count[CFG_RATE] == 3);
+
+    /* A command lost once is repeated and goes through */
+    baud = 115200;
+    fake_reset(GNSS_RECEIVER_UBLOX, 115200);
+    fake.drop = 1;
+    CHECK(gnss_config_run(&link, &config, &baud) == ESP_OK);
+    CHECK(fake.cmd_count[CFG_MSG] == 13);
+}
+
+/**
+ * @brief A receiver that stays at its rate is not lost: the link follows it back
+ *
+ */
+static void test_baud_refused(void)
+{
+    gnss_config_t config = make_config(GNSS_RECEIVER_UBLOX);
+    uint32_t baud = 9600;
+
+    fake_reset(GNSS_RECEIVER_UBLOX, 9600);
+    fake.keep_baud = true;
+    CHECK(gnss_config_run(&link, &config, &baud) == ESP_ERR_TIMEOUT);
+    CHECK(baud == 9600);
+    CHECK(fake.link_baud == 9600);
+    CHECK(fake.cmd_count[CFG_PRT] == 3);
+    /* Configured at the old rate */
+    CHECK(fake.rate_ms == 200);
+    CHECK(fake.msg_rate[0][0x00] == 1);
+}
+
+/**
+ * @brief The MediaTek command set
+ *
+ */
+static void test_mtk(void)
+{
+    gnss_config_t config = make_config(GNSS_RECEIVER_MTK);
+    uint32_t baud = 9600;
+
+    fake_reset(GNSS_RECEIVER_MTK, 9600);
+    CHECK(gnss_config_run(&link, &config, &baud) == ESP_OK);
+    CHECK(baud == 115200 && fake.baud == 115200);
+    CHECK(fake.cmd_count[251] == 1);
+    CHECK(fake.rate_ms == 200);
+    /* GLL, RMC, VTG, GGA, GSA, GSV */
+    CHECK(strcmp(fake.pmtk314, "0,1,0,1,0,0,0,0,0,0,0,0,0,0,0,0,0,0,0") == 0);
+
+    /* Unsupported */
+    baud = 115200;
+    fake_reset(GNSS_RECEIVER_MTK, 115200);
+    fake.nak_cmd = 220;
+    CHECK(gnss_config_run(&link, &config, &baud) == ESP_ERR_NOT_SUPPORTED);
+    CHECK(fake.cmd_count[220] == 1);
+}
+
+int main(void)
+{
+    test_ublox();
+    test_detect();
+    test_nak_timeout();
+    test_baud_refused();
+    test_mtk();
+    return TEST_RESULT();
+}
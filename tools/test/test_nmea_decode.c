@@ -0,0 +1,196 @@
+/* Replay tests of the statement decoder
+
+   An epoch from a receiver with every statement turned on is decoded the way the parser task does it,
+   and each field that lands in the published gps_t is checked.
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include "nmea_decode.h"
+#include "test.h"
+
+#define BIT(statement) (1u << (statement))
+#define REQUIRED_DEFAULT (BIT(STATEMENT_GGA) | BIT(STATEMENT_GSA) | BIT(STATEMENT_RMC) | \
+                          BIT(STATEMENT_GSV) | BIT(STATEMENT_GLL) | BIT(STATEMENT_VTG))
+#define REQUIRED_ALL (REQUIRED_DEFAULT | BIT(STATEMENT_GST) | BIT(STATEMENT_ZDA) | BIT(STATEMENT_GNS) | \
+                      BIT(STATEMENT_GBS) | BIT(STATEMENT_HDT) | BIT(STATEMENT_HDG) | BIT(STATEMENT_DTM))
+
+/* Checksums are filled in by decode() */
+static const char *const epoch[] = {
+    "GNGGA,123456.70,5130.12345,N,00006.54321,W,2,14,0.8,12.3,M,47.0,M,,",
+    "GNGSA,A,3,02,05,07,09,13,15,18,20,23,26,30,31,1.4,0.8,1.1",
+    "GNRMC,123456.70,A,5130.12345,N,00006.54321,W,2.0,271.5,010524,1.2,W,D",
+    "GPGSV,2,1,06,02,45,123,41,05,30,045,38,07,62,300,44,09,12,210,30",
+    "GPGSV,2,2,06,13,55,090,42,15,20,150,35",
+    "GNGLL,5130.12345,N,00006.54321,W,123456.70,A,D",
+    "GNVTG,271.5,T,272.7,M,2.0,N,3.7,K,D",
+    "GNGST,123456.70,1.5,2.1,1.1,35.0,1.3,1.8,2.9",
+    "GNZDA,123456.70,01,05,2024,00,00",
+    "GNGNS,123456.70,5130.12345,N,00006.54321,W,DAN,14,0.8,12.3,47.0,,",
+    "GNGBS,123456.70,1.4,1.9,3.2,18,0.012,-21.5,3.4",
+    "HEHDT,274.2,T",
+    "HCHDG,358.0,3.5,E,1.2,W",
+    "GPDTM,W84,,0.0,N,0.0,E,0.0,W84",
+};
+
+#define EPOCH_LINES (sizeof(epoch) / sizeof(epoch[0]))
+
+static nmea_decoder_t dec;
+
+static nmea_decode_result_t decode(const char *body, uint32_t required)
+{
+    char line[128];
+    uint8_t crc = 0;
+    for (const char *p = body; *p; p++) {
+        crc ^= (uint8_t)*p;
+    }
+    snprintf(line, sizeof(line), "$%s*%02X\r\n", body, crc);
+    return nmea_decode_line(&dec, line, required);
+}
+
+/**
+ * @brief Every statement of the epoch decodes, one update at the end
+ *
+ */
+static void test_epoch(void)
+{
+    int updates = 0;
+
+    nmea_decoder_init(&dec);
+    for (size_t i = 0; i < EPOCH_LINES; i++) {
+        nmea_decode_result_t res = decode(epoch[i], REQUIRED_ALL);
+        CHECK(res != NMEA_DECODE_CRC_ERROR);
+        CHECK(dec.statement != STATEMENT_UNKNOWN);
+        updates += res == NMEA_DECODE_UPDATE;
+        CHECK(updates == (i + 1 == EPOCH_LINES));
+    }
+    const gps_t *gps = &dec.gps;
+    CHECK(gps->statements == REQUIRED_ALL);
+
+    /* The original six */
+    CHECK(gps->latitude_e7 == 515020575);
+    CHECK(gps->longitude_e7 == -1090535);
+    CHECK(gps->tim.hour == 12 && gps->tim.minute == 34 && gps->tim.second == 56 && gps->tim.thousand == 700);
+    CHECK(gps->sats_in_view == 6);
+    CHECK(gps->sats_desc_in_view[5].num == 15 && gps->sats_desc_in_view[5].snr == 35);
+    CHECK_NEAR(gps->dop_p, 1.4, 1e-6);
+
+    /* GST */
+    CHECK_NEAR(gps->error.rms, 1.5, 1e-6);
+    CHECK_NEAR(gps->error.major, 2.1, 1e-6);
+    CHECK_NEAR(gps->error.minor, 1.1, 1e-6);
+    CHECK_NEAR(gps->error.orientation, 35.0, 1e-6);
+    CHECK_NEAR(gps->error.lat, 1.3, 1e-6);
+    CHECK_NEAR(gps->error.lon, 1.8, 1e-6);
+    CHECK_NEAR(gps->error.alt, 2.9, 1e-6);
+
+    /* ZDA: four digit year, stored from 2000 like RMC's */
+    CHECK(gps->date.year == 24 && gps->date.month == 5 && gps->date.day == 1);
+
+    /* GNS: differential on GPS, so a DGPS fix, altitude above the ellipsoid as from GGA */
+    CHECK(strcmp(gps->mode, "DAN") == 0);
+    CHECK(gps->fix == GPS_FIX_DGPS);
+    CHECK(gps->sats_in_use == 14);
+    CHECK_NEAR(gps->dop_h, 0.8, 1e-6);
+    CHECK_NEAR(gps->altitude, 59.3, 1e-4);
+
+    /* GBS */
+    CHECK_NEAR(gps->fault.lat, 1.4, 1e-6);
+    CHECK_NEAR(gps->fault.lon, 1.9, 1e-6);
+    CHECK_NEAR(gps->fault.alt, 3.2, 1e-6);
+    CHECK(gps->fault.sat == 18);
+    CHECK_NEAR(gps->fault.probability, 0.012, 1e-6);
+    CHECK_NEAR(gps->fault.bias, -21.5, 1e-6);
+    CHECK_NEAR(gps->fault.bias_sd, 3.4, 1e-6);
+
+    /* HDT and HDG: deviation east is added and wraps through north, variation west is negative */
+    CHECK_NEAR(gps->heading, 274.2, 1e-4);
+    CHECK_NEAR(gps->heading_magnetic, 1.5, 1e-4);
+    CHECK_NEAR(gps->variation, -1.2, 1e-6);
+
+    /* DTM */
+    CHECK(strcmp(gps->datum, "W84") == 0);
+    CHECK(gps->datum_offset.lat == 0 && gps->datum_offset.lon == 0 && gps->datum_offset.alt == 0);
+    CHECK(strcmp(gps->datum_ref, "W84") == 0);
+}
+
+/**
+ * @brief With the default required set the new statements ride along with the next update
+ *
+ */
+static void test_default_required(void)
+{
+    int updates = 0;
+
+    nmea_decoder_init(&dec);
+    for (int e = 0; e < 3; e++) {
+        for (size_t i = 0; i < EPOCH_LINES; i++) {
+            if (decode(epoch[i], REQUIRED_DEFAULT) == NMEA_DECODE_UPDATE) {
+                updates++;
+                /* The first update has only the six, later ones carry the last epoch's others too */
+                CHECK(dec.gps.statements == (e == 0 ? REQUIRED_DEFAULT : REQUIRED_ALL));
+            }
+        }
+    }
+    CHECK(updates == 3);
+}
+
+/**
+ * @brief Other forms the new statements take
+ *
+ */
+static void test_variants(void)
+{
+    nmea_decoder_init(&dec);
+
+    /* GNS without a fix on any constellation, and with one */
+    CHECK(decode("GNGNS,010203.00,,,,,NNN,00,,,,,", REQUIRED_ALL) == NMEA_DECODE_OK);
+    CHECK(dec.gps.fix == GPS_FIX_INVALID);
+    CHECK(strcmp(dec.gps.mode, "NNN") == 0);
+    CHECK(decode("GNGNS,010203.00,5130.00000,S,00006.00000,E,NAA,08,1.1,5.0,40.0,,", REQUIRED_ALL) == NMEA_DECODE_OK);
+    CHECK(dec.gps.fix == GPS_FIX_GPS);
+    CHECK(dec.gps.latitude_e7 == -515000000);
+    /* A mode longer than six constellations is cut to fit */
+    CHECK(decode("GNGNS,010203.00,,,,,AAAAAAAA,08,1.1,5.0,40.0,,", REQUIRED_ALL) == NMEA_DECODE_OK);
+    CHECK(strcmp(dec.gps.mode, "AAAAAA") == 0);
+
+    /* HDG without deviation or variation, and deviation west through north */
+    CHECK(decode("HCHDG,123.4,,,,", REQUIRED_ALL) == NMEA_DECODE_OK);
+    CHECK_NEAR(dec.gps.heading_magnetic, 123.4, 1e-4);
+    CHECK(decode("HCHDG,1.0,2.5,W,3.0,E", REQUIRED_ALL) == NMEA_DECODE_OK);
+    CHECK_NEAR(dec.gps.heading_magnetic, 358.5, 1e-4);
+    CHECK_NEAR(dec.gps.variation, 3.0, 1e-6);
+
+    /* A local datum */
+    CHECK(decode("GPDTM,999,,0.1,N,0.2,W,0.0,W84", REQUIRED_ALL) == NMEA_DECODE_OK);
+    CHECK(strcmp(dec.gps.datum, "999") == 0);
+    CHECK_NEAR(dec.gps.datum_offset.lat, 0.1, 1e-6);
+    CHECK_NEAR(dec.gps.datum_offset.lon, -0.2, 1e-6);
+    CHECK(decode("GPDTM,999,,0.0321,S,1.5,E,-12.5,W84", REQUIRED_ALL) == NMEA_DECODE_OK);
+    CHECK_NEAR(dec.gps.datum_offset.lat, -0.0321, 1e-6);
+    CHECK_NEAR(dec.gps.datum_offset.lon, 1.5, 1e-6);
+    CHECK_NEAR(dec.gps.datum_offset.alt, -12.5, 1e-6);
+    CHECK(strcmp(dec.gps.datum_ref, "W84") == 0);
+
+    /* ZDA in the next century */
+    CHECK(decode("GPZDA,000000.00,01,03,2100,00,00", REQUIRED_ALL) == NMEA_DECODE_OK);
+    CHECK(dec.gps.date.year == 100 && dec.gps.date.month == 3);
+
+    /* A broken checksum is reported for the new statements as for the old */
+    CHECK(nmea_decode_line(&dec, "$HEHDT,274.2,T*00\r\n", REQUIRED_ALL) == NMEA_DECODE_CRC_ERROR);
+    CHECK(nmea_decode_line(&dec, "$GNGST,123456.70,1.5,2.1,1.1,35.0,1.3,1.8,2.9\r\n", REQUIRED_ALL) ==
+          NMEA_DECODE_CRC_ERROR);
+}
+
+int main(void)
+{
+    test_epoch();
+    test_default_required();
+    test_variants();
+    return TEST_RESULT();
+}
@@ -0,0 +1,175 @@
+/* Tests of the NMEA 0183 output encoder
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdlib.h>
+#include <string.h>
+#include "nmea_encoder.h"
+#include "nmea_decode.h"
+#include "test.h"
+
+/* A sentence with its checksum and line end, as the encoder should write it */
+static const char *sentence(const char *body)
+{
+    static char line[NMEA_MAX_SENTENCE_LEN + 16];
+    uint8_t crc = 0;
+    for (const char *p = body; *p; p++) {
+        crc ^= (uint8_t)*p;
+    }
+    snprintf(line, sizeof(line), "$%s*%02X\r\n", body, crc);
+    return line;
+}
+
+/* Every sentence in buf fits the NMEA 0183 length and carries the right checksum, returns how many */
+static int check_sentences(const char *buf)
+{
+    int count = 0;
+    while (*buf) {
+        size_t len = strcspn(buf, "\n") + 1;
+        char body[NMEA_MAX_SENTENCE_LEN];
+        CHECK(buf[0] == '$' && len <= NMEA_MAX_SENTENCE_LEN && len > 6);
+        if (len > NMEA_MAX_SENTENCE_LEN || len <= 6) {
+            return -1;
+        }
+        memcpy(body, buf + 1, len - 6);
+        body[len - 6] = '\0';
+        CHECK(strncmp(buf, sentence(body), len) == 0);
+        buf += len;
+        count++;
+    }
+    return count;
+}
+
+static const nmea_steer_t steer = {
+    .valid = true,
+    .cross_track_m = 185.2f,
+    .track_deg = 45.0f,
+    .bearing_deg = 50.0f,
+    .steer_deg = 48.5f,
+    .range_m = 4630.0f,
+    .closing_mps = 5 * NMEA_KNOTS,
+    .dest = { -338567844, 1512152967 },
+    .origin_id = "ORG",
+    .dest_id = "DST",
+};
+
+/**
+ * @brief APB, XTE and RMB for a known steer, and flagged void when it isn't valid
+ *
+ */
+static void test_steer(void)
+{
+    char buf[NMEA_MAX_SENTENCE_LEN + 1];
+
+    /* Right of track, so steer left */
+    CHECK(nmea_encode_xte("GP", &steer, buf, sizeof(buf)) > 0);
+    CHECK(strcmp(buf, sentence("GPXTE,A,A,0.100,L,N,A")) == 0);
+    CHECK(nmea_encode_apb("GP", &steer, buf, sizeof(buf)) > 0);
+    CHECK(strcmp(buf, sentence("GPAPB,A,A,0.100,L,N,V,V,45.0,T,DST,50.0,T,48.5,T,A")) == 0);
+    CHECK(nmea_encode_rmb("GP", &steer, buf, sizeof(buf)) > 0);
+    CHECK(strcmp(buf, sentence("GPRMB,A,0.100,L,ORG,DST,3351.4071,S,15112.9178,E,2.500,50.0,5.00,V,A")) == 0);
+
+    nmea_steer_t off = steer;
+    off.valid = false;
+    off.cross_track_m = -92.6f;
+    off.arrived = true;
+    CHECK(nmea_encode_xte("GP", &off, buf, sizeof(buf)) > 0);
+    CHECK(strcmp(buf, sentence("GPXTE,V,V,0.050,R,N,N")) == 0);
+    CHECK(nmea_encode_rmb("GP", &off, buf, sizeof(buf)) > 0);
+    CHECK(strcmp(buf, sentence("GPRMB,V,0.050,R,ORG,DST,3351.4071,S,15112.9178,E,2.500,50.0,5.00,A,N")) == 0);
+}
+
+/**
+ * @brief HDG and RMC from a GPS object, and RMC read back by the decoder
+ *
+ */
+static void test_gps(void)
+{
+    static nmea_decoder_t dec;
+    char buf[NMEA_MAX_SENTENCE_LEN + 1];
+    gps_t gps = { 0 };
+
+    gps.heading_magnetic = 123.4f;
+    CHECK(nmea_encode(STATEMENT_HDG, "HC", &gps, buf, sizeof(buf)) > 0);
+    CHECK(strcmp(buf, sentence("HCHDG,123.4,,,0.0,E")) == 0);
+
+    gps.tim = (gps_time_t) { 12, 34, 56, 700 };
+    gps.date = (gps_date_t) { 1, 5, 24 };
+    gps.valid = true;
+    gps.latitude_e7 = 515020575;
+    gps.longitude_e7 = -1090535;
+    gps.speed = 2 * NMEA_KNOTS;
+    gps.cog = 271.5f;
+    gps.variation = -1.2f;
+    int len = nmea_encode(STATEMENT_RMC, "GP", &gps, buf, sizeof(buf));
+    CHECK(strcmp(buf, sentence("GPRMC,123456.700,A,5130.1235,N,00006.5432,W,2.00,271.5,010524,1.2,W,")) == 0);
+    CHECK(len == (int)strlen(buf));
+
+    nmea_decoder_init(&dec);
+    CHECK(nmea_decode_line(&dec, buf, 1 << STATEMENT_RMC) == NMEA_DECODE_UPDATE);
+    CHECK(abs(dec.gps.latitude_e7 - gps.latitude_e7) <= 9);
+    CHECK(abs(dec.gps.longitude_e7 - gps.longitude_e7) <= 9);
+    CHECK_NEAR(dec.gps.speed, gps.speed, 1e-4);
+    CHECK_NEAR(dec.gps.variation, gps.variation, 1e-4);
+    CHECK(dec.gps.date.year == 24 && dec.gps.tim.thousand == 700);
+}
+
+/**
+ * @brief GSV is split four satellites a sentence, each sentence checksummed on its own
+ *
+ */
+static void test_gsv(void)
+{
+    char buf[4 * NMEA_MAX_SENTENCE_LEN + 1];
+    gps_t gps = { 0 };
+
+    CHECK(nmea_encode(STATEMENT_GSV, "GP", &gps, buf, sizeof(buf)) > 0);
+    CHECK(check_sentences(buf) == 1);
+    gps.sats_in_view = 9;
+    for (int i = 0; i < gps.sats_in_view; i++) {
+        gps.sats_desc_in_view[i] = (gps_satellite_t) { i + 1, 45, 300, 40 };
+    }
+    CHECK(nmea_encode(STATEMENT_GSV, "GP", &gps, buf, sizeof(buf)) > 0);
+    CHECK(check_sentences(buf) == 3);
+    CHECK(strncmp(buf, "$GPGSV,3,1,09,01,45,300,40,", 27) == 0);
+}
+
+/**
+ * @brief Bad arguments and sentences that don't fit leave an empty buffer
+ *
+ */
+static void test_refused(void)
+{
+    char buf[NMEA_MAX_SENTENCE_LEN + 1];
+    gps_t gps = { 0 };
+
+    CHECK(nmea_encode(STATEMENT_UNKNOWN, "GP", &gps, buf, sizeof(buf)) == -1);
+    CHECK(nmea_encode(STATEMENT_RMC, "G", &gps, buf, sizeof(buf)) == -1);
+    CHECK(nmea_encode_xte("GPS", &steer, buf, sizeof(buf)) == -1);
+    CHECK(nmea_encode(STATEMENT_RMC, "GP", &gps, buf, 0) == -1);
+
+    strcpy(buf, "x");
+    CHECK(nmea_encode(STATEMENT_RMC, "GP", &gps, buf, 20) == -1);
+    CHECK(buf[0] == '\0');
+    strcpy(buf, "x");
+    CHECK(nmea_encode_apb("GP", &steer, buf, 30) == -1);
+    CHECK(buf[0] == '\0');
+    /* Exactly the sentence and its terminator */
+    int len = nmea_encode_xte("GP", &steer, buf, sizeof(buf));
+    CHECK(nmea_encode_xte("GP", &steer, buf, len + 1) == len);
+    CHECK(nmea_encode_xte("GP", &steer, buf, len) == -1);
+}
+
+int main(void)
+{
+    test_steer();
+    test_gps();
+    test_gsv();
+    test_refused();
+    return TEST_RESULT();
+}
@@ -0,0 +1,135 @@
+/* Tests of the number formatting
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdlib.h>
+#include <float.h>
+#include "numfmt.h"
+#include "test.h"
+
+static int check_fixed(float value, uint8_t decimals, const char *expect)
+{
+    char buf[NUMFMT_MAX_LEN + 1];
+    int n = numfmt_fixed(buf, value, decimals);
+    CHECK(n <= NUMFMT_MAX_LEN);
+    buf[n] = '\0';
+    if (strcmp(buf, expect) != 0) {
+        printf("numfmt_fixed(%.9g, %u) = \"%s\", expected \"%s\"\n", value, decimals, buf, expect);
+        test_failures++;
+    }
+    return n;
+}
+
+/**
+ * @brief Rounding, carries and signs
+ *
+ */
+static void test_fixed(void)
+{
+    check_fixed(0, 2, "0.00");
+    check_fixed(1.5f, 0, "2");
+    check_fixed(-1.25f, 1, "-1.3");
+    check_fixed(9.996f, 2, "10.00");
+    check_fixed(-0.001f, 2, "0.00");
+    check_fixed(359.95f, 1, "360.0");
+    check_fixed(51.5f, 6, "51.500000");
+    check_fixed(123456.75f, 2, "123456.75");
+    check_fixed(0.5f, 12, "0.500000000");
+}
+
+/**
+ * @brief NaN, infinities and values beyond the integer part don't reach the integer conversion
+ *
+ */
+static void test_fixed_range(void)
+{
+    check_fixed(NAN, 2, "nan");
+    check_fixed(-NAN, 0, "nan");
+    check_fixed(INFINITY, 1, "4294967295.0");
+    check_fixed(-INFINITY, 1, "-4294967295.0");
+    check_fixed(4294967296.0f, 0, "4294967295");
+    check_fixed(-1e30f, 3, "-4294967295.000");
+    check_fixed(FLT_MAX, 9, "4294967295.000000000");
+    /* Largest float below 2^32, a whole number */
+    check_fixed(4294967040.0f, 9, "4294967040.000000000");
+    CHECK(check_fixed(-FLT_MAX, 9, "-4294967295.000000000") == NUMFMT_MAX_LEN);
+}
+
+/**
+ * @brief Fixed point and integer output against printf
+ *
+ */
+static void test_scaled(void)
+{
+    const int32_t values[] = { 0, 1, -1, 9, 10, 515000000, -1799999999, INT32_MAX, INT32_MIN };
+    char buf[NUMFMT_MAX_LEN + 1], expect[32];
+
+    for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+        int32_t v = values[i];
+        buf[numfmt_int(buf, v)] = '\0';
+        snprintf(expect, sizeof(expect), "%ld", (long)v);
+        CHECK(strcmp(buf, expect) == 0);
+        buf[numfmt_scaled(buf, v, 7)] = '\0';
+        snprintf(expect, sizeof(expect), "%s%lld.%07lld", v < 0 ? "-" : "", llabs((long long)v) / 10000000,
+                 llabs((long long)v) % 10000000);
+        CHECK(strcmp(buf, expect) == 0);
+    }
+}
+
+/**
+ * @brief UTC times either side of leap days and centuries
+ *
+ */
+static void test_utc(void)
+{
+    char buf[NUMFMT_UTC_MAX_LEN + 1];
+
+    buf[numfmt_utc(buf, 0)] = '\0';
+    CHECK(strcmp(buf, "1970-01-01T00:00:00.000Z") == 0);
+    buf[numfmt_utc(buf, 951782400000LL + 86399999)] = '\0';
+    CHECK(strcmp(buf, "2000-02-29T23:59:59.999Z") == 0);
+    buf[numfmt_utc(buf, 1714564800123LL)] = '\0';
+    CHECK(strcmp(buf, "2024-05-01T12:00:00.123Z") == 0);
+    buf[numfmt_utc(buf, 4107542400000LL)] = '\0';
+    CHECK(strcmp(buf, "2100-03-01T00:00:00.000Z") == 0);
+}
+
+/**
+ * @brief Days from a civil date agree with the dates numfmt_utc writes
+ *
+ */
+static void test_days_from_civil(void)
+{
+    char buf[NUMFMT_UTC_MAX_LEN + 1];
+
+    CHECK(numfmt_days_from_civil(1970, 1, 1) == 0);
+    CHECK(numfmt_days_from_civil(1969, 12, 31) == -1);
+    CHECK(numfmt_days_from_civil(2000, 2, 29) == 11016);
+    CHECK(numfmt_days_from_civil(2100, 3, 1) == 47541);
+    /* Every day from 1970 to 2199 round trips through numfmt_utc */
+    for (int32_t days = 0; days < 84000; days++) {
+        int y, m, d;
+        buf[numfmt_utc(buf, (int64_t)days * 86400000)] = '\0';
+        if (sscanf(buf, "%4d-%2d-%2d", &y, &m, &d) != 3 || numfmt_days_from_civil(y, m, d) != days) {
+            CHECK(!"day round trips");
+            break;
+        }
+    }
+}
+
+int main(void)
+{
+    test_fixed();
+    test_fixed_range();
+    test_scaled();
+    test_utc();
+    test_days_from_civil();
+    return TEST_RESULT();
+}
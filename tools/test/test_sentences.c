@@ -0,0 +1,194 @@
+/* Tests of the sentence registration table
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include "nmea_sentence.h"
+#include "test.h"
+
+/**
+ * @brief What the last callback was given
+ *
+ */
+typedef struct {
+    int calls;
+    char address[NMEA_SENTENCE_KEY_LENGTH + 1];
+    size_t num_fields;
+    nmea_field_t fields[CONFIG_NMEA_PARSER_MAX_FIELDS];
+    size_t text_field;              /*!< String field to copy, it only lives during the callback */
+    char text[64];
+} seen_t;
+
+static void on_sentence(const char *address, const nmea_field_t *fields, size_t num_fields, void *ctx)
+{
+    seen_t *seen = ctx;
+    seen->calls++;
+    snprintf(seen->address, sizeof(seen->address), "%s", address);
+    seen->num_fields = num_fields;
+    memcpy(seen->fields, fields, num_fields * sizeof(nmea_field_t));
+    seen->text[0] = '\0';
+    if (seen->text_field < num_fields && fields[seen->text_field].present) {
+        snprintf(seen->text, sizeof(seen->text), "%s", fields[seen->text_field].value.s);
+    }
+}
+
+/**
+ * @brief Checksum a sentence and hand it on the way the parser does
+ *
+ * @return int index of the sentence it matched, -1 if none or the checksum failed
+ */
+static int feed(nmea_sentence_table_t *table, const char *body)
+{
+    static nmea_decoder_t dec;
+    char line[160];
+    uint8_t crc = 0;
+
+    for (const char *p = body; *p; p++) {
+        crc ^= (uint8_t)*p;
+    }
+    snprintf(line, sizeof(line), "$%s*%02X\r\n", body, crc);
+    nmea_decoder_init(&dec);
+    if (nmea_decode_line(&dec, line, 1 << STATEMENT_GGA) == NMEA_DECODE_CRC_ERROR ||
+            dec.statement != STATEMENT_UNKNOWN) {
+        return -1;
+    }
+    /* The parser lets a sentence past the header when a key matches its first characters */
+    if (nmea_sentence_find(table, line + 1, NMEA_HEADER_LEN - 1, true) < 0) {
+        return -1;
+    }
+    int index = nmea_sentence_find(table, line + 1, strcspn(line + 1, ",*\r\n"), false);
+    if (index >= 0) {
+        nmea_sentence_dispatch(table, index, line);
+    }
+    return index;
+}
+
+/**
+ * @brief Keys, schemas and callbacks that are refused, and a full table
+ *
+ */
+static void test_add(void)
+{
+    static nmea_sentence_table_t table;
+    static const nmea_field_type_t schema[] = { NMEA_FIELD_INT };
+    seen_t seen = { 0 };
+
+    memset(&table, 0, sizeof(table));
+    CHECK(nmea_sentence_add(&table, "", schema, 1, on_sentence, &seen) == ESP_ERR_INVALID_ARG);
+    CHECK(nmea_sentence_add(&table, "ABCDEFGHIJKLMNO", schema, 1, on_sentence, &seen) == ESP_ERR_INVALID_ARG);
+    CHECK(nmea_sentence_add(&table, "PMTK001", schema, CONFIG_NMEA_PARSER_MAX_FIELDS + 1, on_sentence, &seen) ==
+          ESP_ERR_INVALID_ARG);
+    CHECK(nmea_sentence_add(&table, "PMTK001", schema, 1, NULL, &seen) == ESP_ERR_INVALID_ARG);
+    CHECK(atomic_load(&table.num_sentences) == 0);
+
+    CHECK(nmea_sentence_add(&table, "ABCDEFGHIJKLMN", schema, 1, on_sentence, &seen) == ESP_OK);
+    for (int i = 1; i < CONFIG_NMEA_PARSER_MAX_SENTENCES; i++) {
+        CHECK(nmea_sentence_add(&table, "PMTK001", schema, 1, on_sentence, &seen) == ESP_OK);
+    }
+    CHECK(nmea_sentence_add(&table, "PMTK001", schema, 1, on_sentence, &seen) == ESP_ERR_NO_MEM);
+    CHECK(atomic_load(&table.num_sentences) == CONFIG_NMEA_PARSER_MAX_SENTENCES);
+}
+
+/**
+ * @brief Exact keys, wildcards, the early match on the header and registration order
+ *
+ */
+static void test_find(void)
+{
+    static nmea_sentence_table_t table;
+    static const nmea_field_type_t schema[] = { NMEA_FIELD_STRING };
+    seen_t seen = { 0 };
+
+    memset(&table, 0, sizeof(table));
+    CHECK(nmea_sentence_add(&table, "--TXT", schema, 1, on_sentence, &seen) == ESP_OK);
+    CHECK(nmea_sentence_add(&table, "PMTK001", schema, 1, on_sentence, &seen) == ESP_OK);
+    CHECK(nmea_sentence_add(&table, "PUBX", schema, 1, on_sentence, &seen) == ESP_OK);
+    CHECK(nmea_sentence_add(&table, "GPTXT", schema, 1, on_sentence, &seen) == ESP_OK);
+
+    CHECK(nmea_sentence_find(&table, "GPTXT", 5, false) == 0);
+    CHECK(nmea_sentence_find(&table, "GNTXT", 5, false) == 0);
+    CHECK(nmea_sentence_find(&table, "GPTXTX", 6, false) == -1);
+    CHECK(nmea_sentence_find(&table, "GPTX", 4, false) == -1);
+    CHECK(nmea_sentence_find(&table, "PMTK001", 7, false) == 1);
+    CHECK(nmea_sentence_find(&table, "PMTK010", 7, false) == -1);
+    CHECK(nmea_sentence_find(&table, "PUBX", 4, false) == 2);
+
+    /* Only the first five address characters are known at the header */
+    CHECK(nmea_sentence_find(&table, "PMTK0", 5, true) == 1);
+    CHECK(nmea_sentence_find(&table, "PUBX,", 5, true) == 2);
+    CHECK(nmea_sentence_find(&table, "PSTMV", 5, true) == -1);
+    CHECK(nmea_sentence_find(&table, "PMTK0", 5, false) == -1);
+}
+
+/**
+ * @brief Fields are converted to their schema types, missing and empty ones are not present
+ *
+ */
+static void test_dispatch(void)
+{
+    static nmea_sentence_table_t table;
+    static const nmea_field_type_t pubx[] = {
+        NMEA_FIELD_INT, NMEA_FIELD_STRING, NMEA_FIELD_FLOAT, NMEA_FIELD_CHAR, NMEA_FIELD_SKIP,
+        NMEA_FIELD_CHAR, NMEA_FIELD_FLOAT, NMEA_FIELD_STRING, NMEA_FIELD_HEX, NMEA_FIELD_INT,
+    };
+    static const nmea_field_type_t txt[] = { NMEA_FIELD_INT, NMEA_FIELD_INT, NMEA_FIELD_INT, NMEA_FIELD_STRING };
+    seen_t pubx_seen = { .text_field = 1 }, txt_seen = { .text_field = 3 };
+
+    memset(&table, 0, sizeof(table));
+    CHECK(nmea_sentence_add(&table, "PUBX", pubx, 10, on_sentence, &pubx_seen) == ESP_OK);
+    CHECK(nmea_sentence_add(&table, "--TXT", txt, 4, on_sentence, &txt_seen) == ESP_OK);
+
+    CHECK(feed(&table, "PUBX,00,123456.00,5130.12345,N,00006.5,W,-12.5,G3,1F") == 0);
+    CHECK(pubx_seen.calls == 1);
+    CHECK(strcmp(pubx_seen.address, "PUBX") == 0);
+    CHECK(pubx_seen.num_fields == 10);
+    CHECK(pubx_seen.fields[0].present && pubx_seen.fields[0].value.i == 0);
+    CHECK(strcmp(pubx_seen.text, "123456.00") == 0);
+    CHECK_NEAR(pubx_seen.fields[2].value.f, 5130.12345, 1e-3);
+    CHECK(pubx_seen.fields[3].value.c == 'N');
+    CHECK(pubx_seen.fields[4].present && pubx_seen.fields[4].value.u == 0);
+    CHECK(pubx_seen.fields[5].value.c == 'W');
+    CHECK_NEAR(pubx_seen.fields[6].value.f, -12.5, 1e-6);
+    CHECK(pubx_seen.fields[8].value.u == 0x1f);
+    /* Past the end of the sentence */
+    CHECK(!pubx_seen.fields[9].present);
+
+    /* Empty fields, text with spaces, any talker */
+    CHECK(feed(&table, "GNTXT,01,01,,ANTENNA OPEN") == 1);
+    CHECK(txt_seen.calls == 1);
+    CHECK(strcmp(txt_seen.address, "GNTXT") == 0);
+    CHECK(txt_seen.fields[0].value.i == 1);
+    CHECK(!txt_seen.fields[2].present);
+    CHECK(strcmp(txt_seen.text, "ANTENNA OPEN") == 0);
+
+    /* More fields than the parser keeps: the rest are dropped, not overrun */
+    char body[160] = "GPTXT";
+    for (int i = 0; i < CONFIG_NMEA_PARSER_MAX_FIELDS + 5; i++) {
+        strcat(body, ",7");
+    }
+    CHECK(feed(&table, body) == 1);
+    CHECK(txt_seen.calls == 2);
+    CHECK(txt_seen.fields[3].present);
+
+    /* Not registered, or a bad checksum: no callback */
+    CHECK(feed(&table, "PMTK001,220,3") == -1);
+    char line[] = "$PUBX,00,1*00\r\n";
+    static nmea_decoder_t dec;
+    nmea_decoder_init(&dec);
+    CHECK(nmea_decode_line(&dec, line, 1 << STATEMENT_GGA) == NMEA_DECODE_CRC_ERROR);
+    CHECK(pubx_seen.calls == 1);
+    CHECK(txt_seen.calls == 2);
+}
+
+int main(void)
+{
+    test_add();
+    test_find();
+    test_dispatch();
+    return TEST_RESULT();
+}
@@ -0,0 +1,156 @@
+/* Tests of the statement enable and require masks
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include "nmea_decode.h"
+#include "test.h"
+
+#define BIT(statement) (1u << (statement))
+
+/* One epoch from a receiver with its default sentences, checksums filled in by make_line() */
+static const char *const epoch[] = {
+    "GPGGA,123456.00,5130.00000,N,00006.00000,W,1,09,1.0,12.3,M,47.0,M,,",
+    "GPGSA,A,3,02,05,07,09,13,15,18,20,23,,,,1.8,1.0,1.5",
+    "GPRMC,123456.00,A,5130.00000,N,00006.00000,W,0.5,90.0,010524,,,A",
+    "GPGSV,3,1,09,02,45,123,41,05,30,045,38,07,62,300,44,09,12,210,30",
+    "GPGSV,3,2,09,13,55,090,42,15,20,150,35,18,70,010,45,20,08,330,28",
+    "GPGSV,3,3,09,23,40,260,40",
+    "GPGLL,5130.00000,N,00006.00000,W,123456.00,A,A",
+    "GPVTG,90.0,T,,M,0.5,N,0.9,K,A",
+    "GPZDA,123456.00,01,05,2024,00,00",
+};
+
+#define EPOCH_LINES (sizeof(epoch) / sizeof(epoch[0]))
+
+static void make_line(char *line, size_t size, const char *body)
+{
+    uint8_t crc = 0;
+    for (const char *p = body; *p; p++) {
+        crc ^= (uint8_t)*p;
+    }
+    snprintf(line, size, "$%s*%02X\r\n", body, crc);
+}
+
+/**
+ * @brief Run epochs through the filter the parser applies after the header, then the decoder
+ *
+ * @param rejected filled with the lines dropped at the header
+ * @return int updates
+ */
+static int run_epochs(int epochs, uint32_t enabled, uint32_t required, int *rejected)
+{
+    static nmea_decoder_t dec;
+    char line[128];
+    int updates = 0;
+
+    nmea_decoder_init(&dec);
+    *rejected = 0;
+    for (int e = 0; e < epochs; e++) {
+        for (size_t i = 0; i < EPOCH_LINES; i++) {
+            make_line(line, sizeof(line), epoch[i]);
+            if (!(enabled & BIT(nmea_decode_header(line)))) {
+                (*rejected)++;
+                continue;
+            }
+            if (nmea_decode_line(&dec, line, required) == NMEA_DECODE_UPDATE) {
+                updates++;
+                CHECK(!(enabled & BIT(STATEMENT_GGA)) || dec.gps.latitude_e7 == 515000000);
+            }
+        }
+    }
+    return updates;
+}
+
+/**
+ * @brief Lists of names as /api/nmea takes them
+ *
+ */
+static void test_parse(void)
+{
+    uint32_t mask = 0;
+
+    CHECK(nmea_statement_mask_parse("gga,rmc", &mask));
+    CHECK(mask == (BIT(STATEMENT_GGA) | BIT(STATEMENT_RMC)));
+    CHECK(nmea_statement_mask_parse("GSV,Vtg,unknown", &mask));
+    CHECK(mask == (BIT(STATEMENT_GSV) | BIT(STATEMENT_VTG) | BIT(STATEMENT_UNKNOWN)));
+    CHECK(nmea_statement_mask_parse("dtm", &mask));
+    CHECK(mask == BIT(STATEMENT_DTM));
+
+    /* Refused, the mask is left as it was */
+    CHECK(!nmea_statement_mask_parse("", &mask));
+    CHECK(!nmea_statement_mask_parse(",", &mask));
+    CHECK(!nmea_statement_mask_parse("gga,", &mask));
+    CHECK(!nmea_statement_mask_parse(",gga", &mask));
+    CHECK(!nmea_statement_mask_parse("gga,,rmc", &mask));
+    CHECK(!nmea_statement_mask_parse("ggax", &mask));
+    CHECK(!nmea_statement_mask_parse("gg", &mask));
+    CHECK(!nmea_statement_mask_parse("gga rmc", &mask));
+    CHECK(mask == BIT(STATEMENT_DTM));
+}
+
+/**
+ * @brief Settings the parser refuses
+ *
+ */
+static void test_valid(void)
+{
+    const uint32_t built = BIT(STATEMENT_GGA) | BIT(STATEMENT_RMC) | BIT(STATEMENT_VTG);
+    const uint32_t required = BIT(STATEMENT_GGA) | BIT(STATEMENT_RMC);
+
+    CHECK(nmea_statement_masks_valid(built, built, required));
+    CHECK(nmea_statement_masks_valid(built, built | BIT(STATEMENT_UNKNOWN), required));
+    /* Not compiled in */
+    CHECK(!nmea_statement_masks_valid(built, built | BIT(STATEMENT_GSV), required));
+    /* Required but dropped */
+    CHECK(!nmea_statement_masks_valid(built, BIT(STATEMENT_GGA), required));
+    /* Unknown statements never complete an epoch */
+    CHECK(!nmea_statement_masks_valid(built, built | BIT(STATEMENT_UNKNOWN), required | BIT(STATEMENT_UNKNOWN)));
+    /* Nothing required, every statement would be an update */
+    CHECK(!nmea_statement_masks_valid(built, built, 0));
+    CHECK(!nmea_statement_masks_valid(built, 0, 0));
+}
+
+/**
+ * @brief Disabled statements are dropped at the header and each epoch still gives one update
+ *
+ */
+static void test_filter(void)
+{
+    uint32_t all = 0, enabled = 0, required = 0;
+    int rejected;
+
+    CHECK(nmea_statement_mask_parse("gga,gsa,rmc,gsv,gll,vtg,zda", &all));
+    CHECK(nmea_statement_mask_parse("gga,gsa,rmc,gsv,gll,vtg", &required));
+    CHECK(run_epochs(10, all, required, &rejected) == 10);
+    CHECK(rejected == 0);
+
+    CHECK(nmea_statement_mask_parse("gga,rmc,vtg", &enabled));
+    CHECK(nmea_statement_mask_parse("gga,rmc", &required));
+    CHECK(nmea_statement_masks_valid(all, enabled, required));
+    CHECK(run_epochs(10, enabled, required, &rejected) == 10);
+    CHECK(rejected == 10 * 6);
+
+    /* The GSV group only counts once all of it is in */
+    CHECK(nmea_statement_mask_parse("gsv", &enabled));
+    CHECK(run_epochs(10, enabled, enabled, &rejected) == 10);
+    CHECK(rejected == 10 * 6);
+
+    /* What an empty require= used to do: an update per statement, hence refused */
+    CHECK(nmea_statement_mask_parse("gga,rmc,vtg", &enabled));
+    CHECK(!nmea_statement_masks_valid(all, enabled, 0));
+    CHECK(run_epochs(10, enabled, 0, &rejected) == 30);
+}
+
+int main(void)
+{
+    test_parse();
+    test_valid();
+    test_filter();
+    return TEST_RESULT();
+}
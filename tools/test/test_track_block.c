@@ -0,0 +1,173 @@
+/* Tests of the track log block coding
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include "track_block.h"
+#include "col_file.h"
+#include "test.h"
+
+static bool same_point(const track_point_t *a, const track_point_t *b)
+{
+    return a->t_ms == b->t_ms && a->lat_e7 == b->lat_e7 && a->lon_e7 == b->lon_e7 && a->heading == b->heading &&
+           a->port == b->port && a->stbd == b->stbd;
+}
+
+/**
+ * @brief Fill blocks the way the firmware does and check each decodes to the points put in
+ *
+ * A point goes into the current block as a delta while one fits, otherwise it starts the next block.
+ *
+ * @return int blocks used
+ */
+static int check_points(const track_point_t *points, int count)
+{
+    track_block_t block;
+    track_point_t point;
+    uint8_t tmp[TRACK_LOG_POINT_MAX];
+    int blocks = 0;
+    int start = 0;
+
+    while (start < count) {
+        int i = start + 1;
+        memset(&block, 0, sizeof(block));
+        block.header.magic = TRACK_LOG_MAGIC;
+        block.header.t_ms = points[start].t_ms;
+        block.header.lat_e7 = points[start].lat_e7;
+        block.header.lon_e7 = points[start].lon_e7;
+        block.header.heading = points[start].heading;
+        block.header.port = points[start].port;
+        block.header.stbd = points[start].stbd;
+        block.header.count = 1;
+        for (; i < count; i++) {
+            size_t n = track_block_delta(&points[i - 1], &points[i], tmp);
+            CHECK(n <= TRACK_LOG_POINT_MAX);
+            if (n == 0) {
+                break;
+            }
+            if (block.header.len + n > TRACK_LOG_DATA_MAX) {
+                /* Only a nearly full block is closed for lack of room */
+                CHECK(block.header.len > TRACK_LOG_DATA_MAX - TRACK_LOG_POINT_MAX);
+                break;
+            }
+            memcpy(block.bytes + sizeof(track_block_header_t) + block.header.len, tmp, n);
+            block.header.len += n;
+            block.header.count++;
+        }
+
+        const uint8_t *p = block.bytes + sizeof(track_block_header_t);
+        const uint8_t *end = p + block.header.len;
+        track_block_first(&block.header, &point);
+        for (int j = start; j < i; j++) {
+            if (j > start) {
+                CHECK(track_block_next(&p, end, &point));
+            }
+            CHECK(same_point(&point, &points[j]));
+        }
+        CHECK(p == end);
+        /* A delta cut short is not applied: the last point is lost, the ones before are intact */
+        if (block.header.len > 0) {
+            int decoded = start + 1;
+            p = block.bytes + sizeof(track_block_header_t);
+            track_block_first(&block.header, &point);
+            while (track_block_next(&p, end - 1, &point)) {
+                CHECK(same_point(&point, &points[decoded]));
+                decoded++;
+            }
+            CHECK(decoded == i - 1);
+        }
+        blocks++;
+        start = i;
+    }
+    return blocks;
+}
+
+/**
+ * @brief A boat wandering at 1 Hz: small deltas, a few bytes per point
+ *
+ */
+static void test_random_walk(void)
+{
+    static track_point_t points[4000];
+    uint32_t seed = 7;
+    track_point_t point = { .t_ms = 1700000000000, .lat_e7 = 517000000, .lon_e7 = -1200000 };
+
+    for (int i = 0; i < 4000; i++) {
+        seed = seed * 1103515245 + 12345;
+        point.t_ms += 1000 + (seed >> 16) % 50;
+        point.lat_e7 += (int32_t)((seed >> 8) % 201) - 100;
+        point.lon_e7 += (int32_t)((seed >> 12) % 301) - 150;
+        point.heading = (seed >> 4) % 3600;
+        point.port = (seed >> 20) % 101;
+        point.stbd = (seed >> 24) % 101;
+        points[i] = point;
+    }
+    /* No breaks, so blocks fill up: 472 data bytes at 9 to 12 bytes a point */
+    int blocks = check_points(points, 4000);
+    CHECK(blocks >= 4000 / (int)(TRACK_LOG_DATA_MAX / 9) && blocks <= 4000 / (int)(TRACK_LOG_DATA_MAX / 12) + 1);
+}
+
+/**
+ * @brief Time going back and jumps too far for a delta start a new block
+ *
+ */
+static void test_breaks(void)
+{
+    const track_point_t points[] = {
+        { 1000, 100000000, 200000000, 10, 0, 0 },
+        { 2000, 100000010, 200000010, 20, 50, 50 },
+        { 1500, 100000020, 200000020, 30, 50, 50 },             /* time backwards */
+        { 2500, 100000030, 200000030, 40, 50, 50 },
+        { 3500, -900000000, -1800000000, 50, 0, 100 },          /* across the world, dlon below INT32_MIN */
+        { 4500, 900000000, 1800000000, 3599, 100, 0 },          /* and back */
+        { 4500LL + UINT32_MAX + 1, 900000000, 1800000000, 0, 0, 0 },   /* gap longer than 49 days */
+        { 4500LL + UINT32_MAX + 2, 900000000, 1800000000, 0, 0, 0 },
+    };
+    uint8_t tmp[TRACK_LOG_POINT_MAX];
+
+    CHECK(track_block_delta(&points[1], &points[2], tmp) == 0);
+    CHECK(track_block_delta(&points[3], &points[4], tmp) > 0);
+    CHECK(track_block_delta(&points[4], &points[5], tmp) == 0);
+    CHECK(track_block_delta(&points[5], &points[6], tmp) == 0);
+    CHECK(check_points(points, sizeof(points) / sizeof(points[0])) == 4);
+}
+
+/**
+ * @brief The largest deltas fit TRACK_LOG_POINT_MAX and decode back
+ *
+ */
+static void test_extremes(void)
+{
+    const track_point_t a = { 0, 0, 0, 0, 0, 255 };
+    const track_point_t b = { UINT32_MAX, INT32_MAX, INT32_MIN, UINT16_MAX, 255, 0 };
+    const track_point_t points[] = { a, b, a };
+    uint8_t tmp[TRACK_LOG_POINT_MAX];
+
+    /* 5 + 5 + 5 + 3 + 2 + 2, the duties fit two bytes */
+    CHECK(track_block_delta(&a, &b, tmp) == 22);
+    CHECK(check_points(points, 3) == 2);
+}
+
+/**
+ * @brief The host tools check blocks with the same CRC as esp_rom_crc32_le()
+ *
+ */
+static void test_crc(void)
+{
+    CHECK(col_crc32(0, "123456789", 9) == 0xcbf43926);
+    CHECK(col_crc32(col_crc32(0, "1234", 4), "56789", 5) == 0xcbf43926);
+}
+
+int main(void)
+{
+    test_random_walk();
+    test_breaks();
+    test_extremes();
+    test_crc();
+    return TEST_RESULT();
+}
@@ -0,0 +1,235 @@
+/* Tests of the UBX frame decoder and NAV-PVT conversion
+
+   This example code is in the Public Domain (or CC0 licensed, at your option.)
+
+   Unless required by applicable law or agreed to in writing, this
+   software is distributed on an "AS IS" BASIS, WITHOUT WARRANTIES OR
+   CONDITIONS OF ANY KIND, either express or implied.
+*/
+
+#include <string.h>
+#include "ubx.h"
+#include "test.h"
+
+static void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = v & 0xff;
+    p[1] = v >> 8;
+}
+
+static void put_i32(uint8_t *p, int32_t v)
+{
+    uint32_t u = (uint32_t)v;
+    for (int i = 0; i < 4; i++) {
+        p[i] = (u >> (8 * i)) & 0xff;
+    }
+}
+
+/**
+ * @brief A NAV-PVT payload for a 3D fix at 2024-05-01 12:34:56.789
+ *
+ */
+static void make_pvt(uint8_t *payload, int32_t lat_e7, int32_t lon_e7, int32_t nano)
+{
+    memset(payload, 0, UBX_NAV_PVT_LEN);
+    put_u16(payload + 4, 2024);
+    payload[6] = 5;
+    payload[7] = 1;
+    payload[8] = 12;
+    payload[9] = 34;
+    payload[10] = 56;
+    payload[11] = 0x03;                 /* date and time valid */
+    put_i32(payload + 16, nano);
+    payload[20] = 3;                    /* 3D */
+    payload[21] = 0x01;                 /* gnssFixOK */
+    payload[23] = 11;
+    put_i32(payload + 24, lon_e7);
+    put_i32(payload + 28, lat_e7);
+    put_i32(payload + 36, 12345);       /* hMSL, mm */
+    put_i32(payload + 60, 2500);        /* gSpeed, mm/s */
+    put_i32(payload + 64, 27012345);    /* headMot, 1e-5 deg */
+    put_u16(payload + 76, 142);         /* pDOP, 0.01 */
+}
+
+/**
+ * @brief Feed bytes to the decoder
+ *
+ * @return int bytes that were not part of a frame, the result for the last byte in last
+ */
+static int feed(ubx_decoder_t *dec, const uint8_t *data, size_t len, ubx_result_t *last)
+{
+    int other = 0;
+    for (size_t i = 0; i < len; i++) {
+        *last = ubx_decode_byte(dec, data[i]);
+        other += *last == UBX_NOT_FRAME;
+        /* Only the last byte of a frame ends it */
+        if (i + 1 < len && *last != UBX_NOT_FRAME) {
+            CHECK(*last == UBX_MORE);
+        }
+    }
+    return other;
+}
+
+/**
+ * @brief Frames built by ubx_build_frame match ones taken from the u-blox interface description
+ *
+ */
+static void test_build(void)
+{
+    static const uint8_t mon_ver_poll[] = { 0xb5, 0x62, 0x0a, 0x04, 0x00, 0x00, 0x0e, 0x34 };
+    static const uint8_t cfg_prt_poll[] = { 0xb5, 0x62, 0x06, 0x00, 0x00, 0x00, 0x06, 0x18 };
+    uint8_t out[16];
+
+    CHECK(ubx_build_frame(0x0a, 0x04, NULL, 0, out) == sizeof(mon_ver_poll));
+    CHECK(memcmp(out, mon_ver_poll, sizeof(mon_ver_poll)) == 0);
+    CHECK(ubx_build_frame(UBX_CLASS_CFG, 0x00, NULL, 0, out) == sizeof(cfg_prt_poll));
+    CHECK(memcmp(out, cfg_prt_poll, sizeof(cfg_prt_poll)) == 0);
+}
+
+/**
+ * @brief A NAV-PVT frame between NMEA lines comes out whole, the NMEA bytes are handed back
+ *
+ */
+static void test_nav_pvt(void)
+{
+    static const char nmea[] = "$GPGGA,123456.00,5130.0000,N,00006.0000,W,1,11,0.9,12.3,M,,,,*00\r\n";
+    uint8_t payload[UBX_NAV_PVT_LEN];
+    uint8_t frame[UBX_NAV_PVT_LEN + 8];
+    ubx_decoder_t dec;
+    ubx_result_t res;
+    gps_t gps;
+
+    make_pvt(payload, 515000123, -1000456, 789000000);
+    size_t len = ubx_build_frame(UBX_CLASS_NAV, UBX_ID_NAV_PVT, payload, UBX_NAV_PVT_LEN, frame);
+    CHECK(len == UBX_NAV_PVT_LEN + 8);
+
+    ubx_decoder_reset(&dec);
+    CHECK(feed(&dec, (const uint8_t *)nmea, strlen(nmea), &res) == (int)strlen(nmea));
+    CHECK(feed(&dec, frame, len, &res) == 0);
+    CHECK(res == UBX_FRAME);
+    CHECK(!ubx_decoder_busy(&dec));
+    CHECK(dec.cls == UBX_CLASS_NAV && dec.id == UBX_ID_NAV_PVT && dec.len == UBX_NAV_PVT_LEN);
+    CHECK(feed(&dec, (const uint8_t *)nmea, strlen(nmea), &res) == (int)strlen(nmea));
+
+    memset(&gps, 0, sizeof(gps));
+    CHECK(ubx_nav_pvt_to_gps(dec.payload, dec.len, &gps));
+    CHECK(gps.valid);
+    CHECK(gps.fix == GPS_FIX_GPS);
+    CHECK(gps.fix_mode == GPS_MODE_3D);
+    CHECK(gps.latitude_e7 == 515000123);
+    CHECK(gps.longitude_e7 == -1000456);
+    CHECK_NEAR(gps.latitude, 51.5000123, 1e-5);
+    CHECK(gps.sats_in_use == 11);
+    CHECK_NEAR(gps.altitude, 12.345, 1e-4);
+    CHECK_NEAR(gps.speed, 2.5, 1e-6);
+    CHECK_NEAR(gps.cog, 270.12345, 1e-4);
+    CHECK_NEAR(gps.dop_p, 1.42, 1e-5);
+    CHECK(gps.dop_h == gps.dop_p);
+    CHECK(gps.date.year == 24 && gps.date.month == 5 && gps.date.day == 1);
+    CHECK(gps.tim.hour == 12 && gps.tim.minute == 34 && gps.tim.second == 56 && gps.tim.thousand == 789);
+
+    /* Wrong length is not NAV-PVT */
+    CHECK(!ubx_nav_pvt_to_gps(dec.payload, UBX_NAV_PVT_LEN - 1, &gps));
+}
+
+/**
+ * @brief Without a fix the position is left alone, a negative fraction doesn't wrap the milliseconds
+ *
+ */
+static void test_no_fix(void)
+{
+    uint8_t payload[UBX_NAV_PVT_LEN];
+    gps_t gps;
+
+    make_pvt(payload, 0, 0, -500);
+    payload[20] = 0;
+    payload[21] = 0;
+    memset(&gps, 0, sizeof(gps));
+    gps.latitude_e7 = 1;
+    gps.longitude_e7 = 2;
+    CHECK(ubx_nav_pvt_to_gps(payload, UBX_NAV_PVT_LEN, &gps));
+    CHECK(!gps.valid);
+    CHECK(gps.fix == GPS_FIX_INVALID);
+    CHECK(gps.fix_mode == GPS_MODE_INVALID);
+    CHECK(gps.latitude_e7 == 1 && gps.longitude_e7 == 2);
+    CHECK(gps.tim.thousand == 0);
+
+    /* A fix type of 3D without gnssFixOK is not a fix either */
+    make_pvt(payload, 10, 20, 0);
+    payload[21] = 0;
+    CHECK(ubx_nav_pvt_to_gps(payload, UBX_NAV_PVT_LEN, &gps));
+    CHECK(!gps.valid);
+    CHECK(gps.latitude_e7 == 1);
+
+    /* Differential */
+    payload[21] = 0x03;
+    CHECK(ubx_nav_pvt_to_gps(payload, UBX_NAV_PVT_LEN, &gps));
+    CHECK(gps.fix == GPS_FIX_DGPS);
+    CHECK(gps.latitude_e7 == 10 && gps.longitude_e7 == 20);
+}
+
+/**
+ * @brief Broken frames are reported and the decoder picks up the next one
+ *
+ */
+static void test_errors(void)
+{
+    static uint8_t big[UBX_MAX_PAYLOAD + 50];
+    uint8_t frame[sizeof(big) + 8];
+    uint8_t ack[2] = { UBX_CLASS_CFG, 0x08 };
+    ubx_decoder_t dec;
+    ubx_result_t res;
+
+    ubx_decoder_reset(&dec);
+
+    /* Bad checksum, first and second byte */
+    size_t len = ubx_build_frame(UBX_CLASS_ACK, UBX_ID_ACK_ACK, ack, 2, frame);
+    frame[len - 2] ^= 1;
+    feed(&dec, frame, len - 1, &res);
+    CHECK(res == UBX_BAD_CHECKSUM);
+    /* The byte after a failed CK_A is not in a frame */
+    CHECK(ubx_decode_byte(&dec, frame[len - 1]) == UBX_NOT_FRAME);
+    frame[len - 2] ^= 1;
+    frame[len - 1] ^= 1;
+    feed(&dec, frame, len, &res);
+    CHECK(res == UBX_BAD_CHECKSUM);
+
+    /* Too long to keep, followed to its end so the next frame is found */
+    for (size_t i = 0; i < sizeof(big); i++) {
+        big[i] = UBX_SYNC_1;
+    }
+    len = ubx_build_frame(UBX_CLASS_NAV, 0x35, big, sizeof(big), frame);
+    feed(&dec, frame, len, &res);
+    CHECK(res == UBX_TOO_LONG);
+    len = ubx_build_frame(UBX_CLASS_ACK, UBX_ID_ACK_NAK, ack, 2, frame);
+    feed(&dec, frame, len, &res);
+    CHECK(res == UBX_FRAME);
+    CHECK(dec.cls == UBX_CLASS_ACK && dec.id == UBX_ID_ACK_NAK);
+    CHECK(dec.payload[0] == UBX_CLASS_CFG && dec.payload[1] == 0x08);
+
+    /* Repeated first sync characters still find the frame */
+    CHECK(ubx_decode_byte(&dec, UBX_SYNC_1) == UBX_MORE);
+    CHECK(ubx_decode_byte(&dec, UBX_SYNC_1) == UBX_MORE);
+    feed(&dec, frame + 1, len - 1, &res);
+    CHECK(res == UBX_FRAME);
+
+    /* A lone first sync character gives back the byte after it */
+    CHECK(ubx_decode_byte(&dec, UBX_SYNC_1) == UBX_MORE);
+    CHECK(ubx_decode_byte(&dec, '$') == UBX_NOT_FRAME);
+    CHECK(!ubx_decoder_busy(&dec));
+
+    /* An empty payload */
+    len = ubx_build_frame(0x0a, 0x04, NULL, 0, frame);
+    feed(&dec, frame, len, &res);
+    CHECK(res == UBX_FRAME);
+    CHECK(dec.len == 0);
+}
+
+int main(void)
+{
+    test_build();
+    test_nav_pvt();
+    test_no_fix();
+    test_errors();
+    return TEST_RESULT();
+}